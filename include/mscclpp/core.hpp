@@ -466,12 +466,30 @@ struct EndpointConfig {
   static const int DefaultMaxCqPollNum = 1;
   static const int DefaultMaxSendWr = 8192;
   static const int DefaultMaxWrPerSend = 64;
+  /// Prefer the network interfaces on the NUMA node of the current GPU, if there is one.
+  static const int NumaNodeAuto = -1;
+  /// Prefer no network interface over another.
+  static const int NumaNodeAny = -2;
 
   Transport transport;
   int ibMaxCqSize = DefaultMaxCqSize;
   int ibMaxCqPollNum = DefaultMaxCqPollNum;
   int ibMaxSendWr = DefaultMaxSendWr;
   int ibMaxWrPerSend = DefaultMaxWrPerSend;
+  /// The network interfaces an Ethernet endpoint may listen on, in the format of `MSCCLPP_SOCKET_IFNAME`, e.g.
+  /// "eth0,eth1" for interfaces whose names start with either, "=eth0" for an exact name, or "^docker" to exclude.
+  /// If empty, `MSCCLPP_SOCKET_IFNAME` applies, or the interfaces are detected.
+  std::string ethInterfaces;
+  /// The NUMA node whose network interfaces an Ethernet endpoint prefers, or @ref NumaNodeAuto or @ref NumaNodeAny.
+  /// Endpoints of a context are spread round-robin over the interfaces with a physical device on this node, or else
+  /// over those with a physical device among the ones named by @ref ethInterfaces or `MSCCLPP_SOCKET_IFNAME`.
+  /// Otherwise, they all listen on the first interface found.
+  int numaNode = NumaNodeAuto;
+  /// Defer establishing the connections of this endpoint to their first use, which is typically from the proxy
+  /// thread. Over Ethernet, the sending socket is connected on the first send, the receiving socket is accepted when
+  /// the peer connects, and a connection is lazy if either of its endpoints is. Over IB, the QP is still created and
+  /// made ready to receive at once; only making it ready to send waits for the first send.
+  bool lazy = false;
 
   /// Default constructor. Sets transport to Transport::Unknown.
   EndpointConfig() : transport(Transport::Unknown) {}
@@ -651,10 +669,11 @@ class Communicator {
   /// Connect to a remote rank on setup.
   ///
   /// This function only prepares metadata for connection. The actual connection is made by a following call of
-  /// @ref setup(). Note that this function is two-way and a connection from rank `i` to remote rank `j` needs
-  /// to have a counterpart from rank `j` to rank `i`. Note that with IB, buffers are registered at a page level and if
-  /// a buffer is spread through multiple pages and do not fully utilize all of them, IB's QP has to register for all
-  /// involved pages. This potentially has security risks if the connection's accesses are given to a malicious process.
+  /// @ref setup(), or on first use if `localConfig.lazy` is set. Note that this function is two-way and a connection
+  /// from rank `i` to remote rank `j` needs to have a counterpart from rank `j` to rank `i`. Note that with IB, buffers
+  /// are registered at a page level and if a buffer is spread through multiple pages and do not fully utilize all of
+  /// them, IB's QP has to register for all involved pages. This potentially has security risks if the connection's
+  /// accesses are given to a malicious process.
   ///
   /// @param remoteRank The rank of the remote process.
   /// @param tag The tag of the connection for identifying it.
@@ -693,6 +712,8 @@ class Communicator {
 
   // Pointer to the internal implementation.
   std::unique_ptr<Impl> pimpl_;
+
+  friend class SemaphorePool;
 };
 
 /// A constant TransportFlags object representing no transports.
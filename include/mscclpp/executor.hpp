@@ -4,9 +4,12 @@
 #ifndef MSCCLPP_EXECUTOR_HPP_
 #define MSCCLPP_EXECUTOR_HPP_
 
+#include <future>
 #include <memory>
 #include <mscclpp/core.hpp>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace mscclpp {
 
@@ -35,6 +38,36 @@ class ExecutionPlan {
   friend class Executor;
 };
 
+/// Durations of one phase of @ref Executor::execute() calls, in microseconds.
+struct ExecutionPhaseStats {
+  uint64_t count = 0;
+  double totalUs = 0;
+  double minUs = 0;
+  double maxUs = 0;
+
+  double meanUs() const { return count > 0 ? totalUs / count : 0; }
+};
+
+/// Latency breakdown of the @ref Executor::execute() calls with the same execution plan and message size.
+struct ExecutionProfile {
+  std::string planName;
+  /// The larger of the input and output message sizes of the executions in bytes, which is the size that collective
+  /// benchmarks report.
+  size_t messageSize = 0;
+  /// Looking up the cached execution context.
+  ExecutionPhaseStats lookup;
+  /// Deriving the operations for the message size from the plan. Includes setting up connections, memories and
+  /// channels when no execution context is cached yet.
+  ExecutionPhaseStats planLoad;
+  /// Uploading the operations to the device.
+  ExecutionPhaseStats upload;
+  /// Launching the kernel.
+  ExecutionPhaseStats launch;
+  /// Running the kernel on the device, measured with events recorded on the stream. Executions on a capturing stream
+  /// are not measured.
+  ExecutionPhaseStats device;
+};
+
 class Executor {
  public:
   Executor(std::shared_ptr<Communicator> comm);
@@ -45,6 +78,37 @@ class Executor {
   void execute(int rank, void* sendbuff, void* recvBuff, size_t sendBuffSize, size_t recvBuffSize, DataType dataType,
                const ExecutionPlan& plan, cudaStream_t stream, PacketType packetType = PacketType::LL16);
 
+  /// Sets up the connections, memories and channels for executing a plan on the given buffers without launching it,
+  /// so that the first @ref execute() with the same buffers and plan does not pay for the setup. Like the first
+  /// execution, the setup is collective: all ranks of the plan have to set up the same plan.
+  ///
+  /// @param rank The rank of this process.
+  /// @param sendbuff The send buffer.
+  /// @param recvBuff The receive buffer.
+  /// @param sendBuffSize The size of the send buffer in bytes.
+  /// @param recvBuffSize The size of the receive buffer in bytes.
+  /// @param plan The execution plan.
+  void setup(int rank, void* sendbuff, void* recvBuff, size_t sendBuffSize, size_t recvBuffSize,
+             const ExecutionPlan& plan);
+
+  /// Runs @ref setup() on a background thread with the current device of the calling thread. Calls of
+  /// @ref execute() wait for the setup to finish. The @ref Executor must outlive the setup.
+  ///
+  /// @return A future that becomes ready when the setup finishes, and rethrows any error of the setup.
+  std::shared_future<void> setupAsync(int rank, void* sendbuff, void* recvBuff, size_t sendBuffSize,
+                                      size_t recvBuffSize, const ExecutionPlan& plan);
+
+  /// Enables or disables profiling of @ref execute() calls. Profiling adds timestamps on the host and a pair of events
+  /// on the stream to every execution.
+  void setProfiling(bool enable);
+
+  /// Returns the profiles collected so far, one per execution plan and message size. Waits for the device timings of
+  /// executions still in flight.
+  std::vector<ExecutionProfile> getProfiles();
+
+  /// Discards the profiles collected so far.
+  void resetProfiles();
+
  private:
   struct Impl;
   std::unique_ptr<Impl> impl_;
@@ -18,29 +18,36 @@ constexpr size_t DEFAULT_FIFO_SIZE = 128;
 class Fifo {
  public:
   /// Constructs a new @ref Fifo object.
-  /// @param size The number of entires in the FIFO.
-  Fifo(int size = DEFAULT_FIFO_SIZE);
+  /// @param size The number of entires in each lane of the FIFO.
+  /// @param numLanes The number of lanes, see @ref FifoDeviceHandle.
+  Fifo(int size = DEFAULT_FIFO_SIZE, int numLanes = 1);
 
   /// Destroys the @ref Fifo object.
   ~Fifo();
 
-  /// Polls the FIFO for a trigger.
+  /// Polls a lane of the FIFO for a trigger.
   ///
-  /// Returns @ref ProxyTrigger which is the trigger at the head of fifo.
-  ProxyTrigger poll();
+  /// @param lane The lane to poll.
+  /// Returns @ref ProxyTrigger which is the trigger at the head of the lane.
+  ProxyTrigger poll(int lane = 0);
 
-  /// Pops a trigger from the FIFO.
-  void pop();
+  /// Pops a trigger from a lane of the FIFO.
+  /// @param lane The lane to pop from.
+  void pop(int lane = 0);
 
-  /// Flushes the tail of the FIFO.
+  /// Flushes the tails of all lanes of the FIFO.
   ///
   /// @param sync If true, waits for the flush to complete before returning.
   void flushTail(bool sync = false);
 
   /// Return the FIFO size.
-  /// @return The FIFO size.
+  /// @return The FIFO size of each lane.
   int size() const;
 
+  /// Return the number of lanes.
+  /// @return The number of lanes.
+  int numLanes() const;
+
   /// Returns a @ref FifoDeviceHandle object representing the device FIFO.
   ///
   /// @return A @ref FifoDeviceHandle object representing the device FIFO.
@@ -25,8 +25,12 @@ struct alignas(16) ProxyTrigger {
   uint64_t fst, snd;
 };
 
-/// A concurrent FIFO where multiple device threads (the number of threads should not exceed the fifo size) can push
-/// work elements and a single host proxy thread consumes them.
+/// Distance in 64-bit words between the heads of adjacent lanes of a FIFO, so that each head is in its own 128-byte
+/// line and pushes to different lanes do not contend.
+constexpr int FifoLaneStride = 16;
+
+/// A concurrent FIFO where multiple device threads (the number of threads should not exceed the fifo size, or half of
+/// it for threads that push pairs of triggers) can push work elements and a single host proxy thread consumes them.
 ///
 /// The FIFO has a head pointer allocated on the device which starts at 0 and goes up to 2^64-1, which is almost
 /// infinity. There are two copies of the tail, one on the device, @ref FifoDeviceHandle::tailReplica, and another on
@@ -38,6 +42,11 @@ struct alignas(16) ProxyTrigger {
 /// Duplicating the tail is a good idea because the FIFO is large enough, and we do not need frequent updates for the
 /// tail as there is usually enough space for device threads to push their work into.
 ///
+/// The FIFO may be partitioned into @ref numLanes lanes, each being a ring of @ref size entries with its own head and
+/// tail. A thread block always pushes to the same lane, `blockIdx.x % numLanes`, so that blocks do not contend on a
+/// single head and a full lane does not block the others. Triggers of a thread block are handled in the order they
+/// are pushed, but there is no order between the triggers of thread blocks on different lanes.
+///
 struct FifoDeviceHandle {
 #if defined(MSCCLPP_DEVICE_COMPILE)
   /// Push a trigger to the FIFO.
@@ -46,7 +55,51 @@ struct FifoDeviceHandle {
   /// @param maxSpinCount The maximum number of spin counts before asserting. Never assert if negative.
   /// @return The new head of the FIFO.
   MSCCLPP_DEVICE_INLINE uint64_t push(ProxyTrigger trigger, int64_t maxSpinCount = 1000000) {
-    uint64_t curFifoHead = atomicFetchAdd(this->head, (uint64_t)1, memoryOrderRelaxed);
+    int lane = this->lane();
+    uint64_t curFifoHead = atomicFetchAdd(this->head + lane * FifoLaneStride, (uint64_t)1, memoryOrderRelaxed);
+    write(lane, curFifoHead, trigger, maxSpinCount);
+    return curFifoHead;
+  }
+
+  /// Push two triggers to consecutive entries of the FIFO, so that the proxy pops them one right after the other
+  /// regardless of other threads pushing at the same time.
+  ///
+  /// @param first The trigger to push first.
+  /// @param second The trigger to push second.
+  /// @param maxSpinCount The maximum number of spin counts before asserting. Never assert if negative.
+  /// @return The head of the FIFO where @p second is pushed to.
+  MSCCLPP_DEVICE_INLINE uint64_t push(ProxyTrigger first, ProxyTrigger second, int64_t maxSpinCount = 1000000) {
+    int lane = this->lane();
+    uint64_t curFifoHead = atomicFetchAdd(this->head + lane * FifoLaneStride, (uint64_t)2, memoryOrderRelaxed);
+    write(lane, curFifoHead, first, maxSpinCount);
+    write(lane, curFifoHead + 1, second, maxSpinCount);
+    return curFifoHead + 1;
+  }
+
+  /// Wait until there is a place in the FIFO to push a trigger.
+  ///
+  /// @param curFifoHead The current head of the FIFO, as returned by @ref push() in the same thread block.
+  /// @param maxSpinCount The maximum number of spin counts before asserting. Never assert if negative.
+  MSCCLPP_DEVICE_INLINE void sync(uint64_t curFifoHead, int64_t maxSpinCount = 1000000) {
+    int lane = this->lane();
+    uint64_t* laneTail = this->tailReplica + lane;
+    ProxyTrigger* laneTriggers = this->triggers + lane * size;
+    // Same as push but in this case checking the fist condition is probably faster since for tail to be pushed we need
+    // to wait for cudaMemcpy to be done.
+    OR_POLL_MAYBE_JAILBREAK((curFifoHead >= atomicLoad(laneTail, memoryOrderRelaxed)),
+                            (atomicLoad(&(laneTriggers[curFifoHead % size].fst), memoryOrderRelaxed) != 0),
+                            maxSpinCount);
+  }
+
+  /// Get the lane that the calling thread pushes to.
+  /// @return The lane index.
+  MSCCLPP_DEVICE_INLINE int lane() const { return (numLanes == 1) ? 0 : (int)(blockIdx.x % numLanes); }
+
+ private:
+  /// Write a trigger to an entry of a lane that is already reserved by advancing the head of the lane.
+  MSCCLPP_DEVICE_INLINE void write(int lane, uint64_t curFifoHead, ProxyTrigger trigger, int64_t maxSpinCount) {
+    uint64_t* laneTail = this->tailReplica + lane;
+    ProxyTrigger* laneTriggers = this->triggers + lane * size;
 
     // make the last bit intentionally non-zero so that we can safely poll. Don't worry, we will change it back in host
     // side
@@ -57,13 +110,13 @@ struct FifoDeviceHandle {
     // for the second condition we need to read CPU memory.
     // As atomic access is slow, we first check using the bare pointer and then use the atomic load if the
     // condition is not met.
-    if (curFifoHead >= size + *(this->tailReplica)) {
-      OR_POLL_MAYBE_JAILBREAK((curFifoHead >= size + atomicLoad(this->tailReplica, memoryOrderRelaxed)),
-                              (atomicLoad(&(this->triggers[curFifoHead % size].fst), memoryOrderRelaxed) != 0),
+    if (curFifoHead >= size + *laneTail) {
+      OR_POLL_MAYBE_JAILBREAK((curFifoHead >= size + atomicLoad(laneTail, memoryOrderRelaxed)),
+                              (atomicLoad(&(laneTriggers[curFifoHead % size].fst), memoryOrderRelaxed) != 0),
                               maxSpinCount);
     }
 
-    ProxyTrigger* triggerPtr = &(this->triggers[curFifoHead % size]);
+    ProxyTrigger* triggerPtr = &(laneTriggers[curFifoHead % size]);
 
     // There is a Write-After-Read hazard for the triggerPtr->fst. So the st instruction will not be executed
     // before the loop.
@@ -74,31 +127,22 @@ struct FifoDeviceHandle {
     atomicStore(&(triggerPtr->snd), trigger.snd, memoryOrderRelaxed);
     atomicStore(&(triggerPtr->fst), trigger.fst, memoryOrderRelaxed);
 #endif  // !defined(MSCCLPP_DEVICE_CUDA)
-
-    return curFifoHead;
   }
 
-  /// Wait until there is a place in the FIFO to push a trigger.
-  ///
-  /// @param curFifoHead The current head of the FIFO.
-  /// @param maxSpinCount The maximum number of spin counts before asserting. Never assert if negative.
-  MSCCLPP_DEVICE_INLINE void sync(uint64_t curFifoHead, int64_t maxSpinCount = 1000000) {
-    // Same as push but in this case checking the fist condition is probably faster since for tail to be pushed we need
-    // to wait for cudaMemcpy to be done.
-    OR_POLL_MAYBE_JAILBREAK((curFifoHead >= atomicLoad(this->tailReplica, memoryOrderRelaxed)),
-                            (atomicLoad(&(this->triggers[curFifoHead % size].fst), memoryOrderRelaxed) != 0),
-                            maxSpinCount);
-  }
+ public:
 #endif  // defined(MSCCLPP_DEVICE_COMPILE)
 
-  /// The FIFO buffer that is allocated on the host via `cudaHostAlloc()`.
+  /// The FIFO buffer that is allocated on the host via `cudaHostAlloc()`, @ref size entries per lane.
   ProxyTrigger* triggers;
-  /// Replica of the FIFO tail that is allocated on device.
+  /// Replica of the FIFO tail of each lane that is allocated on device.
   uint64_t* tailReplica;
-  /// The FIFO head. Allocated on the device and only accessed by the device.
+  /// The FIFO head of each lane, @ref FifoLaneStride words apart. Allocated on the device and only accessed by the
+  /// device.
   uint64_t* head;
-  /// The FIFO size.
+  /// The FIFO size of each lane.
   int size;
+  /// The number of lanes.
+  int numLanes;
 };
 
 }  // namespace mscclpp
@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_HANG_DETECTOR_HPP_
+#define MSCCLPP_HANG_DETECTOR_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "core.hpp"
+
+namespace mscclpp {
+
+/// A watchdog that detects stuck communication and reports who is waiting on whom.
+///
+/// A background thread periodically samples the state of the semaphores, proxy FIFOs, IB connections and bootstraps
+/// of this process. If some semaphore is waiting or some FIFO has pending triggers, and none of the sampled values
+/// changed for the timeout, the detector considers this rank stalled and dumps its state with a warning. Every rank
+/// reports a summary to rank 0 at each check, and rank 0 warns which stalled ranks are waiting on which ranks.
+///
+/// Constructing and destroying a @ref HangDetector is collective: the destructor of rank 0 waits until all ranks have
+/// destroyed their detectors. If that takes longer than the stall timeout plus a few seconds, the destructor warns and
+/// returns, and the bootstrap stays in use by the watchdog thread until the remaining ranks stop.
+class HangDetector {
+ public:
+  /// Constructs a new @ref HangDetector object and starts the watchdog thread.
+  ///
+  /// @param bootstrap The bootstrap to exchange summaries over. It is used by the watchdog thread while the detector is
+  /// alive, so it must not be used by any other thread meanwhile; a dedicated bootstrap is recommended.
+  /// @param timeoutSec The time without progress after which a waiting rank is considered stalled.
+  /// @param checkPeriodMs The period of sampling the state and exchanging summaries.
+  HangDetector(std::shared_ptr<Bootstrap> bootstrap, int64_t timeoutSec = 60, int64_t checkPeriodMs = 1000);
+
+  /// Stops the watchdog thread and destroys the @ref HangDetector object.
+  ~HangDetector();
+
+  /// Returns whether this rank is currently considered stalled.
+  ///
+  /// @return True if this rank has been waiting without progress for the timeout.
+  bool stalled() const;
+
+  /// Returns the state dump of this rank taken at the latest check.
+  ///
+  /// @return A human-readable dump with one line per watched object.
+  std::string report() const;
+
+ private:
+  struct Impl;
+  std::shared_ptr<Impl> pimpl_;
+};
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_HANG_DETECTOR_HPP_
@@ -0,0 +1,188 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_METRICS_HPP_
+#define MSCCLPP_METRICS_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mscclpp {
+
+/// Labels of a metric as a list of (name, value) pairs.
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+/// A monotonically increasing counter.
+///
+/// Increments go to one of several cache-line-sized shards picked by the calling thread, so that threads updating the
+/// same counter do not contend with each other.
+class Counter {
+ public:
+  /// Constructs a new @ref Counter object. Counters are usually obtained from a @ref MetricsRegistry instead.
+  Counter();
+
+  /// Destroys the @ref Counter object.
+  ~Counter();
+
+  /// Adds a value to the counter.
+  ///
+  /// @param value The value to add.
+  void add(uint64_t value = 1);
+
+  /// Returns the current value of the counter.
+  ///
+  /// @return The sum over all shards.
+  uint64_t value() const;
+
+  /// Resets the counter to zero.
+  void reset();
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> pimpl_;
+};
+
+/// A snapshot of a @ref Histogram.
+struct HistogramSnapshot {
+  /// The number of recorded values.
+  uint64_t count = 0;
+  /// The sum of recorded values.
+  uint64_t sum = 0;
+  /// The smallest recorded value, or 0 if nothing was recorded.
+  uint64_t min = 0;
+  /// The largest recorded value, or 0 if nothing was recorded.
+  uint64_t max = 0;
+  /// Inclusive upper bounds of the non-empty buckets, in increasing order.
+  std::vector<uint64_t> bucketUpperBounds;
+  /// The number of values in each of the non-empty buckets.
+  std::vector<uint64_t> bucketCounts;
+
+  /// Returns an estimate of a quantile of the recorded values.
+  ///
+  /// @param q The quantile in [0, 1].
+  /// @return The upper bound of the bucket that contains the quantile, clamped to the recorded range.
+  uint64_t quantile(double q) const;
+};
+
+/// A histogram of non-negative integer values, typically latencies in nanoseconds.
+///
+/// Values are counted in log-linear buckets as in HDR histograms: every power of two is split into
+/// @ref Histogram::SubBuckets linear buckets, so quantiles are estimated within a relative error of
+/// 1 / @ref Histogram::SubBuckets over the whole 64-bit range. Like @ref Counter, updates are sharded per thread.
+class Histogram {
+ public:
+  /// The number of linear buckets per power of two.
+  static constexpr int SubBuckets = 8;
+
+  /// Constructs a new @ref Histogram object. Histograms are usually obtained from a @ref MetricsRegistry instead.
+  Histogram();
+
+  /// Destroys the @ref Histogram object.
+  ~Histogram();
+
+  /// Records a value.
+  ///
+  /// @param value The value to record.
+  void record(uint64_t value);
+
+  /// Takes a snapshot of the histogram. Values recorded concurrently may or may not be included.
+  ///
+  /// @return A @ref HistogramSnapshot object.
+  HistogramSnapshot snapshot() const;
+
+  /// Removes all recorded values.
+  void reset();
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> pimpl_;
+};
+
+/// A registry of named metrics.
+///
+/// Metrics are identified by their name and labels. Requesting the same metric twice returns the same object, so
+/// components should look up their metrics once and keep the returned pointers for use on hot paths.
+class MetricsRegistry {
+ public:
+  /// Constructs a new empty @ref MetricsRegistry object.
+  MetricsRegistry();
+
+  /// Destroys the @ref MetricsRegistry object.
+  ~MetricsRegistry();
+
+  /// Returns the registry that the library reports its own metrics to.
+  ///
+  /// If the `MSCCLPP_METRICS_PORT` environment variable is set, a @ref MetricsHttpServer serving this registry on
+  /// 127.0.0.1 at that port is started when the registry is first used. The registry is never destroyed, so it can be
+  /// used during static destruction.
+  ///
+  /// @return The global @ref MetricsRegistry object.
+  static MetricsRegistry& global();
+
+  /// Gets or creates a counter.
+  ///
+  /// @param name The metric name, which should follow the Prometheus naming conventions.
+  /// @param help A description of the metric. Only the description given at the first registration of the name is kept.
+  /// @param labels The labels that identify the counter among the metrics of the same name.
+  /// @return A shared pointer to the @ref Counter object.
+  std::shared_ptr<Counter> counter(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+
+  /// Gets or creates a histogram.
+  ///
+  /// @param name The metric name, which should follow the Prometheus naming conventions.
+  /// @param help A description of the metric. Only the description given at the first registration of the name is kept.
+  /// @param labels The labels that identify the histogram among the metrics of the same name.
+  /// @return A shared pointer to the @ref Histogram object.
+  std::shared_ptr<Histogram> histogram(const std::string& name, const std::string& help,
+                                       const MetricLabels& labels = {});
+
+  /// Removes a counter or histogram from the registry. Holders of the metric may keep using it, but it is no longer
+  /// rendered. Removing a metric that is not registered has no effect.
+  ///
+  /// @param name The metric name.
+  /// @param labels The labels that identify the metric among the metrics of the same name.
+  void remove(const std::string& name, const MetricLabels& labels = {});
+
+  /// Renders all metrics in the Prometheus text exposition format. Histograms are rendered as summaries with
+  /// quantiles 0.5, 0.9, 0.99 and 0.999.
+  ///
+  /// @return The rendered metrics.
+  std::string prometheusText() const;
+
+  /// Resets all metrics to zero. Registered metrics stay valid.
+  void reset();
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> pimpl_;
+};
+
+/// A minimal HTTP server that serves the metrics of a @ref MetricsRegistry in the Prometheus text format.
+class MetricsHttpServer {
+ public:
+  /// Constructs a new @ref MetricsHttpServer object and starts serving in a background thread.
+  ///
+  /// @param registry The registry to serve. It must outlive the server.
+  /// @param port The port to listen on. If 0, a free port is picked.
+  /// @param address The IPv4 address to listen on.
+  MetricsHttpServer(MetricsRegistry& registry, int port, const std::string& address = "127.0.0.1");
+
+  /// Stops the server and destroys the @ref MetricsHttpServer object.
+  ~MetricsHttpServer();
+
+  /// Returns the port the server is listening on.
+  ///
+  /// @return The port.
+  int port() const;
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> pimpl_;
+};
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_METRICS_HPP_
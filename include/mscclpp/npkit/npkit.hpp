@@ -8,6 +8,7 @@
 #include <mscclpp/gpu_utils.hpp>
 #include <mscclpp/npkit/npkit_event.hpp>
 #include <mscclpp/npkit/npkit_struct.hpp>
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
@@ -26,18 +27,55 @@
 
 #define NPKIT_SHM_NUM_EVENTS 64
 
+namespace mscclpp {
+class Bootstrap;
+}  // namespace mscclpp
+
 class NpKit {
  public:
   static const uint64_t kNumGpuEventBuffers = 1024;
 
   static const uint64_t kNumCpuEventBuffers = 64;
 
-  static void Init(int rank);
+  // Event buffers are rings and their sizes must be powers of two. Only the latest events of a buffer are kept.
+  // 64K * 1024 * 16B = 1GB per GPU
+  static const uint64_t kMaxNumGpuEventsPerBuffer = 1ULL << 16;
+
+  // 256K * 64 * (16B + 4B stamp) = 320MB per CPU
+  static const uint64_t kMaxNumCpuEventsPerBuffer = 1ULL << 18;
+
+  // Initialize NpKit. If `bootstrap` is given, clocks are synchronized by SyncClocks() at the end of Init() and
+  // again at the start of Shutdown(), which makes both of them collective over `bootstrap`.
+  static void Init(int rank, std::shared_ptr<mscclpp::Bootstrap> bootstrap = nullptr);
 
   static void Dump(const std::string& dump_dir);
 
   static void Shutdown();
 
+  // Start a background thread that streams newly collected CPU and GPU events to per-rank files under `dump_dir`
+  // every `drain_interval_ms`. If `sample_period_ms` is nonzero, only the events drained during the first
+  // `sample_window_ms` of every `sample_period_ms` are written and the rest are discarded.
+  static void StartStreaming(const std::string& dump_dir, uint64_t drain_interval_ms = 100,
+                             uint64_t sample_period_ms = 0, uint64_t sample_window_ms = 0);
+
+  // Stop the streaming thread after draining all pending events.
+  static void StopStreaming();
+
+  // Number of events that were overwritten in the ring buffers before they could be drained or dumped.
+  static uint64_t GetNumDroppedEvents();
+
+  // Estimate the offset of the local CPU clock from the CPU clock of rank 0 over `bootstrap`, taking the best of
+  // `num_rounds` round trips. This is collective. Calling it both before and after a run lets ExportTrace() correct
+  // the clock drift between ranks as well. The measured offsets are dumped along with the events.
+  static void SyncClocks(std::shared_ptr<mscclpp::Bootstrap> bootstrap, int num_rounds = 16);
+
+  // Convert the events dumped by `rank` under `dump_dir` into a Chrome trace event JSON file at `trace_path`, which
+  // can be opened by chrome://tracing or Perfetto. Timestamps are in the CPU clock domain of rank 0.
+  static void ExportTrace(const std::string& dump_dir, int rank, const std::string& trace_path);
+
+  // Merge trace files written by ExportTrace() into a single trace file.
+  static void MergeTraces(const std::vector<std::string>& trace_paths, const std::string& merged_trace_path);
+
   static NpKitEventCollectContext* GetGpuEventCollectContexts();
 
 #if defined(MSCCLPP_DEVICE_COMPILE)
@@ -61,9 +99,15 @@ class NpKit {
     NpKitEventCollectContext* npKitCtx = npKitEventCollectContexts + blockIdx.x;
     NpKitEvent* global_event_buffer = npKitCtx->event_buffer;
     uint64_t global_event_buffer_head = npKitCtx->event_buffer_head;
-    for (size_t i = threadIdx.x; i < event_buffer_head * sizeof(NpKitEvent) / sizeof(int4); i += blockDim.x) {
-      ((int4*)(global_event_buffer + global_event_buffer_head))[i] = ((int4*)event_buffer)[i];
+    // The global buffer is a ring; `event_buffer_head` counts all events ever stored.
+    static_assert(sizeof(NpKitEvent) == sizeof(int4), "NpKitEvent must be the size of int4");
+    for (size_t i = threadIdx.x; i < event_buffer_head; i += blockDim.x) {
+      ((int4*)global_event_buffer)[(global_event_buffer_head + i) & (kMaxNumGpuEventsPerBuffer - 1)] =
+          ((int4*)event_buffer)[i];
     }
+    // Make the events visible to the host drainer before publishing the new head.
+    __threadfence_system();
+    __syncshm();
     if (threadIdx.x == 0) {
       npKitCtx->event_buffer_head += event_buffer_head;
     }
@@ -72,16 +116,26 @@ class NpKit {
 
   static void CollectCpuEvent(uint8_t type, uint32_t size, uint32_t rsvd, uint64_t timestamp, int channel_id);
 
+  // Collect a CPU event into the buffer of the channel set by SetCpuEventChannel() on the calling thread.
+  static void CollectCpuEvent(uint8_t type, uint32_t size, uint32_t rsvd, uint64_t timestamp);
+
+  // Set the channel that CPU events collected by the calling thread are attributed to, e.g. the proxy channel whose
+  // trigger is being handled. Channel `i` is collected into buffer `i % kNumCpuEventBuffers`.
+  static void SetCpuEventChannel(int channel_id);
+
+  // The current CPU time in the same clock domain as the CPU timestamps provided to GPU kernels.
+  static uint64_t GetCpuTimestampNow();
+
   static uint64_t* GetCpuTimestamp();
 
  private:
   static void CpuTimestampUpdateThread();
 
-  // 64K * 1024 * 16B = 1GB per GPU
-  static const uint64_t kMaxNumGpuEventsPerBuffer = 1ULL << 16;
+  static void StreamingThread();
+
+  static void DrainEvents(bool write);
 
-  // 64K * 2 (send/recv) * (1024/64) = 2M, 2M * 64 * 16B = 2GB per CPU
-  static const uint64_t kMaxNumCpuEventsPerBuffer = 1ULL << 21;
+  static void DumpClockOffsets(const std::string& dump_dir);
 
   static std::vector<mscclpp::UniqueCudaPtr<NpKitEvent>> gpu_event_buffers_;
   static std::vector<std::unique_ptr<NpKitEvent[]>> cpu_event_buffers_;
@@ -91,6 +145,15 @@ class NpKit {
 
   static uint64_t rank_;
 
+  // Offset of the local CPU clock from the CPU clock of rank 0, in nanoseconds, measured at `local_time`.
+  struct ClockOffsetSample {
+    uint64_t local_time;
+    int64_t offset;
+  };
+
+  // Offsets measured by SyncClocks() since the last Init().
+  static std::vector<ClockOffsetSample> clock_offset_samples_;
+
 #if defined(__HIP_PLATFORM_AMD__)
   static mscclpp::UniqueCudaHostPtr<uint64_t[]> cpu_timestamp_;
 #else
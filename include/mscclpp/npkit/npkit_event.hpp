@@ -15,4 +15,23 @@
 #define NPKIT_EVENT_EXECUTOR_OP_BASE_ENTRY 0x5
 #define NPKIT_EVENT_EXECUTOR_OP_BASE_EXIT 0x17
 
+// CPU events of the proxy thread. TRIGGER spans from dequeuing a trigger to popping it from the FIFO.
+#define NPKIT_EVENT_PROXY_TRIGGER_ENTRY 0x29
+#define NPKIT_EVENT_PROXY_TRIGGER_EXIT 0x2A
+#define NPKIT_EVENT_PROXY_HANDLER_ENTRY 0x2B
+#define NPKIT_EVENT_PROXY_HANDLER_EXIT 0x2C
+#define NPKIT_EVENT_PROXY_FIFO_FLUSH_TAIL_ENTRY 0x2D
+#define NPKIT_EVENT_PROXY_FIFO_FLUSH_TAIL_EXIT 0x2E
+
+// CPU events of connections. WRITE and UPDATE_AND_SYNC span until the request is posted, FLUSH spans the wait for
+// completions and IB_CQ_COMPLETION marks every batch of work completions polled from the CQ.
+#define NPKIT_EVENT_CONN_WRITE_ENTRY 0x2F
+#define NPKIT_EVENT_CONN_WRITE_EXIT 0x30
+#define NPKIT_EVENT_CONN_UPDATE_AND_SYNC_ENTRY 0x31
+#define NPKIT_EVENT_CONN_UPDATE_AND_SYNC_EXIT 0x32
+#define NPKIT_EVENT_CONN_FLUSH_ENTRY 0x33
+#define NPKIT_EVENT_CONN_FLUSH_EXIT 0x34
+#define NPKIT_EVENT_CONN_IB_CQ_COMPLETION_ENTRY 0x35
+#define NPKIT_EVENT_CONN_IB_CQ_COMPLETION_EXIT 0x36
+
 #endif
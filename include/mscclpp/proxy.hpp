@@ -4,6 +4,8 @@
 #ifndef MSCCLPP_PROXY_HPP_
 #define MSCCLPP_PROXY_HPP_
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <memory>
 
@@ -15,30 +17,117 @@ enum class ProxyHandlerResult {
   Continue,
   FlushFifoTailAndContinue,
   Stop,
+  /// The request continues in the next trigger of the same FIFO lane, which the proxy handles before any trigger of
+  /// other lanes.
+  ContinueInSameLane,
 };
 
 class Proxy;
 using ProxyHandler = std::function<ProxyHandlerResult(ProxyTrigger)>;
 
+/// The loop of a proxy thread, see @ref Proxy::runLoop().
+using ProxyLoop = std::function<void(Proxy&)>;
+
 class Proxy {
  public:
-  Proxy(ProxyHandler handler, std::function<void()> threadInit, size_t fifoSize = DEFAULT_FIFO_SIZE);
-  Proxy(ProxyHandler handler, size_t fifoSize = DEFAULT_FIFO_SIZE);
+  Proxy(ProxyHandler handler, std::function<void()> threadInit, size_t fifoSize = DEFAULT_FIFO_SIZE, int fifoLanes = 1);
+  Proxy(ProxyHandler handler, size_t fifoSize = DEFAULT_FIFO_SIZE, int fifoLanes = 1);
+
+  /// Constructs a proxy whose thread runs `loop` once instead of calling a handler for each trigger. `loop` is
+  /// expected to call @ref runLoop() with a handler of a concrete type, so that the handler is called directly rather
+  /// than through a `std::function`. See @ref ProxyEngine.
+  Proxy(ProxyLoop loop, std::function<void()> threadInit, size_t fifoSize = DEFAULT_FIFO_SIZE, int fifoLanes = 1);
   ~Proxy();
 
   void start();
   void stop();
 
   /// This is a concurrent fifo which is multiple threads from the device
-  /// can produce for and the sole proxy thread consumes it.
+  /// can produce for and the sole proxy thread consumes it. The proxy polls
+  /// its lanes round-robin, one trigger at a time.
   /// @return the fifo
   Fifo& fifo();
 
+  /// Handles triggers until the proxy is stopped or `handler` returns @ref ProxyHandlerResult::Stop. Only to be called
+  /// by the loop of the proxy thread.
+  /// @param handler Callable as `ProxyHandlerResult(ProxyTrigger)`.
+  template <class Handler>
+  void runLoop(Handler&& handler);
+
  private:
   struct Impl;
   std::unique_ptr<Impl> pimpl;
+
+  // Parts of runLoop() that are defined in the library, so that its tuning and build flags stay out of this header.
+  const std::atomic_bool& running() const;
+  int stopCheckPeriod() const;
+  int flushPeriod() const;
+  uint64_t beginTrigger();
+  void endHandler(uint64_t entryTime);
+  void endTrigger(uint64_t entryTime);
+  void flushFifoTail();
 };
 
+template <class Handler>
+void Proxy::runLoop(Handler&& handler) {
+  Fifo& fifo = this->fifo();
+  const std::atomic_bool& running = this->running();
+  ProxyTrigger trigger;
+
+  const int stopCheckPeriod = this->stopCheckPeriod();
+  const int flushPeriod = this->flushPeriod();
+  const int numLanes = fifo.numLanes();
+  int lane = 0;
+  bool holdLane = false;
+
+  int runCnt = stopCheckPeriod;
+  uint64_t flushCnt = 0;
+  for (;;) {
+    if (runCnt-- == 0) {
+      runCnt = stopCheckPeriod;
+      if (!running) {
+        break;
+      }
+    }
+    // Poll to see if we are ready to send anything
+    trigger = fifo.poll(lane);
+    if (trigger.fst == 0 || trigger.snd == 0) {  // TODO: this check is a potential pitfall for custom triggers
+      // there is one in progress. Move on to the next lane unless the handler waits for the rest of a request.
+      if (!holdLane && ++lane == numLanes) {
+        lane = 0;
+      }
+      continue;
+    }
+    trigger.snd ^= ((uint64_t)1 << (uint64_t)63);  // this is where the last bit of snd is reverted.
+
+    uint64_t entryTime = beginTrigger();
+    ProxyHandlerResult result = handler(trigger);
+    endHandler(entryTime);
+
+    // Send completion: reset only the high 64 bits
+    fifo.pop(lane);
+    holdLane = (result == ProxyHandlerResult::ContinueInSameLane);
+    if (!holdLane && ++lane == numLanes) {
+      lane = 0;
+    }
+    endTrigger(entryTime);
+
+    // Flush the tail to device memory. This is either triggered every flushPeriod to make sure that the fifo can make
+    // progress even if there is no request mscclppSync. However, mscclppSync type is for flush request.
+    if ((++flushCnt % flushPeriod) == 0 || result == ProxyHandlerResult::FlushFifoTailAndContinue) {
+      // TODO: relocate this check: || (trigger.fields.type & mscclppSync)
+      flushFifoTail();
+    }
+
+    if (result == ProxyHandlerResult::Stop) {
+      break;
+    }
+  }
+
+  // make sure the tail is flushed before we shut the proxy
+  fifo.flushTail(/*sync=*/true);
+}
+
 }  // namespace mscclpp
 
 #endif  // MSCCLPP_PROXY_HPP_
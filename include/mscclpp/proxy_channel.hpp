@@ -22,11 +22,86 @@ class BaseProxyService {
   virtual void stopProxy() = 0;
 };
 
+/// Base class of proxy services whose proxy thread calls the trigger handler of `Derived` directly, rather than
+/// through a `std::function` for every trigger.
+///
+/// `Derived` implements `ProxyHandlerResult handleTrigger(ProxyTrigger)`, and may hide `void threadInit()` to set up
+/// the proxy thread before it handles any trigger. If these are private, `Derived` needs to befriend the engine.
+///
+/// The proxy thread uses the members of `Derived`, which are destroyed before the engine, so the destructor of
+/// `Derived` has to stop the proxy with @ref stopProxy().
+template <class Derived>
+class ProxyEngine : public BaseProxyService {
+ public:
+  /// Constructor.
+  /// @param fifoSize The number of entries in each lane of the FIFO of the proxy.
+  /// @param fifoLanes The number of lanes of the FIFO.
+  ProxyEngine(size_t fifoSize = DEFAULT_FIFO_SIZE, int fifoLanes = 1)
+      : proxy_(std::make_shared<Proxy>(
+            [this](Proxy& proxy) {
+              proxy.runLoop([this](ProxyTrigger trigger) { return derived().handleTrigger(trigger); });
+            },
+            [this]() { derived().threadInit(); }, fifoSize, fifoLanes)) {}
+
+  /// Destructor. Stops the proxy in case `Derived` has not, so that its thread does not outlive the engine.
+  ~ProxyEngine() override { proxy_->stop(); }
+
+  /// Start the proxy.
+  void startProxy() override { proxy_->start(); }
+
+  /// Stop the proxy.
+  void stopProxy() override { proxy_->stop(); }
+
+  /// Get the proxy, e.g. to build @ref ProxyChannel objects with.
+  /// @return The proxy.
+  std::shared_ptr<Proxy> proxy() const { return proxy_; }
+
+ protected:
+  /// Called on the proxy thread before it handles any trigger.
+  void threadInit() {}
+
+  std::shared_ptr<Proxy> proxy_;
+
+ private:
+  Derived& derived() { return static_cast<Derived&>(*this); }
+};
+
+/// A request decoded from a trigger of a proxy channel in either @ref TriggerFormat.
+struct ProxyRequest {
+  /// The type of the trigger.
+  TriggerType type;
+  /// The ID of the semaphore of the channel, or the custom type of a @ref TriggerCustom trigger.
+  uint32_t chanId;
+  /// The destination memory region.
+  MemoryId dst;
+  /// The offset into the destination memory region.
+  uint64_t dstOffset;
+  /// The source memory region.
+  MemoryId src;
+  /// The offset into the source memory region.
+  uint64_t srcOffset;
+  /// The size of the transfer.
+  uint64_t size;
+};
+
+/// Handler of custom triggers of a @ref ProxyService.
+using CustomTriggerHandler = std::function<ProxyHandlerResult(const ProxyRequest&)>;
+
 /// Proxy service implementation.
-class ProxyService : public BaseProxyService {
+class ProxyService : public ProxyEngine<ProxyService> {
  public:
   /// Constructor.
-  ProxyService(size_t fifoSize = DEFAULT_FIFO_SIZE);
+  /// @param fifoSize The number of entries in the FIFO of the proxy.
+  /// @param triggerFormat The encoding that the proxy channels of this service push to the FIFO.
+  /// @ref TriggerFormat::Extended takes two FIFO entries per request but lifts the 4 GiB limit on sizes and offsets,
+  /// and the limits on the number of memories and semaphores.
+  /// @param fifoLanes The number of lanes of the FIFO. Thread blocks push to different lanes when there are more than
+  /// one, which avoids contention between them but leaves their triggers unordered with respect to each other.
+  ProxyService(size_t fifoSize = DEFAULT_FIFO_SIZE, TriggerFormat triggerFormat = TriggerFormat::Compact,
+               int fifoLanes = 1);
+
+  /// Destructor. Stops the proxy before the semaphores and memories that it uses are destroyed.
+  ~ProxyService() override;
 
   /// Build and add a semaphore to the proxy service.
   /// @param connection The connection associated with the semaphore.
@@ -54,20 +129,44 @@ class ProxyService : public BaseProxyService {
   ProxyChannel proxyChannel(SemaphoreId id);
 
   /// Start the proxy service.
-  void startProxy();
+  void startProxy() override;
 
   /// Stop the proxy service.
-  void stopProxy();
+  void stopProxy() override;
+
+  /// Get the encoding that the proxy channels of this service push to the FIFO.
+  /// @return The trigger format.
+  TriggerFormat triggerFormat() const;
+
+  /// Register the handler of a custom trigger type, which devices push with
+  /// @ref ProxyChannelDeviceHandle::pushCustom(). Handlers have to be registered before the proxy is started.
+  /// @param customType The custom type, which is limited to the bits of a semaphore ID in the trigger format.
+  /// @param handler The handler, called on the proxy thread.
+  void registerCustomTrigger(uint32_t customType, CustomTriggerHandler handler);
 
  private:
+  friend class ProxyEngine<ProxyService>;
+
   std::vector<std::shared_ptr<Host2DeviceSemaphore>> semaphores_;
   std::vector<RegisteredMemory> memories_;
-  std::shared_ptr<Proxy> proxy_;
+  std::vector<CustomTriggerHandler> customHandlers_;
+  TriggerFormat triggerFormat_;
   int deviceNumaNode;
+  // The first entry of an extended trigger while the proxy waits for the second one.
+  ProxyTrigger pendingTrigger_;
+  bool hasPendingTrigger_;
+  // Custom handlers are read by the proxy thread without locking, so they are fixed once it starts.
+  bool proxyStarted_;
 
-  void bindThread();
+  void threadInit();
 
   ProxyHandlerResult handleTrigger(ProxyTrigger triggerRaw);
+
+  // Handles a request of a type known at compile time, see the dispatch table in proxy_channel.cc.
+  template <TriggerType Type>
+  ProxyHandlerResult handleRequest(const ProxyRequest& request);
+
+  ProxyHandlerResult handleCustomRequest(const ProxyRequest& request);
 };
 
 /// Proxy channel.
@@ -79,10 +178,13 @@ struct ProxyChannel {
 
   std::shared_ptr<Proxy> proxy_;
 
+  TriggerFormat triggerFormat_ = TriggerFormat::Compact;
+
  public:
   ProxyChannel() = default;
 
-  ProxyChannel(SemaphoreId semaphoreId, std::shared_ptr<Host2DeviceSemaphore> semaphore, std::shared_ptr<Proxy> proxy);
+  ProxyChannel(SemaphoreId semaphoreId, std::shared_ptr<Host2DeviceSemaphore> semaphore, std::shared_ptr<Proxy> proxy,
+               TriggerFormat triggerFormat = TriggerFormat::Compact);
 
   ProxyChannel(const ProxyChannel& other) = default;
 
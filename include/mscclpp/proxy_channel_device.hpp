@@ -19,6 +19,9 @@ using TriggerType = uint64_t;
 const TriggerType TriggerData = 0x1;  // Trigger a data transfer.
 const TriggerType TriggerFlag = 0x2;  // Trigger a signaling.
 const TriggerType TriggerSync = 0x4;  // Trigger a flush.
+// Trigger a handler registered with ProxyService::registerCustomTrigger(). The semaphore ID field of the trigger
+// carries the custom type.
+const TriggerType TriggerCustom = 0x0;
 
 #define MSCCLPP_BITS_SIZE 32
 #define MSCCLPP_BITS_OFFSET 32
@@ -83,9 +86,87 @@ union ChannelTrigger {
 #endif  // defined(MSCCLPP_DEVICE_COMPILE)
 };
 
+/// Encoding of the triggers that a @ref ProxyChannelDeviceHandle pushes to the FIFO of its proxy service.
+enum class TriggerFormat : uint32_t {
+  /// A single FIFO entry per request, see @ref ChannelTrigger.
+  Compact = 0,
+  /// Two consecutive FIFO entries per request, see @ref ExtendedChannelTrigger.
+  Extended = 1,
+};
+
+#define MSCCLPP_BITS_EXT_SIZE 48
+#define MSCCLPP_BITS_EXT_OFFSET 48
+#define MSCCLPP_BITS_EXT_REGMEM_HANDLE 20
+#define MSCCLPP_BITS_EXT_CONNID 20
+#define MSCCLPP_BITS_EXT_VERSION 4
+
+/// Version of the extended encoding stored in both entries of an @ref ExtendedChannelTrigger. Being non-zero, it also
+/// keeps the first 64 bits of each entry non-zero, which is what the proxy polls for.
+constexpr uint64_t ExtendedTriggerVersion = 1;
+
+/// Work element spanning two consecutive entries in the FIFO, for transfers that exceed the limits of
+/// @ref ChannelTrigger: sizes and offsets up to 256 TiB, and up to 2^20 memories and semaphores.
+union ExtendedChannelTrigger {
+  ProxyTrigger value[2];
+  struct {
+    // value[0].fst
+    uint64_t srcOffset : MSCCLPP_BITS_EXT_OFFSET;
+    uint64_t type : MSCCLPP_BITS_TYPE;
+    uint64_t : (64 - MSCCLPP_BITS_EXT_OFFSET - MSCCLPP_BITS_TYPE - MSCCLPP_BITS_EXT_VERSION);
+    uint64_t version : MSCCLPP_BITS_EXT_VERSION;
+    // value[0].snd
+    uint64_t dstOffset : MSCCLPP_BITS_EXT_OFFSET;
+    uint64_t : (64 - MSCCLPP_BITS_EXT_OFFSET - MSCCLPP_BITS_FIFO_RESERVED);
+    uint64_t reserved : MSCCLPP_BITS_FIFO_RESERVED;
+    // value[1].fst
+    uint64_t size : MSCCLPP_BITS_EXT_SIZE;
+    uint64_t : (64 - MSCCLPP_BITS_EXT_SIZE - MSCCLPP_BITS_EXT_VERSION);
+    uint64_t secondVersion : MSCCLPP_BITS_EXT_VERSION;
+    // value[1].snd
+    uint64_t srcMemoryId : MSCCLPP_BITS_EXT_REGMEM_HANDLE;
+    uint64_t dstMemoryId : MSCCLPP_BITS_EXT_REGMEM_HANDLE;
+    uint64_t chanId : MSCCLPP_BITS_EXT_CONNID;
+    uint64_t : (64 - MSCCLPP_BITS_EXT_REGMEM_HANDLE - MSCCLPP_BITS_EXT_REGMEM_HANDLE - MSCCLPP_BITS_EXT_CONNID -
+                MSCCLPP_BITS_FIFO_RESERVED);
+    uint64_t secondReserved : MSCCLPP_BITS_FIFO_RESERVED;
+  } fields;
+
+#if defined(MSCCLPP_DEVICE_COMPILE)
+  /// Default constructor.
+  MSCCLPP_DEVICE_INLINE ExtendedChannelTrigger() {}
+
+  /// Constructor.
+  /// @param type The type of the trigger.
+  /// @param dst The destination memory region.
+  /// @param dstOffset The offset into the destination memory region.
+  /// @param src The source memory region.
+  /// @param srcOffset The offset into the source memory region.
+  /// @param bytes The bytes of the transfer.
+  /// @param semaphoreId The ID of the semaphore.
+  MSCCLPP_DEVICE_INLINE ExtendedChannelTrigger(TriggerType type, MemoryId dst, uint64_t dstOffset, MemoryId src,
+                                               uint64_t srcOffset, uint64_t bytes, int semaphoreId) {
+    constexpr uint64_t maskSize = (1ULL << MSCCLPP_BITS_EXT_SIZE) - 1;
+    constexpr uint64_t maskOffset = (1ULL << MSCCLPP_BITS_EXT_OFFSET) - 1;
+    constexpr uint64_t maskMemoryId = (1ULL << MSCCLPP_BITS_EXT_REGMEM_HANDLE) - 1;
+    constexpr uint64_t maskType = (1ULL << MSCCLPP_BITS_TYPE) - 1;
+    constexpr uint64_t maskChanId = (1ULL << MSCCLPP_BITS_EXT_CONNID) - 1;
+    constexpr uint64_t version = ExtendedTriggerVersion << (64 - MSCCLPP_BITS_EXT_VERSION);
+    value[0].fst = version + (((uint64_t)type & maskType) << MSCCLPP_BITS_EXT_OFFSET) + (srcOffset & maskOffset);
+    value[0].snd = dstOffset & maskOffset;
+    value[1].fst = version + (bytes & maskSize);
+    value[1].snd = (((((uint64_t)semaphoreId & maskChanId) << MSCCLPP_BITS_EXT_REGMEM_HANDLE) + (dst & maskMemoryId))
+                    << MSCCLPP_BITS_EXT_REGMEM_HANDLE) +
+                   (src & maskMemoryId);
+  }
+#endif  // defined(MSCCLPP_DEVICE_COMPILE)
+};
+
 struct ProxyChannelDeviceHandle {
   SemaphoreId semaphoreId_;
 
+  // the encoding that the proxy service of this channel decodes.
+  TriggerFormat triggerFormat_;
+
   Host2DeviceSemaphoreDeviceHandle semaphore_;
 
   // this is a concurrent fifo which is multiple threads from the device
@@ -93,6 +174,39 @@ struct ProxyChannelDeviceHandle {
   FifoDeviceHandle fifo_;
 
 #if defined(MSCCLPP_DEVICE_COMPILE)
+  /// Push a trigger to the FIFO in the format of the proxy service.
+  /// @return The head of the FIFO where the last entry of the trigger is pushed to.
+  MSCCLPP_DEVICE_INLINE uint64_t push(TriggerType type, MemoryId dst, uint64_t dstOffset, MemoryId src,
+                                      uint64_t srcOffset, uint64_t size) {
+    return push(type, dst, dstOffset, src, srcOffset, size, semaphoreId_);
+  }
+
+  /// Push a @ref TriggerCustom to the FIFO, which the proxy service passes to the handler registered for
+  /// `customType`. The arguments are passed through as they are, except that in the compact format `size` and
+  /// `srcOffset` must not both be zero, as the proxy would never see the trigger; this is asserted unless `NDEBUG` is
+  /// defined.
+  /// @param customType The custom type of the trigger.
+  /// @param dst The destination memory region.
+  /// @param dstOffset The offset into the destination memory region.
+  /// @param src The source memory region.
+  /// @param srcOffset The offset into the source memory region.
+  /// @param size The size of the transfer.
+  /// @return The head of the FIFO where the last entry of the trigger is pushed to, to @ref FifoDeviceHandle::sync()
+  /// on if the handler asks for a flush of the FIFO tail.
+  MSCCLPP_DEVICE_INLINE uint64_t pushCustom(uint32_t customType, MemoryId dst, uint64_t dstOffset, MemoryId src,
+                                            uint64_t srcOffset, uint64_t size) {
+    if (triggerFormat_ == TriggerFormat::Compact) {
+      // The compact encoding has no spare bit in its first 64 bits, which the proxy polls for being non-zero.
+      ChannelTrigger trigger(TriggerCustom, dst, dstOffset, src, srcOffset, size, customType);
+      if (trigger.value.fst == 0) {
+        __assert_fail("pushCustom: size and srcOffset must not both be zero in the compact trigger format", __FILE__,
+                      __LINE__, __PRETTY_FUNCTION__);
+      }
+      return fifo_.push(trigger.value);
+    }
+    return push(TriggerCustom, dst, dstOffset, src, srcOffset, size, customType);
+  }
+
   /// Push a @ref TriggerData to the FIFO.
   /// @param dst The destination memory region.
   /// @param dstOffset The offset into the destination memory region.
@@ -100,7 +214,7 @@ struct ProxyChannelDeviceHandle {
   /// @param srcOffset The offset into the source memory region.
   /// @param size The size of the transfer.
   MSCCLPP_DEVICE_INLINE void put(MemoryId dst, uint64_t dstOffset, MemoryId src, uint64_t srcOffset, uint64_t size) {
-    fifo_.push(ChannelTrigger(TriggerData, dst, dstOffset, src, srcOffset, size, semaphoreId_).value);
+    push(TriggerData, dst, dstOffset, src, srcOffset, size);
   }
 
   /// Push a @ref TriggerData to the FIFO.
@@ -113,7 +227,7 @@ struct ProxyChannelDeviceHandle {
   }
 
   /// Push a @ref TriggerFlag to the FIFO.
-  MSCCLPP_DEVICE_INLINE void signal() { fifo_.push(ChannelTrigger(TriggerFlag, 0, 0, 0, 0, 1, semaphoreId_).value); }
+  MSCCLPP_DEVICE_INLINE void signal() { push(TriggerFlag, 0, 0, 0, 0, 1); }
 
   /// Push a @ref TriggerData and a @ref TriggerFlag at the same time to the FIFO.
   /// @param dst The destination memory region.
@@ -123,7 +237,7 @@ struct ProxyChannelDeviceHandle {
   /// @param size The size of the transfer.
   MSCCLPP_DEVICE_INLINE void putWithSignal(MemoryId dst, uint64_t dstOffset, MemoryId src, uint64_t srcOffset,
                                            uint64_t size) {
-    fifo_.push(ChannelTrigger(TriggerData | TriggerFlag, dst, dstOffset, src, srcOffset, size, semaphoreId_).value);
+    push(TriggerData | TriggerFlag, dst, dstOffset, src, srcOffset, size);
   }
 
   /// Push a @ref TriggerData and a @ref TriggerFlag at the same time to the FIFO.
@@ -143,9 +257,7 @@ struct ProxyChannelDeviceHandle {
   /// @param size The size of the transfer.
   MSCCLPP_DEVICE_INLINE void putWithSignalAndFlush(MemoryId dst, uint64_t dstOffset, MemoryId src, uint64_t srcOffset,
                                                    uint64_t size) {
-    uint64_t curFifoHead = fifo_.push(
-        ChannelTrigger(TriggerData | TriggerFlag | TriggerSync, dst, dstOffset, src, srcOffset, size, semaphoreId_)
-            .value);
+    uint64_t curFifoHead = push(TriggerData | TriggerFlag | TriggerSync, dst, dstOffset, src, srcOffset, size);
     fifo_.sync(curFifoHead);
   }
 
@@ -160,7 +272,7 @@ struct ProxyChannelDeviceHandle {
 
   /// Push a @ref TriggerSync to the FIFO.
   MSCCLPP_DEVICE_INLINE void flush() {
-    uint64_t curFifoHead = fifo_.push(ChannelTrigger(TriggerSync, 0, 0, 0, 0, 1, semaphoreId_).value);
+    uint64_t curFifoHead = push(TriggerSync, 0, 0, 0, 0, 1);
     fifo_.sync(curFifoHead);
   }
 
@@ -172,6 +284,16 @@ struct ProxyChannelDeviceHandle {
   /// @param maxSpinCount The maximum number of spin counts before asserting. Never assert if negative.
   MSCCLPP_DEVICE_INLINE void wait(int64_t maxSpinCount = 10000000) { semaphore_.wait(maxSpinCount); }
 
+ private:
+  MSCCLPP_DEVICE_INLINE uint64_t push(TriggerType type, MemoryId dst, uint64_t dstOffset, MemoryId src,
+                                      uint64_t srcOffset, uint64_t size, uint32_t id) {
+    if (triggerFormat_ == TriggerFormat::Extended) {
+      ExtendedChannelTrigger trigger(type, dst, dstOffset, src, srcOffset, size, id);
+      return fifo_.push(trigger.value[0], trigger.value[1]);
+    }
+    return fifo_.push(ChannelTrigger(type, dst, dstOffset, src, srcOffset, size, id).value);
+  }
+
 #endif  // defined(MSCCLPP_DEVICE_COMPILE)
 };
 
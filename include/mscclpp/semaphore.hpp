@@ -21,6 +21,14 @@ namespace mscclpp {
 /// the local peer that it has completed a data transfer by incrementing the remote peer's outbound semaphore ID and
 /// copying the incremented value to the local peer's inbound semaphore ID.
 ///
+/// Semaphore IDs are allocated in slabs shared by the semaphores of a communicator. The inbound semaphore IDs of the
+/// semaphores on a connection are registered and exchanged with the remote peer once per slab, and the n-th semaphore
+/// of a type constructed on a connection is paired with the n-th semaphore of the same type constructed by the remote
+/// peer on the same connection. The first slab is exchanged when the connection is established, so constructing up to
+/// 512 semaphores of a type on a connection does not require the remote peer to construct any: a semaphore that only
+/// signals the remote peer does not need a counterpart. The remote peer needs to construct as many semaphores as the
+/// local peer beyond that.
+///
 /// @tparam InboundDeleter The deleter for inbound semaphore IDs. This is either `std::default_delete` for host memory
 /// or @ref CudaDeleter for device memory.
 /// @tparam OutboundDeleter The deleter for outbound semaphore IDs. This is either `std::default_delete` for host memory
@@ -29,25 +37,43 @@ namespace mscclpp {
 template <template <typename> typename InboundDeleter, template <typename> typename OutboundDeleter>
 class BaseSemaphore {
  protected:
-  /// The registered memory for the remote peer's inbound semaphore ID.
+  /// The registered memory that contains the remote peer's inbound semaphore ID.
   NonblockingFuture<RegisteredMemory> remoteInboundSemaphoreIdsRegMem_;
 
+  /// The offset of the remote peer's inbound semaphore ID in @ref remoteInboundSemaphoreIdsRegMem_.
+  uint64_t remoteInboundSemaphoreIdOffset_;
+
   /// The inbound semaphore ID that is incremented by the remote peer and waited on by the local peer.
   ///
   /// The location of @ref localInboundSemaphore_ can be either on the host or on the device.
-  std::unique_ptr<uint64_t, InboundDeleter<uint64_t>> localInboundSemaphore_;
+  std::shared_ptr<uint64_t> localInboundSemaphore_;
 
   /// The expected inbound semaphore ID to be incremented by the local peer and compared to the
   /// @ref localInboundSemaphore_.
   ///
   /// The location of @ref expectedInboundSemaphore_ can be either on the host or on the device.
-  std::unique_ptr<uint64_t, InboundDeleter<uint64_t>> expectedInboundSemaphore_;
+  std::shared_ptr<uint64_t> expectedInboundSemaphore_;
 
   /// The outbound semaphore ID that is incremented by the local peer and copied to the remote peer's @ref
   /// localInboundSemaphore_.
   ///
   /// The location of @ref outboundSemaphore_ can be either on the host or on the device.
-  std::unique_ptr<uint64_t, OutboundDeleter<uint64_t>> outboundSemaphore_;
+  std::shared_ptr<uint64_t> outboundSemaphore_;
+
+  /// The registration of this semaphore with the hang detector. Declared last so that the semaphore is unregistered
+  /// before its IDs are freed.
+  std::shared_ptr<void> hangDetectorEntry_;
+
+  /// Constructs a BaseSemaphore whose semaphore IDs are allocated later by @ref allocateSemaphoreIds().
+  BaseSemaphore() : remoteInboundSemaphoreIdOffset_(0) {}
+
+  /// Allocates the semaphore IDs from the slabs of a communicator. Only defined for the semaphores of the library.
+  ///
+  /// @param communicator The communicator to allocate semaphore IDs from.
+  /// @param connection The connection associated with this semaphore.
+  /// @param pairInbound Whether to pair the inbound semaphore ID with the remote peer. If false,
+  /// @ref remoteInboundSemaphoreIdsRegMem_ is never set.
+  void allocateSemaphoreIds(Communicator& communicator, std::shared_ptr<Connection> connection, bool pairInbound);
 
  public:
   /// Constructs a BaseSemaphore.
@@ -58,7 +84,8 @@ class BaseSemaphore {
   BaseSemaphore(std::unique_ptr<uint64_t, InboundDeleter<uint64_t>> localInboundSemaphoreId,
                 std::unique_ptr<uint64_t, InboundDeleter<uint64_t>> expectedInboundSemaphoreId,
                 std::unique_ptr<uint64_t, OutboundDeleter<uint64_t>> outboundSemaphoreId)
-      : localInboundSemaphore_(std::move(localInboundSemaphoreId)),
+      : remoteInboundSemaphoreIdOffset_(0),
+        localInboundSemaphore_(std::move(localInboundSemaphoreId)),
         expectedInboundSemaphore_(std::move(expectedInboundSemaphoreId)),
         outboundSemaphore_(std::move(outboundSemaphoreId)) {}
 };
@@ -108,10 +135,20 @@ class Host2HostSemaphore : public BaseSemaphore<std::default_delete, std::defaul
   /// @return true if the remote host has signaled.
   bool poll();
 
-  /// Wait for the remote host to signal.
+  /// Wait for the remote host to signal by busy-waiting.
   /// @param maxSpinCount The maximum number of spin counts before throwing an exception. Never throws if negative.
   void wait(int64_t maxSpinCount = 10000000);
 
+  /// Wait for the remote host to signal without occupying a core for long.
+  ///
+  /// Busy-waits for up to `spinUsec` and then blocks the calling thread. Over @ref Transport::Ethernet, the thread is
+  /// woken up when the signal arrives. Over IB, the signal is written by the NIC without notifying the host, so the
+  /// thread polls in growing intervals of up to 100 microseconds.
+  ///
+  /// @param timeoutUsec The timeout in microseconds before throwing an exception. Never throws if negative.
+  /// @param spinUsec The time in microseconds to busy-wait before blocking.
+  void waitBlocking(int64_t timeoutUsec = 30000000, int64_t spinUsec = 10);
+
  private:
   std::shared_ptr<Connection> connection_;
 };
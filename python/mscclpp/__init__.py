@@ -9,6 +9,7 @@ from ._mscclpp import (
     connect_nvls_collective,
     EndpointConfig,
     Fifo,
+    HangDetector,
     Host2DeviceSemaphore,
     Host2HostSemaphore,
     numa,
@@ -20,13 +21,16 @@ from ._mscclpp import (
     TcpBootstrap,
     Transport,
     TransportFlags,
+    TriggerFormat,
     DataType,
     Executor,
     ExecutionPlan,
+    ExecutorSetupFuture,
     PacketType,
     version,
     is_nvls_supported,
     npkit,
+    metrics,
 )
 
 __version__ = version()
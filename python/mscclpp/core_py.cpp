@@ -23,6 +23,8 @@ extern void register_numa(nb::module_& m);
 extern void register_nvls(nb::module_& m);
 extern void register_executor(nb::module_& m);
 extern void register_npkit(nb::module_& m);
+extern void register_metrics(nb::module_& m);
+extern void register_hang_detector(nb::module_& m);
 
 template <typename T>
 void def_nonblocking_future(nb::handle& m, const std::string& typestr) {
@@ -145,7 +147,10 @@ void register_core(nb::module_& m) {
       .def_rw("ib_max_cq_size", &EndpointConfig::ibMaxCqSize)
       .def_rw("ib_max_cq_poll_num", &EndpointConfig::ibMaxCqPollNum)
       .def_rw("ib_max_send_wr", &EndpointConfig::ibMaxSendWr)
-      .def_rw("ib_max_wr_per_send", &EndpointConfig::ibMaxWrPerSend);
+      .def_rw("ib_max_wr_per_send", &EndpointConfig::ibMaxWrPerSend)
+      .def_rw("eth_interfaces", &EndpointConfig::ethInterfaces)
+      .def_rw("numa_node", &EndpointConfig::numaNode)
+      .def_rw("lazy", &EndpointConfig::lazy);
 
   nb::class_<Context>(m, "Context")
       .def(nb::init<>())
@@ -194,4 +199,6 @@ NB_MODULE(_mscclpp, m) {
   register_nvls(m);
   register_executor(m);
   register_npkit(m);
+  register_metrics(m);
+  register_hang_detector(m);
 }
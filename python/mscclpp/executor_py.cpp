@@ -2,15 +2,68 @@
 // Licensed under the MIT license.
 
 #include <nanobind/nanobind.h>
+#include <nanobind/ndarray.h>
+#include <nanobind/stl/optional.h>
 #include <nanobind/stl/shared_ptr.h>
 #include <nanobind/stl/string.h>
+#include <nanobind/stl/vector.h>
 
+#include <chrono>
+#include <mscclpp/errors.hpp>
 #include <mscclpp/executor.hpp>
 #include <mscclpp/gpu.hpp>
 
 namespace nb = nanobind;
 using namespace mscclpp;
 
+// A contiguous device array of any framework that supports DLPack, e.g. torch, cupy or jax.
+using DeviceArray = nb::ndarray<nb::c_contig>;
+
+static void* arrayData(const DeviceArray& array) {
+  if (array.device_type() != nb::device::cuda::value && array.device_type() != nb::device::rocm::value) {
+    throw Error("The array is not on a GPU", ErrorCode::InvalidUsage);
+  }
+  return const_cast<void*>(array.data());
+}
+
+static size_t arrayBytes(const DeviceArray& array) {
+  size_t bytes = array.dtype().bits / 8 * array.dtype().lanes;
+  for (size_t i = 0; i < array.ndim(); ++i) {
+    bytes *= array.shape(i);
+  }
+  return bytes;
+}
+
+static DataType arrayDataType(const DeviceArray& array) {
+  nb::dlpack::dtype dtype = array.dtype();
+  if (dtype.lanes == 1) {
+    switch (dtype.code) {
+      case (uint8_t)nb::dlpack::dtype_code::Int:
+        if (dtype.bits == 32) return DataType::INT32;
+        break;
+      case (uint8_t)nb::dlpack::dtype_code::UInt:
+        if (dtype.bits == 32) return DataType::UINT32;
+        break;
+      case (uint8_t)nb::dlpack::dtype_code::Float:
+        if (dtype.bits == 16) return DataType::FLOAT16;
+        if (dtype.bits == 32) return DataType::FLOAT32;
+        break;
+      case (uint8_t)nb::dlpack::dtype_code::Bfloat:
+        if (dtype.bits == 16) return DataType::BFLOAT16;
+        break;
+    }
+  }
+  throw Error("Unsupported array data type", ErrorCode::InvalidUsage);
+}
+
+// Accepts a raw stream handle, a torch stream, a cupy stream, or None for the default stream.
+static cudaStream_t toStream(nb::handle stream) {
+  if (stream.is_none()) return nullptr;
+  if (nb::hasattr(stream, "cuda_stream")) return (cudaStream_t)nb::cast<uintptr_t>(stream.attr("cuda_stream"));
+  if (nb::hasattr(stream, "ptr")) return (cudaStream_t)nb::cast<uintptr_t>(stream.attr("ptr"));
+  return (cudaStream_t)nb::cast<uintptr_t>(stream);
+}
+
 void register_executor(nb::module_& m) {
   nb::enum_<DataType>(m, "DataType")
       .value("int32", DataType::INT32)
@@ -24,8 +77,59 @@ void register_executor(nb::module_& m) {
   nb::class_<ExecutionPlan>(m, "ExecutionPlan")
       .def(nb::init<const std::string, const std::string>(), nb::arg("name"), nb::arg("planPath"));
 
+  nb::class_<ExecutionPhaseStats>(m, "ExecutionPhaseStats")
+      .def_ro("count", &ExecutionPhaseStats::count)
+      .def_ro("total_us", &ExecutionPhaseStats::totalUs)
+      .def_ro("min_us", &ExecutionPhaseStats::minUs)
+      .def_ro("max_us", &ExecutionPhaseStats::maxUs)
+      .def("mean_us", &ExecutionPhaseStats::meanUs);
+
+  nb::class_<ExecutionProfile>(m, "ExecutionProfile")
+      .def_ro("plan_name", &ExecutionProfile::planName)
+      .def_ro("message_size", &ExecutionProfile::messageSize)
+      .def_ro("lookup", &ExecutionProfile::lookup)
+      .def_ro("plan_load", &ExecutionProfile::planLoad)
+      .def_ro("upload", &ExecutionProfile::upload)
+      .def_ro("launch", &ExecutionProfile::launch)
+      .def_ro("device", &ExecutionProfile::device);
+
+  nb::class_<std::shared_future<void>>(m, "ExecutorSetupFuture")
+      .def("done",
+           [](const std::shared_future<void>& self) {
+             return self.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+           })
+      .def(
+          "result",
+          [](const std::shared_future<void>& self, std::optional<double> timeoutSec) {
+            nb::gil_scoped_release release;
+            if (!timeoutSec.has_value()) {
+              self.wait();
+            } else if (self.wait_for(std::chrono::duration<double>(*timeoutSec)) != std::future_status::ready) {
+              throw Error("Executor setup did not finish in time", ErrorCode::Timeout);
+            }
+            self.get();
+          },
+          nb::arg("timeout") = nb::none());
+
   nb::class_<Executor>(m, "Executor")
       .def(nb::init<std::shared_ptr<Communicator>>(), nb::arg("comm"))
+      .def(
+          "execute",
+          [](Executor* self, int rank, const DeviceArray& sendbuf, const DeviceArray& recvbuf,
+             const ExecutionPlan& plan, nb::handle stream, PacketType packetType) {
+            DataType dataType = arrayDataType(sendbuf);
+            if (arrayDataType(recvbuf) != dataType) {
+              throw Error("The send and receive arrays have different data types", ErrorCode::InvalidUsage);
+            }
+            void* sendPtr = arrayData(sendbuf);
+            void* recvPtr = arrayData(recvbuf);
+            cudaStream_t cudaStream = toStream(stream);
+            nb::gil_scoped_release release;
+            self->execute(rank, sendPtr, recvPtr, arrayBytes(sendbuf), arrayBytes(recvbuf), dataType, plan, cudaStream,
+                          packetType);
+          },
+          nb::arg("rank"), nb::arg("sendbuf").noconvert(), nb::arg("recvbuf").noconvert(), nb::arg("plan"),
+          nb::arg("stream") = nb::none(), nb::arg("packetType") = PacketType::LL16)
       .def(
           "execute",
           [](Executor* self, int rank, uintptr_t sendbuff, uintptr_t recvBuff, size_t sendBuffSize, size_t recvBuffSize,
@@ -34,5 +138,29 @@ void register_executor(nb::module_& m) {
                           recvBuffSize, dataType, plan, (cudaStream_t)stream, packetType);
           },
           nb::arg("rank"), nb::arg("sendbuff"), nb::arg("recvBuff"), nb::arg("sendBuffSize"), nb::arg("recvBuffSize"),
-          nb::arg("dataType"), nb::arg("plan"), nb::arg("stream"), nb::arg("packetType") = PacketType::LL16);
+          nb::arg("dataType"), nb::arg("plan"), nb::arg("stream"), nb::arg("packetType") = PacketType::LL16,
+          nb::call_guard<nb::gil_scoped_release>())
+      .def(
+          "setup",
+          [](Executor* self, int rank, const DeviceArray& sendbuf, const DeviceArray& recvbuf,
+             const ExecutionPlan& plan) {
+            void* sendPtr = arrayData(sendbuf);
+            void* recvPtr = arrayData(recvbuf);
+            nb::gil_scoped_release release;
+            self->setup(rank, sendPtr, recvPtr, arrayBytes(sendbuf), arrayBytes(recvbuf), plan);
+          },
+          nb::arg("rank"), nb::arg("sendbuf").noconvert(), nb::arg("recvbuf").noconvert(), nb::arg("plan"))
+      .def(
+          "setup_async",
+          [](Executor* self, int rank, const DeviceArray& sendbuf, const DeviceArray& recvbuf,
+             const ExecutionPlan& plan) {
+            return self->setupAsync(rank, arrayData(sendbuf), arrayData(recvbuf), arrayBytes(sendbuf),
+                                    arrayBytes(recvbuf), plan);
+          },
+          nb::arg("rank"), nb::arg("sendbuf").noconvert(), nb::arg("recvbuf").noconvert(), nb::arg("plan"),
+          // The background setup uses the executor and both arrays until the returned future is done.
+          nb::keep_alive<0, 1>(), nb::keep_alive<0, 3>(), nb::keep_alive<0, 4>())
+      .def("set_profiling", &Executor::setProfiling, nb::arg("enable"))
+      .def("get_profiles", &Executor::getProfiles)
+      .def("reset_profiles", &Executor::resetProfiles);
 }
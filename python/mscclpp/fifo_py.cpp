@@ -16,15 +16,17 @@ void register_fifo(nb::module_& m) {
       .def_rw("tail_replica", &FifoDeviceHandle::tailReplica)
       .def_rw("head", &FifoDeviceHandle::head)
       .def_rw("size", &FifoDeviceHandle::size)
+      .def_rw("num_lanes", &FifoDeviceHandle::numLanes)
       .def_prop_ro("raw", [](const FifoDeviceHandle& self) -> nb::bytes {
         return nb::bytes(reinterpret_cast<const char*>(&self), sizeof(self));
       });
 
   nb::class_<Fifo>(m, "Fifo")
-      .def(nb::init<int>(), nb::arg("size") = DEFAULT_FIFO_SIZE)
-      .def("poll", &Fifo::poll)
-      .def("pop", &Fifo::pop)
+      .def(nb::init<int, int>(), nb::arg("size") = DEFAULT_FIFO_SIZE, nb::arg("num_lanes") = 1)
+      .def("poll", &Fifo::poll, nb::arg("lane") = 0)
+      .def("pop", &Fifo::pop, nb::arg("lane") = 0)
       .def("flush_tail", &Fifo::flushTail, nb::arg("sync") = false)
       .def("size", &Fifo::size)
+      .def("num_lanes", &Fifo::numLanes)
       .def("device_handle", &Fifo::deviceHandle);
 }
@@ -0,0 +1,20 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <nanobind/nanobind.h>
+#include <nanobind/stl/shared_ptr.h>
+#include <nanobind/stl/string.h>
+
+#include <mscclpp/core.hpp>
+#include <mscclpp/hang_detector.hpp>
+
+namespace nb = nanobind;
+using namespace mscclpp;
+
+void register_hang_detector(nb::module_& m) {
+  nb::class_<HangDetector>(m, "HangDetector")
+      .def(nb::init<std::shared_ptr<Bootstrap>, int64_t, int64_t>(), nb::arg("bootstrap"), nb::arg("timeout_sec") = 60,
+           nb::arg("check_period_ms") = 1000)
+      .def("stalled", &HangDetector::stalled)
+      .def("report", &HangDetector::report);
+}
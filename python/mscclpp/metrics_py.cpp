@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <nanobind/nanobind.h>
+#include <nanobind/stl/pair.h>
+#include <nanobind/stl/shared_ptr.h>
+#include <nanobind/stl/string.h>
+#include <nanobind/stl/vector.h>
+
+#include <mscclpp/metrics.hpp>
+
+namespace nb = nanobind;
+using namespace mscclpp;
+
+void register_metrics(nb::module_& m) {
+  nb::module_ sub_m = m.def_submodule("metrics", "Metrics functions");
+
+  nb::class_<Counter>(sub_m, "Counter")
+      .def("add", &Counter::add, nb::arg("value") = 1)
+      .def("value", &Counter::value)
+      .def("reset", &Counter::reset);
+
+  nb::class_<HistogramSnapshot>(sub_m, "HistogramSnapshot")
+      .def_ro("count", &HistogramSnapshot::count)
+      .def_ro("sum", &HistogramSnapshot::sum)
+      .def_ro("min", &HistogramSnapshot::min)
+      .def_ro("max", &HistogramSnapshot::max)
+      .def_ro("bucket_upper_bounds", &HistogramSnapshot::bucketUpperBounds)
+      .def_ro("bucket_counts", &HistogramSnapshot::bucketCounts)
+      .def("quantile", &HistogramSnapshot::quantile, nb::arg("q"));
+
+  nb::class_<Histogram>(sub_m, "Histogram")
+      .def("record", &Histogram::record, nb::arg("value"))
+      .def("snapshot", &Histogram::snapshot)
+      .def("reset", &Histogram::reset);
+
+  nb::class_<MetricsRegistry>(sub_m, "MetricsRegistry")
+      .def(nb::init<>())
+      .def_static("global_registry", &MetricsRegistry::global, nb::rv_policy::reference)
+      .def("counter", &MetricsRegistry::counter, nb::arg("name"), nb::arg("help"),
+           nb::arg("labels") = MetricLabels())
+      .def("histogram", &MetricsRegistry::histogram, nb::arg("name"), nb::arg("help"),
+           nb::arg("labels") = MetricLabels())
+      .def("prometheus_text", &MetricsRegistry::prometheusText)
+      .def("reset", &MetricsRegistry::reset);
+
+  nb::class_<MetricsHttpServer>(sub_m, "MetricsHttpServer")
+      .def(nb::init<MetricsRegistry&, int, const std::string&>(), nb::arg("registry"), nb::arg("port") = 0,
+           nb::arg("address") = "127.0.0.1", nb::keep_alive<1, 2>())
+      .def("port", &MetricsHttpServer::port);
+
+  sub_m.def(
+      "prometheus_text", []() { return MetricsRegistry::global().prometheusText(); },
+      "Render the metrics of the library in the Prometheus text format");
+}
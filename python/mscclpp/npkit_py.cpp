@@ -2,15 +2,25 @@
 // Licensed under the MIT license.
 
 #include <nanobind/nanobind.h>
+#include <nanobind/stl/shared_ptr.h>
 #include <nanobind/stl/string.h>
+#include <nanobind/stl/vector.h>
 
+#include <mscclpp/core.hpp>
 #include <mscclpp/npkit/npkit.hpp>
 
 namespace nb = nanobind;
 
 void register_npkit(nb::module_ &m) {
   nb::module_ sub_m = m.def_submodule("npkit", "NPKit functions");
-  sub_m.def("init", &NpKit::Init);
+  sub_m.def("init", &NpKit::Init, nb::arg("rank"), nb::arg("bootstrap") = nb::none());
   sub_m.def("dump", &NpKit::Dump);
   sub_m.def("shutdown", &NpKit::Shutdown);
+  sub_m.def("start_streaming", &NpKit::StartStreaming, nb::arg("dump_dir"), nb::arg("drain_interval_ms") = 100,
+            nb::arg("sample_period_ms") = 0, nb::arg("sample_window_ms") = 0);
+  sub_m.def("stop_streaming", &NpKit::StopStreaming);
+  sub_m.def("num_dropped_events", &NpKit::GetNumDroppedEvents);
+  sub_m.def("sync_clocks", &NpKit::SyncClocks, nb::arg("bootstrap"), nb::arg("num_rounds") = 16);
+  sub_m.def("export_trace", &NpKit::ExportTrace, nb::arg("dump_dir"), nb::arg("rank"), nb::arg("trace_path"));
+  sub_m.def("merge_traces", &NpKit::MergeTraces, nb::arg("trace_paths"), nb::arg("merged_trace_path"));
 }
@@ -11,28 +11,36 @@ namespace nb = nanobind;
 using namespace mscclpp;
 
 void register_proxy_channel(nb::module_& m) {
+  nb::enum_<TriggerFormat>(m, "TriggerFormat")
+      .value("Compact", TriggerFormat::Compact)
+      .value("Extended", TriggerFormat::Extended);
+
   nb::class_<BaseProxyService>(m, "BaseProxyService")
       .def("start_proxy", &BaseProxyService::startProxy)
       .def("stop_proxy", &BaseProxyService::stopProxy);
 
   nb::class_<ProxyService, BaseProxyService>(m, "ProxyService")
-      .def(nb::init<size_t>(), nb::arg("fifoSize") = DEFAULT_FIFO_SIZE)
+      .def(nb::init<size_t, TriggerFormat, int>(), nb::arg("fifoSize") = DEFAULT_FIFO_SIZE,
+           nb::arg("triggerFormat") = TriggerFormat::Compact, nb::arg("fifoLanes") = 1)
       .def("start_proxy", &ProxyService::startProxy)
       .def("stop_proxy", &ProxyService::stopProxy)
       .def("build_and_add_semaphore", &ProxyService::buildAndAddSemaphore, nb::arg("comm"), nb::arg("connection"))
       .def("add_semaphore", &ProxyService::addSemaphore, nb::arg("semaphore"))
       .def("add_memory", &ProxyService::addMemory, nb::arg("memory"))
       .def("semaphore", &ProxyService::semaphore, nb::arg("id"))
-      .def("proxy_channel", &ProxyService::proxyChannel, nb::arg("id"));
+      .def("proxy_channel", &ProxyService::proxyChannel, nb::arg("id"))
+      .def("trigger_format", &ProxyService::triggerFormat);
 
   nb::class_<ProxyChannel>(m, "ProxyChannel")
-      .def(nb::init<SemaphoreId, std::shared_ptr<Host2DeviceSemaphore>, std::shared_ptr<Proxy>>(),
-           nb::arg("semaphoreId"), nb::arg("semaphore"), nb::arg("proxy"))
+      .def(nb::init<SemaphoreId, std::shared_ptr<Host2DeviceSemaphore>, std::shared_ptr<Proxy>, TriggerFormat>(),
+           nb::arg("semaphoreId"), nb::arg("semaphore"), nb::arg("proxy"),
+           nb::arg("triggerFormat") = TriggerFormat::Compact)
       .def("device_handle", &ProxyChannel::deviceHandle);
 
   nb::class_<ProxyChannel::DeviceHandle>(m, "ProxyChannelDeviceHandle")
       .def(nb::init<>())
       .def_rw("semaphoreId_", &ProxyChannel::DeviceHandle::semaphoreId_)
+      .def_rw("triggerFormat_", &ProxyChannel::DeviceHandle::triggerFormat_)
       .def_rw("semaphore_", &ProxyChannel::DeviceHandle::semaphore_)
       .def_rw("fifo_", &ProxyChannel::DeviceHandle::fifo_)
       .def_prop_ro("raw", [](const ProxyChannel::DeviceHandle& self) -> nb::bytes {
@@ -31,7 +31,9 @@ void register_semaphore(nb::module_& m) {
       .def("signal", &Host2HostSemaphore::signal)
       .def("poll", &Host2HostSemaphore::poll)
       .def("wait", &Host2HostSemaphore::wait, nb::call_guard<nb::gil_scoped_release>(),
-           nb::arg("max_spin_count") = 10000000);
+           nb::arg("max_spin_count") = 10000000)
+      .def("wait_blocking", &Host2HostSemaphore::waitBlocking, nb::call_guard<nb::gil_scoped_release>(),
+           nb::arg("timeout_usec") = 30000000, nb::arg("spin_usec") = 10);
 
   nb::class_<SmDevice2DeviceSemaphore> smDevice2DeviceSemaphore(m, "SmDevice2DeviceSemaphore");
   smDevice2DeviceSemaphore
@@ -1,8 +1,13 @@
 # Copyright (c) Microsoft Corporation.
 # Licensed under the MIT license.
 
+from concurrent.futures import ThreadPoolExecutor
 import ctypes
+import fcntl
+import functools
+import hashlib
 import os
+import re
 import struct
 import subprocess
 import tempfile
@@ -61,81 +66,175 @@ class Kernel:
         cp.cuda.driver.moduleUnload(self._module)
 
 
+_include_pattern = re.compile(rb'^\s*#\s*include\s*[<"]([^>"]+)[>"]', re.MULTILINE)
+
+
+def _hash_sources(source_file: str, include_dirs: list) -> bytes:
+    """Hash a source file and every header it includes transitively that is found in its directory or `include_dirs`.
+    Other headers come with the compiler and are covered by its version."""
+    digest = hashlib.sha256()
+    visited = set()
+    pending = [(os.path.basename(source_file), os.path.realpath(source_file))]
+    while pending:
+        name, path = pending.pop()
+        if path in visited:
+            continue
+        visited.add(path)
+        with open(path, "rb") as f:
+            content = f.read()
+        digest.update(name.encode() + b"\0" + hashlib.sha256(content).digest())
+        for include in _include_pattern.findall(content):
+            include = include.decode()
+            for directory in [os.path.dirname(path)] + include_dirs:
+                candidate = os.path.join(directory, include)
+                if os.path.isfile(candidate):
+                    pending.append((include, os.path.realpath(candidate)))
+                    break
+    return digest.digest()
+
+
+@functools.lru_cache(maxsize=None)
+def _compiler_version(compiler: str) -> str:
+    return subprocess.run([compiler, "--version"], capture_output=True, text=True, check=True).stdout
+
+
+def _kernel_cache_dir():
+    """The directory of compiled kernels shared by all processes of a user, or None if the cache is disabled by setting
+    MSCCLPP_KERNEL_CACHE_DIR to an empty string."""
+    cache_dir = os.environ.get("MSCCLPP_KERNEL_CACHE_DIR")
+    if cache_dir is None:
+        cache_home = os.environ.get("XDG_CACHE_HOME", os.path.join(os.path.expanduser("~"), ".cache"))
+        cache_dir = os.path.join(cache_home, "mscclpp", "kernels")
+    return cache_dir or None
+
+
 class KernelBuilder:
     kernel_map: dict = {}
 
-    def get_key(self, kernel_name, macro_dict):
-        return kernel_name + "-".join(f"{key}={macro_dict[key]}" for key in sorted(macro_dict))
-
     def __init__(self, file: str, kernel_name: str, file_dir: str = None, macro_dict: dict = {}):
-        kernel_key = self.get_key(kernel_name, macro_dict)
-        if kernel_key in self.kernel_map:
-            self._kernel = self.kernel_map[kernel_key]
-            return
-        self._tempdir = tempfile.TemporaryDirectory(suffix=f"{os.getpid()}")
+        self._prepare(file, kernel_name, file_dir, macro_dict)
+        if self._key not in self.kernel_map:
+            self.kernel_map[self._key] = Kernel(self._get_ptx(), kernel_name)
+        self._kernel = self.kernel_map[self._key]
+
+    @classmethod
+    def build_all(cls, kernels: list, max_workers: int = None) -> list:
+        """Build several kernels, compiling the ones that are not cached yet in parallel.
+
+        Each item of `kernels` is a dict of the arguments of the constructor. Returns the builders in the same order.
+        """
+        builders = []
+        for kwargs in kernels:
+            builder = cls.__new__(cls)
+            builder._prepare(**kwargs)
+            builders.append(builder)
+        # Only compilation runs on the worker threads, as loading modules needs the CUDA context of this thread.
+        missing = list({builder._key: builder for builder in builders if builder._key not in cls.kernel_map}.values())
+        with ThreadPoolExecutor(max_workers=max_workers) as pool:
+            ptxs = list(pool.map(lambda builder: builder._get_ptx(), missing))
+        for builder, ptx in zip(missing, ptxs):
+            cls.kernel_map[builder._key] = Kernel(ptx, builder._kernel_name)
+        for builder in builders:
+            builder._kernel = cls.kernel_map[builder._key]
+        return builders
+
+    def _prepare(self, file: str, kernel_name: str, file_dir: str = None, macro_dict: dict = {}):
+        self._kernel_name = kernel_name
         self._current_file_dir = file_dir if file_dir else os.path.dirname(os.path.abspath(__file__))
+        self._source_file = os.path.join(self._current_file_dir, file)
         self.macros = None
         if file_dir:
             self.macros = ["-D{}={}".format(macro, value) for macro, value in macro_dict.items()]
-        ptx = self._compile_cuda(os.path.join(self._current_file_dir, file), f"{kernel_name}.ptx")
-        self._kernel = Kernel(ptx, kernel_name)
-        self.kernel_map[kernel_key] = self._kernel
-
-    def _compile_cuda(self, source_file, output_file, std_version="c++17"):
         mscclpp_home = os.environ.get("MSCCLPP_HOME", "/usr/local/mscclpp")
-        include_dir = os.path.join(mscclpp_home, "include")
+        self._include_dir = os.path.join(mscclpp_home, "include")
+        # The target is resolved on this thread, as the current device is per thread.
         if not cp.cuda.runtime.is_hip:
-            compute_capability = cp.cuda.Device().compute_capability
+            self._arch = cp.cuda.Device().compute_capability
             cuda_home = os.environ.get("CUDA_HOME")
-            nvcc = os.path.join(cuda_home, "bin/nvcc") if cuda_home else "nvcc"
+            self._compiler = os.path.join(cuda_home, "bin/nvcc") if cuda_home else "nvcc"
+        else:
+            # the gcn arch name is like "gfx942:sramecc+:xnack-"
+            self._arch = (
+                cp.cuda.runtime.getDeviceProperties(cp.cuda.Device().id)["gcnArchName"].decode("utf-8").split(":")[0]
+            )
+            rocm_home = os.environ.get("ROCM_HOME")
+            self._compiler = os.path.join(rocm_home, "bin/hipcc") if rocm_home else "hipcc"
+        digest = hashlib.sha256(_hash_sources(self._source_file, [self._include_dir]))
+        for part in [kernel_name, self._arch, _compiler_version(self._compiler)] + self._command("", ""):
+            digest.update(part.encode() + b"\0")
+        self._key = digest.hexdigest()
+
+    def _command(self, source_file, output_file, std_version="c++17"):
+        if not cp.cuda.runtime.is_hip:
             command = [
-                nvcc,
+                self._compiler,
                 f"-std={std_version}",
                 "-ptx",
                 "-Xcompiler",
                 "-Wall,-Wextra",
-                f"-I{include_dir}",
+                f"-I{self._include_dir}",
                 f"{source_file}",
-                f"--gpu-architecture=compute_{compute_capability}",
-                f"--gpu-code=sm_{compute_capability},compute_{compute_capability}",
+                f"--gpu-architecture=compute_{self._arch}",
+                f"--gpu-code=sm_{self._arch},compute_{self._arch}",
                 "-o",
-                f"{self._tempdir.name}/{output_file}",
+                f"{output_file}",
             ]
         else:
-            # the gcn arch name is like "gfx942:sramecc+:xnack-"
-            gcn_arch = (
-                cp.cuda.runtime.getDeviceProperties(cp.cuda.Device().id)["gcnArchName"].decode("utf-8").split(":")[0]
-            )
-            rocm_home = os.environ.get("ROCM_HOME")
-            hipcc = os.path.join(rocm_home, "bin/hipcc") if rocm_home else "hipcc"
             command = [
-                hipcc,
+                self._compiler,
                 f"-std={std_version}",
                 "--genco",
                 "-D__HIP_PLATFORM_AMD__",
-                f"--offload-arch={gcn_arch}",
-                f"-I{include_dir}",
+                f"--offload-arch={self._arch}",
+                f"-I{self._include_dir}",
                 f"{source_file}",
                 "-o",
-                f"{self._tempdir.name}/{output_file}",
+                f"{output_file}",
             ]
         if self.macros:
             command += self.macros
+        return command
+
+    def _get_ptx(self) -> bytes:
+        """Read the compiled kernel from the cache, or compile and cache it. Concurrent processes on a node wait for the
+        one that compiles instead of compiling the same kernel again."""
+        cache_dir = _kernel_cache_dir()
+        if cache_dir is None:
+            return self._compile_cuda()
+        cached_file = os.path.join(cache_dir, f"{self._key}.ptx")
         try:
-            subprocess.run(command, capture_output=True, text=True, check=True, bufsize=1)
-            with open(f"{self._tempdir.name}/{output_file}", "rb") as f:
+            os.makedirs(cache_dir, exist_ok=True)
+            with open(f"{cached_file}.lock", "w") as lock:
+                fcntl.flock(lock, fcntl.LOCK_EX)
+                if not os.path.isfile(cached_file):
+                    ptx = self._compile_cuda()
+                    # Publish atomically, so that readers never see a partial file even without the lock.
+                    temp_file = f"{cached_file}.{os.getpid()}.tmp"
+                    with open(temp_file, "wb") as f:
+                        f.write(ptx)
+                    os.replace(temp_file, cached_file)
+                    return ptx
+            with open(cached_file, "rb") as f:
                 return f.read()
-        except subprocess.CalledProcessError as e:
-            print(e.stderr, end="")
-            raise RuntimeError("Compilation failed: ", " ".join(command))
+        except OSError as e:
+            print(f"Kernel cache {cache_dir} is not usable: {e}")
+            return self._compile_cuda()
+
+    def _compile_cuda(self) -> bytes:
+        with tempfile.TemporaryDirectory(suffix=f"{os.getpid()}") as tempdir:
+            output_file = os.path.join(tempdir, f"{self._kernel_name}.ptx")
+            command = self._command(self._source_file, output_file)
+            try:
+                subprocess.run(command, capture_output=True, text=True, check=True, bufsize=1)
+                with open(output_file, "rb") as f:
+                    return f.read()
+            except subprocess.CalledProcessError as e:
+                print(e.stderr, end="")
+                raise RuntimeError("Compilation failed: ", " ".join(command))
 
     def get_compiled_kernel(self):
         return self._kernel
 
-    def __del__(self):
-        if hasattr(self, "_tempdir"):
-            self._tempdir.cleanup()
-
 
 def pack(*args):
     res = b""
@@ -107,7 +107,7 @@ def main(
     executor = Executor(mscclpp_group.communicator)
     npkit_dump_dir = os.getenv("NPKIT_DUMP_DIR")
     if npkit_dump_dir is not None:
-        npkit.init(mscclpp_group.my_rank)
+        npkit.init(mscclpp_group.my_rank, mscclpp_group.bootstrap)
     execution_plan = ExecutionPlan(execution_plan_name, execution_plan_path)
 
     cp.random.seed(seed)
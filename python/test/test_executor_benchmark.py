@@ -0,0 +1,60 @@
+# Copyright (c) Microsoft Corporation.
+# Licensed under the MIT license.
+
+# Measures the host-side dispatch overhead of Executor.execute() from Python. Run with e.g.
+#   mpirun -np 2 python3 -m pytest ./python/test/test_executor_benchmark.py --benchmark-only
+
+import os
+
+import cupy as cp
+import pytest
+
+from mscclpp import DataType, ExecutionPlan, Executor
+import mscclpp.comm as mscclpp_comm
+from .mscclpp_mpi import MpiGroup, parametrize_mpi_groups, mpi_group
+
+pytest.importorskip("pytest_benchmark")
+
+# Every rank runs exactly this many executions, as each one waits for its peers.
+ROUNDS = 20
+ITERATIONS = 50
+
+
+@parametrize_mpi_groups(2)
+@pytest.mark.parametrize("interface", ["pointer", "dlpack"])
+@pytest.mark.parametrize("nelems", [1024, 1024 * 1024])
+def test_executor_dispatch(mpi_group: MpiGroup, interface: str, nelems: int, benchmark):
+    project_dir = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+    mscclpp_group = mscclpp_comm.CommGroup(mpi_group.comm)
+    executor = Executor(mscclpp_group.communicator)
+    execution_plan = ExecutionPlan(
+        "allreduce_pairs", os.path.join(project_dir, "test", "execution-files", "allreduce.json")
+    )
+    rank = mpi_group.comm.rank
+    buffer = cp.zeros(nelems, dtype=cp.float16)
+    stream = cp.cuda.Stream(non_blocking=True)
+    executor.setup_async(rank, buffer, buffer, execution_plan).result()
+
+    if interface == "pointer":
+
+        def execute():
+            executor.execute(
+                rank,
+                buffer.data.ptr,
+                buffer.data.ptr,
+                buffer.nbytes,
+                buffer.nbytes,
+                DataType.float16,
+                execution_plan,
+                stream.ptr,
+            )
+
+    else:
+
+        def execute():
+            executor.execute(rank, buffer, buffer, execution_plan, stream)
+
+    mscclpp_group.barrier()
+    benchmark.pedantic(execute, rounds=ROUNDS, iterations=ITERATIONS, warmup_rounds=1)
+    stream.synchronize()
+    mscclpp_group.barrier()
@@ -3,6 +3,7 @@
 
 from concurrent.futures import ThreadPoolExecutor
 import os
+import sys
 import time
 import threading
 
@@ -397,6 +398,26 @@ class MscclppKernel:
         return self._kernel.launch_kernel(self.params, self.nblocks, self.nthreads, 0, None)
 
 
+def test_kernel_builder_cache(tmp_path, monkeypatch):
+    monkeypatch.setenv("MSCCLPP_KERNEL_CACHE_DIR", str(tmp_path))
+    monkeypatch.setattr(KernelBuilder, "kernel_map", {})
+    file_dir = os.path.dirname(os.path.abspath(__file__))
+    kernels = [
+        dict(file="fifo_test.cu", kernel_name="fifo", file_dir=file_dir),
+        dict(file="proxy_test.cu", kernel_name="proxy", file_dir=file_dir),
+    ]
+    builders = KernelBuilder.build_all(kernels)
+    cached_files = sorted(tmp_path.glob("*.ptx"))
+    assert len(cached_files) == 2
+    assert builders[0].get_compiled_kernel() is KernelBuilder(**kernels[0]).get_compiled_kernel()
+
+    # A new process finds the compiled kernels on disk.
+    monkeypatch.setattr(KernelBuilder, "kernel_map", {})
+    mtimes = [f.stat().st_mtime_ns for f in cached_files]
+    KernelBuilder.build_all(kernels)
+    assert [f.stat().st_mtime_ns for f in sorted(tmp_path.glob("*.ptx"))] == mtimes
+
+
 @parametrize_mpi_groups(2, 4, 8, 16)
 @pytest.mark.parametrize("transport", ["NVLink", "IB"])
 def test_h2d_semaphores(mpi_group: MpiGroup, transport: str):
@@ -606,7 +627,7 @@ def test_executor(mpi_group: MpiGroup, filename: str):
     executor = Executor(mscclpp_group.communicator)
     npkit_dump_dir = os.getenv("NPKIT_DUMP_DIR")
     if npkit_dump_dir is not None:
-        npkit.init(mscclpp_group.my_rank)
+        npkit.init(mscclpp_group.my_rank, mscclpp_group.bootstrap)
     execution_plan = ExecutionPlan("allreduce_pairs", os.path.join(project_dir, "test", "execution-files", filename))
 
     nelems = 1024 * 1024
@@ -638,3 +659,55 @@ def test_executor(mpi_group: MpiGroup, filename: str):
     if npkit_dump_dir is not None:
         npkit.dump(npkit_dump_dir)
         npkit.shutdown()
+
+
+@parametrize_mpi_groups(2)
+def test_executor_dlpack(mpi_group: MpiGroup):
+    if all_ranks_on_the_same_node(mpi_group) is False:
+        pytest.skip("algo not support cross node")
+    project_dir = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+    mscclpp_group = mscclpp_comm.CommGroup(mpi_group.comm)
+    executor = Executor(mscclpp_group.communicator)
+    execution_plan = ExecutionPlan(
+        "allreduce_pairs", os.path.join(project_dir, "test", "execution-files", "allreduce.json")
+    )
+
+    # The plan is in-place, so the same array is passed as both buffers.
+    nelems = 1024 * 1024
+    buffer = cp.full(nelems, mpi_group.comm.rank + 1, dtype=cp.float16)
+    future = executor.setup_async(mpi_group.comm.rank, buffer, buffer, execution_plan)
+    future.result(timeout=60)
+    assert future.done()
+
+    stream = cp.cuda.Stream(non_blocking=True)
+    executor.execute(mpi_group.comm.rank, buffer, buffer, execution_plan, stream)
+    stream.synchronize()
+    expected = sum(range(1, mpi_group.comm.size + 1))
+    assert cp.allclose(buffer, cp.full(nelems, expected, dtype=cp.float16))
+
+    with pytest.raises(TypeError):
+        executor.execute(mpi_group.comm.rank, buffer[::2], buffer[::2], execution_plan, stream)
+
+
+@parametrize_mpi_groups(2)
+def test_executor_setup_async_keeps_arguments_alive(mpi_group: MpiGroup):
+    if all_ranks_on_the_same_node(mpi_group) is False:
+        pytest.skip("algo not support cross node")
+    project_dir = os.path.dirname(os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+    mscclpp_group = mscclpp_comm.CommGroup(mpi_group.comm)
+    executor = Executor(mscclpp_group.communicator)
+    execution_plan = ExecutionPlan(
+        "allreduce_pairs", os.path.join(project_dir, "test", "execution-files", "allreduce.json")
+    )
+    buffer = cp.zeros(1024 * 1024, dtype=cp.float16)
+    executor_refs = sys.getrefcount(executor)
+    buffer_refs = sys.getrefcount(buffer)
+
+    # The future holds the executor and both arrays while the setup may still use them.
+    future = executor.setup_async(mpi_group.comm.rank, buffer, buffer, execution_plan)
+    assert sys.getrefcount(executor) == executor_refs + 1
+    assert sys.getrefcount(buffer) == buffer_refs + 2
+    future.result(timeout=60)
+    del future
+    assert sys.getrefcount(executor) == executor_refs
+    assert sys.getrefcount(buffer) == buffer_refs
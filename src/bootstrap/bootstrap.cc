@@ -3,9 +3,11 @@
 
 #include <sys/resource.h>
 
+#include <atomic>
 #include <cstring>
 #include <mscclpp/core.hpp>
 #include <mscclpp/errors.hpp>
+#include <mscclpp/metrics.hpp>
 #include <sstream>
 #include <thread>
 #include <unordered_map>
@@ -13,6 +15,7 @@
 
 #include "api.h"
 #include "debug.h"
+#include "hang_detector_internal.hpp"
 #include "socket.h"
 #include "utils_internal.hpp"
 
@@ -106,6 +109,18 @@ class TcpBootstrap::Impl {
   SocketAddress netIfAddr_;
   std::unordered_map<std::pair<int, int>, std::shared_ptr<Socket>, PairHash> peerSendSockets_;
   std::unordered_map<std::pair<int, int>, std::shared_ptr<Socket>, PairHash> peerRecvSockets_;
+  std::shared_ptr<Histogram> setupNs_;
+  std::shared_ptr<Counter> bytesSent_;
+  std::shared_ptr<Counter> bytesReceived_;
+
+  // The operation this bootstrap is blocked in, reported by the hang detector.
+  enum class BlockedOp : int { None, Send, Recv, AllGather, Barrier };
+  struct BlockedOpGuard;
+  std::atomic<int> blockedOp_;
+  std::atomic<int> blockedPeer_;
+  std::atomic<int> blockedTag_;
+  std::shared_ptr<void> hangDetectorEntry_;
+  std::string describeBlockedOp() const;
 
   void netSend(Socket* sock, const void* data, int size);
   void netRecv(Socket* sock, void* data, int size);
@@ -148,7 +163,60 @@ TcpBootstrap::Impl::Impl(int rank, int nRanks)
       peerCommAddresses_(nRanks, SocketAddress()),
       barrierArr_(nRanks, 0),
       abortFlagStorage_(new uint32_t(0)),
-      abortFlag_(abortFlagStorage_.get()) {}
+      abortFlag_(abortFlagStorage_.get()) {
+  auto& registry = MetricsRegistry::global();
+  setupNs_ = registry.histogram("mscclpp_bootstrap_setup_ns", "Time spent establishing bootstrap connections");
+  bytesSent_ = registry.counter("mscclpp_bootstrap_sent_bytes_total", "Bytes sent over bootstrap sockets");
+  bytesReceived_ = registry.counter("mscclpp_bootstrap_received_bytes_total", "Bytes received over bootstrap sockets");
+
+  blockedOp_ = (int)BlockedOp::None;
+  WatchEntry entry;
+  entry.name = "TcpBootstrap";
+  entry.describe = [this]() { return describeBlockedOp(); };
+  hangDetectorEntry_ = registerWatchEntry(std::move(entry));
+}
+
+// Records the operation in progress. Nested operations, such as the allGather of a barrier, keep the outermost one.
+struct TcpBootstrap::Impl::BlockedOpGuard {
+  Impl* impl;
+  bool owner;
+
+  BlockedOpGuard(Impl* impl, BlockedOp op, int peer, int tag) : impl(impl) {
+    int none = (int)BlockedOp::None;
+    owner = impl->blockedOp_.compare_exchange_strong(none, (int)op);
+    if (owner) {
+      impl->blockedPeer_ = peer;
+      impl->blockedTag_ = tag;
+    }
+  }
+
+  ~BlockedOpGuard() {
+    if (owner) impl->blockedOp_ = (int)BlockedOp::None;
+  }
+};
+
+std::string TcpBootstrap::Impl::describeBlockedOp() const {
+  std::stringstream ss;
+  ss << "rank " << rank_ << "/" << nRanks_;
+  switch ((BlockedOp)blockedOp_.load()) {
+    case BlockedOp::None:
+      ss << " idle";
+      break;
+    case BlockedOp::Send:
+      ss << " in send to rank " << blockedPeer_ << " with tag " << blockedTag_;
+      break;
+    case BlockedOp::Recv:
+      ss << " in recv from rank " << blockedPeer_ << " with tag " << blockedTag_;
+      break;
+    case BlockedOp::AllGather:
+      ss << " in allGather";
+      break;
+    case BlockedOp::Barrier:
+      ss << " in barrier";
+      break;
+  }
+  return ss.str();
+}
 
 UniqueId TcpBootstrap::Impl::getUniqueId() const { return getUniqueId(uniqueId_); }
 
@@ -418,6 +486,7 @@ void TcpBootstrap::Impl::establishConnections(int64_t timeoutSec) {
   peerCommAddresses_[rank_] = listenSock_->getAddr();
   allGather(peerCommAddresses_.data(), sizeof(SocketAddress));
 
+  setupNs_->record(timer.elapsed() * 1000);
   TRACE(MSCCLPP_INIT, "rank %d nranks %d - DONE", rank_, nRanks_);
 }
 
@@ -447,6 +516,7 @@ void TcpBootstrap::Impl::allGather(void* allData, int size) {
   int nRanks = nRanks_;
 
   TRACE(MSCCLPP_INIT, "rank %d nranks %d size %d", rank, nRanks, size);
+  BlockedOpGuard guard(this, BlockedOp::AllGather, -1, -1);
 
   /* Simple ring based AllGather
    * At each step i receive data from (rank-i-1) from left
@@ -499,6 +569,7 @@ std::shared_ptr<Socket> TcpBootstrap::Impl::getPeerRecvSocket(int peer, int tag)
 void TcpBootstrap::Impl::netSend(Socket* sock, const void* data, int size) {
   sock->send(&size, sizeof(int));
   sock->send(const_cast<void*>(data), size);
+  bytesSent_->add(size);
 }
 
 void TcpBootstrap::Impl::netRecv(Socket* sock, void* data, int size) {
@@ -510,19 +581,25 @@ void TcpBootstrap::Impl::netRecv(Socket* sock, void* data, int size) {
     throw Error(ss.str(), ErrorCode::InvalidUsage);
   }
   sock->recv(data, std::min(recvSize, size));
+  bytesReceived_->add(std::min(recvSize, size));
 }
 
 void TcpBootstrap::Impl::send(void* data, int size, int peer, int tag) {
+  BlockedOpGuard guard(this, BlockedOp::Send, peer, tag);
   auto sock = getPeerSendSocket(peer, tag);
   netSend(sock.get(), data, size);
 }
 
 void TcpBootstrap::Impl::recv(void* data, int size, int peer, int tag) {
+  BlockedOpGuard guard(this, BlockedOp::Recv, peer, tag);
   auto sock = getPeerRecvSocket(peer, tag);
   netRecv(sock.get(), data, size);
 }
 
-void TcpBootstrap::Impl::barrier() { allGather(barrierArr_.data(), sizeof(int)); }
+void TcpBootstrap::Impl::barrier() {
+  BlockedOpGuard guard(this, BlockedOp::Barrier, -1, -1);
+  allGather(barrierArr_.data(), sizeof(int));
+}
 
 void TcpBootstrap::Impl::close() {
   listenSockRoot_.reset(nullptr);
@@ -11,6 +11,7 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <fstream>
 #include <mscclpp/errors.hpp>
 #include <mscclpp/utils.hpp>
@@ -23,6 +24,8 @@ namespace mscclpp {
 
 #define MSCCLPP_SOCKET_SEND 0
 #define MSCCLPP_SOCKET_RECV 1
+// Buffers that a vectored send or receive takes at most.
+#define MSCCLPP_SOCKET_MAX_IOV 16
 
 /* Format a string representation of a (union mscclppSocketAddress *) socket address using getnameinfo()
  *
@@ -339,6 +342,19 @@ int FindInterfaces(char* ifNames, union SocketAddress* ifAddrs, int ifNameMaxSiz
   return nIfs;
 }
 
+int GetInterfaceNumaNode(const char* ifName) {
+  std::string path = std::string("/sys/class/net/") + ifName + "/device/numa_node";
+  std::ifstream file(path);
+  int numaNode;
+  if (!file.is_open() || !(file >> numaNode)) return -1;
+  return numaNode;
+}
+
+bool InterfaceHasDevice(const char* ifName) {
+  std::string path = std::string("/sys/class/net/") + ifName + "/device";
+  return access(path.c_str(), F_OK) == 0;
+}
+
 Socket::Socket(const SocketAddress* addr, uint64_t magic, enum SocketType type, volatile uint32_t* abortFlag,
                int asyncFlag) {
   fd_ = -1;
@@ -350,6 +366,7 @@ Socket::Socket(const SocketAddress* addr, uint64_t magic, enum SocketType type,
   state_ = SocketStateInitialized;
   magic_ = magic;
   type_ = type;
+  recvWaitAll_ = false;
 
   if (addr) {
     /* IPv4/IPv6 support */
@@ -521,56 +538,94 @@ void Socket::accept(const Socket* listenSocket, int64_t timeout) {
   if (abortFlag_ && *abortFlag_ != 0) throw Error("aborted", ErrorCode::Aborted);
 }
 
-void Socket::send(void* ptr, int size) {
-  int offset = 0;
-  if (state_ != SocketStateReady) {
-    std::stringstream ss;
-    ss << "socket state (" << state_ << ") is not ready";
-    throw Error(ss.str(), ErrorCode::InternalError);
+void Socket::adoptAccepted(const Socket* listenSocket, int fd) {
+  if (listenSocket == NULL) {
+    throw Error("listenSocket is NULL", ErrorCode::InvalidUsage);
+  }
+  fd_ = fd;
+  acceptFd_ = listenSocket->getFd();
+  abortFlag_ = listenSocket->getAbortFlag();
+  asyncFlag_ = listenSocket->getAsyncFlag();
+  magic_ = listenSocket->getMagic();
+  type_ = listenSocket->getType();
+  socklen_t socklen = sizeof(union SocketAddress);
+  if (::getpeername(fd_, &addr_.sa, &socklen) != 0) {
+    throw SysError("getpeername failed", errno);
   }
-  socketWait(MSCCLPP_SOCKET_SEND, ptr, size, &offset);
+  salen_ = socklen;
+  state_ = SocketStateReady;
 }
 
-void Socket::recv(void* ptr, int size) {
-  int offset = 0;
+void Socket::checkReady(const char* what) const {
   if (state_ != SocketStateReady) {
     std::stringstream ss;
-    ss << "socket state (" << state_ << ") is not ready";
+    ss << "socket state (" << state_ << ") is not ready" << what;
     throw Error(ss.str(), ErrorCode::InternalError);
   }
+}
+
+void Socket::send(const void* ptr, size_t size) {
+  size_t offset = 0;
+  checkReady("");
+  socketWait(MSCCLPP_SOCKET_SEND, const_cast<void*>(ptr), size, &offset);
+}
+
+void Socket::recv(void* ptr, size_t size) {
+  size_t offset = 0;
+  checkReady("");
   socketWait(MSCCLPP_SOCKET_RECV, ptr, size, &offset);
 }
 
-void Socket::recvUntilEnd(void* ptr, int size, int* closed) {
-  int offset = 0;
+void Socket::sendv(const struct iovec* iov, int iovcnt) {
+  checkReady(" in sendv");
+  socketWaitv(MSCCLPP_SOCKET_SEND, iov, iovcnt);
+}
+
+void Socket::recvv(const struct iovec* iov, int iovcnt) {
+  checkReady(" in recvv");
+  socketWaitv(MSCCLPP_SOCKET_RECV, iov, iovcnt);
+}
+
+void Socket::recvUntilEnd(void* ptr, size_t size, int* closed) {
+  size_t offset = 0;
   *closed = 0;
-  if (state_ != SocketStateReady) {
-    std::stringstream ss;
-    ss << "socket state (" << state_ << ") is not ready in recvUntilEnd";
-    throw Error(ss.str(), ErrorCode::InternalError);
-  }
+  checkReady(" in recvUntilEnd");
 
-  int bytes = 0;
+  ssize_t bytes = 0;
   char* data = (char*)ptr;
+  int flags = recvWaitAll_ ? MSG_WAITALL : 0;
 
-  do {
-    bytes = ::recv(fd_, data + (offset), size - (offset), 0);
-    if (bytes == 0) {
+  while (offset < size) {
+    bytes = ::recv(fd_, data + (offset), size - (offset), flags);
+    if (bytes == 0 || (bytes == -1 && state_ == SocketStateClosed)) {
       *closed = 1;
       return;
     }
     if (bytes == -1) {
-      if (errno != EINTR && errno != EWOULDBLOCK && errno != EAGAIN && state_ != SocketStateClosed) {
+      // Interrupted calls are retried rather than returning a partial buffer.
+      if (errno != EINTR && errno != EWOULDBLOCK && errno != EAGAIN) {
         throw SysError("recv until end failed", errno);
-      } else {
-        bytes = 0;
       }
+      bytes = 0;
     }
     (offset) += bytes;
     if (abortFlag_ && *abortFlag_ != 0) {
       throw Error("aborted", ErrorCode::Aborted);
     }
-  } while (bytes > 0 && (offset) < size);
+  }
+}
+
+void Socket::setBusyPoll(int usec) {
+  if (fd_ == -1) {
+    throw Error("file descriptor is -1", ErrorCode::InvalidUsage);
+  }
+#if defined(SO_BUSY_POLL)
+  if (::setsockopt(fd_, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) != 0) {
+    throw SysError("setsockopt(SO_BUSY_POLL) failed", errno);
+  }
+#else
+  WARN("SO_BUSY_POLL is not supported on this platform, ignoring busy poll of %d us", usec);
+#endif
 }
 
 void Socket::close() {
@@ -616,7 +671,7 @@ void Socket::tryAccept() {
 void Socket::finalizeAccept() {
   uint64_t magic;
   enum SocketType type;
-  int received = 0;
+  size_t received = 0;
   socketProgress(MSCCLPP_SOCKET_RECV, &magic, sizeof(magic), &received);
   if (received == 0) return;
   socketWait(MSCCLPP_SOCKET_RECV, &magic, sizeof(magic), &received);
@@ -703,7 +758,7 @@ void Socket::pollConnect() {
 }
 
 void Socket::finalizeConnect() {
-  int sent = 0;
+  size_t sent = 0;
   socketProgress(MSCCLPP_SOCKET_SEND, &magic_, sizeof(magic_), &sent);
   if (sent == 0) return;
   socketWait(MSCCLPP_SOCKET_SEND, &magic_, sizeof(magic_), &sent);
@@ -712,8 +767,8 @@ void Socket::finalizeConnect() {
   state_ = SocketStateReady;
 }
 
-void Socket::socketProgressOpt(int op, void* ptr, int size, int* offset, int block, int* closed) {
-  int bytes = 0;
+void Socket::socketProgressOpt(int op, void* ptr, size_t size, size_t* offset, int block, int* closed) {
+  ssize_t bytes = 0;
   *closed = 0;
   char* data = (char*)ptr;
 
@@ -739,7 +794,7 @@ void Socket::socketProgressOpt(int op, void* ptr, int size, int* offset, int blo
   } while (bytes > 0 && (*offset) < size);
 }
 
-void Socket::socketProgress(int op, void* ptr, int size, int* offset) {
+void Socket::socketProgress(int op, void* ptr, size_t size, size_t* offset) {
   int closed;
   socketProgressOpt(op, ptr, size, offset, 0, &closed);
   if (closed) {
@@ -749,8 +804,56 @@ void Socket::socketProgress(int op, void* ptr, int size, int* offset) {
   }
 }
 
-void Socket::socketWait(int op, void* ptr, int size, int* offset) {
+void Socket::socketWait(int op, void* ptr, size_t size, size_t* offset) {
   while (*offset < size) socketProgress(op, ptr, size, offset);
 }
 
+void Socket::socketWaitv(int op, const struct iovec* iov, int iovcnt) {
+  if (iovcnt > MSCCLPP_SOCKET_MAX_IOV) {
+    throw Error("too many buffers for a vectored socket operation", ErrorCode::InvalidUsage);
+  }
+  // A partial transfer moves the start of the remaining buffers, so they are tracked in a copy.
+  struct iovec remaining[MSCCLPP_SOCKET_MAX_IOV];
+  std::copy(iov, iov + iovcnt, remaining);
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = remaining;
+  msg.msg_iovlen = iovcnt;
+
+  while (msg.msg_iovlen > 0) {
+    // Skip the buffers that are done, including empty ones.
+    if (msg.msg_iov->iov_len == 0) {
+      msg.msg_iov++;
+      msg.msg_iovlen--;
+      continue;
+    }
+    ssize_t bytes = (op == MSCCLPP_SOCKET_RECV) ? ::recvmsg(fd_, &msg, MSG_DONTWAIT)
+                                                : ::sendmsg(fd_, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (op == MSCCLPP_SOCKET_RECV && bytes == 0) {
+      char line[SOCKET_NAME_MAXLEN + 1];
+      throw Error("connection closed by remote peer " + std::string(SocketToString(&addr_, line, 0)),
+                  ErrorCode::RemoteError);
+    }
+    if (bytes == -1) {
+      if (errno != EINTR && errno != EWOULDBLOCK && errno != EAGAIN) {
+        throw SysError(op == MSCCLPP_SOCKET_RECV ? "recvmsg failed" : "sendmsg failed", errno);
+      }
+      bytes = 0;
+    }
+    while (bytes > 0) {
+      size_t done = std::min((size_t)bytes, msg.msg_iov->iov_len);
+      msg.msg_iov->iov_base = (char*)msg.msg_iov->iov_base + done;
+      msg.msg_iov->iov_len -= done;
+      bytes -= done;
+      if (msg.msg_iov->iov_len == 0) {
+        msg.msg_iov++;
+        msg.msg_iovlen--;
+      }
+    }
+    if (abortFlag_ && *abortFlag_ != 0) {
+      throw Error("aborted", ErrorCode::Aborted);
+    }
+  }
+}
+
 }  // namespace mscclpp
@@ -73,18 +73,25 @@ struct Communicator::Impl::Connector : public Setuppable {
         commImpl_(commImpl_),
         remoteRank_(remoteRank),
         tag_(tag),
-        localEndpoint_(comm.context()->createEndpoint(localConfig)) {}
+        localEndpoint_(comm.context()->createEndpoint(localConfig)),
+        semaphoreData_(
+            commImpl_.semaphorePool_.prepareConnection(*comm.context(), localConfig.transport, semaphoreSlabs_)) {}
 
   void beginSetup(std::shared_ptr<Bootstrap> bootstrap) override {
     bootstrap->send(localEndpoint_.serialize(), remoteRank_, tag_);
+    bootstrap->send(semaphoreData_, remoteRank_, tag_);
   }
 
   void endSetup(std::shared_ptr<Bootstrap> bootstrap) override {
     std::vector<char> data;
     bootstrap->recv(data, remoteRank_, tag_);
     auto remoteEndpoint = Endpoint::deserialize(data);
+    std::vector<char> remoteSemaphoreData;
+    bootstrap->recv(remoteSemaphoreData, remoteRank_, tag_);
     auto connection = comm_.context()->connect(localEndpoint_, remoteEndpoint);
     commImpl_.connectionInfos_[connection.get()] = {remoteRank_, tag_};
+    commImpl_.semaphorePool_.addConnection(connection, semaphoreSlabs_, remoteSemaphoreData);
+    semaphoreSlabs_.clear();
     connectionPromise_.set_value(connection);
     INFO(MSCCLPP_INIT, "Connection %d -> %d created (%s)", comm_.bootstrap()->getRank(), remoteRank_,
          connection->getTransportName().c_str());
@@ -96,6 +103,9 @@ struct Communicator::Impl::Connector : public Setuppable {
   int remoteRank_;
   int tag_;
   Endpoint localEndpoint_;
+  // The initial semaphore slabs of the connection
+  SemaphorePool::InitialSlabs semaphoreSlabs_;
+  std::vector<char> semaphoreData_;
 };
 
 MSCCLPP_API_CPP NonblockingFuture<std::shared_ptr<Connection>> Communicator::connectOnSetup(
@@ -7,12 +7,58 @@
 #include <mscclpp/npkit/npkit.hpp>
 #endif
 
+#include <chrono>
 #include <mscclpp/utils.hpp>
 #include <sstream>
 #include <thread>
 
 #include "debug.h"
 #include "endpoint.hpp"
+#include "ethernet_acceptor.hpp"
+#include "ethernet_reaper.hpp"
+#include "hang_detector_internal.hpp"
+#include "metrics_internal.hpp"
+#include "utils_internal.hpp"
+
+// NpKit CPU events of connections, collected into the channel of the calling thread (see NpKit::SetCpuEventChannel).
+// The entry event type is used as the slot so that pairs of different kinds can nest.
+#define NPKIT_CONN_COLLECT(event, pairEvent, size) \
+  NpKit::CollectCpuEvent(event, (uint32_t)(size), pairEvent, NpKit::GetCpuTimestampNow())
+
+#if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_WRITE_ENTRY) && defined(ENABLE_NPKIT_EVENT_CONN_WRITE_EXIT)
+#define NPKIT_CONN_WRITE(event, size) NPKIT_CONN_COLLECT(event, NPKIT_EVENT_CONN_WRITE_ENTRY, size)
+#else
+#define NPKIT_CONN_WRITE(event, size)
+#endif
+
+#if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_UPDATE_AND_SYNC_ENTRY) && \
+    defined(ENABLE_NPKIT_EVENT_CONN_UPDATE_AND_SYNC_EXIT)
+#define NPKIT_CONN_UPDATE_AND_SYNC(event) NPKIT_CONN_COLLECT(event, NPKIT_EVENT_CONN_UPDATE_AND_SYNC_ENTRY, 0)
+#else
+#define NPKIT_CONN_UPDATE_AND_SYNC(event)
+#endif
+
+#if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_FLUSH_ENTRY) && defined(ENABLE_NPKIT_EVENT_CONN_FLUSH_EXIT)
+#define NPKIT_CONN_FLUSH(event) NPKIT_CONN_COLLECT(event, NPKIT_EVENT_CONN_FLUSH_ENTRY, 0)
+#else
+#define NPKIT_CONN_FLUSH(event)
+#endif
+
+#if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_CONN_IB_CQ_COMPLETION_ENTRY) && \
+    defined(ENABLE_NPKIT_EVENT_CONN_IB_CQ_COMPLETION_EXIT)
+#define NPKIT_CONN_IB_CQ_COMPLETION(numCompletions)                                               \
+  do {                                                                                            \
+    if ((numCompletions) > 0) {                                                                   \
+      uint64_t npkitTimestamp = NpKit::GetCpuTimestampNow();                                      \
+      NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_IB_CQ_COMPLETION_ENTRY, (uint32_t)(numCompletions), \
+                             NPKIT_EVENT_CONN_IB_CQ_COMPLETION_ENTRY, npkitTimestamp);            \
+      NpKit::CollectCpuEvent(NPKIT_EVENT_CONN_IB_CQ_COMPLETION_EXIT, (uint32_t)(numCompletions),  \
+                             NPKIT_EVENT_CONN_IB_CQ_COMPLETION_ENTRY, npkitTimestamp);            \
+    }                                                                                             \
+  } while (false)
+#else
+#define NPKIT_CONN_IB_CQ_COMPLETION(numCompletions)
+#endif
 
 namespace mscclpp {
 
@@ -31,6 +77,33 @@ std::shared_ptr<RegisteredMemory::Impl> Connection::getImpl(RegisteredMemory& me
 
 std::shared_ptr<Endpoint::Impl> Connection::getImpl(Endpoint& memory) { return memory.pimpl_; }
 
+// ConnectionMetrics
+
+// Never destroyed, since connections may outlive static objects.
+static MetricLabelIds& connectionMetricIds() {
+  static MetricLabelIds* ids = new MetricLabelIds();
+  return *ids;
+}
+
+ConnectionMetrics::ConnectionMetrics(Transport transport) : id(connectionMetricIds().acquire()) {
+  labels = {{"transport", TransportNames[static_cast<int>(transport)]}, {"connection", std::to_string(id)}};
+  auto& registry = MetricsRegistry::global();
+  writes = registry.counter("mscclpp_connection_writes_total", "Writes issued on connections", labels);
+  writeBytes = registry.counter("mscclpp_connection_write_bytes_total", "Bytes written on connections", labels);
+  updateAndSyncs =
+      registry.counter("mscclpp_connection_update_and_syncs_total", "Semaphore updates issued on connections", labels);
+  flushWaitNs = registry.histogram("mscclpp_connection_flush_wait_ns", "Time spent in connection flushes", labels);
+}
+
+ConnectionMetrics::~ConnectionMetrics() {
+  auto& registry = MetricsRegistry::global();
+  registry.remove("mscclpp_connection_writes_total", labels);
+  registry.remove("mscclpp_connection_write_bytes_total", labels);
+  registry.remove("mscclpp_connection_update_and_syncs_total", labels);
+  registry.remove("mscclpp_connection_flush_wait_ns", labels);
+  connectionMetricIds().release(id);
+}
+
 std::string Connection::getTransportName() {
   return TransportNames[static_cast<int>(this->transport())] + " -> " +
          TransportNames[static_cast<int>(this->remoteTransport())];
@@ -39,7 +112,7 @@ std::string Connection::getTransportName() {
 // CudaIpcConnection
 
 CudaIpcConnection::CudaIpcConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, cudaStream_t stream)
-    : stream_(stream) {
+    : stream_(stream), metrics_(Transport::CudaIpc) {
   if (localEndpoint.transport() != Transport::CudaIpc) {
     throw mscclpp::Error("Cuda IPC connection can only be made from a Cuda IPC endpoint", ErrorCode::InvalidUsage);
   }
@@ -62,6 +135,7 @@ Transport CudaIpcConnection::remoteTransport() { return Transport::CudaIpc; }
 
 void CudaIpcConnection::write(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
                               uint64_t size) {
+  NPKIT_CONN_WRITE(NPKIT_EVENT_CONN_WRITE_ENTRY, size);
   validateTransport(dst, remoteTransport(), dstOffset, size);
   validateTransport(src, transport(), srcOffset, size);
 
@@ -71,10 +145,13 @@ void CudaIpcConnection::write(RegisteredMemory dst, uint64_t dstOffset, Register
   MSCCLPP_CUDATHROW(cudaMemcpyAsync(dstPtr + dstOffset, srcPtr + srcOffset, size, cudaMemcpyDeviceToDevice, stream_));
   INFO(MSCCLPP_P2P, "CudaIpcConnection write: from %p to %p, size %lu", srcPtr + srcOffset, dstPtr + dstOffset, size);
 
-  // npkitCollectEntryEvent(conn, NPKIT_EVENT_DMA_SEND_DATA_ENTRY, (uint32_t)size);
+  metrics_.writes->add();
+  metrics_.writeBytes->add(size);
+  NPKIT_CONN_WRITE(NPKIT_EVENT_CONN_WRITE_EXIT, size);
 }
 
 void CudaIpcConnection::updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) {
+  NPKIT_CONN_UPDATE_AND_SYNC(NPKIT_EVENT_CONN_UPDATE_AND_SYNC_ENTRY);
   validateTransport(dst, remoteTransport());
   uint64_t oldValue = *src;
   *src = newValue;
@@ -84,16 +161,21 @@ void CudaIpcConnection::updateAndSync(RegisteredMemory dst, uint64_t dstOffset,
   INFO(MSCCLPP_P2P, "CudaIpcConnection atomic write: from %p to %p, %lu -> %lu", src, dstPtr + dstOffset, oldValue,
        newValue);
 
-  // npkitCollectEntryEvent(conn, NPKIT_EVENT_DMA_SEND_DATA_ENTRY, (uint32_t)size);
+  metrics_.updateAndSyncs->add();
+  NPKIT_CONN_UPDATE_AND_SYNC(NPKIT_EVENT_CONN_UPDATE_AND_SYNC_EXIT);
 }
 
 void CudaIpcConnection::flush(int64_t timeoutUsec) {
+  NPKIT_CONN_FLUSH(NPKIT_EVENT_CONN_FLUSH_ENTRY);
   if (timeoutUsec >= 0) {
     INFO(MSCCLPP_P2P, "CudaIpcConnection flush: timeout is not supported, ignored");
   }
   AvoidCudaGraphCaptureGuard guard;
+  auto start = std::chrono::steady_clock::now();
   MSCCLPP_CUDATHROW(cudaStreamSynchronize(stream_));
-  // npkitCollectExitEvents(conn, NPKIT_EVENT_DMA_SEND_EXIT);
+  metrics_.flushWaitNs->record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+  NPKIT_CONN_FLUSH(NPKIT_EVENT_CONN_FLUSH_EXIT);
   INFO(MSCCLPP_P2P, "CudaIpcConnection flushing connection");
 }
 
@@ -102,22 +184,42 @@ void CudaIpcConnection::flush(int64_t timeoutUsec) {
 IBConnection::IBConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, Context& context)
     : transport_(localEndpoint.transport()),
       remoteTransport_(remoteEndpoint.transport()),
-      dummyAtomicSource_(std::make_unique<uint64_t>(0)) {
+      dummyAtomicSource_(std::make_unique<uint64_t>(0)),
+      metrics_(localEndpoint.transport()),
+      lazy_(getImpl(localEndpoint)->lazy_) {
   qp = getImpl(localEndpoint)->ibQp_;
+  // The QP is ready to receive at once, since the peer may write before this side sends anything
   qp->rtr(getImpl(remoteEndpoint)->ibQpInfo_);
-  qp->rts();
+  if (!lazy_) qp->rts();
   dummyAtomicSourceMem_ = context.registerMemory(dummyAtomicSource_.get(), sizeof(uint64_t), transport_);
   validateTransport(dummyAtomicSourceMem_, transport_);
   dstTransportInfo_ = getImpl(dummyAtomicSourceMem_)->getTransportInfo(transport_);
+
+  WatchEntry entry;
+  entry.name = "IBConnection via " + getIBDeviceName(transport_);
+  entry.values.resize(1);
+  entry.values[0].name = "cqItems";
+  entry.values[0].getter = [qp = qp]() { return (uint64_t)qp->getNumCqItems(); };
+  hangDetectorEntry_ = registerWatchEntry(std::move(entry));
   INFO(MSCCLPP_NET, "IB connection via %s created", getIBDeviceName(transport_).c_str());
 }
 
+void IBConnection::readyToSend() {
+  if (lazy_) {
+    std::call_once(rtsOnce_, [this]() {
+      qp->rts();
+      INFO(MSCCLPP_NET, "IB connection via %s ready to send", getIBDeviceName(transport_).c_str());
+    });
+  }
+}
+
 Transport IBConnection::transport() { return transport_; }
 
 Transport IBConnection::remoteTransport() { return remoteTransport_; }
 
 void IBConnection::write(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
                          uint64_t size) {
+  NPKIT_CONN_WRITE(NPKIT_EVENT_CONN_WRITE_ENTRY, size);
   validateTransport(dst, remoteTransport(), dstOffset, size);
   validateTransport(src, transport(), srcOffset, size);
 
@@ -133,16 +235,20 @@ void IBConnection::write(RegisteredMemory dst, uint64_t dstOffset, RegisteredMem
   auto dstMrInfo = dstTransportInfo.ibMrInfo;
   auto srcMr = srcTransportInfo.ibMr;
 
+  readyToSend();
   qp->stageSend(srcMr, dstMrInfo, (uint32_t)size, /*wrId=*/0, /*srcOffset=*/srcOffset, /*dstOffset=*/dstOffset,
                 /*signaled=*/true);
 
   qp->postSend();
   INFO(MSCCLPP_NET, "IBConnection write: from %p to %p, size %lu", (uint8_t*)srcMr->getBuff() + srcOffset,
        (uint8_t*)dstMrInfo.addr + dstOffset, size);
-  // npkitCollectEntryEvent(conn, NPKIT_EVENT_IB_SEND_DATA_ENTRY, (uint32_t)size);
+  metrics_.writes->add();
+  metrics_.writeBytes->add(size);
+  NPKIT_CONN_WRITE(NPKIT_EVENT_CONN_WRITE_EXIT, size);
 }
 
 void IBConnection::updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) {
+  NPKIT_CONN_UPDATE_AND_SYNC(NPKIT_EVENT_CONN_UPDATE_AND_SYNC_ENTRY);
   validateTransport(dst, remoteTransport());
   auto dstTransportInfo = getImpl(dst)->getTransportInfo(remoteTransport());
   if (dstTransportInfo.ibLocal) {
@@ -154,14 +260,19 @@ void IBConnection::updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint6
   uint64_t oldValue = *src;
   *src = newValue;
 
+  readyToSend();
   qp->stageAtomicAdd(dstTransportInfo_.ibMr, dstMrInfo, /*wrId=*/0, dstOffset, newValue - oldValue, /*signaled=*/true);
 
   qp->postSend();
   INFO(MSCCLPP_NET, "IBConnection atomic Write: from %p to %p, %lu -> %lu", src, (uint8_t*)dstMrInfo.addr + dstOffset,
        oldValue, newValue);
+  metrics_.updateAndSyncs->add();
+  NPKIT_CONN_UPDATE_AND_SYNC(NPKIT_EVENT_CONN_UPDATE_AND_SYNC_EXIT);
 }
 
 void IBConnection::flush(int64_t timeoutUsec) {
+  NPKIT_CONN_FLUSH(NPKIT_EVENT_CONN_FLUSH_ENTRY);
+  auto start = std::chrono::steady_clock::now();
   Timer timer;
   while (qp->getNumCqItems()) {
     int wcNum = qp->pollCq();
@@ -175,6 +286,7 @@ void IBConnection::flush(int64_t timeoutUsec) {
                     ErrorCode::Timeout);
       }
     }
+    NPKIT_CONN_IB_CQ_COMPLETION(wcNum);
     for (int i = 0; i < wcNum; ++i) {
       int status = qp->getWcStatus(i);
       if (status != static_cast<int>(WsStatus::Success)) {
@@ -182,49 +294,119 @@ void IBConnection::flush(int64_t timeoutUsec) {
       }
     }
   }
+  metrics_.flushWaitNs->record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
   INFO(MSCCLPP_NET, "IBConnection flushing connection");
-  // npkitCollectExitEvents(conn, NPKIT_EVENT_IB_SEND_EXIT);
+  NPKIT_CONN_FLUSH(NPKIT_EVENT_CONN_FLUSH_EXIT);
 }
 
 // EthernetConnection
 
+// Applies the optional socket tuning from the environment to the receiving socket of an EthernetConnection.
+static void setEthernetRecvSocketOptions(Socket& socket) {
+  const char* busyPoll = getenv("MSCCLPP_SOCKET_BUSY_POLL");
+  if (busyPoll != nullptr) {
+    INFO(MSCCLPP_ENV, "MSCCLPP_SOCKET_BUSY_POLL set by environment to %s", busyPoll);
+    socket.setBusyPoll(atoi(busyPoll));
+  }
+  const char* waitAll = getenv("MSCCLPP_SOCKET_WAITALL");
+  if (waitAll != nullptr) {
+    INFO(MSCCLPP_ENV, "MSCCLPP_SOCKET_WAITALL set by environment to %s", waitAll);
+    socket.setRecvWaitAll(atoi(waitAll) != 0);
+  }
+}
+
 EthernetConnection::EthernetConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, uint64_t sendBufferSize,
-                                       uint64_t recvBufferSize)
-    : abortFlag_(0), sendBufferSize_(sendBufferSize), recvBufferSize_(recvBufferSize) {
+                                       uint64_t recvBufferSize, std::shared_ptr<EthernetReaper> reaper,
+                                       std::shared_ptr<EthernetAcceptor> acceptor)
+    : abortFlag_(0),
+      sendBufferSize_(sendBufferSize),
+      recvBufferSize_(recvBufferSize),
+      metrics_(Transport::Ethernet),
+      reaper_(reaper),
+      lazy_(false),
+      localEndpoint_(localEndpoint),
+      closing_(false) {
   // Validating Transport Protocol
   if (localEndpoint.transport() != Transport::Ethernet || remoteEndpoint.transport() != Transport::Ethernet) {
     throw mscclpp::Error("Ethernet connection can only be made from Ethernet endpoints", ErrorCode::InvalidUsage);
   }
 
-  // Instanciating Buffers
-  sendBuffer_.resize(sendBufferSize_);
-  recvBuffer_.resize(recvBufferSize_);
+  remoteAddress_ = getImpl(remoteEndpoint)->socketAddress_;
+  // Both sides must agree, or the eager side would wait for the lazy one to connect
+  lazy_ = getImpl(localEndpoint)->lazy_ || getImpl(remoteEndpoint)->lazy_;
+
+  if (lazy_) {
+    // The reaper or the acceptor accepts the connection once the peer connects
+    if (reaper_) {
+      reaper_->add(this);
+    } else {
+      acceptor_ = acceptor ? acceptor : std::make_shared<EthernetAcceptor>();
+      acceptor_->add(this);
+    }
+    INFO(MSCCLPP_NET, "Ethernet connection created, to be connected on first use");
+    return;
+  }
 
   // Creating Thread to Accept the Connection
-  auto parameter = (getImpl(localEndpoint)->socket_).get();
-  std::thread t([this, parameter]() {
-    recvSocket_ = std::make_unique<Socket>(nullptr, MSCCLPP_SOCKET_MAGIC, SocketTypeUnknown, abortFlag_);
-    recvSocket_->accept(parameter);
-  });
+  std::thread t([this]() { acceptRecv(); });
 
   // Starting Connection
-  sendSocket_ = std::make_unique<Socket>(&(getImpl(remoteEndpoint)->socketAddress_), MSCCLPP_SOCKET_MAGIC,
-                                         SocketTypeBootstrap, abortFlag_);
-  sendSocket_->connect();
+  std::call_once(connectOnce_, [this]() { connectSend(); });
 
-  // Ensure the Connection was Established
+  // Ensure the Connection was Established, and release the listening socket of the endpoint unless the user holds it
   t.join();
+  localEndpoint_ = Endpoint();
 
-  // Starting Thread to Receive Messages
-  threadRecvMessages_ = std::thread(&EthernetConnection::recvMessages, this);
+  // Starting Thread to Receive Messages, unless the reaper of the context receives them
+  if (reaper_) {
+    reaper_->add(this);
+  } else {
+    threadRecvMessages_ = std::thread(&EthernetConnection::recvMessages, this);
+  }
 
   INFO(MSCCLPP_NET, "Ethernet connection created");
 }
 
+void EthernetConnection::connectSend() {
+  sendSocket_ = std::make_unique<Socket>(&remoteAddress_, MSCCLPP_SOCKET_MAGIC, SocketTypeBootstrap, abortFlag_);
+  sendSocket_->connect();
+}
+
+void EthernetConnection::acceptRecv() {
+  auto socket = std::make_unique<Socket>(nullptr, MSCCLPP_SOCKET_MAGIC, SocketTypeUnknown, abortFlag_);
+  socket->accept(listenSocket());
+  setRecvSocket(std::move(socket));
+}
+
+void EthernetConnection::adoptRecv(int fd) {
+  auto socket = std::make_unique<Socket>(nullptr, MSCCLPP_SOCKET_MAGIC, SocketTypeUnknown, abortFlag_);
+  socket->adoptAccepted(listenSocket(), fd);
+  setRecvSocket(std::move(socket));
+}
+
+void EthernetConnection::setRecvSocket(std::unique_ptr<Socket> socket) {
+  setEthernetRecvSocketOptions(*socket);
+  std::lock_guard<std::mutex> lock(recvMutex_);
+  if (closing_) throw Error("Ethernet connection closed while accepting", ErrorCode::Aborted);
+  recvSocket_ = std::move(socket);
+  recvBuffer_.reset(new char[recvBufferSize_]);
+}
+
+Socket* EthernetConnection::listenSocket() { return getImpl(localEndpoint_)->socket_.get(); }
+
 EthernetConnection::~EthernetConnection() {
-  sendSocket_->close();
-  recvSocket_->close();
-  threadRecvMessages_.join();
+  if (reaper_) reaper_->remove(this);
+  if (acceptor_) acceptor_->remove(this);
+  {
+    // Wakes up the receiving thread waiting for a message
+    std::lock_guard<std::mutex> lock(recvMutex_);
+    closing_ = true;
+    if (recvSocket_) ::shutdown(recvSocket_->getFd(), SHUT_RD);
+  }
+  if (sendSocket_) sendSocket_->close();
+  if (threadRecvMessages_.joinable()) threadRecvMessages_.join();
+  if (recvSocket_) recvSocket_->close();
 }
 
 Transport EthernetConnection::transport() { return Transport::Ethernet; }
@@ -233,6 +415,7 @@ Transport EthernetConnection::remoteTransport() { return Transport::Ethernet; }
 
 void EthernetConnection::write(RegisteredMemory dst, uint64_t dstOffset, RegisteredMemory src, uint64_t srcOffset,
                                uint64_t size) {
+  NPKIT_CONN_WRITE(NPKIT_EVENT_CONN_WRITE_ENTRY, size);
   // Validating Transport Protocol
   validateTransport(dst, remoteTransport(), dstOffset, size);
   validateTransport(src, transport(), srcOffset, size);
@@ -240,94 +423,85 @@ void EthernetConnection::write(RegisteredMemory dst, uint64_t dstOffset, Registe
   // Initializing Variables
   char* srcPtr = reinterpret_cast<char*>(src.data()) + srcOffset / sizeof(char);
   char* dstPtr = reinterpret_cast<char*>(dst.originalDataPtr()) + dstOffset / sizeof(char);
+  EthernetMessageHeader header{dstPtr, size};
   uint64_t sentDataSize = 0;
-  uint64_t headerSize = 0;
-
-  // Copying Meta Data to Send Buffer
-  char* dstPtrBytes = reinterpret_cast<char*>(&dstPtr);
-  std::copy(dstPtrBytes, dstPtrBytes + sizeof(dstPtr), sendBuffer_.data() + headerSize / sizeof(char));
-  headerSize += sizeof(dstPtr);
-  char* sizeBytes = reinterpret_cast<char*>(&size);
-  std::copy(sizeBytes, sizeBytes + sizeof(size), sendBuffer_.data() + headerSize / sizeof(char));
-  headerSize += sizeof(size);
-
-  // Getting Data From GPU and Sending Message
-  while (sentDataSize < size) {
-    uint64_t dataSize =
-        std::min(sendBufferSize_ - headerSize / sizeof(char), (size - sentDataSize) / sizeof(char)) * sizeof(char);
-    uint64_t messageSize = dataSize + headerSize;
-    mscclpp::memcpyCuda<char>(sendBuffer_.data() + headerSize / sizeof(char),
-                              (char*)srcPtr + (sentDataSize / sizeof(char)), dataSize, cudaMemcpyDeviceToHost);
-    sendSocket_->send(sendBuffer_.data(), messageSize);
-    sentDataSize += messageSize;
-    headerSize = 0;
-  }
+  std::call_once(connectOnce_, [this]() { connectSend(); });
+  if (!sendBuffer_) sendBuffer_.reset(new char[sendBufferSize_]);
+
+  // Getting Data From GPU and Sending Message. The header goes out with the first chunk in a single call.
+  do {
+    uint64_t dataSize = std::min(sendBufferSize_, size - sentDataSize);
+    mscclpp::memcpyCuda<char>(sendBuffer_.get(), srcPtr + sentDataSize, dataSize, cudaMemcpyDeviceToHost);
+    if (sentDataSize == 0) {
+      struct iovec iov[2] = {{&header, sizeof(header)}, {sendBuffer_.get(), dataSize}};
+      sendSocket_->sendv(iov, 2);
+    } else {
+      sendSocket_->send(sendBuffer_.get(), dataSize);
+    }
+    sentDataSize += dataSize;
+  } while (sentDataSize < size);
 
   INFO(MSCCLPP_NET, "EthernetConnection write: from %p to %p, size %lu", srcPtr, dstPtr, size);
+  metrics_.writes->add();
+  metrics_.writeBytes->add(size);
+  NPKIT_CONN_WRITE(NPKIT_EVENT_CONN_WRITE_EXIT, size);
 }
 
 void EthernetConnection::updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) {
+  NPKIT_CONN_UPDATE_AND_SYNC(NPKIT_EVENT_CONN_UPDATE_AND_SYNC_ENTRY);
   // Validating Transport Protocol
   validateTransport(dst, remoteTransport());
 
   // Initializing Variables
   uint64_t oldValue = *src;
   uint64_t* dstPtr = reinterpret_cast<uint64_t*>(reinterpret_cast<char*>(dst.originalDataPtr()) + dstOffset);
-  uint64_t dataSize = sizeof(uint64_t);
-  uint64_t messageSize = 0;
+  EthernetMessageHeader header{reinterpret_cast<char*>(dstPtr), sizeof(uint64_t)};
   *src = newValue;
 
-  // Copying Data to Send Buffer
-  char* dstPtrBytes = reinterpret_cast<char*>(&dstPtr);
-  std::copy(dstPtrBytes, dstPtrBytes + sizeof(dstPtr), sendBuffer_.data() + messageSize / sizeof(char));
-  messageSize += sizeof(dstPtr);
-  char* sizeBytes = reinterpret_cast<char*>(&dataSize);
-  std::copy(sizeBytes, sizeBytes + sizeof(dataSize), sendBuffer_.data() + messageSize / sizeof(char));
-  messageSize += sizeof(dataSize);
-  char* dataBytes = reinterpret_cast<char*>(src);
-  std::copy(dataBytes, dataBytes + dataSize, sendBuffer_.data() + messageSize / sizeof(char));
-  messageSize += dataSize;
-
   // Sending Message
-  sendSocket_->send(sendBuffer_.data(), messageSize);
+  std::call_once(connectOnce_, [this]() { connectSend(); });
+  struct iovec iov[2] = {{&header, sizeof(header)}, {src, sizeof(uint64_t)}};
+  sendSocket_->sendv(iov, 2);
 
   INFO(MSCCLPP_NET, "EthernetConnection atomic write: from %p to %p, %lu -> %lu", src, dstPtr + dstOffset, oldValue,
        newValue);
+  metrics_.updateAndSyncs->add();
+  NPKIT_CONN_UPDATE_AND_SYNC(NPKIT_EVENT_CONN_UPDATE_AND_SYNC_EXIT);
 }
 
 void EthernetConnection::flush(int64_t) { INFO(MSCCLPP_NET, "EthernetConnection flushing connection"); }
 
 void EthernetConnection::recvMessages() {
-  // Declarating Variables
-  char* ptr;
-  uint64_t size;
-  uint64_t recvSize;
+  EthernetMessageHeader header = {};
   int closed = 0;
-  bool received = true;
-
-  // Receiving Messages Until Connection is Closed
-  while (recvSocket_->getState() != SocketStateClosed) {
-    // Receiving Data Address
-    if (closed == 0) recvSocket_->recvUntilEnd(&ptr, sizeof(char*), &closed);
-    received &= !closed;
-
-    // Receiving data size
-    if (closed == 0) recvSocket_->recvUntilEnd(&size, sizeof(uint64_t), &closed);
-    received &= !closed;
-
-    // Receiving Data and Copying Data yo GPU
-    recvSize = 0;
-    while (recvSize < size && closed == 0) {
-      uint64_t messageSize = std::min(recvBufferSize_, (size - recvSize) / sizeof(char)) * sizeof(char);
-      recvSocket_->recvUntilEnd(recvBuffer_.data(), messageSize, &closed);
-      received &= !closed;
-
-      if (received)
-        mscclpp::memcpyCuda<char>((char*)ptr + (recvSize / sizeof(char)), recvBuffer_.data(), messageSize,
-                                  cudaMemcpyHostToDevice);
+
+  // Receiving Messages Until the Peer Closes the Connection
+  for (;;) {
+    // Receiving Data Address and Size
+    recvSocket_->recvUntilEnd(&header, sizeof(header), &closed);
+    if (closed) return;
+
+    // Receiving Data and Copying Data to GPU
+    uint64_t recvSize = 0;
+    while (recvSize < header.size) {
+      uint64_t messageSize = std::min(recvBufferSize_, header.size - recvSize);
+      recvSocket_->recvUntilEnd(recvBuffer_.get(), messageSize, &closed);
+      if (closed) return;
+      copyReceived(header, recvSize, messageSize);
       recvSize += messageSize;
     }
+    messageReceived(header);
   }
 }
 
+void EthernetConnection::copyReceived(const EthernetMessageHeader& header, uint64_t offset, uint64_t size) {
+  mscclpp::memcpyCuda<char>(header.dst + offset, recvBuffer_.get(), size, cudaMemcpyHostToDevice);
+}
+
+void EthernetConnection::messageReceived(const EthernetMessageHeader& header) {
+  // A semaphore update may have a Host2HostSemaphore waiting on it. The destination may be device memory, which only
+  // futexWakeWaiters() accepts.
+  if (header.size == sizeof(uint64_t)) futexWakeWaiters(header.dst);
+}
+
 }  // namespace mscclpp
@@ -11,7 +11,7 @@
 
 namespace mscclpp {
 
-Context::Impl::Impl() : ipcStream_(cudaStreamNonBlocking) {}
+Context::Impl::Impl() : ethernetReaperCreated_(false), ethernetEndpoints_(0) {}
 
 IbCtx* Context::Impl::getIbContext(Transport ibTransport) {
   // Find IB context or create it
@@ -25,6 +25,24 @@ IbCtx* Context::Impl::getIbContext(Transport ibTransport) {
   }
 }
 
+cudaStream_t Context::Impl::getIpcStream() {
+  if (!ipcStream_) ipcStream_ = std::make_unique<CudaStreamWithFlags>(cudaStreamNonBlocking);
+  return *ipcStream_;
+}
+
+std::shared_ptr<EthernetReaper> Context::Impl::getEthernetReaper() {
+  if (!ethernetReaperCreated_) {
+    ethernetReaper_ = EthernetReaper::create();
+    ethernetReaperCreated_ = true;
+  }
+  return ethernetReaper_;
+}
+
+std::shared_ptr<EthernetAcceptor> Context::Impl::getEthernetAcceptor() {
+  if (!ethernetAcceptor_) ethernetAcceptor_ = std::make_shared<EthernetAcceptor>();
+  return ethernetAcceptor_;
+}
+
 MSCCLPP_API_CPP Context::Context() : pimpl_(std::make_unique<Impl>()) {}
 
 MSCCLPP_API_CPP Context::~Context() = default;
@@ -43,7 +61,7 @@ MSCCLPP_API_CPP std::shared_ptr<Connection> Context::connect(Endpoint localEndpo
     if (remoteEndpoint.transport() != Transport::CudaIpc) {
       throw mscclpp::Error("Local transport is CudaIpc but remote is not", ErrorCode::InvalidUsage);
     }
-    conn = std::make_shared<CudaIpcConnection>(localEndpoint, remoteEndpoint, pimpl_->ipcStream_);
+    conn = std::make_shared<CudaIpcConnection>(localEndpoint, remoteEndpoint, pimpl_->getIpcStream());
   } else if (AllIBTransports.has(localEndpoint.transport())) {
     if (!AllIBTransports.has(remoteEndpoint.transport())) {
       throw mscclpp::Error("Local transport is IB but remote is not", ErrorCode::InvalidUsage);
@@ -53,7 +71,10 @@ MSCCLPP_API_CPP std::shared_ptr<Connection> Context::connect(Endpoint localEndpo
     if (remoteEndpoint.transport() != Transport::Ethernet) {
       throw mscclpp::Error("Local transport is Ethernet but remote is not", ErrorCode::InvalidUsage);
     }
-    conn = std::make_shared<EthernetConnection>(localEndpoint, remoteEndpoint);
+    auto reaper = pimpl_->getEthernetReaper();
+    conn = std::make_shared<EthernetConnection>(localEndpoint, remoteEndpoint, EthernetConnectionBufferSize,
+                                                EthernetConnectionBufferSize, reaper,
+                                                reaper ? nullptr : pimpl_->getEthernetAcceptor());
   } else {
     throw mscclpp::Error("Unsupported transport", ErrorCode::InternalError);
   }
@@ -9,9 +9,14 @@
 #include <sys/syscall.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <mscclpp/gpu_utils.hpp>
 #include <mscclpp/utils.hpp>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 int mscclppDebugLevel = -1;
 static int pid = -1;
@@ -23,11 +28,119 @@ FILE* mscclppDebugFile = stdout;
 mscclppLogHandler_t mscclppDebugLogHandler = NULL;
 pthread_mutex_t mscclppDebugLock = PTHREAD_MUTEX_INITIALIZER;
 std::chrono::steady_clock::time_point mscclppEpoch;
+static std::atomic<bool> mscclppDebugAsync{false};
+static std::atomic<bool> mscclppDebugJson{false};
+static double mscclppEpochWallTime;  // seconds since the Unix epoch at mscclppEpoch
+
+// Names of the sub-systems in the order of their bits in mscclppDebugLogSubSys.
+static const char* const mscclppDebugSubsysNames[] = {"INIT", "COLL",   "P2P", "SHM",   "NET",
+                                                      "GRAPH", "TUNING", "ENV", "ALLOC", "CALL"};
+static constexpr int mscclppDebugNumSubsys = sizeof(mscclppDebugSubsysNames) / sizeof(mscclppDebugSubsysNames[0]);
+// Per sub-system levels, stored as level + 1 so that 0 means following mscclppDebugLevel.
+static int mscclppDebugSubsysLevel[mscclppDebugNumSubsys];
+static std::atomic<bool> mscclppDebugHasSubsysLevels{false};
 
 static __thread int tid = -1;
 
 void mscclppDebugDefaultLogHandler(const char* msg) { fwrite(msg, 1, strlen(msg), mscclppDebugFile); }
 
+static int mscclppDebugParseLevel(const char* str) {
+  if (strcasecmp(str, "NONE") == 0) return MSCCLPP_LOG_NONE;
+  if (strcasecmp(str, "VERSION") == 0) return MSCCLPP_LOG_VERSION;
+  if (strcasecmp(str, "WARN") == 0) return MSCCLPP_LOG_WARN;
+  if (strcasecmp(str, "INFO") == 0) return MSCCLPP_LOG_INFO;
+  if (strcasecmp(str, "ABORT") == 0) return MSCCLPP_LOG_ABORT;
+  if (strcasecmp(str, "TRACE") == 0) return MSCCLPP_LOG_TRACE;
+  return -1;
+}
+
+static void mscclppDebugSetSubsysLevelMask(uint64_t mask, int level) {
+  for (int i = 0; i < mscclppDebugNumSubsys; ++i) {
+    if ((mask & (1ULL << i)) == 0) continue;
+    __atomic_store_n(&mscclppDebugSubsysLevel[i], level < 0 ? 0 : level + 1, __ATOMIC_RELAXED);
+  }
+  bool hasSubsysLevels = false;
+  for (int i = 0; i < mscclppDebugNumSubsys; ++i) {
+    hasSubsysLevels = hasSubsysLevels || __atomic_load_n(&mscclppDebugSubsysLevel[i], __ATOMIC_RELAXED) != 0;
+  }
+  mscclppDebugHasSubsysLevels.store(hasSubsysLevels, std::memory_order_release);
+}
+
+/* Per call site rate limiting (MSCCLPP_DEBUG_RATE_LIMIT=<rate>[:<burst>])
+ *
+ * Every call site, identified by its format string and line, owns a token bucket
+ * in a fixed-size open-addressing table. Buckets refill at `rate` tokens per second
+ * up to `burst` tokens, and a message is only logged if it can take a token. Dropped
+ * messages are counted and the count is reported with the next message the call
+ * site logs. Call sites that do not find a free slot in the table are not limited.
+ */
+namespace {
+
+constexpr size_t RateLimitTableSize = 1024;  // must be a power of two
+constexpr size_t RateLimitMaxProbes = 16;
+
+struct RateLimitSite {
+  std::atomic<uint64_t> key{0};  // 0 if the slot is free
+  std::atomic_flag lock = ATOMIC_FLAG_INIT;
+  bool initialized = false;
+  double tokens = 0;
+  int64_t lastRefillNs = 0;
+  uint64_t suppressed = 0;
+};
+
+RateLimitSite rateLimitSites[RateLimitTableSize];
+std::atomic<double> rateLimitRate{0};
+std::atomic<double> rateLimitBurst{0};
+
+// Returns whether a message of the call site may be logged. If so, `suppressed` is set to the
+// number of messages of the call site dropped since the last one that was logged.
+bool rateLimitAcquire(const char* fmt, int line, uint64_t& suppressed) {
+  suppressed = 0;
+  double rate = rateLimitRate.load(std::memory_order_relaxed);
+  if (rate <= 0) return true;
+  uint64_t key = ((uint64_t)(uintptr_t)fmt * 0x9e3779b97f4a7c15ULL) ^ (uint64_t)line;
+  if (key == 0) key = 1;
+  size_t index = (size_t)(key >> 32);
+  for (size_t probe = 0; probe < RateLimitMaxProbes; ++probe) {
+    RateLimitSite& site = rateLimitSites[(index + probe) & (RateLimitTableSize - 1)];
+    uint64_t current = site.key.load(std::memory_order_acquire);
+    if (current == 0 && site.key.compare_exchange_strong(current, key)) current = key;
+    if (current != key) continue;
+
+    int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count();
+    double burst = std::max(rateLimitBurst.load(std::memory_order_relaxed), 1.0);
+    while (site.lock.test_and_set(std::memory_order_acquire)) {
+    }
+    if (!site.initialized) {
+      site.tokens = burst;
+      site.lastRefillNs = now;
+      site.initialized = true;
+    }
+    site.tokens = std::min(burst, site.tokens + (now - site.lastRefillNs) * 1e-9 * rate);
+    site.lastRefillNs = now;
+    bool allowed = site.tokens >= 1;
+    if (allowed) {
+      site.tokens -= 1;
+      suppressed = site.suppressed;
+      site.suppressed = 0;
+    } else {
+      site.suppressed++;
+    }
+    site.lock.clear(std::memory_order_release);
+    return allowed;
+  }
+  return true;
+}
+
+}  // namespace
+
+static void mscclppDebugSetRateLimitInternal(double rate, double burst) {
+  rateLimitBurst.store(burst, std::memory_order_relaxed);
+  rateLimitRate.store(rate, std::memory_order_relaxed);
+}
+
 void mscclppDebugInit() {
   pthread_mutex_lock(&mscclppDebugLock);
   if (mscclppDebugLevel != -1) {
@@ -38,21 +151,16 @@ void mscclppDebugInit() {
   int tempNcclDebugLevel = -1;
   if (mscclpp_debug == NULL) {
     tempNcclDebugLevel = MSCCLPP_LOG_NONE;
-  } else if (strcasecmp(mscclpp_debug, "VERSION") == 0) {
-    tempNcclDebugLevel = MSCCLPP_LOG_VERSION;
-  } else if (strcasecmp(mscclpp_debug, "WARN") == 0) {
-    tempNcclDebugLevel = MSCCLPP_LOG_WARN;
-  } else if (strcasecmp(mscclpp_debug, "INFO") == 0) {
-    tempNcclDebugLevel = MSCCLPP_LOG_INFO;
-  } else if (strcasecmp(mscclpp_debug, "ABORT") == 0) {
-    tempNcclDebugLevel = MSCCLPP_LOG_ABORT;
-  } else if (strcasecmp(mscclpp_debug, "TRACE") == 0) {
-    tempNcclDebugLevel = MSCCLPP_LOG_TRACE;
+  } else {
+    tempNcclDebugLevel = mscclppDebugParseLevel(mscclpp_debug);
   }
+  // The highest level of any sub-system
+  int maxDebugLevel = tempNcclDebugLevel;
 
   /* Parse the MSCCLPP_DEBUG_SUBSYS env var
    * This can be a comma separated list such as INIT,COLL
-   * or ^INIT,COLL etc
+   * or ^INIT,COLL etc. An entry like NET=WARN also sets the
+   * level of the sub-system, overriding MSCCLPP_DEBUG for it.
    */
   char* mscclppDebugSubsysEnv = getenv("MSCCLPP_DEBUG_SUBSYS");
   if (mscclppDebugSubsysEnv != NULL) {
@@ -65,31 +173,20 @@ void mscclppDebugInit() {
     char* mscclppDebugSubsys = strdup(mscclppDebugSubsysEnv);
     char* subsys = strtok(mscclppDebugSubsys, ",");
     while (subsys != NULL) {
+      char* levelStr = strchr(subsys, '=');
+      if (levelStr != NULL) *levelStr++ = '\0';
       uint64_t mask = 0;
-      if (strcasecmp(subsys, "INIT") == 0) {
-        mask = MSCCLPP_INIT;
-      } else if (strcasecmp(subsys, "COLL") == 0) {
-        mask = MSCCLPP_COLL;
-      } else if (strcasecmp(subsys, "P2P") == 0) {
-        mask = MSCCLPP_P2P;
-      } else if (strcasecmp(subsys, "SHM") == 0) {
-        mask = MSCCLPP_SHM;
-      } else if (strcasecmp(subsys, "NET") == 0) {
-        mask = MSCCLPP_NET;
-      } else if (strcasecmp(subsys, "GRAPH") == 0) {
-        mask = MSCCLPP_GRAPH;
-      } else if (strcasecmp(subsys, "TUNING") == 0) {
-        mask = MSCCLPP_TUNING;
-      } else if (strcasecmp(subsys, "ENV") == 0) {
-        mask = MSCCLPP_ENV;
-      } else if (strcasecmp(subsys, "ALLOC") == 0) {
-        mask = MSCCLPP_ALLOC;
-      } else if (strcasecmp(subsys, "CALL") == 0) {
-        mask = MSCCLPP_CALL;
-      } else if (strcasecmp(subsys, "ALL") == 0) {
-        mask = MSCCLPP_ALL;
+      for (int i = 0; i < mscclppDebugNumSubsys; ++i) {
+        if (strcasecmp(subsys, mscclppDebugSubsysNames[i]) == 0) mask = 1ULL << i;
       }
-      if (mask) {
+      if (strcasecmp(subsys, "ALL") == 0) mask = MSCCLPP_ALL;
+      int level = (levelStr != NULL) ? mscclppDebugParseLevel(levelStr) : -1;
+      if (mask && level >= 0) {
+        // A sub-system with its own level is always enabled
+        mscclppDebugSetSubsysLevelMask(mask, level);
+        mscclppDebugMask |= mask;
+        maxDebugLevel = std::max(maxDebugLevel, level);
+      } else if (mask) {
         if (invert)
           mscclppDebugMask &= ~mask;
         else
@@ -109,7 +206,7 @@ void mscclppDebugInit() {
    * MSCCLPP_DEBUG level is > VERSION
    */
   const char* mscclppDebugFileEnv = getenv("MSCCLPP_DEBUG_FILE");
-  if (tempNcclDebugLevel > MSCCLPP_LOG_VERSION && mscclppDebugFileEnv != NULL) {
+  if (maxDebugLevel > MSCCLPP_LOG_VERSION && mscclppDebugFileEnv != NULL) {
     int c = 0;
     char debugFn[PATH_MAX + 1] = "";
     char* dfn = debugFn;
@@ -146,11 +243,698 @@ void mscclppDebugInit() {
 
   if (mscclppDebugLogHandler == NULL) mscclppDebugLogHandler = mscclppDefaultLogHandler;
 
+  /* MSCCLPP_DEBUG_ASYNC=1 hands INFO and TRACE messages over to a background writer thread
+   * instead of formatting and writing them on the calling thread.
+   */
+  const char* mscclppDebugAsyncEnv = getenv("MSCCLPP_DEBUG_ASYNC");
+  if (maxDebugLevel > MSCCLPP_LOG_WARN && mscclppDebugAsyncEnv != NULL && atoi(mscclppDebugAsyncEnv) != 0) {
+    mscclppDebugAsync.store(true, std::memory_order_release);
+  }
+
+  const char* mscclppDebugFormatEnv = getenv("MSCCLPP_DEBUG_FORMAT");
+  if (mscclppDebugFormatEnv != NULL && strcasecmp(mscclppDebugFormatEnv, "JSON") == 0) {
+    mscclppDebugJson.store(true, std::memory_order_release);
+  }
+
+  const char* mscclppDebugRateLimitEnv = getenv("MSCCLPP_DEBUG_RATE_LIMIT");
+  if (mscclppDebugRateLimitEnv != NULL) {
+    char* end;
+    double rate = strtod(mscclppDebugRateLimitEnv, &end);
+    double burst = (*end == ':') ? strtod(end + 1, NULL) : rate;
+    mscclppDebugSetRateLimitInternal(rate, burst);
+  }
+
   mscclppEpoch = std::chrono::steady_clock::now();
+  mscclppEpochWallTime = std::chrono::duration_cast<std::chrono::duration<double>>(
+                             std::chrono::system_clock::now().time_since_epoch())
+                             .count();
   __atomic_store_n(&mscclppDebugLevel, tempNcclDebugLevel, __ATOMIC_RELEASE);
   pthread_mutex_unlock(&mscclppDebugLock);
 }
 
+static const char* mscclppDebugLevelName(mscclppDebugLogLevel level, unsigned long flags) {
+  switch (level) {
+    case MSCCLPP_LOG_VERSION:
+      return "VERSION";
+    case MSCCLPP_LOG_WARN:
+      return "WARN";
+    case MSCCLPP_LOG_INFO:
+      return "INFO";
+    case MSCCLPP_LOG_ABORT:
+      return "ABORT";
+    case MSCCLPP_LOG_TRACE:
+      return flags == MSCCLPP_CALL ? "CALL" : "TRACE";
+    default:
+      return "";
+  }
+}
+
+static size_t mscclppDebugLogPrefix(char* buffer, size_t size, mscclppDebugLogLevel level, unsigned long flags,
+                                    const char* filefunc, int line, int tid, int cudaDev, double timestamp) {
+  int len = 0;
+  if (level == MSCCLPP_LOG_WARN) {
+    len = snprintf(buffer, size, "%s:%d:%d [%d] %s:%d MSCCLPP WARN ", hostname.c_str(), pid, tid, cudaDev, filefunc,
+                   line);
+  } else if (level == MSCCLPP_LOG_INFO || level == MSCCLPP_LOG_VERSION || level == MSCCLPP_LOG_ABORT) {
+    len = snprintf(buffer, size, "%s:%d:%d [%d] MSCCLPP %s ", hostname.c_str(), pid, tid, cudaDev,
+                   mscclppDebugLevelName(level, flags));
+  } else if (level == MSCCLPP_LOG_TRACE && flags == MSCCLPP_CALL) {
+    len = snprintf(buffer, size, "%s:%d:%d MSCCLPP CALL ", hostname.c_str(), pid, tid);
+  } else if (level == MSCCLPP_LOG_TRACE) {
+    len = snprintf(buffer, size, "%s:%d:%d [%d] %f %s:%d MSCCLPP TRACE ", hostname.c_str(), pid, tid, cudaDev,
+                   timestamp, filefunc, line);
+  }
+  return len > 0 ? std::min((size_t)len, size - 1) : 0;
+}
+
+// Escape `in` as the contents of a JSON string. Stops early rather than splitting an escape sequence.
+static size_t mscclppDebugJsonEscape(char* out, size_t size, const char* in) {
+  size_t len = 0;
+  for (; *in != '\0'; ++in) {
+    char escaped[8];
+    unsigned char c = (unsigned char)*in;
+    int n = 1;
+    escaped[0] = c;
+    if (c == '"' || c == '\\') {
+      n = snprintf(escaped, sizeof(escaped), "\\%c", c);
+    } else if (c == '\n') {
+      n = snprintf(escaped, sizeof(escaped), "\\n");
+    } else if (c == '\t') {
+      n = snprintf(escaped, sizeof(escaped), "\\t");
+    } else if (c < 0x20) {
+      n = snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+    }
+    if (len + n + 1 > size) break;
+    memcpy(out + len, escaped, n);
+    len += n;
+  }
+  if (size > 0) out[len] = '\0';
+  return len;
+}
+
+// Render a complete log line including the trailing newline, either as text or as a JSON object
+// (MSCCLPP_DEBUG_FORMAT=JSON). `timestamp` is in milliseconds since mscclppEpoch.
+static size_t mscclppDebugFormatLine(char* buffer, size_t size, mscclppDebugLogLevel level, unsigned long flags,
+                                     const char* filefunc, int line, int tid, int cudaDev, double timestamp,
+                                     const char* msg) {
+  size_t len;
+  if (!mscclppDebugJson.load(std::memory_order_relaxed)) {
+    len = mscclppDebugLogPrefix(buffer, size, level, flags, filefunc, line, tid, cudaDev, timestamp);
+    int ret = snprintf(buffer + len, size - len, "%s", msg);
+    if (ret > 0) len = std::min(len + ret, size - 2);
+    buffer[len++] = '\n';
+    buffer[len] = '\0';
+    return len;
+  }
+  char subsys[128] = "";
+  if (flags != (unsigned long)MSCCLPP_ALL) {
+    size_t subsysLen = 0;
+    for (int i = 0; i < mscclppDebugNumSubsys; ++i) {
+      if ((flags & (1UL << i)) == 0) continue;
+      int ret = snprintf(subsys + subsysLen, sizeof(subsys) - subsysLen, "%s%s", subsysLen > 0 ? "|" : "",
+                         mscclppDebugSubsysNames[i]);
+      if (ret > 0) subsysLen = std::min(subsysLen + ret, sizeof(subsys) - 1);
+    }
+  }
+  char source[256];
+  mscclppDebugJsonEscape(source, sizeof(source), filefunc);
+  int ret = snprintf(buffer, size,
+                     "{\"time\":%.6f,\"host\":\"%s\",\"pid\":%d,\"tid\":%d,\"dev\":%d,\"level\":\"%s\","
+                     "\"subsys\":\"%s\",\"source\":\"%s\",\"line\":%d,\"msg\":\"",
+                     mscclppEpochWallTime + timestamp / 1000, hostname.c_str(), pid, tid, cudaDev,
+                     mscclppDebugLevelName(level, flags), subsys, source, line);
+  // Leave room for closing the object
+  len = ret > 0 ? std::min((size_t)ret, size - 4) : 0;
+  len += mscclppDebugJsonEscape(buffer + len, size - len - 3, msg);
+  memcpy(buffer + len, "\"}\n", 4);
+  return len + 3;
+}
+
+static double mscclppDebugTimestamp() {
+  auto delta = std::chrono::steady_clock::now() - mscclppEpoch;
+  return std::chrono::duration_cast<std::chrono::duration<double>>(delta).count() * 1000;
+}
+
+/* Asynchronous logging backend (MSCCLPP_DEBUG_ASYNC=1)
+ *
+ * Each logging thread owns a single-producer/single-consumer ring of fixed-size
+ * records. A record holds the format string pointer (format strings are literals
+ * with static storage, so the pointer serves as the format id) followed by the
+ * raw arguments decoded according to the format. A background writer thread
+ * drains all rings, renders the lines and calls mscclppDebugLogHandler, so the
+ * calling thread never formats, takes a lock or touches the file.
+ *
+ * When a ring is full the record is dropped and counted; the writer reports the
+ * number of dropped records. WARN messages keep going through the synchronous
+ * path (after flushing the pending records) so that they are never lost.
+ */
+namespace {
+
+constexpr size_t AsyncLogRecordSize = 512;
+constexpr uint64_t AsyncLogRingSize = 512;  // records per thread, must be a power of two
+
+struct AsyncLogRecordHeader {
+  const char* fmt;
+  const char* filefunc;
+  unsigned long flags;
+  double timestamp;
+  int line;
+  int tid;
+  int cudaDev;
+  uint16_t argsSize;
+  uint8_t level;
+  uint8_t preformatted;
+};
+
+struct AsyncLogRecord : AsyncLogRecordHeader {
+  char args[AsyncLogRecordSize - sizeof(AsyncLogRecordHeader)];
+};
+static_assert(sizeof(AsyncLogRecord) == AsyncLogRecordSize, "unexpected AsyncLogRecord size");
+
+struct AsyncLogRing {
+  alignas(64) std::atomic<uint64_t> head{0};
+  alignas(64) std::atomic<uint64_t> tail{0};
+  std::atomic<uint64_t> dropped{0};
+  std::atomic<bool> orphaned{false};
+  uint64_t reportedDropped = 0;  // only accessed by the consumer
+  AsyncLogRecord records[AsyncLogRingSize];
+};
+
+// A single printf conversion specification, e.g. "%-8.*lu".
+struct AsyncLogFormatSpec {
+  const char* begin;  // points to '%'
+  const char* end;    // one past the conversion character
+  int numStars;       // number of '*' width/precision arguments
+  int precision;      // -1 if there is no precision or it is given by '*'
+  bool starPrecision;  // whether the precision is given by '*'
+  char length;        // 0, 'H' (hh), 'h', 'l', 'q' (ll), 'z', 'j' or 't'
+  char conversion;
+};
+
+// Parse the conversion specification starting at `p` (which points to '%').
+// Returns false for specifications the asynchronous path does not support
+// (positional arguments, %n, wide characters, long double).
+bool asyncLogParseSpec(const char* p, AsyncLogFormatSpec& spec) {
+  spec.begin = p++;
+  spec.numStars = 0;
+  spec.precision = -1;
+  spec.starPrecision = false;
+  spec.length = 0;
+  while (*p != '\0' && strchr("-+ #0'", *p) != nullptr) p++;
+  if (*p == '*') {
+    spec.numStars++;
+    p++;
+  } else {
+    while (*p >= '0' && *p <= '9') p++;
+  }
+  if (*p == '$') return false;
+  if (*p == '.') {
+    p++;
+    if (*p == '*') {
+      spec.numStars++;
+      spec.starPrecision = true;
+      p++;
+    } else {
+      spec.precision = 0;
+      while (*p >= '0' && *p <= '9') spec.precision = spec.precision * 10 + (*p++ - '0');
+    }
+  }
+  switch (*p) {
+    case 'h':
+      spec.length = (p[1] == 'h') ? 'H' : 'h';
+      p += (p[1] == 'h') ? 2 : 1;
+      break;
+    case 'l':
+      spec.length = (p[1] == 'l') ? 'q' : 'l';
+      p += (p[1] == 'l') ? 2 : 1;
+      break;
+    case 'z':
+    case 'j':
+    case 't':
+      spec.length = *p++;
+      break;
+    case 'L':
+      return false;
+  }
+  spec.conversion = *p;
+  if (spec.conversion == '\0' || strchr("diouxXcsfFeEgGaAp%", spec.conversion) == nullptr) return false;
+  if (spec.length == 'l' && (spec.conversion == 'c' || spec.conversion == 's')) return false;
+  spec.end = p + 1;
+  return true;
+}
+
+template <typename T>
+bool asyncLogPut(AsyncLogRecord& rec, const T& value) {
+  if (rec.argsSize + sizeof(T) > sizeof(rec.args)) return false;
+  memcpy(rec.args + rec.argsSize, &value, sizeof(T));
+  rec.argsSize += sizeof(T);
+  return true;
+}
+
+template <typename T>
+T asyncLogGet(const AsyncLogRecord& rec, size_t& offset) {
+  T value;
+  memcpy(&value, rec.args + offset, sizeof(T));
+  offset += sizeof(T);
+  return value;
+}
+
+int64_t asyncLogReadSigned(char length, va_list* vargs) {
+  switch (length) {
+    case 'l':
+      return va_arg(*vargs, long);
+    case 'q':
+      return va_arg(*vargs, long long);
+    case 'z':
+      return va_arg(*vargs, ssize_t);
+    case 'j':
+      return va_arg(*vargs, intmax_t);
+    case 't':
+      return va_arg(*vargs, ptrdiff_t);
+    default:
+      return va_arg(*vargs, int);
+  }
+}
+
+uint64_t asyncLogReadUnsigned(char length, va_list* vargs) {
+  switch (length) {
+    case 'l':
+      return va_arg(*vargs, unsigned long);
+    case 'q':
+      return va_arg(*vargs, unsigned long long);
+    case 'z':
+      return va_arg(*vargs, size_t);
+    case 'j':
+      return va_arg(*vargs, uintmax_t);
+    case 't':
+      return va_arg(*vargs, ptrdiff_t);
+    default:
+      return va_arg(*vargs, unsigned int);
+  }
+}
+
+// Decode the arguments of `fmt` from `vargs` into `rec.args`. Returns false if the
+// format is not supported or the arguments do not fit into the record.
+bool asyncLogCapture(AsyncLogRecord& rec, const char* fmt, va_list* vargs) {
+  for (const char* p = strchr(fmt, '%'); p != nullptr; p = strchr(p, '%')) {
+    AsyncLogFormatSpec spec;
+    if (!asyncLogParseSpec(p, spec)) return false;
+    p = spec.end;
+    if (spec.conversion == '%') continue;
+    int stars[2] = {0, 0};
+    for (int i = 0; i < spec.numStars; ++i) {
+      stars[i] = va_arg(*vargs, int);
+      if (!asyncLogPut(rec, stars[i])) return false;
+    }
+    bool ok = true;
+    switch (spec.conversion) {
+      case 'd':
+      case 'i':
+        ok = asyncLogPut(rec, asyncLogReadSigned(spec.length, vargs));
+        break;
+      case 'o':
+      case 'u':
+      case 'x':
+      case 'X':
+        ok = asyncLogPut(rec, asyncLogReadUnsigned(spec.length, vargs));
+        break;
+      case 'c':
+        ok = asyncLogPut(rec, va_arg(*vargs, int));
+        break;
+      case 'p':
+        ok = asyncLogPut(rec, va_arg(*vargs, void*));
+        break;
+      case 's': {
+        const char* str = va_arg(*vargs, const char*);
+        // A negative length encodes a null pointer, which printf renders as "(null)".
+        int32_t len = -1;
+        if (str != nullptr) {
+          int precision = spec.starPrecision ? stars[spec.numStars - 1] : spec.precision;
+          len = (int32_t)((precision >= 0) ? strnlen(str, precision) : strlen(str));
+        }
+        ok = asyncLogPut(rec, len);
+        if (ok && len > 0) {
+          if (rec.argsSize + (size_t)len + 1 > sizeof(rec.args)) return false;
+          memcpy(rec.args + rec.argsSize, str, len);
+          rec.argsSize += len;
+        }
+        if (ok && len >= 0) ok = asyncLogPut(rec, '\0');
+        break;
+      }
+      default:  // floating point conversions
+        ok = asyncLogPut(rec, va_arg(*vargs, double));
+        break;
+    }
+    if (!ok) return false;
+  }
+  return true;
+}
+
+template <typename T>
+int asyncLogRenderOne(char* out, size_t size, const char* spec, int numStars, const int* stars, T value) {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+  if (numStars == 0) return snprintf(out, size, spec, value);
+  if (numStars == 1) return snprintf(out, size, spec, stars[0], value);
+  return snprintf(out, size, spec, stars[0], stars[1], value);
+#pragma GCC diagnostic pop
+}
+
+// Render the message of `rec` into `out`, the inverse of asyncLogCapture.
+size_t asyncLogRender(const AsyncLogRecord& rec, char* out, size_t size) {
+  if (size == 0) return 0;
+  if (rec.preformatted) return snprintf(out, size, "%s", rec.args);
+  size_t len = 0;
+  size_t offset = 0;
+  const char* p = rec.fmt;
+  char spec[32];
+  while (*p != '\0' && len + 1 < size) {
+    if (*p != '%') {
+      out[len++] = *p++;
+      continue;
+    }
+    AsyncLogFormatSpec parsed;
+    asyncLogParseSpec(p, parsed);  // validated at capture time
+    p = parsed.end;
+    if (parsed.conversion == '%') {
+      out[len++] = '%';
+      continue;
+    }
+    size_t specLen = std::min((size_t)(parsed.end - parsed.begin), sizeof(spec) - 1);
+    memcpy(spec, parsed.begin, specLen);
+    spec[specLen] = '\0';
+    int stars[2] = {0, 0};
+    for (int i = 0; i < parsed.numStars; ++i) stars[i] = asyncLogGet<int>(rec, offset);
+    char* dst = out + len;
+    size_t avail = size - len;
+    int ret = 0;
+    switch (parsed.conversion) {
+      case 'd':
+      case 'i': {
+        int64_t v = asyncLogGet<int64_t>(rec, offset);
+        switch (parsed.length) {
+          case 'l':
+            ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, (long)v);
+            break;
+          case 'q':
+            ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, (long long)v);
+            break;
+          case 'z':
+            ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, (ssize_t)v);
+            break;
+          case 'j':
+            ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, (intmax_t)v);
+            break;
+          case 't':
+            ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, (ptrdiff_t)v);
+            break;
+          default:
+            ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, (int)v);
+            break;
+        }
+        break;
+      }
+      case 'o':
+      case 'u':
+      case 'x':
+      case 'X': {
+        uint64_t v = asyncLogGet<uint64_t>(rec, offset);
+        switch (parsed.length) {
+          case 'l':
+            ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, (unsigned long)v);
+            break;
+          case 'q':
+            ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, (unsigned long long)v);
+            break;
+          case 'z':
+            ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, (size_t)v);
+            break;
+          case 'j':
+            ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, (uintmax_t)v);
+            break;
+          case 't':
+            ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, (ptrdiff_t)v);
+            break;
+          default:
+            ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, (unsigned int)v);
+            break;
+        }
+        break;
+      }
+      case 'c':
+        ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, asyncLogGet<int>(rec, offset));
+        break;
+      case 'p':
+        ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, asyncLogGet<void*>(rec, offset));
+        break;
+      case 's': {
+        int32_t strLen = asyncLogGet<int32_t>(rec, offset);
+        const char* str = nullptr;
+        if (strLen >= 0) {
+          str = rec.args + offset;
+          offset += strLen + 1;
+        }
+        ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, str);
+        break;
+      }
+      default:
+        ret = asyncLogRenderOne(dst, avail, spec, parsed.numStars, stars, asyncLogGet<double>(rec, offset));
+        break;
+    }
+    if (ret > 0) len += std::min((size_t)ret, avail - 1);
+  }
+  out[len] = '\0';
+  return len;
+}
+
+class AsyncLogger {
+ public:
+  AsyncLogger() : running_(true), writer_([this]() { run(); }) {}
+
+  ~AsyncLogger() {
+    mscclppDebugAsync.store(false, std::memory_order_release);
+    running_.store(false, std::memory_order_release);
+    if (writer_.joinable()) writer_.join();
+    drain();
+    // Rings of threads that are still alive are intentionally leaked, since those
+    // threads may still be holding a pointer to them.
+  }
+
+  AsyncLogRing* registerRing() {
+    AsyncLogRing* ring = new AsyncLogRing();
+    std::lock_guard<std::mutex> lock(ringsMutex_);
+    rings_.push_back(ring);
+    return ring;
+  }
+
+  void flush() { drain(); }
+
+ private:
+  void run() {
+    mscclppSetThreadName(pthread_self(), "MSCCLPP-Log");
+    while (running_.load(std::memory_order_acquire)) {
+      if (!drain()) std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+  }
+
+  // Write out all pending records. Returns true if anything was written.
+  bool drain() {
+    std::lock_guard<std::mutex> drainLock(drainMutex_);
+    std::vector<AsyncLogRing*> rings;
+    {
+      std::lock_guard<std::mutex> lock(ringsMutex_);
+      rings = rings_;
+    }
+    bool written = false;
+    char msg[1024];
+    char buffer[2048];
+    for (AsyncLogRing* ring : rings) {
+      bool orphaned = ring->orphaned.load(std::memory_order_acquire);
+      uint64_t head = ring->head.load(std::memory_order_acquire);
+      uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+      for (; tail != head; ++tail) {
+        const AsyncLogRecord& rec = ring->records[tail & (AsyncLogRingSize - 1)];
+        asyncLogRender(rec, msg, sizeof(msg));
+        mscclppDebugFormatLine(buffer, sizeof(buffer), (mscclppDebugLogLevel)rec.level, rec.flags, rec.filefunc,
+                               rec.line, rec.tid, rec.cudaDev, rec.timestamp, msg);
+        mscclppDebugLogHandler(buffer);
+        written = true;
+      }
+      ring->tail.store(tail, std::memory_order_release);
+      uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+      if (dropped != ring->reportedDropped) {
+        snprintf(msg, sizeof(msg), "%lu log records dropped by the asynchronous logger",
+                 (unsigned long)(dropped - ring->reportedDropped));
+        if (mscclppDebugJson.load(std::memory_order_relaxed)) {
+          mscclppDebugFormatLine(buffer, sizeof(buffer), MSCCLPP_LOG_INFO, MSCCLPP_ALL, "", 0, -1, -1,
+                                 mscclppDebugTimestamp(), msg);
+        } else {
+          snprintf(buffer, sizeof(buffer), "%s:%d MSCCLPP INFO %s\n", hostname.c_str(), pid, msg);
+        }
+        mscclppDebugLogHandler(buffer);
+        ring->reportedDropped = dropped;
+        written = true;
+      }
+      if (orphaned) {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        rings_.erase(std::find(rings_.begin(), rings_.end(), ring));
+        delete ring;
+      }
+    }
+    return written;
+  }
+
+  std::atomic<bool> running_;
+  std::mutex ringsMutex_;
+  std::mutex drainMutex_;
+  std::vector<AsyncLogRing*> rings_;
+  std::thread writer_;
+};
+
+AsyncLogger& asyncLogger() {
+  static AsyncLogger logger;
+  return logger;
+}
+
+struct AsyncLogThreadState {
+  AsyncLogRing* ring = nullptr;
+  int tid = -1;
+  int cudaDev = -1;
+  // Set once the thread exits, as the writer may free the ring anytime after. Messages of destructors that run later
+  // on the thread are logged synchronously.
+  bool destroyed = false;
+  ~AsyncLogThreadState() {
+    if (ring != nullptr) ring->orphaned.store(true, std::memory_order_release);
+    ring = nullptr;
+    destroyed = true;
+  }
+};
+
+thread_local AsyncLogThreadState asyncLogThreadState;
+
+// Queues a message to the writer thread. Returns false if the thread is exiting, in which case the message has to be
+// logged synchronously.
+bool mscclppDebugLogAsync(mscclppDebugLogLevel level, unsigned long flags, const char* filefunc, int line,
+                          const char* fmt, va_list* vargs) {
+  AsyncLogThreadState& state = asyncLogThreadState;
+  if (state.destroyed) return false;
+  if (state.ring == nullptr) {
+    state.tid = syscall(SYS_gettid);
+    // The device is sampled once per thread; threads are expected to be bound to a device before they log.
+    if (cudaGetDevice(&state.cudaDev) != cudaSuccess) state.cudaDev = -1;
+    state.ring = asyncLogger().registerRing();
+  }
+  AsyncLogRing* ring = state.ring;
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  if (head - ring->tail.load(std::memory_order_acquire) >= AsyncLogRingSize) {
+    ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+  }
+  AsyncLogRecord& rec = ring->records[head & (AsyncLogRingSize - 1)];
+  rec.fmt = fmt;
+  rec.filefunc = filefunc;
+  rec.flags = flags;
+  bool timestamped = level == MSCCLPP_LOG_TRACE && flags != MSCCLPP_CALL;
+  timestamped = timestamped || mscclppDebugJson.load(std::memory_order_relaxed);
+  rec.timestamp = timestamped ? mscclppDebugTimestamp() : 0;
+  rec.line = line;
+  rec.tid = state.tid;
+  rec.cudaDev = state.cudaDev;
+  rec.level = (uint8_t)level;
+  rec.argsSize = 0;
+  va_list captureArgs;
+  va_copy(captureArgs, *vargs);
+  rec.preformatted = !asyncLogCapture(rec, fmt, &captureArgs);
+  va_end(captureArgs);
+  if (rec.preformatted) {
+    // Formats that cannot be decoded are rendered on the calling thread instead.
+    (void)vsnprintf(rec.args, sizeof(rec.args), fmt, *vargs);
+  }
+  ring->head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+}  // namespace
+
+void mscclppDebugSetAsync(int enable) {
+  if (__atomic_load_n(&mscclppDebugLevel, __ATOMIC_ACQUIRE) == -1) mscclppDebugInit();
+  if (enable) asyncLogger();
+  mscclppDebugAsync.store(enable != 0, std::memory_order_release);
+}
+
+void mscclppDebugFlush() {
+  if (mscclppDebugAsync.load(std::memory_order_acquire)) asyncLogger().flush();
+}
+
+void mscclppDebugSetSubsysLevel(unsigned long subsys, int level) {
+  if (__atomic_load_n(&mscclppDebugLevel, __ATOMIC_ACQUIRE) == -1) mscclppDebugInit();
+  mscclppDebugSetSubsysLevelMask(subsys, level);
+}
+
+void mscclppDebugSetRateLimit(double rate, double burst) {
+  if (__atomic_load_n(&mscclppDebugLevel, __ATOMIC_ACQUIRE) == -1) mscclppDebugInit();
+  mscclppDebugSetRateLimitInternal(rate, burst);
+}
+
+void mscclppDebugSetJson(int enable) {
+  if (__atomic_load_n(&mscclppDebugLevel, __ATOMIC_ACQUIRE) == -1) mscclppDebugInit();
+  mscclppDebugJson.store(enable != 0, std::memory_order_release);
+}
+
+// Whether a message of the given level and sub-systems is enabled by MSCCLPP_DEBUG and MSCCLPP_DEBUG_SUBSYS
+static bool mscclppDebugEnabled(mscclppDebugLogLevel level, unsigned long flags) {
+  uint64_t enabled = flags & mscclppDebugMask;
+  if (enabled == 0) return false;
+  if (!mscclppDebugHasSubsysLevels.load(std::memory_order_acquire)) return level <= mscclppDebugLevel;
+  // Enabled if any of the sub-systems of the message is at the level or above
+  for (; enabled != 0; enabled &= enabled - 1) {
+    int i = __builtin_ctzll(enabled);
+    int subsysLevel = (i < mscclppDebugNumSubsys) ? __atomic_load_n(&mscclppDebugSubsysLevel[i], __ATOMIC_RELAXED) : 0;
+    if (level <= (subsysLevel > 0 ? subsysLevel - 1 : mscclppDebugLevel)) return true;
+  }
+  return false;
+}
+
+// Write out a message that passed the level and rate checks
+static void mscclppDebugLogV(mscclppDebugLogLevel level, unsigned long flags, const char* filefunc, int line,
+                             const char* fmt, va_list* vargs) {
+  if (level != MSCCLPP_LOG_WARN && level != MSCCLPP_LOG_ABORT && mscclppDebugAsync.load(std::memory_order_relaxed) &&
+      mscclppDebugLogAsync(level, flags, filefunc, line, fmt, vargs)) {
+    return;
+  }
+  // Keep the order of messages logged before this one
+  mscclppDebugFlush();
+
+  if (tid == -1) {
+    tid = syscall(SYS_gettid);
+  }
+
+  int cudaDev = -1;
+  if (!(level == MSCCLPP_LOG_TRACE && flags == MSCCLPP_CALL)) {
+    MSCCLPP_CUDATHROW(cudaGetDevice(&cudaDev));
+  }
+
+  char msg[1024];
+  char buffer[2048];
+  bool timestamped = (level == MSCCLPP_LOG_TRACE) || mscclppDebugJson.load(std::memory_order_relaxed);
+  double timestamp = timestamped ? mscclppDebugTimestamp() : 0;
+  if (vsnprintf(msg, sizeof(msg), fmt, *vargs) >= 0) {
+    mscclppDebugFormatLine(buffer, sizeof(buffer), level, flags, filefunc, line, tid, cudaDev, timestamp, msg);
+    mscclppDebugLogHandler(buffer);
+  }
+}
+
+static void mscclppDebugLogF(mscclppDebugLogLevel level, unsigned long flags, const char* filefunc, int line,
+                             const char* fmt, ...) __attribute__((format(printf, 5, 6)));
+
+static void mscclppDebugLogF(mscclppDebugLogLevel level, unsigned long flags, const char* filefunc, int line,
+                             const char* fmt, ...) {
+  va_list vargs;
+  va_start(vargs, fmt);
+  mscclppDebugLogV(level, flags, filefunc, line, fmt, &vargs);
+  va_end(vargs);
+}
+
 /* Common logging function used by the INFO, WARN and TRACE macros
  * Also exported to the dynamically loadable Net transport modules so
  * they can share the debugging mechanisms and output files
@@ -171,45 +955,22 @@ void mscclppDebugLog(mscclppDebugLogLevel level, unsigned long flags, const char
     va_end(vargs);
     pthread_mutex_unlock(&mscclppDebugLock);
   }
-  if (mscclppDebugLevel < level || ((flags & mscclppDebugMask) == 0)) return;
+  if (!mscclppDebugEnabled(level, flags) || mscclppDebugLevelName(level, flags)[0] == '\0') return;
 
-  if (tid == -1) {
-    tid = syscall(SYS_gettid);
-  }
-
-  int cudaDev;
-  if (!(level == MSCCLPP_LOG_TRACE && flags == MSCCLPP_CALL)) {
-    MSCCLPP_CUDATHROW(cudaGetDevice(&cudaDev));
-  }
-
-  char buffer[1024];
-  size_t len = 0;
-  if (level == MSCCLPP_LOG_WARN) {
-    len = snprintf(buffer, sizeof(buffer), "%s:%d:%d [%d] %s:%d MSCCLPP WARN ", hostname.c_str(), pid, tid, cudaDev,
-                   filefunc, line);
-  } else if (level == MSCCLPP_LOG_INFO) {
-    len = snprintf(buffer, sizeof(buffer), "%s:%d:%d [%d] MSCCLPP INFO ", hostname.c_str(), pid, tid, cudaDev);
-  } else if (level == MSCCLPP_LOG_TRACE && flags == MSCCLPP_CALL) {
-    len = snprintf(buffer, sizeof(buffer), "%s:%d:%d MSCCLPP CALL ", hostname.c_str(), pid, tid);
-  } else if (level == MSCCLPP_LOG_TRACE) {
-    auto delta = std::chrono::steady_clock::now() - mscclppEpoch;
-    double timestamp = std::chrono::duration_cast<std::chrono::duration<double>>(delta).count() * 1000;
-    len = snprintf(buffer, sizeof(buffer), "%s:%d:%d [%d] %f %s:%d MSCCLPP TRACE ", hostname.c_str(), pid, tid, cudaDev,
-                   timestamp, filefunc, line);
-  }
-
-  if (len > 0) {
-    va_list vargs;
-    va_start(vargs, fmt);
-    int ret = vsnprintf(buffer + len, sizeof(buffer) - len, fmt, vargs);
-    va_end(vargs);
-    if (ret >= 0) {
-      len += ret;
-      buffer[len++] = '\n';
-      buffer[len] = '\0';
-      mscclppDebugLogHandler(buffer);
+  // Warnings and aborts are never rate limited
+  if (level != MSCCLPP_LOG_WARN && level != MSCCLPP_LOG_ABORT) {
+    uint64_t suppressed;
+    if (!rateLimitAcquire(fmt, line, suppressed)) return;
+    if (suppressed > 0) {
+      mscclppDebugLogF(level, flags, filefunc, line, "%lu messages of this call site were dropped by the rate limit",
+                       (unsigned long)suppressed);
     }
   }
+
+  va_list vargs;
+  va_start(vargs, fmt);
+  mscclppDebugLogV(level, flags, filefunc, line, fmt, &vargs);
+  va_end(vargs);
 }
 
 mscclppResult_t mscclppDebugSetLogHandler(mscclppLogHandler_t handler) {
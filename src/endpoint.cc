@@ -3,17 +3,22 @@
 
 #include "endpoint.hpp"
 
+#include <stdlib.h>
+#include <string.h>
+
 #include <algorithm>
+#include <mscclpp/numa.hpp>
 
 #include "api.h"
 #include "context.hpp"
+#include "debug.h"
 #include "socket.h"
 #include "utils_internal.hpp"
 
 namespace mscclpp {
 
 Endpoint::Impl::Impl(EndpointConfig config, Context::Impl& contextImpl)
-    : transport_(config.transport), hostHash_(getHostHash()) {
+    : transport_(config.transport), hostHash_(getHostHash()), lazy_(config.lazy) {
   if (AllIBTransports.has(transport_)) {
     ibLocal_ = true;
     ibQp_ = contextImpl.getIbContext(transport_)
@@ -22,8 +27,7 @@ Endpoint::Impl::Impl(EndpointConfig config, Context::Impl& contextImpl)
   } else if (transport_ == Transport::Ethernet) {
     // Configuring Ethernet Interfaces
     abortFlag_ = 0;
-    int ret = FindInterfaces(netIfName_, &socketAddress_, MAX_IF_NAME_SIZE, 1);
-    if (ret <= 0) throw Error("NET/Socket", ErrorCode::InternalError);
+    selectEthernetInterface(config, contextImpl.ethernetEndpoints_++);
 
     // Starting Server Socket
     socket_ = std::make_unique<Socket>(&socketAddress_, MSCCLPP_SOCKET_MAGIC, SocketTypeBootstrap, abortFlag_);
@@ -32,6 +36,70 @@ Endpoint::Impl::Impl(EndpointConfig config, Context::Impl& contextImpl)
   }
 }
 
+// Returns the NUMA node of the current GPU, or -1 if there is none.
+static int currentDeviceNumaNode() {
+  int cudaDev;
+  if (cudaGetDevice(&cudaDev) != cudaSuccess) {
+    (void)cudaGetLastError();
+    return -1;
+  }
+  try {
+    return getDeviceNumaNode(cudaDev);
+  } catch (const Error&) {
+    return -1;
+  }
+}
+
+std::vector<int> selectEthernetInterfaces(const std::vector<EthernetInterfaceInfo>& interfaces, int numaNode,
+                                          bool userSpecified) {
+  std::vector<int> physical;
+  std::vector<int> local;
+  for (int i = 0; i < (int)interfaces.size(); ++i) {
+    if (!interfaces[i].hasDevice) continue;
+    physical.push_back(i);
+    if (numaNode >= 0 && interfaces[i].numaNode == numaNode) local.push_back(i);
+  }
+  if (!local.empty()) return local;
+  // Without locality, detected interfaces may include ones that do not reach the peers, so only those that the user
+  // named are spread over.
+  if (userSpecified && !physical.empty()) return physical;
+  return {0};
+}
+
+void Endpoint::Impl::selectEthernetInterface(const EndpointConfig& config, size_t index) {
+  char names[MAX_IFS * MAX_IF_NAME_SIZE];
+  SocketAddress addrs[MAX_IFS];
+  const char* ifNames = config.ethInterfaces.empty() ? nullptr : config.ethInterfaces.c_str();
+  int nIfs = FindInterfaces(names, addrs, MAX_IF_NAME_SIZE, MAX_IFS, ifNames);
+  if (nIfs <= 0) throw Error("NET/Socket", ErrorCode::InternalError);
+
+  std::vector<int> candidates = {0};
+  if (nIfs > 1) {
+    std::vector<EthernetInterfaceInfo> interfaces(nIfs);
+    for (int i = 0; i < nIfs; ++i) {
+      interfaces[i].hasDevice = InterfaceHasDevice(names + i * MAX_IF_NAME_SIZE);
+      interfaces[i].numaNode = GetInterfaceNumaNode(names + i * MAX_IF_NAME_SIZE);
+    }
+    int numaNode = -1;
+    if (config.numaNode == EndpointConfig::NumaNodeAuto) {
+      numaNode = currentDeviceNumaNode();
+    } else if (config.numaNode != EndpointConfig::NumaNodeAny) {
+      numaNode = config.numaNode;
+    }
+    const char* env = getenv("MSCCLPP_SOCKET_IFNAME");
+    bool userSpecified = ifNames != nullptr || (env != nullptr && strlen(env) > 1);
+    candidates = selectEthernetInterfaces(interfaces, numaNode, userSpecified);
+  }
+
+  // Spread the endpoints of a context over the candidates, so that their connections use all of them
+  int selected = candidates[index % candidates.size()];
+  strncpy(netIfName_, names + selected * MAX_IF_NAME_SIZE, MAX_IF_NAME_SIZE);
+  netIfName_[MAX_IF_NAME_SIZE] = '\0';
+  socketAddress_ = addrs[selected];
+  INFO(MSCCLPP_NET, "Ethernet endpoint on interface %s (%zu of %d candidates)", netIfName_,
+       index % candidates.size() + 1, (int)candidates.size());
+}
+
 MSCCLPP_API_CPP Transport Endpoint::transport() { return pimpl_->transport_; }
 
 MSCCLPP_API_CPP std::vector<char> Endpoint::serialize() {
@@ -44,6 +112,7 @@ MSCCLPP_API_CPP std::vector<char> Endpoint::serialize() {
   if ((pimpl_->transport_) == Transport::Ethernet) {
     std::copy_n(reinterpret_cast<char*>(&pimpl_->socketAddress_), sizeof(pimpl_->socketAddress_),
                 std::back_inserter(data));
+    std::copy_n(reinterpret_cast<char*>(&pimpl_->lazy_), sizeof(pimpl_->lazy_), std::back_inserter(data));
   }
   return data;
 }
@@ -52,7 +121,7 @@ MSCCLPP_API_CPP Endpoint Endpoint::deserialize(const std::vector<char>& data) {
   return Endpoint(std::make_shared<Impl>(data));
 }
 
-Endpoint::Impl::Impl(const std::vector<char>& serialization) {
+Endpoint::Impl::Impl(const std::vector<char>& serialization) : lazy_(false) {
   auto it = serialization.begin();
   std::copy_n(it, sizeof(transport_), reinterpret_cast<char*>(&transport_));
   it += sizeof(transport_);
@@ -66,6 +135,8 @@ Endpoint::Impl::Impl(const std::vector<char>& serialization) {
   if (transport_ == Transport::Ethernet) {
     std::copy_n(it, sizeof(socketAddress_), reinterpret_cast<char*>(&socketAddress_));
     it += sizeof(socketAddress_);
+    std::copy_n(it, sizeof(lazy_), reinterpret_cast<char*>(&lazy_));
+    it += sizeof(lazy_);
   }
 }
 
@@ -0,0 +1,168 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "ethernet_acceptor.hpp"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <mscclpp/errors.hpp>
+#include <utility>
+
+#include "connection.hpp"
+#include "debug.h"
+
+namespace mscclpp {
+
+EthernetAcceptor::EthernetAcceptor() : stop_(false), wakeFd_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {
+  if (wakeFd_ < 0) throw SysError("eventfd failed", errno);
+}
+
+EthernetAcceptor::~EthernetAcceptor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake();
+  if (thread_.joinable()) thread_.join();
+  // Connections hold the acceptor, so none is pending when it is destroyed.
+  ::close(wakeFd_);
+}
+
+void EthernetAcceptor::add(EthernetConnection* connection) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pending_.push_back({connection, -1, {}, 0});
+  if (!thread_.joinable()) {
+    thread_ = std::thread(&EthernetAcceptor::run, this);
+  } else {
+    wake();
+  }
+}
+
+void EthernetAcceptor::remove(EthernetConnection* connection) {
+  // The thread holds the mutex while it accepts, so the connection is either accepted or dropped once it is taken.
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(pending_.begin(), pending_.end(),
+                         [connection](const Pending& pending) { return pending.connection == connection; });
+  if (it == pending_.end()) return;
+  if (it->acceptedFd >= 0) ::close(it->acceptedFd);
+  pending_.erase(it);
+  wake();
+}
+
+void EthernetAcceptor::wake() {
+  uint64_t one = 1;
+  if (::write(wakeFd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+    WARN("EthernetAcceptor: write to eventfd failed: %s", strerror(errno));
+  }
+}
+
+void EthernetAcceptor::run() {
+  std::vector<struct pollfd> fds;
+  std::vector<EthernetConnection*> polled;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    fds.assign(1, {wakeFd_, POLLIN, 0});
+    polled.clear();
+    for (const Pending& pending : pending_) {
+      int fd = pending.acceptedFd >= 0 ? pending.acceptedFd : pending.connection->listenSocket()->getFd();
+      fds.push_back({fd, POLLIN, 0});
+      polled.push_back(pending.connection);
+    }
+    lock.unlock();
+    int ret = ::poll(fds.data(), fds.size(), -1);
+    lock.lock();
+    if (ret < 0) {
+      if (errno == EINTR) continue;
+      WARN("EthernetAcceptor: poll failed: %s", strerror(errno));
+      return;
+    }
+    if (fds[0].revents) {
+      uint64_t count;
+      if (::read(wakeFd_, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        WARN("EthernetAcceptor: read from eventfd failed: %s", strerror(errno));
+      }
+    }
+    for (size_t i = 1; i < fds.size(); ++i) {
+      if (fds[i].revents == 0) continue;
+      // The connection may have been removed, or its socket accepted, while the thread polled
+      auto it = std::find_if(pending_.begin(), pending_.end(), [&](const Pending& pending) {
+        return pending.connection == polled[i - 1] &&
+               (pending.acceptedFd >= 0 ? pending.acceptedFd : pending.connection->listenSocket()->getFd()) ==
+                   fds[i].fd;
+      });
+      if (it == pending_.end()) continue;
+      if (it->acceptedFd < 0) {
+        accept(*it);
+      } else if (receiveHandshake(*it)) {
+        pending_.erase(it);
+      }
+    }
+  }
+}
+
+void EthernetAcceptor::accept(Pending& pending) {
+  int fd = ::accept4(pending.connection->listenSocket()->getFd(), nullptr, nullptr, SOCK_CLOEXEC);
+  if (fd < 0) {
+    if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED) {
+      WARN("EthernetAcceptor: accepting a connection failed: %s", strerror(errno));
+    }
+    return;
+  }
+  pending.acceptedFd = fd;
+  pending.handshakeReceived = 0;
+}
+
+bool EthernetAcceptor::receiveHandshake(Pending& pending) {
+  ssize_t res = ::recv(pending.acceptedFd, pending.handshake + pending.handshakeReceived,
+                       sizeof(pending.handshake) - pending.handshakeReceived, MSG_DONTWAIT);
+  if (res < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) return false;
+  if (res <= 0) {
+    // Like Socket::accept(), ignore a peer that goes away before its handshake
+    INFO(MSCCLPP_NET, "EthernetAcceptor: accepted socket closed before its handshake: %s",
+         res == 0 ? "closed" : strerror(errno));
+    reaccept(pending);
+    return false;
+  }
+  pending.handshakeReceived += res;
+  if (pending.handshakeReceived < sizeof(pending.handshake)) return false;
+
+  Socket* listenSocket = pending.connection->listenSocket();
+  uint64_t magic;
+  SocketType type;
+  memcpy(&magic, pending.handshake, sizeof(magic));
+  memcpy(&type, pending.handshake + sizeof(magic), sizeof(type));
+  if (magic != listenSocket->getMagic()) {
+    WARN("EthernetAcceptor: wrong magic %lx != %lx", magic, listenSocket->getMagic());
+    reaccept(pending);
+    return false;
+  }
+  int fd = std::exchange(pending.acceptedFd, -1);
+  if (type != listenSocket->getType()) {
+    WARN("EthernetAcceptor: wrong socket type %d != %d", (int)type, (int)listenSocket->getType());
+    ::close(fd);
+    return true;
+  }
+  EthernetConnection* connection = pending.connection;
+  try {
+    // The socket belongs to the connection from here on, even if this throws.
+    connection->adoptRecv(fd);
+  } catch (const std::exception& e) {
+    WARN("EthernetAcceptor: failed to accept a connection: %s", e.what());
+    return true;
+  }
+  connection->threadRecvMessages_ = std::thread(&EthernetConnection::recvMessages, connection);
+  return true;
+}
+
+void EthernetAcceptor::reaccept(Pending& pending) {
+  ::close(pending.acceptedFd);
+  pending.acceptedFd = -1;
+}
+
+}  // namespace mscclpp
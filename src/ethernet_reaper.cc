@@ -0,0 +1,760 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "ethernet_reaper.hpp"
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define MSCCLPP_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <mscclpp/errors.hpp>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "connection.hpp"
+#include "debug.h"
+
+namespace mscclpp {
+
+#if defined(MSCCLPP_HAS_IO_URING)
+
+// Submission queue entries of the ring. Each connection has at most one receive in flight.
+constexpr unsigned EthernetReaperRingEntries = 256;
+
+// Connections whose socket and receive buffer can be registered with the ring. Others use plain receives.
+constexpr unsigned EthernetReaperMaxFixedSlots = 4096;
+
+// The reaper thread is the only one to submit to its ring, so completions are handled when it asks for them rather
+// than interrupting it. The ring starts disabled, so that the thread that enables it becomes its submitter.
+#if defined(IORING_SETUP_DEFER_TASKRUN)
+constexpr unsigned EthernetReaperRingFlags =
+    IORING_SETUP_R_DISABLED | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_SUBMIT_ALL;
+#else
+constexpr unsigned EthernetReaperRingFlags = 0;
+#endif
+
+// Bytes at the start of the receive buffer of a connection that are registered with the ring. Registering pins the
+// memory, so the buffers, which are sized for whole messages, are not registered in full. Payloads are received through
+// the registered part in chunks of at most this size.
+constexpr uint64_t EthernetReaperFixedBufferBytes = 1024 * 1024;
+
+// Tag of the completions of the reads of the eventfd that wakes the reaper up for new commands.
+constexpr uint64_t EthernetReaperWakeTag = 0;
+
+// Tag of the completions of cancel requests. Receives are tagged with their slot, which is never at these addresses.
+constexpr uint64_t EthernetReaperCancelTag = 1;
+
+namespace {
+
+// Minimal io_uring on top of the system calls, so that no liburing is needed to build.
+class IoUring {
+ public:
+  // Tries `flags` first and falls back to a ring without them on kernels that do not know them.
+  IoUring(unsigned entries, unsigned flags) : flags_(flags) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = flags_;
+    fd_ = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd_ < 0 && errno == EINVAL && flags_ != 0) {
+      memset(&params, 0, sizeof(params));
+      flags_ = 0;
+      fd_ = syscall(__NR_io_uring_setup, entries, &params);
+    }
+    if (fd_ < 0) {
+      throw SysError("io_uring_setup failed", errno);
+    }
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool singleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (singleMmap) {
+      sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+    sqRing_ = mapRing(sqRingSize_, IORING_OFF_SQ_RING);
+    cqRing_ = singleMmap ? sqRing_ : mapRing(cqRingSize_, IORING_OFF_CQ_RING);
+    sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = reinterpret_cast<struct io_uring_sqe*>(mapRing(sqesSize_, IORING_OFF_SQES));
+
+    char* sq = reinterpret_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    unsigned* sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    // The SQ array maps each place of the ring to the SQE of the same index, so that SQEs are used in order.
+    for (unsigned i = 0; i < sqEntries_; ++i) {
+      sqArray[i] = i;
+    }
+    sqeTail_ = *sqTail_;
+
+    char* cq = reinterpret_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+  }
+
+  ~IoUring() { close(); }
+
+  // Unmaps and closes the ring, which cancels the requests in flight. No other method may be called afterwards.
+  void close() {
+    if (fd_ < 0) return;
+    munmap(sqes_, sqesSize_);
+    if (cqRing_ != sqRing_) munmap(cqRing_, cqRingSize_);
+    munmap(sqRing_, sqRingSize_);
+    ::close(fd_);
+    fd_ = -1;
+  }
+
+  // Returns a cleared SQE, submitting the queued ones first if the queue is full.
+  struct io_uring_sqe* getSqe() {
+    if (sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+      submit(0);
+    }
+    while (sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+      std::this_thread::yield();
+      submit(0);
+    }
+    struct io_uring_sqe* sqe = &sqes_[sqeTail_ & sqMask_];
+    sqeTail_++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+  }
+
+  // Submits the queued SQEs and waits for at least `waitNr` completions.
+  void submit(unsigned waitNr) {
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+    unsigned toSubmit = sqeTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    int ret = syscall(__NR_io_uring_enter, fd_, toSubmit, waitNr, waitNr ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      throw SysError("io_uring_enter failed", errno);
+    }
+  }
+
+  // Calls `handle` with each available completion.
+  template <class Handler>
+  void reap(Handler&& handle) {
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+      struct io_uring_cqe cqe = cqes_[head & cqMask_];
+      __atomic_store_n(cqHead_, ++head, __ATOMIC_RELEASE);
+      handle(cqe);
+      tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    }
+  }
+
+  unsigned flags() const { return flags_; }
+
+  // Returns a negative errno on failure.
+  int registerResource(unsigned opcode, void* arg, unsigned nrArgs) {
+    int ret = syscall(__NR_io_uring_register, fd_, opcode, arg, nrArgs);
+    return (ret < 0) ? -errno : ret;
+  }
+
+ private:
+  void* mapRing(size_t size, uint64_t offset) {
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+    if (ptr == MAP_FAILED) {
+      throw SysError("mmap of io_uring failed", errno);
+    }
+    return ptr;
+  }
+
+  int fd_;
+  unsigned flags_;
+  void* sqRing_;
+  void* cqRing_;
+  size_t sqRingSize_;
+  size_t cqRingSize_;
+  size_t sqesSize_;
+  unsigned* sqHead_;
+  unsigned* sqTail_;
+  unsigned sqMask_;
+  unsigned sqEntries_;
+  unsigned sqeTail_;
+  struct io_uring_sqe* sqes_;
+  unsigned* cqHead_;
+  unsigned* cqTail_;
+  unsigned cqMask_;
+  struct io_uring_cqe* cqes_;
+};
+
+}  // namespace
+
+struct EthernetReaper::Impl {
+  // The receive state of a connection.
+  struct Slot {
+    EthernetConnection* connection;
+    int index;
+    int fd;
+    bool fixedFile;
+    bool fixedBuffer;
+    bool inFlight;
+    bool closed;
+    // Set while a lazy connection waits for its peer to connect and send its handshake.
+    bool accepting;
+    // The socket accepted for a lazy connection while its handshake, the magic and type of the socket, is received.
+    int acceptedFd;
+    char handshake[sizeof(uint64_t) + sizeof(SocketType)];
+    uint64_t handshakeReceived;
+    std::promise<void>* removed;
+    EthernetMessageHeader header;
+    uint64_t headerReceived;
+    uint64_t payloadReceived;
+    uint64_t chunkSize;
+    uint64_t chunkReceived;
+  };
+
+  struct Command {
+    EthernetConnection* connection;
+    // Set for removals.
+    std::promise<void>* removed;
+  };
+
+  IoUring ring;
+  int wakeFd;
+  uint64_t wakeValue;
+  bool fixedFiles;
+  bool fixedBuffers;
+  std::mutex mutex;
+  std::vector<Command> commands;
+  // The commands that the thread is processing.
+  std::vector<Command> processing;
+  bool stopping;
+  // Set once the thread stops on an error, after which commands are no longer processed.
+  bool failed;
+  std::vector<std::unique_ptr<Slot>> slots;
+  std::vector<int> freeSlots;
+  std::thread thread;
+
+  Impl()
+      : ring(EthernetReaperRingEntries, EthernetReaperRingFlags),
+        wakeValue(0),
+        fixedFiles(false),
+        fixedBuffers(false),
+        stopping(false),
+        failed(false) {
+    wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (wakeFd < 0) {
+      throw SysError("eventfd failed", errno);
+    }
+#if defined(IORING_RSRC_REGISTER_SPARSE)
+    // Sparse tables, filled in as connections are added. Older kernels fall back to plain files and buffers.
+    struct io_uring_rsrc_register reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.nr = EthernetReaperMaxFixedSlots;
+    reg.flags = IORING_RSRC_REGISTER_SPARSE;
+    fixedFiles = ring.registerResource(IORING_REGISTER_FILES2, &reg, sizeof(reg)) >= 0;
+    fixedBuffers = ring.registerResource(IORING_REGISTER_BUFFERS2, &reg, sizeof(reg)) >= 0;
+#endif
+    INFO(MSCCLPP_NET, "EthernetReaper: io_uring with fixed files %d, fixed buffers %d", fixedFiles, fixedBuffers);
+    std::promise<void> started;
+    std::future<void> startedFuture = started.get_future();
+    thread = std::thread([this, &started]() { run(started); });
+    try {
+      startedFuture.get();
+    } catch (...) {
+      thread.join();
+      ::close(wakeFd);
+      throw;
+    }
+  }
+
+  ~Impl() {
+    if (thread.joinable()) thread.join();
+    ::close(wakeFd);
+  }
+
+  // Asks the thread to stop. Returns false if it could not be woken up, in which case it is left running.
+  bool stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      if (failed) return true;
+    }
+    return wake();
+  }
+
+  // Queues a command for the thread. Removals complete at once if the thread has stopped on an error.
+  void push(Command command) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (failed) {
+        if (!command.removed) throw Error("EthernetReaper stopped on an earlier error", ErrorCode::InternalError);
+        command.removed->set_value();
+        return;
+      }
+      commands.push_back(command);
+    }
+    if (!wake() && !command.removed) throw Error("Failed to wake up the EthernetReaper", ErrorCode::SystemError);
+  }
+
+  // Returns false on failure, which a blocking eventfd only reports for invalid arguments.
+  bool wake() {
+    uint64_t one = 1;
+    ssize_t ret;
+    do {
+      ret = write(wakeFd, &one, sizeof(one));
+    } while (ret < 0 && errno == EINTR);
+    if (ret != sizeof(one)) {
+      WARN("EthernetReaper: write to eventfd failed: %s", strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  // Sets `started` once the ring is ready, or to the error that keeps the reaper from starting.
+  void run(std::promise<void>& started) {
+    try {
+#if defined(IORING_SETUP_R_DISABLED)
+      if (ring.flags() & IORING_SETUP_R_DISABLED) {
+        int ret = ring.registerResource(IORING_REGISTER_ENABLE_RINGS, nullptr, 0);
+        if (ret < 0) throw SysError("enabling io_uring failed", -ret);
+      }
+#endif
+      armWake();
+    } catch (...) {
+      started.set_exception(std::current_exception());
+      return;
+    }
+    started.set_value();
+    try {
+      for (;;) {
+        ring.submit(1);
+        bool stop = false;
+        ring.reap([&](const struct io_uring_cqe& cqe) {
+          if (cqe.user_data == EthernetReaperWakeTag) {
+            stop = processCommands();
+            if (!stop) armWake();
+          } else if (cqe.user_data != EthernetReaperCancelTag) {
+            complete(reinterpret_cast<Slot*>(cqe.user_data), cqe.res);
+          }
+        });
+        if (stop) break;
+      }
+    } catch (const std::exception& e) {
+      WARN("EthernetReaper: stopped receiving the messages of %zu connections: %s", slots.size() - freeSlots.size(),
+           e.what());
+      fail();
+    }
+  }
+
+  // Gives up on all connections after an error of the ring, so that their removal does not wait for the thread.
+  void fail() {
+    // Closing the ring cancels the receives in flight, so that the kernel no longer writes to the receive buffers.
+    ring.close();
+    std::vector<Command> pending;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      failed = true;
+      pending.swap(commands);
+    }
+    for (auto& slot : slots) {
+      if (slot && slot->acceptedFd >= 0) ::close(slot->acceptedFd);
+      if (slot && slot->removed) slot->removed->set_value();
+    }
+    slots.clear();
+    freeSlots.clear();
+    for (const std::vector<Command>* queue : {&processing, &pending}) {
+      for (const Command& command : *queue) {
+        if (command.removed) command.removed->set_value();
+      }
+    }
+  }
+
+  void armWake() {
+    struct io_uring_sqe* sqe = ring.getSqe();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeFd;
+    sqe->addr = reinterpret_cast<uint64_t>(&wakeValue);
+    sqe->len = sizeof(wakeValue);
+    sqe->user_data = EthernetReaperWakeTag;
+  }
+
+  // Returns whether the reaper stops.
+  bool processCommands() {
+    bool stop;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      processing.swap(commands);
+      stop = stopping;
+    }
+    for (Command& command : processing) {
+      // Taken out of the command first, so that fail() only completes the removals that are not yet handed over.
+      std::promise<void>* removed = std::exchange(command.removed, nullptr);
+      if (removed) {
+        removeSlot(command.connection, removed);
+      } else {
+        addSlot(command.connection);
+      }
+    }
+    processing.clear();
+    // Connections hold the reaper, so none is left when it is destroyed.
+    return stop;
+  }
+
+  void addSlot(EthernetConnection* connection) {
+    int index;
+    if (!freeSlots.empty()) {
+      index = freeSlots.back();
+      freeSlots.pop_back();
+    } else {
+      index = slots.size();
+      slots.emplace_back();
+    }
+    slots[index] = std::make_unique<Slot>();
+    Slot& slot = *slots[index];
+    slot.connection = connection;
+    slot.index = index;
+    slot.acceptedFd = -1;
+    if (!connection->recvSocket_) {
+      // A lazy connection is accepted once the peer connects
+      slot.accepting = true;
+      postAccept(slot);
+      return;
+    }
+    startReceiving(slot);
+  }
+
+  // Queues an accept on the listening socket of a lazy connection.
+  void postAccept(Slot& slot) {
+    struct io_uring_sqe* sqe = ring.getSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = slot.connection->listenSocket()->getFd();
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = reinterpret_cast<uint64_t>(&slot);
+    slot.inFlight = true;
+  }
+
+  // Queues a receive of the rest of the handshake on the socket accepted for a lazy connection.
+  void postHandshake(Slot& slot) {
+    struct io_uring_sqe* sqe = ring.getSqe();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = slot.acceptedFd;
+    sqe->addr = reinterpret_cast<uint64_t>(slot.handshake + slot.handshakeReceived);
+    sqe->len = sizeof(slot.handshake) - slot.handshakeReceived;
+    sqe->msg_flags = MSG_WAITALL;
+    sqe->user_data = reinterpret_cast<uint64_t>(&slot);
+    slot.inFlight = true;
+  }
+
+  // Drops the socket accepted for a lazy connection and accepts the next one.
+  void reaccept(Slot& slot) {
+    ::close(slot.acceptedFd);
+    slot.acceptedFd = -1;
+    postAccept(slot);
+  }
+
+  // Handles the completion of an accept or of a handshake receive of a lazy connection.
+  void completeAccept(Slot& slot, int res) {
+    if (slot.acceptedFd < 0) {
+      if (res == -EINTR || res == -EAGAIN || res == -ECONNABORTED) {
+        postAccept(slot);
+      } else if (res < 0) {
+        WARN("EthernetReaper: accepting a connection failed: %s", strerror(-res));
+        slot.closed = true;
+      } else {
+        slot.acceptedFd = res;
+        slot.handshakeReceived = 0;
+        postHandshake(slot);
+      }
+      return;
+    }
+    if (res == -EINTR || res == -EAGAIN) {
+      postHandshake(slot);
+      return;
+    }
+    if (res <= 0) {
+      // Like Socket::accept(), ignore a peer that goes away before its handshake
+      INFO(MSCCLPP_NET, "EthernetReaper: accepted socket closed before its handshake: %s",
+           res == 0 ? "closed" : strerror(-res));
+      reaccept(slot);
+      return;
+    }
+    slot.handshakeReceived += res;
+    if (slot.handshakeReceived < sizeof(slot.handshake)) {
+      postHandshake(slot);
+      return;
+    }
+    Socket* listenSocket = slot.connection->listenSocket();
+    uint64_t magic;
+    SocketType type;
+    memcpy(&magic, slot.handshake, sizeof(magic));
+    memcpy(&type, slot.handshake + sizeof(magic), sizeof(type));
+    if (magic != listenSocket->getMagic()) {
+      WARN("EthernetReaper: wrong magic %lx != %lx", magic, listenSocket->getMagic());
+      reaccept(slot);
+      return;
+    }
+    int fd = slot.acceptedFd;
+    slot.acceptedFd = -1;
+    if (type != listenSocket->getType()) {
+      WARN("EthernetReaper: wrong socket type %d != %d", (int)type, (int)listenSocket->getType());
+      ::close(fd);
+      slot.closed = true;
+      return;
+    }
+    slot.accepting = false;
+    try {
+      // The socket belongs to the connection from here on, even if this throws.
+      slot.connection->adoptRecv(fd);
+    } catch (const std::exception& e) {
+      WARN("EthernetReaper: failed to accept a connection: %s", e.what());
+      slot.closed = true;
+      return;
+    }
+    startReceiving(slot);
+  }
+
+  // Registers the receiving socket and buffer of a slot and posts its first receive.
+  void startReceiving(Slot& slot) {
+    EthernetConnection* connection = slot.connection;
+    int index = slot.index;
+    slot.fd = connection->recvSocket_->getFd();
+#if defined(IORING_RSRC_REGISTER_SPARSE)
+    if (index < (int)EthernetReaperMaxFixedSlots) {
+      slot.fixedFile = fixedFiles && updateFile(index, slot.fd);
+      struct iovec iov = {connection->recvBuffer_.get(),
+                          std::min(connection->recvBufferSize_, EthernetReaperFixedBufferBytes)};
+      // Fails if the buffer exceeds the locked memory limit, in which case the connection uses plain receives.
+      slot.fixedBuffer = fixedBuffers && updateBuffer(index, &iov);
+    }
+#endif
+    post(slot);
+  }
+
+  void removeSlot(EthernetConnection* connection, std::promise<void>* removed) {
+    auto it = std::find_if(slots.begin(), slots.end(), [&](const std::unique_ptr<Slot>& slot) {
+      return slot && slot->connection == connection;
+    });
+    if (it == slots.end()) {
+      removed->set_value();
+      return;
+    }
+    Slot& slot = **it;
+    slot.removed = removed;
+    if (slot.inFlight) {
+      // The slot is released when the canceled receive completes.
+      struct io_uring_sqe* sqe = ring.getSqe();
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd = -1;
+      sqe->addr = reinterpret_cast<uint64_t>(&slot);
+      sqe->user_data = EthernetReaperCancelTag;
+    } else {
+      releaseSlot(slot);
+    }
+  }
+
+  void releaseSlot(Slot& slot) {
+    if (slot.acceptedFd >= 0) ::close(slot.acceptedFd);
+#if defined(IORING_RSRC_REGISTER_SPARSE)
+    if (slot.fixedFile) updateFile(slot.index, -1);
+    if (slot.fixedBuffer) {
+      struct iovec iov = {nullptr, 0};
+      updateBuffer(slot.index, &iov);
+    }
+#endif
+    std::promise<void>* removed = slot.removed;
+    int index = slot.index;
+    slots[index].reset();
+    freeSlots.push_back(index);
+    removed->set_value();
+  }
+
+#if defined(IORING_RSRC_REGISTER_SPARSE)
+  bool updateFile(int index, int fd) {
+    struct io_uring_rsrc_update2 update;
+    memset(&update, 0, sizeof(update));
+    update.offset = index;
+    update.data = reinterpret_cast<uint64_t>(&fd);
+    update.nr = 1;
+    return ring.registerResource(IORING_REGISTER_FILES_UPDATE2, &update, sizeof(update)) >= 0;
+  }
+
+  bool updateBuffer(int index, struct iovec* iov) {
+    struct io_uring_rsrc_update2 update;
+    memset(&update, 0, sizeof(update));
+    update.offset = index;
+    update.data = reinterpret_cast<uint64_t>(iov);
+    update.nr = 1;
+    return ring.registerResource(IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update)) >= 0;
+  }
+#endif
+
+  // Returns where the next bytes of a slot go, i.e. the rest of the header or of the current chunk of the payload.
+  char* target(Slot& slot, size_t& len) {
+    if (slot.headerReceived < sizeof(slot.header)) {
+      len = sizeof(slot.header) - slot.headerReceived;
+      return reinterpret_cast<char*>(&slot.header) + slot.headerReceived;
+    }
+    len = slot.chunkSize - slot.chunkReceived;
+    return slot.connection->recvBuffer_.get() + slot.chunkReceived;
+  }
+
+  // Queues the next receive of a slot.
+  void post(Slot& slot) {
+    size_t len;
+    char* ptr = target(slot, len);
+    struct io_uring_sqe* sqe = ring.getSqe();
+    sqe->addr = reinterpret_cast<uint64_t>(ptr);
+    sqe->len = len;
+    if (slot.headerReceived == sizeof(slot.header) && slot.fixedBuffer) {
+      sqe->opcode = IORING_OP_READ_FIXED;
+      sqe->buf_index = slot.index;
+    } else {
+      sqe->opcode = IORING_OP_RECV;
+      sqe->msg_flags = MSG_WAITALL;
+    }
+    if (slot.fixedFile) {
+      sqe->fd = slot.index;
+      sqe->flags |= IOSQE_FIXED_FILE;
+    } else {
+      sqe->fd = slot.fd;
+    }
+    sqe->user_data = reinterpret_cast<uint64_t>(&slot);
+    slot.inFlight = true;
+  }
+
+  void complete(Slot* slotPtr, int res) {
+    Slot& slot = *slotPtr;
+    slot.inFlight = false;
+    if (slot.removed) {
+      releaseSlot(slot);
+      return;
+    }
+    if (slot.accepting) {
+      completeAccept(slot, res);
+      return;
+    }
+    // The payload of a message usually follows its header closely, so the socket is read without blocking for as long
+    // as it has data, which saves a round trip through the ring per message.
+    for (;;) {
+      if (res == 0) {
+        // The peer closed the connection.
+        slot.closed = true;
+        return;
+      }
+      if (res < 0) {
+        if (res == -EINTR || res == -EAGAIN || res == -EWOULDBLOCK) break;
+        WARN("EthernetReaper: receive failed: %s", strerror(-res));
+        slot.closed = true;
+        return;
+      }
+      try {
+        advance(slot, res);
+      } catch (const std::exception& e) {
+        WARN("EthernetReaper: failed to deliver a message: %s", e.what());
+        slot.closed = true;
+        return;
+      }
+      size_t len;
+      char* ptr = target(slot, len);
+      ssize_t ret = recv(slot.fd, ptr, len, MSG_DONTWAIT);
+      res = (ret < 0) ? -errno : ret;
+    }
+    post(slot);
+  }
+
+  // Accounts for `size` received bytes of a slot, and delivers its chunk or message once complete.
+  void advance(Slot& slot, uint64_t size) {
+    if (slot.headerReceived < sizeof(slot.header)) {
+      slot.headerReceived += size;
+      if (slot.headerReceived == sizeof(slot.header)) {
+        slot.payloadReceived = 0;
+        startChunk(slot);
+      }
+    } else {
+      slot.chunkReceived += size;
+      if (slot.chunkReceived == slot.chunkSize) {
+        slot.connection->copyReceived(slot.header, slot.payloadReceived, slot.chunkSize);
+        slot.payloadReceived += slot.chunkSize;
+        startChunk(slot);
+      }
+    }
+  }
+
+  // Moves on to the next chunk of the payload, or to the next message once the payload is complete.
+  void startChunk(Slot& slot) {
+    slot.chunkReceived = 0;
+    if (slot.payloadReceived == slot.header.size) {
+      slot.connection->messageReceived(slot.header);
+      slot.headerReceived = 0;
+      return;
+    }
+    uint64_t maxChunkSize = slot.connection->recvBufferSize_;
+    if (slot.fixedBuffer) maxChunkSize = std::min(maxChunkSize, EthernetReaperFixedBufferBytes);
+    slot.chunkSize = std::min(maxChunkSize, slot.header.size - slot.payloadReceived);
+  }
+};
+
+std::shared_ptr<EthernetReaper> EthernetReaper::create() {
+  const char* env = getenv("MSCCLPP_SOCKET_IO_URING");
+  if (env == nullptr || atoi(env) == 0) return nullptr;
+  INFO(MSCCLPP_ENV, "MSCCLPP_SOCKET_IO_URING set by environment to %s", env);
+  try {
+    return std::shared_ptr<EthernetReaper>(new EthernetReaper(std::make_unique<Impl>()));
+  } catch (const SysError& e) {
+    WARN("io_uring is not usable, receiving on a thread per Ethernet connection: %s", e.what());
+    return nullptr;
+  }
+}
+
+void EthernetReaper::add(EthernetConnection* connection) { pimpl_->push({connection, nullptr}); }
+
+void EthernetReaper::remove(EthernetConnection* connection) {
+  std::promise<void> removed;
+  std::future<void> done = removed.get_future();
+  pimpl_->push({connection, &removed});
+  // Wakes the thread up again in case the wake-up of the command was lost.
+  while (done.wait_for(std::chrono::milliseconds(100)) == std::future_status::timeout) {
+    pimpl_->wake();
+  }
+}
+
+EthernetReaper::~EthernetReaper() {
+  if (!pimpl_->stop()) {
+    // The thread still refers to the state, which is leaked rather than destroyed under it.
+    WARN("EthernetReaper: failed to stop the thread, leaving it running");
+    pimpl_->thread.detach();
+    pimpl_.release();
+  }
+}
+
+#else  // !defined(MSCCLPP_HAS_IO_URING)
+
+struct EthernetReaper::Impl {};
+
+std::shared_ptr<EthernetReaper> EthernetReaper::create() {
+  if (getenv("MSCCLPP_SOCKET_IO_URING") != nullptr) {
+    WARN("MSCCLPP_SOCKET_IO_URING is ignored, as this build has no io_uring support");
+  }
+  return nullptr;
+}
+
+void EthernetReaper::add(EthernetConnection*) {}
+
+void EthernetReaper::remove(EthernetConnection*) {}
+
+EthernetReaper::~EthernetReaper() = default;
+
+#endif  // !defined(MSCCLPP_HAS_IO_URING)
+
+EthernetReaper::EthernetReaper(std::unique_ptr<Impl> pimpl) : pimpl_(std::move(pimpl)) {}
+
+}  // namespace mscclpp
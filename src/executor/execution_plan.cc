@@ -104,28 +104,6 @@ std::vector<ChannelInfo> ExecutionPlan::Impl::getChannelInfosByDstRank(int rank,
   return filter(this->channelInfosByDstRank.at(rank), pred);
 }
 
-std::vector<ChannelInfo> ExecutionPlan::Impl::getUnpairedChannelInfos(int rank, int worldSize,
-                                                                      ChannelType channelType) {
-  std::vector<ChannelInfo> unpaired;
-  for (int peer = 0; peer < worldSize; peer++) {
-    if (peer == rank) {
-      continue;
-    }
-    if (this->channelCountMap[{rank, channelType}][peer] < this->channelCountMap[{peer, channelType}][rank]) {
-      int count = this->channelCountMap[{peer, channelType}][rank] - this->channelCountMap[{rank, channelType}][peer];
-      for (int i = 0; i < count; i++) {
-        ChannelInfo info;
-        info.srcBufferType = BufferType::NONE;
-        info.dstBufferType = BufferType::NONE;
-        info.channelType = channelType;
-        info.connectedPeers.push_back(peer);
-        unpaired.push_back(info);
-      }
-    }
-  }
-  return unpaired;
-}
-
 std::vector<int> ExecutionPlan::Impl::getConnectedPeers(int rank) const {
   std::set<int> peers;
   for (const auto& info : this->channelInfos.at(rank)) {
@@ -240,7 +218,6 @@ void ExecutionPlan::Impl::setupChannels(const json& gpus) {
       for (const auto& peer : channel["connectedTo"]) {
         info.connectedPeers.push_back(peer);
         chanConnectedPeersMap[{peer, info.srcBufferType, info.dstBufferType, info.channelType}].push_back(rank);
-        this->channelCountMap[{rank, info.channelType}][peer]++;
       }
       channelInfos.push_back(info);
     }
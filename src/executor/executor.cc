@@ -1,13 +1,21 @@
 // Copyright (c) Microsoft Corporation.
 // Licensed under the MIT license.
 
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <map>
 #include <mscclpp/executor.hpp>
+#include <mscclpp/metrics.hpp>
 #include <mscclpp/proxy_channel.hpp>
 #include <mscclpp/sm_channel.hpp>
+#include <mutex>
 #include <set>
 
 #include "execution_kernel.hpp"
 #include "execution_plan.hpp"
+#include "semaphore_pool.hpp"
 
 namespace mscclpp {
 struct ExecutionContextKey {
@@ -68,34 +76,118 @@ struct ExecutionContext {
   int nthreadsPerBlock;
 };
 
+// Host-side phases of Executor::execute() that are profiled.
+enum class ExecutionPhase { Lookup, PlanLoad, Upload, Launch, NumPhases };
+
+// Durations of the host-side phases of a single execution.
+struct ExecutionPhaseTimes {
+  std::chrono::steady_clock::time_point last;
+  int64_t durationsNs[(int)ExecutionPhase::NumPhases] = {};
+
+  void restart() { last = std::chrono::steady_clock::now(); }
+
+  // Ends `phase`, which started at the previous call of restart() or mark().
+  void mark(ExecutionPhase phase) {
+    auto now = std::chrono::steady_clock::now();
+    durationsNs[(int)phase] = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+    last = now;
+  }
+};
+
+static void addPhaseSample(ExecutionPhaseStats& stats, double us) {
+  stats.minUs = (stats.count == 0) ? us : std::min(stats.minUs, us);
+  stats.maxUs = (stats.count == 0) ? us : std::max(stats.maxUs, us);
+  stats.totalUs += us;
+  stats.count++;
+}
+
 struct Executor::Impl {
+  using ProfileKey = std::pair<std::string, size_t>;
+
+  // A device timing of an execution whose end event may not have completed yet.
+  struct PendingDeviceTiming {
+    ProfileKey key;
+    cudaEvent_t start;
+    cudaEvent_t end;
+  };
+
   int nranksPerNode;
   int nranks;
   std::shared_ptr<Communicator> comm;
+  // Serializes setup() running on a background thread with execute(), which share the contexts and the plans.
+  std::mutex mutex;
   std::unordered_map<ExecutionContextKey, ExecutionContext> contexts;
+  std::shared_ptr<Counter> executions;
+  std::shared_ptr<Counter> contextCacheHits;
+  std::shared_ptr<Counter> contextCacheMisses;
+  std::shared_ptr<Histogram> contextSetupNs;
+  bool profiling = false;
+  std::map<ProfileKey, ExecutionProfile> profiles;
+  std::deque<PendingDeviceTiming> pendingDeviceTimings;
+  std::vector<cudaEvent_t> freeEvents;
 
   Impl(std::shared_ptr<Communicator> comm) : comm(comm) {
     this->nranksPerNode = comm->bootstrap()->getNranksPerNode();
     this->nranks = comm->bootstrap()->getNranks();
+    auto& registry = MetricsRegistry::global();
+    this->executions = registry.counter("mscclpp_executor_executions_total", "Execution plans run by executors");
+    this->contextCacheHits =
+        registry.counter("mscclpp_executor_context_cache_hits_total", "Executions that reused an execution context");
+    this->contextCacheMisses = registry.counter("mscclpp_executor_context_cache_misses_total",
+                                                "Executions that had to set up a new execution context");
+    this->contextSetupNs =
+        registry.histogram("mscclpp_executor_context_setup_ns", "Time spent setting up new execution contexts");
+  }
+
+  ~Impl() {
+    // Executions in flight still record their events, so they have to complete before the events are destroyed.
+    for (auto& timing : this->pendingDeviceTimings) {
+      (void)cudaEventSynchronize(timing.end);
+      (void)cudaEventDestroy(timing.start);
+      (void)cudaEventDestroy(timing.end);
+    }
+    for (cudaEvent_t event : this->freeEvents) {
+      (void)cudaEventDestroy(event);
+    }
+  }
+
+  // Returns the execution context of the buffers, which may lie anywhere within their allocations.
+  ExecutionContext getExecutionContext(int rank, void* sendbuff, void* recvbuff, size_t sendBuffSize,
+                                       size_t recvBuffSize, const ExecutionPlan& plan, ExecutionPhaseTimes* times) {
+    size_t sendBytes, recvBytes;
+    CUdeviceptr sendBasePtr, recvBasePtr;
+    MSCCLPP_CUTHROW(cuMemGetAddressRange(&sendBasePtr, &sendBytes, (CUdeviceptr)sendbuff));
+    MSCCLPP_CUTHROW(cuMemGetAddressRange(&recvBasePtr, &recvBytes, (CUdeviceptr)recvbuff));
+    size_t offsetIn = (char*)sendbuff - (char*)sendBasePtr;
+    size_t offsetOut = (char*)recvbuff - (char*)recvBasePtr;
+    return this->setupExecutionContext(rank, (void*)sendBasePtr, (void*)recvBasePtr, sendBuffSize, recvBuffSize,
+                                       offsetIn, offsetOut, sendBytes, recvBytes, plan, times);
   }
-  ~Impl() = default;
 
   ExecutionContext setupExecutionContext(int rank, void* sendbuff, void* recvbuff, size_t inputMessageSize,
                                          size_t outputMessageSize, size_t contsSrcOffset, size_t constDstOffset,
-                                         size_t sendBufferSize, size_t recvBufferSize, const ExecutionPlan& plan) {
+                                         size_t sendBufferSize, size_t recvBufferSize, const ExecutionPlan& plan,
+                                         ExecutionPhaseTimes* times) {
     ExecutionContextKey key = {sendbuff, recvbuff, sendBufferSize, recvBufferSize, plan.impl_->name};
-    if (this->contexts.find(key) != this->contexts.end()) {
+    auto it = this->contexts.find(key);
+    if (times) times->mark(ExecutionPhase::Lookup);
+    if (it != this->contexts.end()) {
+      this->contextCacheHits->add();
+      ExecutionContext& context = it->second;
       plan.impl_->operationsReset();
       plan.impl_->lightLoadExecutionPlan(inputMessageSize, outputMessageSize, contsSrcOffset, constDstOffset);
-      this->setupDeviceExecutionPlan(this->contexts[key], rank, plan);
-      this->contexts[key].deviceExecutionPlansBuffer =
-          allocExtSharedCuda<char>(this->contexts[key].deviceExecutionPlans.size() * sizeof(DeviceExecutionPlan));
-      memcpyCuda(this->contexts[key].deviceExecutionPlansBuffer.get(),
-                 (char*)this->contexts[key].deviceExecutionPlans.data(),
-                 this->contexts[key].deviceExecutionPlans.size() * sizeof(DeviceExecutionPlan), cudaMemcpyHostToDevice);
-      return this->contexts[key];
+      this->setupDeviceExecutionPlan(context, rank, plan);
+      if (times) times->mark(ExecutionPhase::PlanLoad);
+      context.deviceExecutionPlansBuffer =
+          allocExtSharedCuda<char>(context.deviceExecutionPlans.size() * sizeof(DeviceExecutionPlan));
+      memcpyCuda(context.deviceExecutionPlansBuffer.get(), (char*)context.deviceExecutionPlans.data(),
+                 context.deviceExecutionPlans.size() * sizeof(DeviceExecutionPlan), cudaMemcpyHostToDevice);
+      if (times) times->mark(ExecutionPhase::Upload);
+      return context;
     }
 
+    this->contextCacheMisses->add();
+    auto setupStart = std::chrono::steady_clock::now();
     plan.impl_->reset();
     plan.impl_->loadExecutionPlan(inputMessageSize, outputMessageSize, contsSrcOffset, constDstOffset);
 
@@ -110,15 +202,68 @@ struct Executor::Impl {
     this->setupRegisteredMemories(context, sendbuff, recvbuff, sendBufferSize, recvBufferSize, rank, plan);
     this->setupChannels(context, sendbuff, recvbuff, sendBufferSize, recvBufferSize, rank, plan);
     this->setupDeviceExecutionPlan(context, rank, plan);
+    if (times) times->mark(ExecutionPhase::PlanLoad);
     context.deviceExecutionPlansBuffer =
         allocExtSharedCuda<char>(context.deviceExecutionPlans.size() * sizeof(DeviceExecutionPlan));
     memcpyCuda(context.deviceExecutionPlansBuffer.get(), (char*)context.deviceExecutionPlans.data(),
                context.deviceExecutionPlans.size() * sizeof(DeviceExecutionPlan), cudaMemcpyHostToDevice);
+    if (times) times->mark(ExecutionPhase::Upload);
     context.proxyService->startProxy();
     this->contexts.insert({key, context});
+    this->contextSetupNs->record(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - setupStart).count());
     return context;
   }
 
+  cudaEvent_t getEvent() {
+    if (this->freeEvents.empty()) {
+      cudaEvent_t event;
+      MSCCLPP_CUDATHROW(cudaEventCreateWithFlags(&event, cudaEventDefault));
+      return event;
+    }
+    cudaEvent_t event = this->freeEvents.back();
+    this->freeEvents.pop_back();
+    return event;
+  }
+
+  void addProfile(const ProfileKey& key, const ExecutionPhaseTimes& times) {
+    ExecutionProfile& profile = this->getProfile(key);
+    addPhaseSample(profile.lookup, times.durationsNs[(int)ExecutionPhase::Lookup] / 1e3);
+    addPhaseSample(profile.planLoad, times.durationsNs[(int)ExecutionPhase::PlanLoad] / 1e3);
+    addPhaseSample(profile.upload, times.durationsNs[(int)ExecutionPhase::Upload] / 1e3);
+    addPhaseSample(profile.launch, times.durationsNs[(int)ExecutionPhase::Launch] / 1e3);
+  }
+
+  ExecutionProfile& getProfile(const ProfileKey& key) {
+    auto it = this->profiles.find(key);
+    if (it == this->profiles.end()) {
+      it = this->profiles.emplace(key, ExecutionProfile()).first;
+      it->second.planName = key.first;
+      it->second.messageSize = key.second;
+    }
+    return it->second;
+  }
+
+  // Accumulates the device timings of completed executions in launch order. If `wait` is true, waits for all of them.
+  void collectDeviceTimings(bool wait) {
+    while (!this->pendingDeviceTimings.empty()) {
+      PendingDeviceTiming& timing = this->pendingDeviceTimings.front();
+      if (wait) {
+        MSCCLPP_CUDATHROW(cudaEventSynchronize(timing.end));
+      } else {
+        cudaError_t status = cudaEventQuery(timing.end);
+        if (status == cudaErrorNotReady) break;
+        MSCCLPP_CUDATHROW(status);
+      }
+      float ms;
+      MSCCLPP_CUDATHROW(cudaEventElapsedTime(&ms, timing.start, timing.end));
+      addPhaseSample(this->getProfile(timing.key).device, ms * 1e3);
+      this->freeEvents.push_back(timing.start);
+      this->freeEvents.push_back(timing.end);
+      this->pendingDeviceTimings.pop_front();
+    }
+  }
+
   TransportFlags getTransportFlags(std::vector<ChannelInfo>& infos, int rank) {
     TransportFlags flags;
     for (ChannelInfo& info : infos) {
@@ -202,9 +347,16 @@ struct Executor::Impl {
     const auto channelTypes = {ChannelType::SM, ChannelType::PROXY};
     std::vector<std::shared_ptr<SmDevice2DeviceSemaphore>> smSemaphores;
     std::vector<mscclpp::SemaphoreId> proxySemaphores;
+    std::map<std::pair<int, ChannelType>, size_t> numSemaphores;
     auto processChannelInfos = [&](std::vector<ChannelInfo>& channelInfos) {
       for (ChannelInfo& info : channelInfos) {
         for (int peer : info.connectedPeers) {
+          if (++numSemaphores[{peer, info.channelType}] > SemaphorePool::SlabSize) {
+            throw Error("Execution plan " + plan.impl_->name + " has more than " +
+                            std::to_string(SemaphorePool::SlabSize) + " channels of a type to rank " +
+                            std::to_string(peer),
+                        ErrorCode::ExecutorError);
+          }
           if (info.channelType == ChannelType::SM) {
             smSemaphores.push_back(
                 std::make_shared<SmDevice2DeviceSemaphore>(*this->comm, context.connections.at(peer)));
@@ -215,16 +367,13 @@ struct Executor::Impl {
         }
       }
     };
+    // The first SemaphorePool::SlabSize semaphores of a type on a connection are paired with the remote peer without
+    // its participation, so a channel that has no counterpart on the peer does not need a fake one. Later ones would
+    // wait for the peer to construct as many in comm->setup(), which a plan asymmetric past that count never does, so
+    // plans over the limit are rejected above.
     for (ChannelType channelType : channelTypes) {
       std::vector<ChannelInfo> channelInfos = plan.impl_->getChannelInfos(rank, channelType);
       processChannelInfos(channelInfos);
-      // Current semaphore construction requires two-way communication, e.g., to construct a semaphore signaling from
-      // rank 0 to rank 1, both rank 0 and rank 1 need to send a message to each other. This PR fixes an executor bug
-      // that fails to conduct two-way communication for constructing such one-way semaphores, and instead hangs
-      // during the semaphore construction. In the future, we may need to change the implementation to construct
-      // semaphore via one-way communication.
-      channelInfos = plan.impl_->getUnpairedChannelInfos(rank, nranks, channelType);
-      processChannelInfos(channelInfos);
     }
     this->comm->setup();
     context.smSemaphores = std::move(smSemaphores);
@@ -340,20 +489,86 @@ struct Executor::Impl {
 
 Executor::Executor(std::shared_ptr<Communicator> comm) : impl_(std::make_unique<Impl>(comm)) {}
 
-void Executor::execute(int rank, void* sendbuff, void* recvbuff, size_t sendBuffSize,
-                       [[maybe_unused]] size_t recvBuffSize, DataType dataType, const ExecutionPlan& plan,
-                       cudaStream_t stream, PacketType packetType) {
-  size_t sendBytes, recvBytes;
-  CUdeviceptr sendBasePtr, recvBasePtr;
-  MSCCLPP_CUTHROW(cuMemGetAddressRange(&sendBasePtr, &sendBytes, (CUdeviceptr)sendbuff));
-  MSCCLPP_CUTHROW(cuMemGetAddressRange(&recvBasePtr, &recvBytes, (CUdeviceptr)recvbuff));
-  size_t offsetIn = (char*)sendbuff - (char*)sendBasePtr;
-  size_t offsetOut = (char*)recvbuff - (char*)recvBasePtr;
+void Executor::execute(int rank, void* sendbuff, void* recvbuff, size_t sendBuffSize, size_t recvBuffSize,
+                       DataType dataType, const ExecutionPlan& plan, cudaStream_t stream, PacketType packetType) {
+  std::lock_guard<std::mutex> lock(this->impl_->mutex);
+  // The lookup phase includes resolving the base addresses of the buffers.
+  ExecutionPhaseTimes times;
+  ExecutionPhaseTimes* profilingTimes = nullptr;
+  if (this->impl_->profiling) {
+    profilingTimes = &times;
+    times.restart();
+  }
 
   ExecutionContext context =
-      this->impl_->setupExecutionContext(rank, (void*)sendBasePtr, (void*)recvBasePtr, sendBuffSize, recvBuffSize,
-                                         offsetIn, offsetOut, sendBytes, recvBytes, plan);
+      this->impl_->getExecutionContext(rank, sendbuff, recvbuff, sendBuffSize, recvBuffSize, plan, profilingTimes);
+  if (!this->impl_->profiling) {
+    this->impl_->launchKernel(context, rank, sendbuff, recvbuff, dataType, stream, packetType);
+    this->impl_->executions->add();
+    return;
+  }
+
+  // Events cannot be timed while the stream is captured into a graph.
+  cudaStreamCaptureStatus captureStatus;
+  MSCCLPP_CUDATHROW(cudaStreamIsCapturing(stream, &captureStatus));
+  bool timeDevice = (captureStatus == cudaStreamCaptureStatusNone);
+  Executor::Impl::ProfileKey key = {plan.impl_->name, std::max(sendBuffSize, recvBuffSize)};
+  Executor::Impl::PendingDeviceTiming timing = {key, nullptr, nullptr};
+  if (timeDevice) {
+    timing.start = this->impl_->getEvent();
+    timing.end = this->impl_->getEvent();
+    MSCCLPP_CUDATHROW(cudaEventRecord(timing.start, stream));
+  }
+  times.restart();
   this->impl_->launchKernel(context, rank, sendbuff, recvbuff, dataType, stream, packetType);
+  times.mark(ExecutionPhase::Launch);
+  if (timeDevice) {
+    MSCCLPP_CUDATHROW(cudaEventRecord(timing.end, stream));
+    this->impl_->pendingDeviceTimings.push_back(timing);
+  }
+  this->impl_->executions->add();
+  this->impl_->addProfile(key, times);
+  this->impl_->collectDeviceTimings(/*wait=*/false);
+}
+
+void Executor::setup(int rank, void* sendbuff, void* recvbuff, size_t sendBuffSize, size_t recvBuffSize,
+                     const ExecutionPlan& plan) {
+  std::lock_guard<std::mutex> lock(this->impl_->mutex);
+  this->impl_->getExecutionContext(rank, sendbuff, recvbuff, sendBuffSize, recvBuffSize, plan, nullptr);
+}
+
+std::shared_future<void> Executor::setupAsync(int rank, void* sendbuff, void* recvbuff, size_t sendBuffSize,
+                                              size_t recvBuffSize, const ExecutionPlan& plan) {
+  // The current device is per thread, so the background thread has to select the caller's one.
+  int deviceId;
+  MSCCLPP_CUDATHROW(cudaGetDevice(&deviceId));
+  return std::async(std::launch::async,
+                    [this, deviceId, rank, sendbuff, recvbuff, sendBuffSize, recvBuffSize, plan]() {
+                      MSCCLPP_CUDATHROW(cudaSetDevice(deviceId));
+                      this->setup(rank, sendbuff, recvbuff, sendBuffSize, recvBuffSize, plan);
+                    })
+      .share();
+}
+
+void Executor::setProfiling(bool enable) {
+  std::lock_guard<std::mutex> lock(this->impl_->mutex);
+  this->impl_->profiling = enable;
+}
+
+std::vector<ExecutionProfile> Executor::getProfiles() {
+  std::lock_guard<std::mutex> lock(this->impl_->mutex);
+  this->impl_->collectDeviceTimings(/*wait=*/true);
+  std::vector<ExecutionProfile> profiles;
+  for (const auto& entry : this->impl_->profiles) {
+    profiles.push_back(entry.second);
+  }
+  return profiles;
+}
+
+void Executor::resetProfiles() {
+  std::lock_guard<std::mutex> lock(this->impl_->mutex);
+  this->impl_->collectDeviceTimings(/*wait=*/true);
+  this->impl_->profiles.clear();
 }
 
 Executor::~Executor() = default;
@@ -1,11 +1,15 @@
 // Copyright (c) Microsoft Corporation.
 // Licensed under the MIT license.
 
+#include <mscclpp/errors.hpp>
 #include <mscclpp/fifo.hpp>
 #include <mscclpp/gpu_utils.hpp>
+#include <string>
+#include <vector>
 
 #include "api.h"
 #include "atomic.hpp"
+#include "hang_detector_internal.hpp"
 
 namespace mscclpp {
 
@@ -14,51 +18,85 @@ struct Fifo::Impl {
   UniqueCudaPtr<uint64_t> head;
   UniqueCudaPtr<uint64_t> tailReplica;
   const int size;
+  const int numLanes;
 
   // allocated on the host. Only accessed by the host. This is a copy of the
-  // value pointed to by fifoTailDev and the invariant is that
-  // *fifoTailDev <= hostTail. Meaning that host's copy of tail is
+  // values pointed to by fifoTailDev and the invariant is that
+  // *fifoTailDev <= hostTail for each lane. Meaning that host's copy of tail is
   // always ahead of the device's copy and host updates the device's copy
   // only when it is needed. Therefore, hostTail is the "true" tail
   // and fifoTailDev is a "stale" tail. See proxy.cc to undertand how
   // these updates are pushed to the device.
-  uint64_t hostTail;
+  std::vector<uint64_t> hostTail;
 
   // for transferring fifo tail
   CudaStreamWithFlags stream;
 
-  Impl(int size)
-      : triggers(makeUniqueCudaHost<ProxyTrigger[]>(size)),
-        head(allocUniqueCuda<uint64_t>()),
-        tailReplica(allocUniqueCuda<uint64_t>()),
+  // registration with the hang detector, destroyed before the head and tail it refers to.
+  std::shared_ptr<void> hangDetectorEntry;
+
+  Impl(int size, int numLanes)
+      : triggers(makeUniqueCudaHost<ProxyTrigger[]>(size * numLanes)),
+        head(allocUniqueCuda<uint64_t>(numLanes * FifoLaneStride)),
+        tailReplica(allocUniqueCuda<uint64_t>(numLanes)),
         size(size),
-        hostTail(0),
-        stream(cudaStreamNonBlocking) {}
+        numLanes(numLanes),
+        hostTail(numLanes, 0),
+        stream(cudaStreamNonBlocking) {
+    WatchEntry entry;
+    entry.name = "Fifo";
+    for (int lane = 0; lane < numLanes; ++lane) {
+      std::string suffix = (numLanes == 1) ? "" : std::to_string(lane);
+      WatchedValue headValue, tailValue;
+      headValue.name = "head" + suffix;
+      headValue.devicePtr = head.get() + lane * FifoLaneStride;
+      tailValue.name = "tail" + suffix;
+      tailValue.hostPtr = &hostTail[lane];
+      entry.values.push_back(headValue);
+      entry.values.push_back(tailValue);
+    }
+    // triggers pushed by the device but not yet handled by the proxy.
+    entry.isWaiting = [](const std::vector<uint64_t>& values) {
+      for (size_t i = 0; i + 1 < values.size(); i += 2) {
+        if (values[i] > values[i + 1]) return true;
+      }
+      return false;
+    };
+    hangDetectorEntry = registerWatchEntry(std::move(entry));
+  }
 };
 
-MSCCLPP_API_CPP Fifo::Fifo(int size) : pimpl(std::make_unique<Impl>(size)) {}
+MSCCLPP_API_CPP Fifo::Fifo(int size, int numLanes) {
+  if (size <= 0 || numLanes <= 0) {
+    throw Error("Invalid FIFO size " + std::to_string(size) + " or number of lanes " + std::to_string(numLanes),
+                ErrorCode::InvalidUsage);
+  }
+  pimpl = std::make_unique<Impl>(size, numLanes);
+}
+
 MSCCLPP_API_CPP Fifo::~Fifo() = default;
 
-MSCCLPP_API_CPP ProxyTrigger Fifo::poll() {
+MSCCLPP_API_CPP ProxyTrigger Fifo::poll(int lane) {
   ProxyTrigger trigger;
-  ProxyTrigger* ptr = &pimpl->triggers.get()[pimpl->hostTail % pimpl->size];
+  ProxyTrigger* ptr = &pimpl->triggers.get()[lane * pimpl->size + pimpl->hostTail[lane] % pimpl->size];
   // we are loading fst first. if fst is non-zero then snd is also valid
   trigger.fst = atomicLoad(&(ptr->fst), memoryOrderAcquire);
   trigger.snd = ptr->snd;
   return trigger;
 }
 
-MSCCLPP_API_CPP void Fifo::pop() {
-  atomicStore(&(pimpl->triggers.get()[pimpl->hostTail % pimpl->size].fst), uint64_t{0}, memoryOrderRelease);
-  (pimpl->hostTail)++;
+MSCCLPP_API_CPP void Fifo::pop(int lane) {
+  atomicStore(&(pimpl->triggers.get()[lane * pimpl->size + pimpl->hostTail[lane] % pimpl->size].fst), uint64_t{0},
+              memoryOrderRelease);
+  (pimpl->hostTail[lane])++;
 }
 
 MSCCLPP_API_CPP void Fifo::flushTail(bool sync) {
   // Flush the tail to device memory. This is either triggered every ProxyFlushPeriod to make sure that the fifo can
   // make progress even if there is no request mscclppSync. However, mscclppSync type is for flush request.
   AvoidCudaGraphCaptureGuard cgcGuard;
-  MSCCLPP_CUDATHROW(cudaMemcpyAsync(pimpl->tailReplica.get(), &pimpl->hostTail, sizeof(uint64_t),
-                                    cudaMemcpyHostToDevice, pimpl->stream));
+  MSCCLPP_CUDATHROW(cudaMemcpyAsync(pimpl->tailReplica.get(), pimpl->hostTail.data(),
+                                    pimpl->numLanes * sizeof(uint64_t), cudaMemcpyHostToDevice, pimpl->stream));
   if (sync) {
     MSCCLPP_CUDATHROW(cudaStreamSynchronize(pimpl->stream));
   }
@@ -66,12 +104,15 @@ MSCCLPP_API_CPP void Fifo::flushTail(bool sync) {
 
 MSCCLPP_API_CPP int Fifo::size() const { return pimpl->size; }
 
+MSCCLPP_API_CPP int Fifo::numLanes() const { return pimpl->numLanes; }
+
 MSCCLPP_API_CPP FifoDeviceHandle Fifo::deviceHandle() {
   FifoDeviceHandle deviceHandle;
   deviceHandle.triggers = pimpl->triggers.get();
   deviceHandle.head = pimpl->head.get();
   deviceHandle.tailReplica = pimpl->tailReplica.get();
   deviceHandle.size = pimpl->size;
+  deviceHandle.numLanes = pimpl->numLanes;
   return deviceHandle;
 }
 
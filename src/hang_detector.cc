@@ -0,0 +1,405 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mscclpp/gpu_utils.hpp>
+#include <mscclpp/hang_detector.hpp>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include "api.h"
+#include "debug.h"
+#include "hang_detector_internal.hpp"
+
+namespace mscclpp {
+
+// Registry of watched objects
+
+namespace {
+
+struct WatchRegistry {
+  std::mutex mutex;
+  uint64_t nextId = 0;
+  std::map<uint64_t, WatchEntry> entries;
+  // Entries whose device values are being read without the mutex held. They are not unregistered until unpinned.
+  std::set<uint64_t> pinned;
+  std::condition_variable unpinned;
+};
+
+// Never destroyed, so that objects destroyed during static destruction can still unregister.
+WatchRegistry& getWatchRegistry() {
+  static WatchRegistry* registry = new WatchRegistry();
+  return *registry;
+}
+
+}  // namespace
+
+std::shared_ptr<void> registerWatchEntry(WatchEntry entry) {
+  WatchRegistry& registry = getWatchRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  uint64_t id = registry.nextId++;
+  registry.entries.emplace(id, std::move(entry));
+  return std::shared_ptr<void>(nullptr, [id](void*) {
+    WatchRegistry& registry = getWatchRegistry();
+    std::unique_lock<std::mutex> lock(registry.mutex);
+    registry.unpinned.wait(lock, [&registry, id] { return registry.pinned.count(id) == 0; });
+    registry.entries.erase(id);
+  });
+}
+
+// HangDetector
+
+// Tag of the summaries sent to rank 0.
+static const int HangDetectorTag = 0x48414e47;
+
+// The number of ranks listed in a summary as being waited on.
+static const int HangDetectorMaxWaitingOn = 16;
+
+// How long to wait for device values to be copied before reporting them as unavailable.
+static const int64_t HangDetectorDeviceReadTimeoutMs = 1000;
+
+// How long the destructor waits for the other ranks to stop, in addition to the stall timeout.
+static const int64_t HangDetectorStopGraceMs = 5000;
+
+// A summary of the state of a rank, sent to rank 0 at every check.
+struct HangDetectorSummary {
+  int32_t rank;
+  int32_t stop;
+  int32_t stalled;
+  int32_t numWaitingOn;
+  int64_t noProgressMs;
+  int32_t waitingOn[HangDetectorMaxWaitingOn];
+};
+
+// A copy of a watched object taken with the registry locked, so that it can be evaluated without the lock.
+struct SampledEntry {
+  WatchEntry entry;
+  std::string description;
+  std::vector<uint64_t> values;
+  bool valid;
+  bool waiting;
+};
+
+struct HangDetector::Impl {
+  std::shared_ptr<Bootstrap> bootstrap;
+  int64_t timeoutMs;
+  int64_t checkPeriodMs;
+  int rank;
+  int nRanks;
+  int cudaDevice;
+  std::thread thread;
+
+  std::mutex stopMutex;
+  std::condition_variable stopCv;
+  bool stop;
+  bool done;
+
+  mutable std::mutex stateMutex;
+  bool stalled;
+  std::string report;
+
+  // Only accessed by the watchdog thread.
+  std::unique_ptr<CudaStreamWithFlags> stream;
+  UniqueCudaHostPtr<uint64_t[]> staging;
+  size_t stagingSize;
+  // Staging buffers of copies that timed out, which must stay alive until the copies complete.
+  std::vector<UniqueCudaHostPtr<uint64_t[]>> abandonedStaging;
+  std::vector<uint64_t> lastSignature;
+  std::chrono::steady_clock::time_point lastProgress;
+  std::string lastGlobalReport;
+
+  Impl(std::shared_ptr<Bootstrap> bootstrap, int64_t timeoutSec, int64_t checkPeriodMs);
+  void runAndNotify();
+  void run();
+  bool readDeviceValues(const std::vector<const uint64_t*>& src, std::vector<uint64_t>& dst);
+  std::vector<SampledEntry> sample(std::vector<uint64_t>& signature, std::string& report);
+  HangDetectorSummary check();
+  void reportGlobal(const std::vector<HangDetectorSummary>& summaries);
+};
+
+HangDetector::Impl::Impl(std::shared_ptr<Bootstrap> bootstrap, int64_t timeoutSec, int64_t checkPeriodMs)
+    : bootstrap(bootstrap),
+      timeoutMs(timeoutSec * 1000),
+      checkPeriodMs(std::max<int64_t>(checkPeriodMs, 1)),
+      rank(bootstrap->getRank()),
+      nRanks(bootstrap->getNranks()),
+      stop(false),
+      done(false),
+      stalled(false),
+      stagingSize(0),
+      lastProgress(std::chrono::steady_clock::now()) {
+  MSCCLPP_CUDATHROW(cudaGetDevice(&cudaDevice));
+}
+
+bool HangDetector::Impl::readDeviceValues(const std::vector<const uint64_t*>& src, std::vector<uint64_t>& dst) {
+  dst.assign(src.size(), 0);
+  if (src.empty()) return true;
+  // Copies queued behind ones that timed out would not complete either.
+  if (!abandonedStaging.empty()) {
+    if (cudaStreamQuery(*stream) != cudaSuccess) return false;
+    abandonedStaging.clear();
+  }
+  if (stagingSize < src.size()) {
+    staging = makeUniqueCudaHost<uint64_t[]>(src.size());
+    stagingSize = src.size();
+  }
+  for (size_t i = 0; i < src.size(); ++i) {
+    memcpyCudaAsync(&staging.get()[i], src[i], 1, *stream, cudaMemcpyDeviceToHost);
+  }
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(HangDetectorDeviceReadTimeoutMs);
+  for (;;) {
+    cudaError_t status = cudaStreamQuery(*stream);
+    if (status == cudaSuccess) break;
+    if (status != cudaErrorNotReady) MSCCLPP_CUDATHROW(status);
+    if (std::chrono::steady_clock::now() > deadline) {
+      abandonedStaging.push_back(std::move(staging));
+      stagingSize = 0;
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  std::copy(staging.get(), staging.get() + src.size(), dst.begin());
+  return true;
+}
+
+// Samples all watched objects. Host values, getters and descriptions are read with the registry locked. Device values
+// are read after unlocking, with only the entries that have them pinned, so that registering and unregistering other
+// objects does not wait for the device.
+std::vector<SampledEntry> HangDetector::Impl::sample(std::vector<uint64_t>& signature, std::string& report) {
+  WatchRegistry& registry = getWatchRegistry();
+  std::vector<SampledEntry> sampled;
+  std::vector<const uint64_t*> devicePtrs;
+  std::vector<uint64_t> pinnedIds;
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    for (const auto& item : registry.entries) {
+      const WatchEntry& entry = item.second;
+      SampledEntry s = {entry, "", std::vector<uint64_t>(entry.values.size(), 0), true, false};
+      bool onDevice = false;
+      for (size_t i = 0; i < entry.values.size(); ++i) {
+        const WatchedValue& value = entry.values[i];
+        if (value.hostPtr != nullptr) {
+          s.values[i] = __atomic_load_n(value.hostPtr, __ATOMIC_RELAXED);
+        } else if (value.devicePtr != nullptr) {
+          devicePtrs.push_back(value.devicePtr);
+          onDevice = true;
+        } else if (value.getter) {
+          s.values[i] = value.getter();
+        }
+      }
+      if (entry.describe) s.description = entry.describe();
+      if (onDevice) {
+        registry.pinned.insert(item.first);
+        pinnedIds.push_back(item.first);
+      }
+      sampled.push_back(std::move(s));
+    }
+  }
+
+  std::vector<uint64_t> deviceValues;
+  bool deviceValid;
+  {
+    // Unpins the entries even if reading throws.
+    struct Unpin {
+      WatchRegistry& registry;
+      const std::vector<uint64_t>& ids;
+      ~Unpin() {
+        if (ids.empty()) return;
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        for (uint64_t id : ids) registry.pinned.erase(id);
+        registry.unpinned.notify_all();
+      }
+    } unpin{registry, pinnedIds};
+    deviceValid = readDeviceValues(devicePtrs, deviceValues);
+  }
+
+  size_t deviceIndex = 0;
+  std::stringstream ss;
+  for (auto& s : sampled) {
+    const WatchEntry& entry = s.entry;
+    for (size_t i = 0; i < entry.values.size(); ++i) {
+      if (entry.values[i].devicePtr == nullptr) continue;
+      s.values[i] = deviceValues[deviceIndex++];
+      s.valid = s.valid && deviceValid;
+    }
+    s.waiting = s.valid && entry.isWaiting && entry.isWaiting(s.values);
+    if (s.valid) signature.insert(signature.end(), s.values.begin(), s.values.end());
+
+    ss << "\n  " << entry.name;
+    if (entry.remoteRank >= 0) ss << " with rank " << entry.remoteRank;
+    ss << ":";
+    for (size_t i = 0; i < entry.values.size(); ++i) {
+      ss << " " << entry.values[i].name << " ";
+      if (s.valid) {
+        ss << s.values[i];
+      } else {
+        ss << "unavailable";
+      }
+    }
+    if (!s.description.empty()) ss << " " << s.description;
+    if (s.waiting) ss << " [waiting]";
+  }
+  report = ss.str();
+  return sampled;
+}
+
+HangDetectorSummary HangDetector::Impl::check() {
+  HangDetectorSummary summary = {};
+  summary.rank = rank;
+  std::vector<uint64_t> signature;
+  std::string entriesReport;
+  std::vector<int> waitingOn;
+  bool waiting = false;
+  for (const auto& s : sample(signature, entriesReport)) {
+    if (!s.waiting) continue;
+    waiting = true;
+    if (s.entry.remoteRank >= 0) waitingOn.push_back(s.entry.remoteRank);
+  }
+  std::sort(waitingOn.begin(), waitingOn.end());
+  waitingOn.erase(std::unique(waitingOn.begin(), waitingOn.end()), waitingOn.end());
+
+  auto now = std::chrono::steady_clock::now();
+  if (signature != lastSignature) {
+    lastSignature = std::move(signature);
+    lastProgress = now;
+  }
+  int64_t noProgressMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastProgress).count();
+  bool isStalled = waiting && noProgressMs >= timeoutMs;
+
+  std::stringstream ss;
+  ss << "rank " << rank << ": " << (isStalled ? "stalled" : (waiting ? "waiting" : "idle or progressing"))
+     << ", no progress for " << noProgressMs / 1000.0 << " s" << entriesReport;
+  bool newlyStalled;
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    newlyStalled = isStalled && !stalled;
+    stalled = isStalled;
+    report = ss.str();
+  }
+  if (newlyStalled) {
+    WARN("Hang detected, dumping the state of %s", ss.str().c_str());
+  }
+
+  summary.stalled = isStalled;
+  summary.noProgressMs = noProgressMs;
+  summary.numWaitingOn = (int32_t)waitingOn.size();
+  for (int i = 0; i < std::min<int>(waitingOn.size(), HangDetectorMaxWaitingOn); ++i) {
+    summary.waitingOn[i] = waitingOn[i];
+  }
+  return summary;
+}
+
+void HangDetector::Impl::reportGlobal(const std::vector<HangDetectorSummary>& summaries) {
+  std::stringstream ss;
+  int numStalled = 0;
+  for (const auto& summary : summaries) {
+    if (!summary.stalled) continue;
+    numStalled++;
+    ss << "\n  rank " << summary.rank << " is waiting on ";
+    if (summary.numWaitingOn == 0) ss << "its proxy";
+    for (int i = 0; i < std::min(summary.numWaitingOn, HangDetectorMaxWaitingOn); ++i) {
+      ss << (i > 0 ? ", " : "") << "rank " << summary.waitingOn[i];
+    }
+    if (summary.numWaitingOn > HangDetectorMaxWaitingOn) {
+      ss << " and " << summary.numWaitingOn - HangDetectorMaxWaitingOn << " more";
+    }
+  }
+  // Only report changes of the set of stalled ranks and what they wait on.
+  std::string globalReport = ss.str();
+  if (globalReport == lastGlobalReport) return;
+  lastGlobalReport = globalReport;
+  if (numStalled > 0) {
+    WARN("Hang detector: %d of %d ranks are stalled:%s", numStalled, nRanks, globalReport.c_str());
+  } else {
+    INFO(MSCCLPP_INIT, "Hang detector: no rank is stalled anymore");
+  }
+}
+
+void HangDetector::Impl::runAndNotify() {
+  try {
+    run();
+  } catch (const std::exception& e) {
+    WARN("Hang detector of rank %d stopped: %s", rank, e.what());
+  }
+  stream.reset();
+  {
+    std::lock_guard<std::mutex> lock(stopMutex);
+    done = true;
+  }
+  stopCv.notify_all();
+}
+
+void HangDetector::Impl::run() {
+  MSCCLPP_CUDATHROW(cudaSetDevice(cudaDevice));
+  stream = std::make_unique<CudaStreamWithFlags>(cudaStreamNonBlocking);
+  std::vector<bool> peerActive(nRanks, true);
+  int numActivePeers = nRanks - 1;
+  bool stopping = false;
+  while (!stopping || (rank == 0 && numActivePeers > 0)) {
+    if (!stopping) {
+      std::unique_lock<std::mutex> lock(stopMutex);
+      stopCv.wait_for(lock, std::chrono::milliseconds(checkPeriodMs), [this] { return stop; });
+      stopping = stop;
+    }
+    HangDetectorSummary summary = check();
+    summary.stop = stopping;
+    if (rank != 0) {
+      bootstrap->send(&summary, sizeof(summary), 0, HangDetectorTag);
+      continue;
+    }
+    std::vector<HangDetectorSummary> summaries = {summary};
+    for (int peer = 1; peer < nRanks; ++peer) {
+      if (!peerActive[peer]) continue;
+      HangDetectorSummary peerSummary;
+      bootstrap->recv(&peerSummary, sizeof(peerSummary), peer, HangDetectorTag);
+      if (peerSummary.stop) {
+        peerActive[peer] = false;
+        numActivePeers--;
+      }
+      summaries.push_back(peerSummary);
+    }
+    reportGlobal(summaries);
+  }
+}
+
+MSCCLPP_API_CPP HangDetector::HangDetector(std::shared_ptr<Bootstrap> bootstrap, int64_t timeoutSec,
+                                           int64_t checkPeriodMs)
+    : pimpl_(std::make_shared<Impl>(bootstrap, timeoutSec, checkPeriodMs)) {
+  // The thread shares the state, since it is left behind if the other ranks do not stop in time.
+  pimpl_->thread = std::thread([impl = pimpl_] { impl->runAndNotify(); });
+}
+
+MSCCLPP_API_CPP HangDetector::~HangDetector() {
+  int64_t waitMs = pimpl_->timeoutMs + HangDetectorStopGraceMs;
+  bool done;
+  {
+    std::unique_lock<std::mutex> lock(pimpl_->stopMutex);
+    pimpl_->stop = true;
+    pimpl_->stopCv.notify_all();
+    done = pimpl_->stopCv.wait_for(lock, std::chrono::milliseconds(waitMs), [this] { return pimpl_->done; });
+  }
+  if (done) {
+    pimpl_->thread.join();
+  } else {
+    WARN("Hang detector of rank %d: other ranks did not stop within %ld ms, leaving the watchdog thread behind",
+         pimpl_->rank, waitMs);
+    pimpl_->thread.detach();
+  }
+}
+
+MSCCLPP_API_CPP bool HangDetector::stalled() const {
+  std::lock_guard<std::mutex> lock(pimpl_->stateMutex);
+  return pimpl_->stalled;
+}
+
+MSCCLPP_API_CPP std::string HangDetector::report() const {
+  std::lock_guard<std::mutex> lock(pimpl_->stateMutex);
+  return pimpl_->report;
+}
+
+}  // namespace mscclpp
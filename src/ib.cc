@@ -297,6 +297,17 @@ int IbQp::getWcStatus(int idx) const { return (*this->wcs)[idx].status; }
 
 int IbQp::getNumCqItems() const { return this->numSignaledPostedItems; }
 
+int IbQp::getState() const {
+  struct ibv_qp_attr qp_attr;
+  struct ibv_qp_init_attr init_attr;
+  if (IBVerbs::ibv_query_qp(this->qp, &qp_attr, IBV_QP_STATE, &init_attr) != 0) {
+    std::stringstream err;
+    err << "ibv_query_qp failed (errno " << errno << ")";
+    throw mscclpp::IbError(err.str(), errno);
+  }
+  return qp_attr.qp_state;
+}
+
 IbCtx::IbCtx(const std::string& devName) : devName(devName) {
 #if !defined(__HIP_PLATFORM_AMD__)
   if (!checkNvPeerMemLoaded()) {
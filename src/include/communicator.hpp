@@ -9,6 +9,8 @@
 #include <unordered_map>
 #include <vector>
 
+#include "semaphore_pool.hpp"
+
 namespace mscclpp {
 
 class ConnectionBase;
@@ -23,6 +25,7 @@ struct Communicator::Impl {
   std::shared_ptr<Context> context_;
   std::unordered_map<const Connection*, ConnectionInfo> connectionInfos_;
   std::vector<std::shared_ptr<Setuppable>> toSetup_;
+  SemaphorePool semaphorePool_;
 
   Impl(std::shared_ptr<Bootstrap> bootstrap, std::shared_ptr<Context> context);
 
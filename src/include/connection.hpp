@@ -6,6 +6,8 @@
 
 #include <mscclpp/core.hpp>
 #include <mscclpp/gpu.hpp>
+#include <mscclpp/metrics.hpp>
+#include <mutex>
 
 #include "communicator.hpp"
 #include "context.hpp"
@@ -15,8 +17,24 @@
 
 namespace mscclpp {
 
+// Metrics of a connection, labeled by its local transport and an id that is reused after the connection is destroyed.
+struct ConnectionMetrics {
+  MetricLabels labels;
+  int id;
+  std::shared_ptr<Counter> writes;
+  std::shared_ptr<Counter> writeBytes;
+  std::shared_ptr<Counter> updateAndSyncs;
+  std::shared_ptr<Histogram> flushWaitNs;
+
+  ConnectionMetrics(Transport transport);
+  ~ConnectionMetrics();
+  ConnectionMetrics(const ConnectionMetrics&) = delete;
+  ConnectionMetrics& operator=(const ConnectionMetrics&) = delete;
+};
+
 class CudaIpcConnection : public Connection {
   cudaStream_t stream_;
+  ConnectionMetrics metrics_;
 
  public:
   CudaIpcConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, cudaStream_t stream);
@@ -39,6 +57,11 @@ class IBConnection : public Connection {
   std::unique_ptr<uint64_t> dummyAtomicSource_;  // not used anywhere but IB needs a source
   RegisteredMemory dummyAtomicSourceMem_;
   mscclpp::TransportInfo dstTransportInfo_;
+  ConnectionMetrics metrics_;
+  std::shared_ptr<void> hangDetectorEntry_;
+  // A lazy connection moves its QP to RTS on the first send.
+  bool lazy_;
+  std::once_flag rtsOnce_;
 
  public:
   IBConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, Context& context);
@@ -52,8 +75,26 @@ class IBConnection : public Connection {
   void updateAndSync(RegisteredMemory dst, uint64_t dstOffset, uint64_t* src, uint64_t newValue) override;
 
   void flush(int64_t timeoutUsec) override;
+
+  // The QP of the local endpoint, which a lazy connection keeps at RTR until its first send.
+  IbQp* getQp() { return qp; }
+
+ private:
+  void readyToSend();
 };
 
+// Precedes the payload of each message of an EthernetConnection.
+struct EthernetMessageHeader {
+  char* dst;
+  uint64_t size;
+};
+
+// Default size of the send and receive buffers of an EthernetConnection, which bounds the chunks of its messages.
+constexpr uint64_t EthernetConnectionBufferSize = 256 * 1024 * 1024;
+
+class EthernetAcceptor;
+class EthernetReaper;
+
 class EthernetConnection : public Connection {
   std::unique_ptr<Socket> sendSocket_;
   std::unique_ptr<Socket> recvSocket_;
@@ -61,12 +102,32 @@ class EthernetConnection : public Connection {
   volatile uint32_t* abortFlag_;
   const uint64_t sendBufferSize_;
   const uint64_t recvBufferSize_;
-  std::vector<char> sendBuffer_;
-  std::vector<char> recvBuffer_;
+  // Allocated on the first write and on accepting the receiving socket respectively, and left uninitialized, so that
+  // only the pages that messages touch are committed.
+  std::unique_ptr<char[]> sendBuffer_;
+  std::unique_ptr<char[]> recvBuffer_;
+  ConnectionMetrics metrics_;
+  // Receives the messages instead of threadRecvMessages_ if set.
+  std::shared_ptr<EthernetReaper> reaper_;
+  // Accepts the receiving socket of a lazy connection without a reaper.
+  std::shared_ptr<EthernetAcceptor> acceptor_;
+  // A lazy connection connects its sending socket on the first send, and accepts its receiving socket when the peer
+  // connects, on the reaper or the acceptor.
+  bool lazy_;
+  Endpoint localEndpoint_;
+  SocketAddress remoteAddress_;
+  std::once_flag connectOnce_;
+  // Guards recvSocket_ against the destructor while the receiving thread accepts it.
+  std::mutex recvMutex_;
+  bool closing_;
 
  public:
-  EthernetConnection(Endpoint localEndpoint, Endpoint remoteEndpoint, uint64_t sendBufferSize = 256 * 1024 * 1024,
-                     uint64_t recvBufferSize = 256 * 1024 * 1024);
+  // A lazy connection without a reaper or an acceptor gets an acceptor of its own.
+  EthernetConnection(Endpoint localEndpoint, Endpoint remoteEndpoint,
+                     uint64_t sendBufferSize = EthernetConnectionBufferSize,
+                     uint64_t recvBufferSize = EthernetConnectionBufferSize,
+                     std::shared_ptr<EthernetReaper> reaper = nullptr,
+                     std::shared_ptr<EthernetAcceptor> acceptor = nullptr);
 
   ~EthernetConnection();
 
@@ -81,8 +142,32 @@ class EthernetConnection : public Connection {
   void flush(int64_t timeoutUsec) override;
 
  private:
+  friend class EthernetAcceptor;
+  friend class EthernetReaper;
+
   void recvMessages();
 
+  // Connects the sending socket to the endpoint of the peer.
+  void connectSend();
+
+  // Accepts the receiving socket from the peer on the local endpoint.
+  void acceptRecv();
+
+  // Takes over the receiving socket that the reaper accepted from the peer on the local endpoint.
+  void adoptRecv(int fd);
+
+  // Uses `socket`, accepted from the peer, to receive.
+  void setRecvSocket(std::unique_ptr<Socket> socket);
+
+  // Returns the listening socket of the local endpoint.
+  Socket* listenSocket();
+
+  // Copies `size` bytes of the payload of `header` at `offset` from the receive buffer to their destination.
+  void copyReceived(const EthernetMessageHeader& header, uint64_t offset, uint64_t size);
+
+  // Completes a message whose payload is copied.
+  void messageReceived(const EthernetMessageHeader& header);
+
   void sendMessage();
 };
 
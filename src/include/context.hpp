@@ -9,6 +9,8 @@
 #include <unordered_map>
 #include <vector>
 
+#include "ethernet_acceptor.hpp"
+#include "ethernet_reaper.hpp"
 #include "ib.hpp"
 
 namespace mscclpp {
@@ -16,12 +18,24 @@ namespace mscclpp {
 struct Context::Impl {
   std::vector<std::shared_ptr<Connection>> connections_;
   std::unordered_map<Transport, std::unique_ptr<IbCtx>> ibContexts_;
-  CudaStreamWithFlags ipcStream_;
+  // Created on the first CudaIpc connection, so that contexts with other transports need no GPU.
+  std::unique_ptr<CudaStreamWithFlags> ipcStream_;
   CUmemGenericAllocationHandle mcHandle_;
+  // Receives the messages of all Ethernet connections if MSCCLPP_SOCKET_IO_URING is set. Created on the first Ethernet
+  // connection, and held by the connections as well, so that it outlives them.
+  std::shared_ptr<EthernetReaper> ethernetReaper_;
+  bool ethernetReaperCreated_;
+  // Accepts the lazy Ethernet connections if there is no reaper. Created on the first Ethernet connection.
+  std::shared_ptr<EthernetAcceptor> ethernetAcceptor_;
+  // Ethernet endpoints created so far, to spread them over the network interfaces.
+  size_t ethernetEndpoints_;
 
   Impl();
 
   IbCtx* getIbContext(Transport ibTransport);
+  cudaStream_t getIpcStream();
+  std::shared_ptr<EthernetReaper> getEthernetReaper();
+  std::shared_ptr<EthernetAcceptor> getEthernetAcceptor();
 };
 
 }  // namespace mscclpp
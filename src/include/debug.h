@@ -99,6 +99,23 @@ void mscclppDebugLog(mscclppDebugLogLevel level, unsigned long flags, const char
                      ...) __attribute__((format(printf, 5, 6)));
 mscclppResult_t mscclppDebugSetLogHandler(mscclppLogHandler_t handler);
 
+// Enable or disable the asynchronous logging backend (also enabled by MSCCLPP_DEBUG_ASYNC=1).
+// When enabled, INFO and TRACE messages are queued into per-thread lock-free rings and
+// written by a background thread.
+void mscclppDebugSetAsync(int enable);
+// Block until all messages queued by the asynchronous logging backend have been written.
+void mscclppDebugFlush();
+// Set the log level of the given sub-systems independently of MSCCLPP_DEBUG (also set by entries
+// like NET=WARN in MSCCLPP_DEBUG_SUBSYS). A negative level makes them follow MSCCLPP_DEBUG again.
+void mscclppDebugSetSubsysLevel(unsigned long subsys, int level);
+// Limit the INFO and TRACE messages of every call site to `rate` messages per second, with bursts
+// of up to `burst` messages (also set by MSCCLPP_DEBUG_RATE_LIMIT=<rate>[:<burst>]). The number of
+// suppressed messages is reported with the next message of the call site. A rate of 0 disables it.
+void mscclppDebugSetRateLimit(double rate, double burst);
+// Enable or disable writing every message as a JSON object on its own line (also enabled by
+// MSCCLPP_DEBUG_FORMAT=JSON).
+void mscclppDebugSetJson(int enable);
+
 // Let code temporarily downgrade WARN into INFO
 extern thread_local int mscclppDebugNoWarn;
 extern char mscclppLastError[];
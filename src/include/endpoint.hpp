@@ -14,12 +14,27 @@
 
 namespace mscclpp {
 
+// What decides whether the Ethernet endpoints of a context use a network interface.
+struct EthernetInterfaceInfo {
+  // Whether a physical device backs the interface.
+  bool hasDevice;
+  // The NUMA node of the device, or -1 if unknown.
+  int numaNode;
+};
+
+// Returns the indices of the interfaces, in the order they are found, that the Ethernet endpoints of a context are
+// spread over round-robin: the physical ones on `numaNode` if any, or else the physical ones if the user named the
+// interfaces, or else only the first one. `numaNode` is negative for no preference.
+std::vector<int> selectEthernetInterfaces(const std::vector<EthernetInterfaceInfo>& interfaces, int numaNode,
+                                          bool userSpecified);
+
 struct Endpoint::Impl {
   Impl(EndpointConfig config, Context::Impl& contextImpl);
   Impl(const std::vector<char>& serialization);
 
   Transport transport_;
   uint64_t hostHash_;
+  bool lazy_;
 
   // The following are only used for IB and are undefined for other transports.
   bool ibLocal_;
@@ -31,6 +46,10 @@ struct Endpoint::Impl {
   SocketAddress socketAddress_;
   volatile uint32_t* abortFlag_;
   char netIfName_[MAX_IF_NAME_SIZE + 1];
+
+ private:
+  // Picks the interface of the `index`-th Ethernet endpoint of a context and sets netIfName_ and socketAddress_.
+  void selectEthernetInterface(const EndpointConfig& config, size_t index);
 };
 
 }  // namespace mscclpp
@@ -0,0 +1,67 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_ETHERNET_ACCEPTOR_HPP_
+#define MSCCLPP_ETHERNET_ACCEPTOR_HPP_
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "socket.h"
+
+namespace mscclpp {
+
+class EthernetConnection;
+
+// Accepts the lazy Ethernet connections of a context on a single thread when there is no EthernetReaper. The thread
+// polls the listening sockets and receives the handshakes without blocking, so that a slow peer does not hold up the
+// others. A connection starts its receiving thread once accepted, so that connections never used hold no thread.
+class EthernetAcceptor {
+ public:
+  EthernetAcceptor();
+
+  ~EthernetAcceptor();
+
+  // Accepts the receiving socket of `connection` once its peer connects, and starts its receiving thread.
+  void add(EthernetConnection* connection);
+
+  // Stops accepting for `connection`, and returns once the acceptor no longer refers to it.
+  void remove(EthernetConnection* connection);
+
+ private:
+  struct Pending {
+    EthernetConnection* connection;
+    // The socket accepted for the connection while its handshake, the magic and type of the socket, is received.
+    int acceptedFd;
+    char handshake[sizeof(uint64_t) + sizeof(SocketType)];
+    size_t handshakeReceived;
+  };
+
+  void run();
+
+  // Accepts a socket on the listening socket of `pending`.
+  void accept(Pending& pending);
+
+  // Receives the handshake on the accepted socket of `pending`. Returns true once `pending` is done with, whether
+  // the connection is accepted or dropped.
+  bool receiveHandshake(Pending& pending);
+
+  // Drops the socket accepted for `pending` to accept the next one.
+  void reaccept(Pending& pending);
+
+  // Wakes up the thread to poll the sockets of pending_ again.
+  void wake();
+
+  std::mutex mutex_;
+  std::vector<Pending> pending_;
+  bool stop_;
+  // An eventfd that wakes up the thread from poll().
+  int wakeFd_;
+  // Started on the first add().
+  std::thread thread_;
+};
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_ETHERNET_ACCEPTOR_HPP_
@@ -0,0 +1,39 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_ETHERNET_REAPER_HPP_
+#define MSCCLPP_ETHERNET_REAPER_HPP_
+
+#include <memory>
+
+namespace mscclpp {
+
+class EthernetConnection;
+
+// Receives the messages of all Ethernet connections of a context on a single thread, which reaps the completions of
+// their receives from an io_uring. The receiving sockets and buffers of the connections are registered with the ring
+// as fixed files and buffers when the kernel and the locked memory limit allow it.
+class EthernetReaper {
+ public:
+  // Returns a new reaper if MSCCLPP_SOCKET_IO_URING is set and io_uring is usable, and nullptr otherwise, in which case
+  // each connection receives on a thread of its own.
+  static std::shared_ptr<EthernetReaper> create();
+
+  ~EthernetReaper();
+
+  // Starts receiving the messages of `connection`.
+  void add(EthernetConnection* connection);
+
+  // Stops receiving the messages of `connection`, and returns once the reaper no longer refers to it.
+  void remove(EthernetConnection* connection);
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> pimpl_;
+
+  EthernetReaper(std::unique_ptr<Impl> pimpl);
+};
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_ETHERNET_REAPER_HPP_
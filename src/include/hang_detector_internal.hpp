@@ -0,0 +1,43 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_HANG_DETECTOR_INTERNAL_HPP_
+#define MSCCLPP_HANG_DETECTOR_INTERNAL_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mscclpp {
+
+// A 64-bit value sampled by the hang detector. Exactly one of `hostPtr`, `devicePtr` and `getter` is set.
+struct WatchedValue {
+  std::string name;
+  const uint64_t* hostPtr = nullptr;
+  const uint64_t* devicePtr = nullptr;
+  std::function<uint64_t()> getter;
+};
+
+// An object whose state is reported by the hang detector, e.g. a semaphore or a FIFO.
+struct WatchEntry {
+  std::string name;
+  // The rank this object waits on, or -1 if it is not associated with a remote rank.
+  int remoteRank = -1;
+  std::vector<WatchedValue> values;
+  // Returns whether the object is waiting given the sampled values, in the order of `values`. Never waiting if unset.
+  // It may be called after the object is unregistered, so it must not access the object.
+  std::function<bool(const std::vector<uint64_t>&)> isWaiting;
+  // Describes state that is not sampled as values, if set. Such state does not count as progress.
+  std::function<std::string()> describe;
+};
+
+// Register an object with the hang detectors of this process. The object stays registered until the returned handle
+// is destroyed, which must happen before any memory referenced by the entry is freed. Destroying the handle waits
+// while a hang detector is reading the device values of the entry.
+std::shared_ptr<void> registerWatchEntry(WatchEntry entry);
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_HANG_DETECTOR_INTERNAL_HPP_
@@ -81,6 +81,8 @@ class IbQp {
   virtual int pollCq();
 
   IbQpInfo& getInfo() { return this->info; }
+  // Returns the current state of the QP as an ibv_qp_state, e.g. IBV_QPS_RTS.
+  virtual int getState() const;
   virtual int getWcStatus([[maybe_unused]] int idx) const;
   virtual int getNumCqItems() const;
 
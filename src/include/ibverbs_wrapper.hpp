@@ -37,6 +37,7 @@ struct IBVerbs {
     ibv_dereg_mr_lib = (ibv_dereg_mr_t)dlsym(handle, "ibv_dereg_mr");
     ibv_query_gid_lib = (ibv_query_gid_t)dlsym(handle, "ibv_query_gid");
     ibv_modify_qp_lib = (ibv_modify_qp_t)dlsym(handle, "ibv_modify_qp");
+    ibv_query_qp_lib = (ibv_query_qp_t)dlsym(handle, "ibv_query_qp");
     ibv_destroy_qp_lib = (ibv_destroy_qp_t)dlsym(handle, "ibv_destroy_qp");
     ibv_query_port_lib = (ibv_query_port_t)dlsym(handle, "ibv_query_port");
     ibv_reg_mr_iova2_lib = (ibv_reg_mr_iova2_t)dlsym(handle, "ibv_reg_mr_iova2");
@@ -44,7 +45,8 @@ struct IBVerbs {
     if (!ibv_get_device_list_lib || !ibv_free_device_list_lib || !ibv_alloc_pd_lib || !ibv_dealloc_pd_lib ||
         !ibv_open_device_lib || !ibv_close_device_lib || !ibv_query_device_lib || !ibv_create_cq_lib ||
         !ibv_create_qp_lib || !ibv_destroy_cq_lib || !ibv_reg_mr_lib || !ibv_dereg_mr_lib || !ibv_query_gid_lib ||
-        !ibv_reg_mr_iova2_lib || !ibv_modify_qp_lib || !ibv_destroy_qp_lib || !ibv_query_port_lib) {
+        !ibv_reg_mr_iova2_lib || !ibv_modify_qp_lib || !ibv_query_qp_lib || !ibv_destroy_qp_lib ||
+        !ibv_query_port_lib) {
       throw mscclpp::IbError("Failed to load one or more function in the ibibverbs library: " + std::string(dlerror()),
                              errno);
       dlclose(handle);
@@ -178,6 +180,16 @@ struct IBVerbs {
     return -1;
   }
 
+  // Static method to query the attributes of a queue pair
+  static int ibv_query_qp(struct ibv_qp* qp, struct ibv_qp_attr* attr, int attr_mask,
+                          struct ibv_qp_init_attr* init_attr) {
+    if (!initialized) initialize();
+    if (ibv_query_qp_lib) {
+      return ibv_query_qp_lib(qp, attr, attr_mask, init_attr);
+    }
+    return -1;
+  }
+
   // Static method to destroy a queue pair
   static int ibv_destroy_qp(struct ibv_qp* qp) {
     if (!initialized) initialize();
@@ -242,6 +254,7 @@ struct IBVerbs {
   typedef int (*ibv_dereg_mr_t)(struct ibv_mr*);
   typedef int (*ibv_query_gid_t)(struct ibv_context*, uint8_t, int, union ibv_gid*);
   typedef int (*ibv_modify_qp_t)(struct ibv_qp*, struct ibv_qp_attr*, int);
+  typedef int (*ibv_query_qp_t)(struct ibv_qp*, struct ibv_qp_attr*, int, struct ibv_qp_init_attr*);
   typedef int (*ibv_query_port_t)(struct ibv_context*, uint8_t, struct ibv_port_attr*);
   typedef struct ibv_mr* (*ibv_reg_mr_iova2_t)(struct ibv_pd* pd, void* addr, size_t length, uint64_t iova,
                                                unsigned int access);
@@ -260,6 +273,7 @@ struct IBVerbs {
   static inline ibv_dereg_mr_t ibv_dereg_mr_lib = nullptr;
   static inline ibv_query_gid_t ibv_query_gid_lib = nullptr;
   static inline ibv_modify_qp_t ibv_modify_qp_lib = nullptr;
+  static inline ibv_query_qp_t ibv_query_qp_lib = nullptr;
   static inline ibv_destroy_qp_t ibv_destroy_qp_lib = nullptr;
   static inline ibv_query_port_t ibv_query_port_lib = nullptr;
   static inline ibv_reg_mr_iova2_t ibv_reg_mr_iova2_lib = nullptr;
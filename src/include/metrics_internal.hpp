@@ -0,0 +1,27 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_METRICS_INTERNAL_HPP_
+#define MSCCLPP_METRICS_INTERNAL_HPP_
+
+#include <mutex>
+#include <set>
+
+namespace mscclpp {
+
+// Hands out small integer ids for the metric labels of objects that come and go, such as proxies and connections.
+// Released ids are handed out again, so the number of label values is bounded by the number of live objects.
+class MetricLabelIds {
+ public:
+  int acquire();
+  void release(int id);
+
+ private:
+  std::mutex mutex_;
+  std::set<int> released_;
+  int next_ = 0;
+};
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_METRICS_INTERNAL_HPP_
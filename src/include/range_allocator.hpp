@@ -0,0 +1,73 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_RANGE_ALLOCATOR_HPP_
+#define MSCCLPP_RANGE_ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+namespace mscclpp {
+
+// Statistics of a RangeAllocator.
+struct RangeAllocatorStats {
+  size_t totalBytes;
+  size_t allocatedBytes;
+  size_t freeBytes;
+  size_t numAllocations;
+  size_t numFreeRanges;
+  size_t largestFreeRange;
+  // 1 - largestFreeRange / freeBytes, i.e., 0 if all free space is contiguous and close to 1 if it is scattered.
+  double fragmentation;
+};
+
+// Carves aligned ranges of offsets out of a fixed-size region, e.g. a multicast address space or a scratch buffer.
+//
+// Free ranges are kept both in a map ordered by offset, so that freed ranges are coalesced with their neighbors, and
+// in free lists segregated by the power of two of their sizes. An allocation takes the best fit among the free ranges
+// of its own size class, or the smallest range of the next non-empty class, so allocating and freeing both take
+// O(log n) time for n free ranges. Not thread-safe.
+class RangeAllocator {
+ public:
+  // Create an allocator of `totalBytes` bytes, rounded down to a multiple of `alignment`.
+  RangeAllocator(size_t totalBytes, size_t alignment = 1);
+
+  // Allocate a range of `size` bytes rounded up to the alignment and return its offset.
+  // Throws an Error with ErrorCode::InvalidUsage if no free range is large enough.
+  size_t allocate(size_t size);
+
+  // Free a range returned by allocate(), given the same size.
+  // Throws an Error with ErrorCode::InvalidUsage if no such range is allocated.
+  void free(size_t offset, size_t size);
+
+  size_t totalBytes() const { return totalBytes_; }
+  size_t alignment() const { return alignment_; }
+  RangeAllocatorStats stats() const;
+
+ private:
+  static constexpr int NumSizeClasses = 64;
+
+  size_t alignedSize(size_t size) const;
+  void insertFreeRange(size_t offset, size_t size);
+  void eraseFreeRange(std::map<size_t, size_t>::iterator it);
+
+  size_t totalBytes_;
+  size_t alignment_;
+  size_t allocatedBytes_;
+  // Free ranges as offset -> size
+  std::map<size_t, size_t> freeRanges_;
+  // Free ranges as (size, offset) by floor(log2(size))
+  std::set<std::pair<size_t, size_t>> sizeClasses_[NumSizeClasses];
+  // Bit i is set if sizeClasses_[i] is not empty
+  uint64_t nonEmptyClasses_;
+  // Allocated ranges as offset -> size
+  std::unordered_map<size_t, size_t> allocatedRanges_;
+};
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_RANGE_ALLOCATOR_HPP_
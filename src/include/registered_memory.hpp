@@ -4,6 +4,8 @@
 #ifndef MSCCLPP_REGISTERED_MEMORY_HPP_
 #define MSCCLPP_REGISTERED_MEMORY_HPP_
 
+#include <sys/types.h>
+
 #include <mscclpp/core.hpp>
 #include <mscclpp/errors.hpp>
 #include <mscclpp/gpu.hpp>
@@ -13,16 +15,41 @@
 
 namespace mscclpp {
 
+// How memory is shared with other processes over Transport::CudaIpc.
+enum class CudaIpcHandleType : int8_t {
+  // A legacy CUDA IPC handle of memory allocated by cudaMalloc.
+  Legacy,
+  // A POSIX file descriptor of memory allocated by cuMemCreate, duplicated by the importer via pidfd_getfd().
+  PosixFd,
+  // A fabric handle of memory allocated by cuMemCreate, importable from any node of the same NVLink domain.
+  Fabric,
+};
+
 struct TransportInfo {
   Transport transport;
 
   // TODO: rewrite this using std::variant or something
   bool ibLocal;
+  CudaIpcHandleType cudaIpcHandleType;
   union {
     struct {
       cudaIpcMemHandle_t cudaIpcBaseHandle;
       size_t cudaIpcOffsetFromBase;
     };
+    struct {
+      union {
+        struct {
+          pid_t cuMemPid;
+          int cuMemFd;
+        };
+        char cuMemFabricHandle[64];
+      };
+      // The granularity-aligned range of the physical allocation that is shared, which covers the registered memory.
+      size_t cuMemMapOffset;
+      size_t cuMemMapSize;
+      // The offset of the registered memory from the start of the shared range.
+      size_t cuMemOffsetFromMap;
+    };
     struct {
       const IbMr* ibMr;
       IbMrInfo ibMrInfo;
@@ -41,6 +68,8 @@ struct RegisteredMemory::Impl {
   uint64_t pidHash;
   TransportFlags transports;
   std::vector<TransportInfo> transportInfos;
+  // The range mapped by importing a cuMem handle, or nullptr if none. Only set for remote memory.
+  void* cuMemMappedPtr = nullptr;
 
   Impl(void* data, size_t size, TransportFlags transports, Context::Impl& contextImpl);
   /// Constructs a RegisteredMemory::Impl from a vector of data. The constructor should only be used for the remote
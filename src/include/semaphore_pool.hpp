@@ -0,0 +1,115 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_SEMAPHORE_POOL_HPP_
+#define MSCCLPP_SEMAPHORE_POOL_HPP_
+
+#include <map>
+#include <memory>
+#include <mscclpp/core.hpp>
+#include <tuple>
+#include <vector>
+
+namespace mscclpp {
+
+// The kinds of semaphores. Paired semaphore IDs are only paired with those of the same kind.
+enum class SemaphoreKind : int8_t {
+  Host2Device,
+  Host2Host,
+  SmDevice2Device,
+};
+
+// An inbound semaphore ID together with the inbound semaphore ID of its counterpart on the remote peer.
+struct PairedSemaphoreId {
+  std::shared_ptr<uint64_t> local;
+  NonblockingFuture<RegisteredMemory> remoteSlab;
+  uint64_t remoteOffset;
+};
+
+// Allocates the semaphore IDs of a communicator in slabs.
+//
+// Inbound semaphore IDs written by remote peers are allocated from slabs dedicated to a connection and a semaphore
+// kind, and the n-th paired ID of a kind allocated on a connection is paired with the n-th one allocated by the peer.
+// The first slab of each kind is registered and exchanged with the peer when the connection is established, so that
+// the first `SlabSize` semaphores of a kind on a connection are set up without the peer: a semaphore that only signals
+// does not need a counterpart constructed by the peer. Later slabs are exchanged in the setup round after they are
+// allocated, which requires the peer to construct as many semaphores. A kind whose first slab either side did not send
+// is exchanged like a later slab. Other IDs are allocated from unregistered slabs.
+// First slabs are carved from arenas that are registered once per transport, so that setting up a connection does not
+// allocate, register or import any memory of its own.
+// The pool keeps the slabs that IDs are currently allocated from. The slabs of a connection are dropped by the pool
+// once the connection is destroyed, and their memory is freed when the semaphores using them are destroyed as well.
+class SemaphorePool {
+ public:
+  // The number of semaphore IDs in a slab.
+  static constexpr size_t SlabSize = 512;
+
+  // The number of first slabs in an arena.
+  static constexpr size_t ArenaSlabs = 64;
+
+  struct Slab {
+    std::shared_ptr<uint64_t> ids;
+    size_t used = SlabSize;
+
+    bool full() const { return used == SlabSize; }
+    std::shared_ptr<uint64_t> next() { return std::shared_ptr<uint64_t>(ids, ids.get() + used++); }
+  };
+
+  // The first slab of each semaphore kind that a connection may use.
+  using InitialSlabs = std::map<SemaphoreKind, Slab>;
+
+  static SemaphorePool& get(Communicator& communicator);
+
+  // Carves the initial slabs of a connection over `transport` that is being established from the arenas. Returns the
+  // data to send to the peer along with the local endpoint.
+  std::vector<char> prepareConnection(Context& context, Transport transport, InitialSlabs& slabs);
+
+  // Sets up the initial slabs of an established connection with the data returned by prepareConnection() of the peer.
+  void addConnection(std::shared_ptr<Connection> connection, const InitialSlabs& slabs,
+                     const std::vector<char>& remoteData);
+
+  // Allocates a zero-initialized semaphore ID that is not accessed by remote peers.
+  std::shared_ptr<uint64_t> allocate(bool onDevice);
+
+  // Allocates a zero-initialized inbound semaphore ID paired with the remote peer of `connection`.
+  PairedSemaphoreId allocatePaired(Communicator& communicator, std::shared_ptr<Connection> connection,
+                                   SemaphoreKind kind);
+
+ private:
+  struct ConnectionSlab {
+    std::weak_ptr<Connection> connection;
+    Slab slab;
+    NonblockingFuture<RegisteredMemory> remoteSlab;
+    // The offset of the slab in `remoteSlab`, which is a whole arena for a first slab.
+    uint64_t remoteSlabOffset = 0;
+  };
+
+  // Memory that first slabs are carved from. It is freed along with its registrations when all its slabs are released.
+  struct Arena {
+    std::shared_ptr<uint64_t> ids;
+    // Declared after `ids` so that they are destroyed before it.
+    std::map<Transport, RegisteredMemory> registrations;
+    size_t used = 0;
+  };
+
+  // Allocates a zero-initialized slab, or the memory of an arena of `numSlabs` slabs.
+  static Slab newSlab(bool onDevice, size_t numSlabs = 1);
+
+  // Carves a slab from the current arena of host or device memory and returns the registration of its arena.
+  Slab carveSlab(Context& context, bool onDevice, Transport transport, RegisteredMemory& arenaMemory,
+                 uint64_t& offset);
+
+  // Drops the slabs of destroyed connections once their number has doubled since the last time.
+  void dropExpiredConnectionSlabs();
+
+  Slab hostSlab_;
+  Slab deviceSlab_;
+  std::shared_ptr<Arena> hostArena_;
+  std::shared_ptr<Arena> deviceArena_;
+  std::map<std::tuple<const Connection*, SemaphoreKind>, ConnectionSlab> connectionSlabs_;
+  size_t connectionSlabsAfterDrop_ = 0;
+};
+
+}  // namespace mscclpp
+
+#endif  // MSCCLPP_SEMAPHORE_POOL_HPP_
@@ -11,6 +11,7 @@
 #include <poll.h>
 #include <stddef.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 namespace mscclpp {
 
@@ -56,6 +57,10 @@ int FindInterfaceMatchSubnet(char* ifNames, union SocketAddress* localAddrs, uni
                              int ifNameMaxSize, int maxIfs);
 int FindInterfaces(char* ifNames, union SocketAddress* ifAddrs, int ifNameMaxSize, int maxIfs,
                    const char* inputIfName = nullptr);
+// Returns the NUMA node of the device behind a network interface, or -1 if unknown, e.g. for virtual interfaces.
+int GetInterfaceNumaNode(const char* ifName);
+// Returns whether a physical device backs a network interface, unlike loopback, bridges or veths.
+bool InterfaceHasDevice(const char* ifName);
 
 class Socket {
  public:
@@ -67,11 +72,25 @@ class Socket {
   void bindAndListen();
   void connect(int64_t timeout = -1);
   void accept(const Socket* listenSocket, int64_t timeout = -1);
-  void send(void* ptr, int size);
-  void recv(void* ptr, int size);
-  void recvUntilEnd(void* ptr, int size, int* closed);
+  // Takes over `fd`, a socket accepted elsewhere from `listenSocket` whose magic and type are already received and
+  // checked, as if accept() had returned it.
+  void adoptAccepted(const Socket* listenSocket, int fd);
+  void send(const void* ptr, size_t size);
+  void recv(void* ptr, size_t size);
+  // Sends the buffers of `iov` (at most 16) in order, with as few sendmsg() calls as the socket takes.
+  void sendv(const struct iovec* iov, int iovcnt);
+  // Receives into the buffers of `iov` (at most 16) in order, with as few recvmsg() calls as the socket gives.
+  void recvv(const struct iovec* iov, int iovcnt);
+  // Blocking receive that sets `closed` instead of throwing if the peer closes the connection.
+  void recvUntilEnd(void* ptr, size_t size, int* closed);
   void close();
 
+  // Lets blocking receives busy-poll the device queue for up to `usec` microseconds before sleeping (SO_BUSY_POLL).
+  void setBusyPoll(int usec);
+  // Makes recvUntilEnd() wait in the kernel until the whole buffer is received (MSG_WAITALL), instead of returning to
+  // the caller after each segment. Only useful on blocking sockets.
+  void setRecvWaitAll(bool waitAll) { recvWaitAll_ = waitAll; }
+
   int getFd() const { return fd_; }
   int getAcceptFd() const { return acceptFd_; }
   int getConnectRetries() const { return connectRetries_; }
@@ -92,9 +111,11 @@ class Socket {
   void finalizeConnect();
   void progressState();
 
-  void socketProgressOpt(int op, void* ptr, int size, int* offset, int block, int* closed);
-  void socketProgress(int op, void* ptr, int size, int* offset);
-  void socketWait(int op, void* ptr, int size, int* offset);
+  void socketProgressOpt(int op, void* ptr, size_t size, size_t* offset, int block, int* closed);
+  void socketProgress(int op, void* ptr, size_t size, size_t* offset);
+  void socketWait(int op, void* ptr, size_t size, size_t* offset);
+  void socketWaitv(int op, const struct iovec* iov, int iovcnt);
+  void checkReady(const char* what) const;
 
   int fd_;
   int acceptFd_;
@@ -105,6 +126,7 @@ class Socket {
   enum SocketState state_;
   uint64_t magic_;
   enum SocketType type_;
+  bool recvWaitAll_;
 
   union SocketAddress addr_;
   int salen_;
@@ -21,6 +21,26 @@ uint64_t getHostHash();
 uint64_t getPidHash();
 void getRandomData(void* buffer, size_t bytes);
 
+// Blocks until the 32-bit word at `addr` differs from `value`, futexWakeAll() is called on `addr`, or `timeoutNs`
+// elapses, whichever comes first. Waits without a timeout if `timeoutNs` is negative. May return spuriously.
+void futexWait(const void* addr, uint32_t value, int64_t timeoutNs);
+// Wakes up all threads of this process blocked in futexWait() on `addr`.
+void futexWakeAll(const void* addr);
+
+// Marks `addr` as waited on by the calling thread for futexWakeWaiters() while the object lives.
+struct FutexWaiter {
+  FutexWaiter(const void* addr);
+  ~FutexWaiter();
+  FutexWaiter(const FutexWaiter&) = delete;
+  FutexWaiter& operator=(const FutexWaiter&) = delete;
+
+  const void* addr;
+};
+
+// Calls futexWakeAll() on `addr` if a FutexWaiter marks it. Returns right away if no thread waits, so it may be called
+// on any address, including device pointers, which must not be passed to futexWakeAll().
+void futexWakeWaiters(const void* addr);
+
 struct netIf {
   char prefix[64];
   int port;
@@ -0,0 +1,413 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <mscclpp/errors.hpp>
+#include <mscclpp/metrics.hpp>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "api.h"
+#include "debug.h"
+#include "metrics_internal.hpp"
+
+namespace mscclpp {
+
+// The number of shards of every counter and histogram. Threads are spread over the shards round-robin.
+static const int MetricsNumShards = 16;
+
+static int getMetricsShard() {
+  static std::atomic<int> nextShard{0};
+  thread_local int shard = nextShard.fetch_add(1, std::memory_order_relaxed) % MetricsNumShards;
+  return shard;
+}
+
+// Counter
+
+struct Counter::Impl {
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> value{0};
+  };
+  Shard shards[MetricsNumShards];
+};
+
+MSCCLPP_API_CPP Counter::Counter() : pimpl_(std::make_unique<Impl>()) {}
+
+MSCCLPP_API_CPP Counter::~Counter() = default;
+
+MSCCLPP_API_CPP void Counter::add(uint64_t value) {
+  pimpl_->shards[getMetricsShard()].value.fetch_add(value, std::memory_order_relaxed);
+}
+
+MSCCLPP_API_CPP uint64_t Counter::value() const {
+  uint64_t sum = 0;
+  for (const auto& shard : pimpl_->shards) sum += shard.value.load(std::memory_order_relaxed);
+  return sum;
+}
+
+MSCCLPP_API_CPP void Counter::reset() {
+  for (auto& shard : pimpl_->shards) shard.value.store(0, std::memory_order_relaxed);
+}
+
+// Histogram
+
+// Values below SubBuckets have a bucket each. Above that, the bucket of a value is given by the position of its most
+// significant bit and the next log2(SubBuckets) bits.
+static const int HistogramSubBucketBits = 3;
+static_assert((1 << HistogramSubBucketBits) == Histogram::SubBuckets, "SubBuckets must be 2^HistogramSubBucketBits");
+static const int HistogramNumBuckets = (64 - HistogramSubBucketBits + 1) * Histogram::SubBuckets;
+
+static int getHistogramBucket(uint64_t value) {
+  if (value < (uint64_t)Histogram::SubBuckets) return (int)value;
+  int msb = 63 - __builtin_clzll(value);
+  int sub = (int)(value >> (msb - HistogramSubBucketBits)) & (Histogram::SubBuckets - 1);
+  return (msb - HistogramSubBucketBits + 1) * Histogram::SubBuckets + sub;
+}
+
+static uint64_t getHistogramBucketUpperBound(int bucket) {
+  if (bucket < Histogram::SubBuckets) return (uint64_t)bucket;
+  int shift = bucket / Histogram::SubBuckets - 1;
+  uint64_t sub = bucket % Histogram::SubBuckets;
+  uint64_t lower = ((uint64_t)Histogram::SubBuckets + sub) << shift;
+  return lower + (((uint64_t)1 << shift) - 1);
+}
+
+struct Histogram::Impl {
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> buckets[HistogramNumBuckets];
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> min;
+    std::atomic<uint64_t> max;
+
+    Shard() { reset(); }
+
+    void reset() {
+      for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+      sum.store(0, std::memory_order_relaxed);
+      min.store(UINT64_MAX, std::memory_order_relaxed);
+      max.store(0, std::memory_order_relaxed);
+    }
+  };
+  std::unique_ptr<Shard[]> shards;
+
+  Impl() : shards(std::make_unique<Shard[]>(MetricsNumShards)) {}
+};
+
+MSCCLPP_API_CPP Histogram::Histogram() : pimpl_(std::make_unique<Impl>()) {}
+
+MSCCLPP_API_CPP Histogram::~Histogram() = default;
+
+MSCCLPP_API_CPP void Histogram::record(uint64_t value) {
+  Impl::Shard& shard = pimpl_->shards[getMetricsShard()];
+  shard.buckets[getHistogramBucket(value)].fetch_add(1, std::memory_order_relaxed);
+  shard.sum.fetch_add(value, std::memory_order_relaxed);
+  uint64_t current = shard.min.load(std::memory_order_relaxed);
+  while (value < current && !shard.min.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+  current = shard.max.load(std::memory_order_relaxed);
+  while (value > current && !shard.max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+
+MSCCLPP_API_CPP HistogramSnapshot Histogram::snapshot() const {
+  HistogramSnapshot snapshot;
+  std::vector<uint64_t> counts(HistogramNumBuckets, 0);
+  uint64_t min = UINT64_MAX;
+  for (int i = 0; i < MetricsNumShards; ++i) {
+    const Impl::Shard& shard = pimpl_->shards[i];
+    for (int b = 0; b < HistogramNumBuckets; ++b) counts[b] += shard.buckets[b].load(std::memory_order_relaxed);
+    snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    min = std::min(min, shard.min.load(std::memory_order_relaxed));
+    snapshot.max = std::max(snapshot.max, shard.max.load(std::memory_order_relaxed));
+  }
+  for (int b = 0; b < HistogramNumBuckets; ++b) {
+    if (counts[b] == 0) continue;
+    snapshot.count += counts[b];
+    snapshot.bucketUpperBounds.push_back(getHistogramBucketUpperBound(b));
+    snapshot.bucketCounts.push_back(counts[b]);
+  }
+  snapshot.min = (snapshot.count > 0) ? min : 0;
+  return snapshot;
+}
+
+MSCCLPP_API_CPP void Histogram::reset() {
+  for (int i = 0; i < MetricsNumShards; ++i) pimpl_->shards[i].reset();
+}
+
+MSCCLPP_API_CPP uint64_t HistogramSnapshot::quantile(double q) const {
+  if (count == 0) return 0;
+  q = std::min(std::max(q, 0.0), 1.0);
+  uint64_t rank = std::max<uint64_t>((uint64_t)std::ceil(q * count), 1);
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < bucketCounts.size(); ++i) {
+    cumulative += bucketCounts[i];
+    if (cumulative >= rank) return std::min(std::max(bucketUpperBounds[i], min), max);
+  }
+  return max;
+}
+
+// MetricsRegistry
+
+enum class MetricType { Counter, Histogram };
+
+struct MetricFamily {
+  MetricType type;
+  std::string help;
+  // Keyed by the rendered labels.
+  std::map<std::string, std::shared_ptr<Counter>> counters;
+  std::map<std::string, std::shared_ptr<Histogram>> histograms;
+};
+
+static std::string renderLabels(const MetricLabels& labels) {
+  std::string rendered;
+  for (const auto& label : labels) {
+    if (!rendered.empty()) rendered += ",";
+    rendered += label.first + "=\"";
+    for (char c : label.second) {
+      if (c == '\\' || c == '"') {
+        rendered += '\\';
+        rendered += c;
+      } else if (c == '\n') {
+        rendered += "\\n";
+      } else {
+        rendered += c;
+      }
+    }
+    rendered += "\"";
+  }
+  return rendered;
+}
+
+struct MetricsRegistry::Impl {
+  mutable std::mutex mutex;
+  std::map<std::string, MetricFamily> families;
+
+  MetricFamily& getFamily(const std::string& name, const std::string& help, MetricType type) {
+    auto it = families.find(name);
+    if (it == families.end()) {
+      it = families.emplace(name, MetricFamily{type, help, {}, {}}).first;
+    } else if (it->second.type != type) {
+      throw Error("Metric " + name + " is already registered with a different type", ErrorCode::InvalidUsage);
+    }
+    return it->second;
+  }
+};
+
+MSCCLPP_API_CPP MetricsRegistry::MetricsRegistry() : pimpl_(std::make_unique<Impl>()) {}
+
+MSCCLPP_API_CPP MetricsRegistry::~MetricsRegistry() = default;
+
+static std::unique_ptr<MetricsHttpServer> startGlobalMetricsHttpServer(MetricsRegistry& registry) {
+  const char* portEnv = getenv("MSCCLPP_METRICS_PORT");
+  if (portEnv == nullptr) return nullptr;
+  try {
+    auto server = std::make_unique<MetricsHttpServer>(registry, atoi(portEnv));
+    INFO(MSCCLPP_INIT, "Serving metrics on 127.0.0.1:%d", server->port());
+    return server;
+  } catch (const BaseError& e) {
+    WARN("Failed to serve metrics on port %s: %s", portEnv, e.what());
+    return nullptr;
+  }
+}
+
+// Never destroyed, since connections and proxies remove their metrics from it when they are destroyed, which may be
+// after static objects.
+MSCCLPP_API_CPP MetricsRegistry& MetricsRegistry::global() {
+  static MetricsRegistry* registry = new MetricsRegistry();
+  static std::unique_ptr<MetricsHttpServer> server = startGlobalMetricsHttpServer(*registry);
+  return *registry;
+}
+
+MSCCLPP_API_CPP std::shared_ptr<Counter> MetricsRegistry::counter(const std::string& name, const std::string& help,
+                                                                  const MetricLabels& labels) {
+  std::lock_guard<std::mutex> lock(pimpl_->mutex);
+  auto& counter = pimpl_->getFamily(name, help, MetricType::Counter).counters[renderLabels(labels)];
+  if (!counter) counter = std::make_shared<Counter>();
+  return counter;
+}
+
+MSCCLPP_API_CPP std::shared_ptr<Histogram> MetricsRegistry::histogram(const std::string& name, const std::string& help,
+                                                                      const MetricLabels& labels) {
+  std::lock_guard<std::mutex> lock(pimpl_->mutex);
+  auto& histogram = pimpl_->getFamily(name, help, MetricType::Histogram).histograms[renderLabels(labels)];
+  if (!histogram) histogram = std::make_shared<Histogram>();
+  return histogram;
+}
+
+MSCCLPP_API_CPP void MetricsRegistry::remove(const std::string& name, const MetricLabels& labels) {
+  std::lock_guard<std::mutex> lock(pimpl_->mutex);
+  auto it = pimpl_->families.find(name);
+  if (it == pimpl_->families.end()) return;
+  std::string rendered = renderLabels(labels);
+  it->second.counters.erase(rendered);
+  it->second.histograms.erase(rendered);
+  if (it->second.counters.empty() && it->second.histograms.empty()) pimpl_->families.erase(it);
+}
+
+MSCCLPP_API_CPP std::string MetricsRegistry::prometheusText() const {
+  static const char* quantiles[] = {"0.5", "0.9", "0.99", "0.999"};
+  std::stringstream ss;
+  std::lock_guard<std::mutex> lock(pimpl_->mutex);
+  for (const auto& entry : pimpl_->families) {
+    const std::string& name = entry.first;
+    const MetricFamily& family = entry.second;
+    ss << "# HELP " << name << " " << family.help << "\n";
+    if (family.type == MetricType::Counter) {
+      ss << "# TYPE " << name << " counter\n";
+      for (const auto& counter : family.counters) {
+        ss << name;
+        if (!counter.first.empty()) ss << "{" << counter.first << "}";
+        ss << " " << counter.second->value() << "\n";
+      }
+      continue;
+    }
+    ss << "# TYPE " << name << " summary\n";
+    for (const auto& histogram : family.histograms) {
+      HistogramSnapshot snapshot = histogram.second->snapshot();
+      std::string labels = histogram.first.empty() ? "" : histogram.first + ",";
+      for (const char* q : quantiles) {
+        ss << name << "{" << labels << "quantile=\"" << q << "\"} " << snapshot.quantile(atof(q)) << "\n";
+      }
+      std::string suffix = histogram.first.empty() ? "" : "{" + histogram.first + "}";
+      ss << name << "_sum" << suffix << " " << snapshot.sum << "\n";
+      ss << name << "_count" << suffix << " " << snapshot.count << "\n";
+    }
+  }
+  return ss.str();
+}
+
+MSCCLPP_API_CPP void MetricsRegistry::reset() {
+  std::lock_guard<std::mutex> lock(pimpl_->mutex);
+  for (auto& entry : pimpl_->families) {
+    for (auto& counter : entry.second.counters) counter.second->reset();
+    for (auto& histogram : entry.second.histograms) histogram.second->reset();
+  }
+}
+
+// MetricLabelIds
+
+int MetricLabelIds::acquire() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (released_.empty()) return next_++;
+  int id = *released_.begin();
+  released_.erase(released_.begin());
+  return id;
+}
+
+void MetricLabelIds::release(int id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  released_.insert(id);
+}
+
+// MetricsHttpServer
+
+// How often the server thread checks whether it should stop.
+static const int MetricsHttpPollPeriodMs = 100;
+
+struct MetricsHttpServer::Impl {
+  MetricsRegistry& registry;
+  int listenFd;
+  int port;
+  std::atomic_bool running;
+  std::thread thread;
+
+  Impl(MetricsRegistry& registry, int port, const std::string& address);
+  ~Impl();
+  void serve();
+  void handle(int fd);
+};
+
+MetricsHttpServer::Impl::Impl(MetricsRegistry& registry, int port, const std::string& address)
+    : registry(registry), listenFd(-1), port(port), running(true) {
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)port);
+  if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+    throw Error("Invalid metrics server address " + address, ErrorCode::InvalidUsage);
+  }
+  listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listenFd < 0) throw SysError("socket failed", errno);
+  int one = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  socklen_t addrLen = sizeof(addr);
+  if (::bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(listenFd, 16) != 0 ||
+      ::getsockname(listenFd, (sockaddr*)&addr, &addrLen) != 0) {
+    int err = errno;
+    ::close(listenFd);
+    throw SysError("Failed to listen on " + address + ":" + std::to_string(port), err);
+  }
+  this->port = ntohs(addr.sin_port);
+  thread = std::thread([this] { serve(); });
+}
+
+MetricsHttpServer::Impl::~Impl() {
+  running = false;
+  if (thread.joinable()) thread.join();
+  ::close(listenFd);
+}
+
+void MetricsHttpServer::Impl::serve() {
+  while (running) {
+    pollfd pfd = {listenFd, POLLIN, 0};
+    if (::poll(&pfd, 1, MetricsHttpPollPeriodMs) <= 0) continue;
+    int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) continue;
+    handle(fd);
+    ::close(fd);
+  }
+}
+
+void MetricsHttpServer::Impl::handle(int fd) {
+  // Read the request head. Only the request line is looked at.
+  timeval timeout = {1, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  std::string request;
+  char buf[1024];
+  while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+    ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) break;
+    request.append(buf, n);
+  }
+  std::string method, path;
+  std::istringstream(request.substr(0, request.find("\r\n"))) >> method >> path;
+
+  std::string status = "200 OK";
+  std::string body;
+  if (method != "GET") {
+    status = "405 Method Not Allowed";
+  } else if (path != "/" && path != "/metrics") {
+    status = "404 Not Found";
+  } else {
+    body = registry.prometheusText();
+  }
+  std::string response = "HTTP/1.1 " + status +
+                         "\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\nContent-Length: " +
+                         std::to_string(body.size()) + "\r\n\r\n" + body;
+  size_t sent = 0;
+  while (sent < response.size()) {
+    ssize_t n = ::send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) break;
+    sent += n;
+  }
+}
+
+MSCCLPP_API_CPP MetricsHttpServer::MetricsHttpServer(MetricsRegistry& registry, int port, const std::string& address)
+    : pimpl_(std::make_unique<Impl>(registry, port, address)) {}
+
+MSCCLPP_API_CPP MetricsHttpServer::~MetricsHttpServer() = default;
+
+MSCCLPP_API_CPP int MetricsHttpServer::port() const { return pimpl_->port; }
+
+}  // namespace mscclpp
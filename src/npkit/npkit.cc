@@ -3,14 +3,19 @@
 
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <fstream>
 #include <mscclpp/gpu.hpp>
 #include <mscclpp/npkit/npkit.hpp>
+#include <mutex>
 
 #include "debug.h"
 
 uint64_t NpKit::rank_ = 0;
+std::vector<NpKit::ClockOffsetSample> NpKit::clock_offset_samples_;
 
 std::vector<mscclpp::UniqueCudaPtr<NpKitEvent>> NpKit::gpu_event_buffers_;
 std::vector<std::unique_ptr<NpKitEvent[]>> NpKit::cpu_event_buffers_;
@@ -26,9 +31,35 @@ mscclpp::UniqueCudaHostPtr<uint64_t> NpKit::cpu_timestamp_;
 std::unique_ptr<std::thread> NpKit::cpu_timestamp_update_thread_;
 volatile bool NpKit::cpu_timestamp_update_thread_should_stop_ = false;
 
+// State of the event streaming thread. `cpu_drained_heads` and `gpu_drained_heads` are the numbers of events of
+// each buffer that have already been consumed, either by streaming or by `NpKit::Dump`.
+static std::unique_ptr<std::thread> streaming_thread;
+static std::mutex streaming_mutex;
+static std::condition_variable streaming_cv;
+static bool streaming_thread_should_stop = false;
+static std::string streaming_dump_dir;
+static uint64_t streaming_drain_interval_ms = 0;
+static uint64_t streaming_sample_period_ms = 0;
+static uint64_t streaming_sample_window_ms = 0;
+static std::vector<uint64_t> cpu_drained_heads;
+static std::vector<uint64_t> gpu_drained_heads;
+static std::atomic<uint64_t> num_dropped_events{0};
+
+// Base of CPU timestamps: the system clock at initialization advanced by the steady clock.
+static uint64_t init_system_clock = 0;
+static uint64_t init_steady_clock = 0;
+
+static thread_local int cpu_event_channel = 0;
+
+// Stamp of every slot of the CPU event buffers. Event `i` is committed to slot `i % kMaxNumCpuEventsPerBuffer` when
+// the stamp of the slot is `2 * (i / kMaxNumCpuEventsPerBuffer + 1)`, and is being written when it is one more.
+static std::vector<std::unique_ptr<std::atomic<uint32_t>[]>> cpu_event_stamps;
+
+// Bootstrap that Init() and Shutdown() synchronize clocks over, and the last directory events were written to.
+static std::shared_ptr<mscclpp::Bootstrap> clock_sync_bootstrap;
+static std::string last_dump_dir;
+
 void NpKit::CpuTimestampUpdateThread() {
-  uint64_t init_system_clock = std::chrono::system_clock::now().time_since_epoch().count();
-  uint64_t init_steady_clock = std::chrono::steady_clock::now().time_since_epoch().count();
   uint64_t curr_steady_clock = 0;
   while (!cpu_timestamp_update_thread_should_stop_) {
 #if defined(__HIP_PLATFORM_AMD__)
@@ -45,12 +76,13 @@ void NpKit::CpuTimestampUpdateThread() {
   }
 }
 
-void NpKit::Init(int rank) {
+void NpKit::Init(int rank, std::shared_ptr<mscclpp::Bootstrap> bootstrap) {
 #if defined(ENABLE_NPKIT)
   uint64_t i = 0;
   NpKitEventCollectContext ctx;
   ctx.event_buffer_head = 0;
   rank_ = rank;
+  clock_offset_samples_.clear();
 
   // Init event data structures
   gpu_collect_contexts_ = mscclpp::allocUniqueCuda<NpKitEventCollectContext>(NpKit::kNumGpuEventBuffers);
@@ -65,8 +97,14 @@ void NpKit::Init(int rank) {
     cpu_event_buffers_.emplace_back(std::make_unique<NpKitEvent[]>(kMaxNumCpuEventsPerBuffer));
     ctx.event_buffer = cpu_event_buffers_[i].get();
     cpu_collect_contexts_[i] = ctx;
+    cpu_event_stamps.emplace_back(std::make_unique<std::atomic<uint32_t>[]>(kMaxNumCpuEventsPerBuffer));
+    for (uint64_t j = 0; j < kMaxNumCpuEventsPerBuffer; j++) cpu_event_stamps[i][j].store(0);
   }
 
+  cpu_drained_heads.assign(NpKit::kNumCpuEventBuffers, 0);
+  gpu_drained_heads.assign(NpKit::kNumGpuEventBuffers, 0);
+  num_dropped_events = 0;
+
 #if defined(__HIP_PLATFORM_AMD__)
   // Init timestamp. Allocates MAXCHANNELS*128 bytes buffer for GPU
   cpu_timestamp_ = mscclpp::makeUniqueCudaHost<uint64_t[]>(NPKIT_MAX_NUM_GPU_THREADBLOCKS *
@@ -81,9 +119,16 @@ void NpKit::Init(int rank) {
   volatile uint64_t* volatile_cpu_timestamp = cpu_timestamp_.get();
   *volatile_cpu_timestamp = std::chrono::system_clock::now().time_since_epoch().count();
 #endif
+  init_system_clock = std::chrono::system_clock::now().time_since_epoch().count();
+  init_steady_clock = std::chrono::steady_clock::now().time_since_epoch().count();
   cpu_timestamp_update_thread_should_stop_ = false;
   cpu_timestamp_update_thread_ = std::make_unique<std::thread>(CpuTimestampUpdateThread);
+
+  clock_sync_bootstrap = bootstrap;
+  last_dump_dir.clear();
+  if (clock_sync_bootstrap) SyncClocks(clock_sync_bootstrap);
 #else
+  (void)bootstrap;
   WARN("NpKit::Init(%d) : MSCCLPP library was not built with NPKit enabled.", rank);
 #endif
 }
@@ -111,77 +156,282 @@ static int GetGpuClockRateInKhz() {
 }
 #endif
 
+#if defined(ENABLE_NPKIT)
+static void WriteTextFile(const std::string& file_path, const std::string& content) {
+  auto file = std::fstream(file_path, std::ios::out);
+  file.write(content.c_str(), content.length());
+  file.close();
+}
+
+static void DumpClockInfo(const std::string& dump_dir, uint64_t rank) {
+  // Dump CPU clock info
+  WriteTextFile(dump_dir + "/cpu_clock_period_num_rank_" + std::to_string(rank),
+                std::to_string(std::chrono::steady_clock::duration::period::num));
+  WriteTextFile(dump_dir + "/cpu_clock_period_den_rank_" + std::to_string(rank),
+                std::to_string(std::chrono::steady_clock::duration::period::den));
+
+  // Dump GPU clockRate
+  WriteTextFile(dump_dir + "/gpu_clock_rate_rank_" + std::to_string(rank), std::to_string(GetGpuClockRateInKhz()));
+}
+
+static std::string CpuEventFilePath(const std::string& dump_dir, uint64_t rank, uint64_t channel) {
+  return dump_dir + "/cpu_events_rank_" + std::to_string(rank) + "_channel_" + std::to_string(channel);
+}
+
+static std::string GpuEventFilePath(const std::string& dump_dir, uint64_t rank, uint64_t buf) {
+  return dump_dir + "/gpu_events_rank_" + std::to_string(rank) + "_buf_" + std::to_string(buf);
+}
+
+// Write events [begin, end) of a ring buffer of `capacity` events to `file`. `ring` may be a device pointer, in
+// which case the events are copied through `staging`, which must hold at least `capacity` events. The copy is
+// synchronous on a non-blocking stream, so it does not wait for kernels on the legacy default stream.
+static void WriteRingEvents(std::fstream& file, const NpKitEvent* ring, uint64_t capacity, uint64_t begin,
+                            uint64_t end, NpKitEvent* staging) {
+  while (begin < end) {
+    uint64_t offset = begin & (capacity - 1);
+    uint64_t count = std::min(end - begin, capacity - offset);
+    const NpKitEvent* src = ring + offset;
+    if (staging != nullptr) {
+      mscclpp::memcpyCuda(staging, src, count);
+      src = staging;
+    }
+    file.write(reinterpret_cast<const char*>(src), count * sizeof(NpKitEvent));
+    begin += count;
+  }
+}
+
+// Read events [begin, end) of CPU event buffer `buf` into `events`, stopping at the first event that is not committed
+// yet. Events that are overwritten before or while they are read are skipped and counted in `num_overwritten`.
+// Returns the index of the first event that was not read.
+static uint64_t ReadCommittedCpuEvents(const NpKitEvent* ring, const std::atomic<uint32_t>* stamps, uint64_t begin,
+                                       uint64_t end, std::vector<NpKitEvent>& events, uint64_t& num_overwritten) {
+  const uint64_t capacity = NpKit::kMaxNumCpuEventsPerBuffer;
+  events.clear();
+  for (; begin < end; begin++) {
+    uint64_t slot = begin & (capacity - 1);
+    uint32_t generation = static_cast<uint32_t>(begin / capacity + 1);
+    uint32_t stamp = stamps[slot].load(std::memory_order_acquire);
+    if ((stamp >> 1) > generation) {
+      num_overwritten++;
+      continue;
+    }
+    if (stamp != (generation << 1)) break;
+    NpKitEvent event = ring[slot];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (stamps[slot].load(std::memory_order_relaxed) != stamp) {
+      num_overwritten++;
+      continue;
+    }
+    events.push_back(event);
+  }
+  return begin;
+}
+#endif
+
 void NpKit::Dump(const std::string& dump_dir) {
 #if defined(ENABLE_NPKIT)
+  last_dump_dir = dump_dir;
+  if (streaming_thread != nullptr) {
+    // Events have been streamed already, only flush the remaining ones.
+    std::string stream_dir = streaming_dump_dir;
+    StopStreaming();
+    if (stream_dir != dump_dir) {
+      WARN("NpKit::Dump(%s) : events were streamed to %s", dump_dir.c_str(), stream_dir.c_str());
+    }
+    DumpClockInfo(dump_dir, rank_);
+    DumpClockOffsets(dump_dir);
+    return;
+  }
+
   uint64_t i = 0;
-  std::string dump_file_path;
+  uint64_t num_overwritten = 0;
 
-  // Dump CPU events
+  // Dump CPU events. Only the last kMaxNumCpuEventsPerBuffer events of each buffer are kept.
+  std::vector<NpKitEvent> events;
   for (i = 0; i < NpKit::kNumCpuEventBuffers; i++) {
-    dump_file_path = dump_dir;
-    dump_file_path += "/cpu_events_rank_";
-    dump_file_path += std::to_string(rank_);
-    dump_file_path += "_channel_";
-    dump_file_path += std::to_string(i);
-    auto cpu_trace_file = std::fstream(dump_file_path, std::ios::out | std::ios::binary);
-    cpu_trace_file.write(reinterpret_cast<char*>(cpu_event_buffers_[i].get()),
-                         cpu_collect_contexts_[i].event_buffer_head * sizeof(NpKitEvent));
+    uint64_t head = __atomic_load_n(&cpu_collect_contexts_[i].event_buffer_head, __ATOMIC_ACQUIRE);
+    uint64_t begin = (head > kMaxNumCpuEventsPerBuffer) ? head - kMaxNumCpuEventsPerBuffer : 0;
+    num_overwritten += begin;
+    ReadCommittedCpuEvents(cpu_event_buffers_[i].get(), cpu_event_stamps[i].get(), begin, head, events,
+                           num_overwritten);
+    auto cpu_trace_file = std::fstream(CpuEventFilePath(dump_dir, rank_, i), std::ios::out | std::ios::binary);
+    cpu_trace_file.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(NpKitEvent));
     cpu_trace_file.close();
   }
 
-  // Dump CPU clock info
-  dump_file_path = dump_dir;
-  dump_file_path += "/cpu_clock_period_num_rank_";
-  dump_file_path += std::to_string(rank_);
-  std::string clock_period_num_str = std::to_string(std::chrono::steady_clock::duration::period::num);
-  auto clock_period_num_file = std::fstream(dump_file_path, std::ios::out);
-  clock_period_num_file.write(clock_period_num_str.c_str(), clock_period_num_str.length());
-  clock_period_num_file.close();
-
-  dump_file_path = dump_dir;
-  dump_file_path += "/cpu_clock_period_den_rank_";
-  dump_file_path += std::to_string(rank_);
-  std::string clock_period_den_str = std::to_string(std::chrono::steady_clock::duration::period::den);
-  auto clock_period_den_file = std::fstream(dump_file_path, std::ios::out);
-  clock_period_den_file.write(clock_period_den_str.c_str(), clock_period_den_str.length());
-  clock_period_den_file.close();
-
-  // Dump GPU events, reuse CPU struct
+  // Dump GPU events. Copy only the used part of each buffer.
+  auto gpu_contexts = std::make_unique<NpKitEventCollectContext[]>(NpKit::kNumGpuEventBuffers);
+  auto staging = std::make_unique<NpKitEvent[]>(kMaxNumGpuEventsPerBuffer);
+  mscclpp::memcpyCuda(gpu_contexts.get(), gpu_collect_contexts_.get(), NpKit::kNumGpuEventBuffers);
   for (i = 0; i < NpKit::kNumGpuEventBuffers; i++) {
-    dump_file_path = dump_dir;
-    dump_file_path += "/gpu_events_rank_";
-    dump_file_path += std::to_string(rank_);
-    dump_file_path += "_buf_";
-    dump_file_path += std::to_string(i);
-    mscclpp::memcpyCuda(cpu_event_buffers_[0].get(), gpu_event_buffers_[i].get(), kMaxNumGpuEventsPerBuffer);
-    mscclpp::memcpyCuda(cpu_collect_contexts_.get(), gpu_collect_contexts_.get() + i, 1);
-    auto gpu_trace_file = std::fstream(dump_file_path, std::ios::out | std::ios::binary);
-    gpu_trace_file.write(reinterpret_cast<char*>(cpu_event_buffers_[0].get()),
-                         cpu_collect_contexts_[0].event_buffer_head * sizeof(NpKitEvent));
+    uint64_t head = gpu_contexts[i].event_buffer_head;
+    uint64_t begin = (head > kMaxNumGpuEventsPerBuffer) ? head - kMaxNumGpuEventsPerBuffer : 0;
+    num_overwritten += begin;
+    auto gpu_trace_file = std::fstream(GpuEventFilePath(dump_dir, rank_, i), std::ios::out | std::ios::binary);
+    WriteRingEvents(gpu_trace_file, gpu_event_buffers_[i].get(), kMaxNumGpuEventsPerBuffer, begin, head,
+                    staging.get());
     gpu_trace_file.close();
   }
+  num_dropped_events = num_overwritten;
 
-  // Dump GPU clockRate
-  dump_file_path = dump_dir;
-  dump_file_path += "/gpu_clock_rate_rank_";
-  dump_file_path += std::to_string(rank_);
-  std::string clock_rate_str = std::to_string(GetGpuClockRateInKhz());
-  auto gpu_clock_rate_file = std::fstream(dump_file_path, std::ios::out);
-  gpu_clock_rate_file.write(clock_rate_str.c_str(), clock_rate_str.length());
-  gpu_clock_rate_file.close();
+  DumpClockInfo(dump_dir, rank_);
+  DumpClockOffsets(dump_dir);
 #else
   WARN("NpKit::Dump(%s) : MSCCLPP library was not built with NPKit enabled.", dump_dir.c_str());
 #endif
 }
 
+#if defined(ENABLE_NPKIT)
+void NpKit::DrainEvents(bool write) {
+  uint64_t i = 0;
+  std::fstream file;
+
+  std::vector<NpKitEvent> events;
+  for (i = 0; i < NpKit::kNumCpuEventBuffers; i++) {
+    // Events are drained up to the first one that is still being written, which the next drain resumes from.
+    uint64_t head = __atomic_load_n(&cpu_collect_contexts_[i].event_buffer_head, __ATOMIC_ACQUIRE);
+    uint64_t begin = cpu_drained_heads[i];
+    if (head == begin) continue;
+    uint64_t num_overwritten = 0;
+    if (head - begin > kMaxNumCpuEventsPerBuffer) {
+      num_overwritten = head - begin - kMaxNumCpuEventsPerBuffer;
+      begin = head - kMaxNumCpuEventsPerBuffer;
+    }
+    cpu_drained_heads[i] = ReadCommittedCpuEvents(cpu_event_buffers_[i].get(), cpu_event_stamps[i].get(), begin,
+                                                  head, events, num_overwritten);
+    if (write) {
+      num_dropped_events += num_overwritten;
+      file.open(CpuEventFilePath(streaming_dump_dir, rank_, i), std::ios::out | std::ios::binary | std::ios::app);
+      file.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(NpKitEvent));
+      file.close();
+    }
+  }
+
+  auto gpu_contexts = std::make_unique<NpKitEventCollectContext[]>(NpKit::kNumGpuEventBuffers);
+  mscclpp::memcpyCuda(gpu_contexts.get(), gpu_collect_contexts_.get(), NpKit::kNumGpuEventBuffers);
+  std::unique_ptr<NpKitEvent[]> staging;
+  for (i = 0; i < NpKit::kNumGpuEventBuffers; i++) {
+    uint64_t head = gpu_contexts[i].event_buffer_head;
+    uint64_t begin = gpu_drained_heads[i];
+    if (head == begin) continue;
+    if (head - begin > kMaxNumGpuEventsPerBuffer) {
+      if (write) num_dropped_events += head - begin - kMaxNumGpuEventsPerBuffer;
+      begin = head - kMaxNumGpuEventsPerBuffer;
+    }
+    if (write) {
+      if (staging == nullptr) staging = std::make_unique<NpKitEvent[]>(kMaxNumGpuEventsPerBuffer);
+      file.open(GpuEventFilePath(streaming_dump_dir, rank_, i), std::ios::out | std::ios::binary | std::ios::app);
+      WriteRingEvents(file, gpu_event_buffers_[i].get(), kMaxNumGpuEventsPerBuffer, begin, head, staging.get());
+      file.close();
+    }
+    gpu_drained_heads[i] = head;
+  }
+}
+
+void NpKit::StreamingThread() {
+  auto start = std::chrono::steady_clock::now();
+  std::unique_lock<std::mutex> lock(streaming_mutex);
+  while (!streaming_thread_should_stop) {
+    streaming_cv.wait_for(lock, std::chrono::milliseconds(streaming_drain_interval_ms));
+    if (streaming_thread_should_stop) break;
+    bool write = true;
+    if (streaming_sample_period_ms > 0) {
+      uint64_t elapsed_ms =
+          std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+      write = (elapsed_ms % streaming_sample_period_ms) < streaming_sample_window_ms;
+    }
+    DrainEvents(write);
+  }
+  DrainEvents(true);
+}
+#endif
+
+void NpKit::StartStreaming(const std::string& dump_dir, uint64_t drain_interval_ms, uint64_t sample_period_ms,
+                           uint64_t sample_window_ms) {
+#if defined(ENABLE_NPKIT)
+  if (cpu_collect_contexts_ == nullptr) {
+    WARN("NpKit::StartStreaming(%s) : NpKit is not initialized.", dump_dir.c_str());
+    return;
+  }
+  if (streaming_thread != nullptr) {
+    WARN("NpKit::StartStreaming(%s) : already streaming to %s.", dump_dir.c_str(), streaming_dump_dir.c_str());
+    return;
+  }
+  int cuda_dev;
+  MSCCLPP_CUDATHROW(cudaGetDevice(&cuda_dev));
+
+  // Events collected so far are not streamed.
+  streaming_dump_dir = dump_dir;
+  DrainEvents(false);
+
+  last_dump_dir = dump_dir;
+
+  // Truncate event files of a previous run.
+  for (uint64_t i = 0; i < NpKit::kNumCpuEventBuffers; i++) {
+    std::fstream(CpuEventFilePath(dump_dir, rank_, i), std::ios::out | std::ios::binary | std::ios::trunc);
+  }
+  for (uint64_t i = 0; i < NpKit::kNumGpuEventBuffers; i++) {
+    std::fstream(GpuEventFilePath(dump_dir, rank_, i), std::ios::out | std::ios::binary | std::ios::trunc);
+  }
+  DumpClockInfo(dump_dir, rank_);
+  DumpClockOffsets(dump_dir);
+
+  streaming_drain_interval_ms = std::max<uint64_t>(drain_interval_ms, 1);
+  streaming_sample_period_ms = sample_period_ms;
+  streaming_sample_window_ms = sample_window_ms;
+  streaming_thread_should_stop = false;
+  streaming_thread = std::make_unique<std::thread>([cuda_dev]() {
+    if (cudaSetDevice(cuda_dev) != cudaSuccess) {
+      WARN("NpKit streaming thread failed to set device %d", cuda_dev);
+      return;
+    }
+    StreamingThread();
+  });
+#else
+  (void)drain_interval_ms;
+  (void)sample_period_ms;
+  (void)sample_window_ms;
+  WARN("NpKit::StartStreaming(%s) : MSCCLPP library was not built with NPKit enabled.", dump_dir.c_str());
+#endif
+}
+
+void NpKit::StopStreaming() {
+#if defined(ENABLE_NPKIT)
+  if (streaming_thread == nullptr) return;
+  {
+    std::lock_guard<std::mutex> lock(streaming_mutex);
+    streaming_thread_should_stop = true;
+  }
+  streaming_cv.notify_all();
+  streaming_thread->join();
+  streaming_thread.reset();
+  if (num_dropped_events > 0) {
+    INFO(MSCCLPP_INIT, "NpKit: %lu events were dropped before they could be streamed", num_dropped_events.load());
+  }
+#endif
+}
+
+uint64_t NpKit::GetNumDroppedEvents() { return num_dropped_events.load(); }
+
 void NpKit::Shutdown() {
 #if defined(ENABLE_NPKIT)
+  StopStreaming();
+
+  // A second clock sync lets ExportTrace() correct the drift over the run. Events are usually dumped before the
+  // shutdown, so the offsets are rewritten next to them.
+  if (clock_sync_bootstrap) {
+    SyncClocks(clock_sync_bootstrap);
+    if (!last_dump_dir.empty()) DumpClockOffsets(last_dump_dir);
+    clock_sync_bootstrap.reset();
+  }
+
   // Stop CPU timestamp updating thread
   cpu_timestamp_update_thread_should_stop_ = true;
   cpu_timestamp_update_thread_->join();
 
   // Free CPU event data structures
   cpu_event_buffers_.clear();
+  cpu_event_stamps.clear();
   cpu_collect_contexts_.reset();
 
   // Free GPU event data structures
@@ -197,15 +447,33 @@ void NpKit::Shutdown() {
 NpKitEventCollectContext* NpKit::GetGpuEventCollectContexts() { return gpu_collect_contexts_.get(); }
 
 void NpKit::CollectCpuEvent(uint8_t type, uint32_t size, uint32_t rsvd, uint64_t timestamp, int channel_id) {
-  uint64_t event_buffer_head = cpu_collect_contexts_[channel_id].event_buffer_head;
-  if (event_buffer_head < kMaxNumCpuEventsPerBuffer) {
-    NpKitEvent& event = cpu_collect_contexts_[channel_id].event_buffer[event_buffer_head];
-    event.fields.type = type;
-    event.fields.size = size;
-    event.fields.rsvd = rsvd;
-    event.fields.timestamp = timestamp;
-    cpu_collect_contexts_[channel_id].event_buffer_head++;
-  }
+  if (cpu_collect_contexts_ == nullptr) return;
+  NpKitEventCollectContext& ctx = cpu_collect_contexts_[channel_id];
+  // Multiple threads may collect events into the same channel. A slot is reserved first and its stamp marks the event
+  // as committed once it is written, so that drains never read an event that is still being written.
+  uint64_t event_buffer_head = __atomic_fetch_add(&ctx.event_buffer_head, 1, __ATOMIC_ACQ_REL);
+  uint64_t slot = event_buffer_head & (kMaxNumCpuEventsPerBuffer - 1);
+  uint32_t generation = static_cast<uint32_t>(event_buffer_head / kMaxNumCpuEventsPerBuffer + 1);
+  std::atomic<uint32_t>& stamp = cpu_event_stamps[channel_id][slot];
+  stamp.store((generation << 1) | 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  NpKitEvent& event = ctx.event_buffer[slot];
+  event.fields.type = type;
+  event.fields.size = size;
+  event.fields.rsvd = rsvd;
+  event.fields.timestamp = timestamp;
+  stamp.store(generation << 1, std::memory_order_release);
+}
+
+void NpKit::CollectCpuEvent(uint8_t type, uint32_t size, uint32_t rsvd, uint64_t timestamp) {
+  CollectCpuEvent(type, size, rsvd, timestamp, cpu_event_channel);
+}
+
+void NpKit::SetCpuEventChannel(int channel_id) { cpu_event_channel = channel_id % kNumCpuEventBuffers; }
+
+uint64_t NpKit::GetCpuTimestampNow() {
+  uint64_t curr_steady_clock = std::chrono::steady_clock::now().time_since_epoch().count();
+  return init_system_clock + (curr_steady_clock - init_steady_clock);
 }
 
 uint64_t* NpKit::GetCpuTimestamp() { return cpu_timestamp_.get(); }
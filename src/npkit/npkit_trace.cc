@@ -0,0 +1,346 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <mscclpp/core.hpp>
+#include <mscclpp/npkit/npkit.hpp>
+#include <sstream>
+#include <unordered_map>
+
+#include "debug.h"
+
+// Tag of the bootstrap messages exchanged by NpKit::SyncClocks.
+static const int kClockSyncTag = 0x4e504b54;
+
+void NpKit::SyncClocks(std::shared_ptr<mscclpp::Bootstrap> bootstrap, int num_rounds) {
+  int rank = bootstrap->getRank();
+  int n_ranks = bootstrap->getNranks();
+  if (rank == 0) {
+    // Rank 0 is the reference clock and serves the other ranks one by one.
+    for (int peer = 1; peer < n_ranks; peer++) {
+      for (int round = 0; round < num_rounds; round++) {
+        uint64_t request;
+        bootstrap->recv(&request, sizeof(request), peer, kClockSyncTag);
+        uint64_t reply[2];
+        reply[0] = GetCpuTimestampNow();
+        reply[1] = GetCpuTimestampNow();
+        bootstrap->send(reply, sizeof(reply), peer, kClockSyncTag);
+      }
+    }
+    clock_offset_samples_.push_back({GetCpuTimestampNow(), 0});
+    return;
+  }
+
+  // NTP-style estimation: the sample with the smallest round trip delay bounds the error the tightest.
+  uint64_t best_delay = std::numeric_limits<uint64_t>::max();
+  ClockOffsetSample best_sample = {0, 0};
+  for (int round = 0; round < num_rounds; round++) {
+    uint64_t t0 = GetCpuTimestampNow();
+    bootstrap->send(&t0, sizeof(t0), 0, kClockSyncTag);
+    uint64_t reply[2];
+    bootstrap->recv(reply, sizeof(reply), 0, kClockSyncTag);
+    uint64_t t3 = GetCpuTimestampNow();
+    uint64_t t1 = reply[0];
+    uint64_t t2 = reply[1];
+    uint64_t delay = (t3 - t0) - (t2 - t1);
+    if (delay < best_delay) {
+      best_delay = delay;
+      best_sample.local_time = t0 + (t3 - t0) / 2;
+      best_sample.offset = ((int64_t)(t1 - t0) + (int64_t)(t2 - t3)) / 2;
+    }
+  }
+  clock_offset_samples_.push_back(best_sample);
+  INFO(MSCCLPP_INIT, "NpKit: clock offset from rank 0 is %ld ns (round trip delay %lu ns)", best_sample.offset,
+       best_delay);
+}
+
+void NpKit::DumpClockOffsets(const std::string& dump_dir) {
+  std::ofstream file(dump_dir + "/cpu_clock_offset_rank_" + std::to_string(rank_));
+  for (const auto& sample : clock_offset_samples_) {
+    file << sample.local_time << " " << sample.offset << "\n";
+  }
+}
+
+namespace {
+
+// NOTE: must be in the same order as `OperationType` in src/include/execution_common.hpp.
+const char* const kExecutorOpNames[] = {
+    "BARRIER",
+    "PUT",
+    "PUT_PACKET",
+    "PUT_WITH_SIGNAL",
+    "PUT_WITH_SIGNAL_AND_FLUSH",
+    "GET",
+    "COPY",
+    "COPY_PACKET",
+    "TRANSFORM_TO_PACKET",
+    "SIGNAL",
+    "WAIT",
+    "FLUSH",
+    "REDUCE",
+    "REDUCE_PACKET",
+    "REDUCE_SEND",
+    "REDUCE_SEND_PACKET",
+    "READ_REDUCE_COPY",
+    "READ_REDUCE_COPY_SEND",
+};
+const int kNumExecutorOps = sizeof(kExecutorOpNames) / sizeof(kExecutorOpNames[0]);
+
+// Name of an event without its _ENTRY/_EXIT suffix, and whether it is an entry event.
+struct EventKind {
+  std::string name;
+  bool is_entry;
+  bool is_time_sync;
+  bool valid;
+};
+
+EventKind GetEventKind(uint8_t type) {
+  auto pair = [](const char* name, bool is_entry) { return EventKind{name, is_entry, false, true}; };
+  if (type >= NPKIT_EVENT_EXECUTOR_OP_BASE_ENTRY && type < NPKIT_EVENT_EXECUTOR_OP_BASE_ENTRY + kNumExecutorOps) {
+    return EventKind{std::string("EXECUTOR_") + kExecutorOpNames[type - NPKIT_EVENT_EXECUTOR_OP_BASE_ENTRY], true,
+                     false, true};
+  }
+  if (type >= NPKIT_EVENT_EXECUTOR_OP_BASE_EXIT && type < NPKIT_EVENT_EXECUTOR_OP_BASE_EXIT + kNumExecutorOps) {
+    return EventKind{std::string("EXECUTOR_") + kExecutorOpNames[type - NPKIT_EVENT_EXECUTOR_OP_BASE_EXIT], false,
+                     false, true};
+  }
+  switch (type) {
+    case NPKIT_EVENT_TIME_SYNC_GPU:
+    case NPKIT_EVENT_TIME_SYNC_CPU:
+      return EventKind{"TIME_SYNC", false, true, true};
+    case NPKIT_EVENT_EXECUTOR_INIT_ENTRY:
+      return pair("EXECUTOR_INIT", true);
+    case NPKIT_EVENT_EXECUTOR_INIT_EXIT:
+      return pair("EXECUTOR_INIT", false);
+    case NPKIT_EVENT_PROXY_TRIGGER_ENTRY:
+      return pair("PROXY_TRIGGER", true);
+    case NPKIT_EVENT_PROXY_TRIGGER_EXIT:
+      return pair("PROXY_TRIGGER", false);
+    case NPKIT_EVENT_PROXY_HANDLER_ENTRY:
+      return pair("PROXY_HANDLER", true);
+    case NPKIT_EVENT_PROXY_HANDLER_EXIT:
+      return pair("PROXY_HANDLER", false);
+    case NPKIT_EVENT_PROXY_FIFO_FLUSH_TAIL_ENTRY:
+      return pair("PROXY_FIFO_FLUSH_TAIL", true);
+    case NPKIT_EVENT_PROXY_FIFO_FLUSH_TAIL_EXIT:
+      return pair("PROXY_FIFO_FLUSH_TAIL", false);
+    case NPKIT_EVENT_CONN_WRITE_ENTRY:
+      return pair("CONN_WRITE", true);
+    case NPKIT_EVENT_CONN_WRITE_EXIT:
+      return pair("CONN_WRITE", false);
+    case NPKIT_EVENT_CONN_UPDATE_AND_SYNC_ENTRY:
+      return pair("CONN_UPDATE_AND_SYNC", true);
+    case NPKIT_EVENT_CONN_UPDATE_AND_SYNC_EXIT:
+      return pair("CONN_UPDATE_AND_SYNC", false);
+    case NPKIT_EVENT_CONN_FLUSH_ENTRY:
+      return pair("CONN_FLUSH", true);
+    case NPKIT_EVENT_CONN_FLUSH_EXIT:
+      return pair("CONN_FLUSH", false);
+    case NPKIT_EVENT_CONN_IB_CQ_COMPLETION_ENTRY:
+      return pair("CONN_IB_CQ_COMPLETION", true);
+    case NPKIT_EVENT_CONN_IB_CQ_COMPLETION_EXIT:
+      return pair("CONN_IB_CQ_COMPLETION", false);
+    default:
+      return EventKind{"", false, false, false};
+  }
+}
+
+std::string ReadTextFile(const std::string& path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    throw mscclpp::Error("NpKit: failed to open " + path, mscclpp::ErrorCode::InvalidUsage);
+  }
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+std::vector<NpKitEvent> ReadEventFile(const std::string& path) {
+  std::vector<NpKitEvent> events;
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) return events;
+  std::streamsize size = file.tellg();
+  file.seekg(0, std::ios::beg);
+  events.resize(size / sizeof(NpKitEvent));
+  file.read(reinterpret_cast<char*>(events.data()), events.size() * sizeof(NpKitEvent));
+  return events;
+}
+
+// One line of a cpu_clock_offset_rank_* file written by NpKit::DumpClockOffsets.
+struct OffsetSample {
+  uint64_t local_time;
+  int64_t offset;
+};
+
+// Maps local CPU timestamps in nanoseconds to the clock of rank 0 by interpolating the measured clock offsets.
+class ClockAligner {
+ public:
+  explicit ClockAligner(const std::string& offset_file_path) {
+    std::ifstream file(offset_file_path);
+    OffsetSample sample;
+    while (file >> sample.local_time >> sample.offset) samples_.push_back(sample);
+    std::sort(samples_.begin(), samples_.end(),
+              [](const OffsetSample& a, const OffsetSample& b) { return a.local_time < b.local_time; });
+  }
+
+  double align(double local_ns) const {
+    if (samples_.empty()) return local_ns;
+    if (samples_.size() == 1 || local_ns <= samples_.front().local_time) return local_ns + samples_.front().offset;
+    if (local_ns >= samples_.back().local_time) return local_ns + samples_.back().offset;
+    auto it = std::upper_bound(samples_.begin(), samples_.end(), local_ns,
+                               [](double t, const OffsetSample& s) { return t < s.local_time; });
+    const OffsetSample& hi = *it;
+    const OffsetSample& lo = *(it - 1);
+    double ratio = (local_ns - lo.local_time) / (double)(hi.local_time - lo.local_time);
+    return local_ns + lo.offset + ratio * (hi.offset - lo.offset);
+  }
+
+ private:
+  std::vector<OffsetSample> samples_;
+};
+
+class TraceWriter {
+ public:
+  explicit TraceWriter(const std::string& path) : file_(path) {
+    if (!file_.is_open()) {
+      throw mscclpp::Error("NpKit: failed to open " + path, mscclpp::ErrorCode::InvalidUsage);
+    }
+    file_ << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  }
+
+  ~TraceWriter() { file_ << "\n]}\n"; }
+
+  // Write a complete ("X") event. Every event is written on its own line, which MergeTraces relies on.
+  void complete(const std::string& name, const char* category, int pid, int tid, double ts_ns, double dur_ns,
+                uint32_t size, uint32_t rsvd) {
+    char buf[512];
+    snprintf(buf, sizeof(buf),
+             "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+             "\"args\":{\"size\":%u,\"rsvd\":%u}}",
+             first_ ? "" : ",\n", name.c_str(), category, pid, tid, ts_ns / 1e3, dur_ns / 1e3, size, rsvd);
+    file_ << buf;
+    first_ = false;
+  }
+
+  void metadata(const char* name, int pid, int tid, const std::string& value) {
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+             first_ ? "" : ",\n", name, pid, tid, value.c_str());
+    file_ << buf;
+    first_ = false;
+  }
+
+ private:
+  std::ofstream file_;
+  bool first_ = true;
+};
+
+struct OpenEvent {
+  double ts_ns;
+  uint32_t size;
+  uint32_t rsvd;
+};
+
+}  // namespace
+
+void NpKit::ExportTrace(const std::string& dump_dir, int rank, const std::string& trace_path) {
+  std::string suffix = "_rank_" + std::to_string(rank);
+  double cpu_period_num = std::stod(ReadTextFile(dump_dir + "/cpu_clock_period_num" + suffix));
+  double cpu_period_den = std::stod(ReadTextFile(dump_dir + "/cpu_clock_period_den" + suffix));
+  double cpu_ns_per_tick = cpu_period_num * 1e9 / cpu_period_den;
+  double gpu_clock_rate_khz = std::stod(ReadTextFile(dump_dir + "/gpu_clock_rate" + suffix));
+  double gpu_ns_per_tick = 1e6 / gpu_clock_rate_khz;
+  ClockAligner aligner(dump_dir + "/cpu_clock_offset" + suffix);
+
+  TraceWriter writer(trace_path);
+  writer.metadata("process_name", rank, 0, "rank " + std::to_string(rank));
+
+  // GPU events: timestamps are converted with the latest CPU/GPU time sync events of the same buffer.
+  // GPU buffers are placed on tids [1, kNumGpuEventBuffers].
+  for (uint64_t buf = 0; buf < kNumGpuEventBuffers; buf++) {
+    std::vector<NpKitEvent> events = ReadEventFile(dump_dir + "/gpu_events" + suffix + "_buf_" + std::to_string(buf));
+    if (events.empty()) continue;
+    int tid = (int)buf + 1;
+    writer.metadata("thread_name", rank, tid, "GPU block " + std::to_string(buf));
+    double cpu_base_ns = -1;
+    double gpu_base_ns = -1;
+    std::unordered_map<std::string, std::vector<OpenEvent>> open_events;
+    for (const NpKitEvent& event : events) {
+      uint8_t type = event.fields.type;
+      if (type == NPKIT_EVENT_TIME_SYNC_CPU) {
+        cpu_base_ns = event.fields.timestamp * cpu_ns_per_tick;
+        gpu_base_ns = -1;
+        continue;
+      }
+      if (type == NPKIT_EVENT_TIME_SYNC_GPU) {
+        if (gpu_base_ns < 0) gpu_base_ns = event.fields.timestamp * gpu_ns_per_tick;
+        continue;
+      }
+      // Ring buffers may start in the middle of a kernel, skip events until the first time sync.
+      if (cpu_base_ns < 0) continue;
+      EventKind kind = GetEventKind(type);
+      if (!kind.valid) continue;
+      double gpu_ns = event.fields.timestamp * gpu_ns_per_tick;
+      if (gpu_base_ns < 0) gpu_base_ns = gpu_ns;
+      double ts_ns = aligner.align(cpu_base_ns + gpu_ns - gpu_base_ns);
+      auto& stack = open_events[kind.name];
+      if (kind.is_entry) {
+        stack.push_back({ts_ns, (uint32_t)event.fields.size, (uint32_t)event.fields.rsvd});
+      } else if (!stack.empty()) {
+        OpenEvent entry = stack.back();
+        stack.pop_back();
+        writer.complete(kind.name, "GPU", rank, tid, entry.ts_ns, ts_ns - entry.ts_ns, entry.size, entry.rsvd);
+      }
+    }
+  }
+
+  // CPU events: pairs are matched by their slot (`rsvd`). CPU channels are placed on tids above the GPU buffers.
+  for (uint64_t channel = 0; channel < kNumCpuEventBuffers; channel++) {
+    std::vector<NpKitEvent> events =
+        ReadEventFile(dump_dir + "/cpu_events" + suffix + "_channel_" + std::to_string(channel));
+    if (events.empty()) continue;
+    int tid = (int)(kNumGpuEventBuffers + 1 + channel);
+    writer.metadata("thread_name", rank, tid, "CPU channel " + std::to_string(channel));
+    std::unordered_map<std::string, std::vector<OpenEvent>> open_events;
+    for (const NpKitEvent& event : events) {
+      EventKind kind = GetEventKind(event.fields.type);
+      if (!kind.valid || kind.is_time_sync) continue;
+      double ts_ns = aligner.align(event.fields.timestamp * cpu_ns_per_tick);
+      auto& stack = open_events[kind.name + "/" + std::to_string(event.fields.rsvd)];
+      if (kind.is_entry) {
+        stack.push_back({ts_ns, (uint32_t)event.fields.size, (uint32_t)event.fields.rsvd});
+      } else if (!stack.empty()) {
+        OpenEvent entry = stack.back();
+        stack.pop_back();
+        writer.complete(kind.name, "CPU", rank, tid, entry.ts_ns, ts_ns - entry.ts_ns, entry.size, entry.rsvd);
+      }
+    }
+  }
+}
+
+void NpKit::MergeTraces(const std::vector<std::string>& trace_paths, const std::string& merged_trace_path) {
+  std::ofstream out(merged_trace_path);
+  if (!out.is_open()) {
+    throw mscclpp::Error("NpKit: failed to open " + merged_trace_path, mscclpp::ErrorCode::InvalidUsage);
+  }
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  bool first = true;
+  for (const auto& path : trace_paths) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+      throw mscclpp::Error("NpKit: failed to open " + path, mscclpp::ErrorCode::InvalidUsage);
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+      // Skip the header and footer lines written by TraceWriter, every other line is a single event.
+      if (line.rfind("{\"name\"", 0) != 0) continue;
+      if (line.back() == ',') line.pop_back();
+      out << (first ? "" : ",\n") << line;
+      first = false;
+    }
+  }
+  out << "\n]}\n";
+}
@@ -12,6 +12,7 @@
 #include "api.h"
 #include "debug.h"
 #include "endpoint.hpp"
+#include "range_allocator.hpp"
 
 namespace mscclpp {
 
@@ -44,8 +45,8 @@ class NvlsConnection::Impl : public std::enable_shared_from_this<NvlsConnection:
   pid_t rootPid_;
   int mcFileDesc_;
 
-  std::list<std::pair<size_t, size_t>> allocatedRanges_;
-  std::list<std::pair<size_t, size_t>> freeRanges_;
+  // Ranges of the multicast address space bound to device memory
+  std::unique_ptr<RangeAllocator> allocator_;
 };
 
 NvlsConnection::Impl::Impl(size_t bufferSize, int numDevices) {
@@ -63,7 +64,7 @@ NvlsConnection::Impl::Impl(size_t bufferSize, int numDevices) {
   mcFileDesc_ = 0;
   MSCCLPP_CUTHROW(
       cuMemExportToShareableHandle(&mcFileDesc_, mcHandle_, CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR, 0 /*flags*/));
-  freeRanges_.emplace_back(0, bufferSize_);
+  allocator_ = std::make_unique<RangeAllocator>(bufferSize_, minMcGran_);
 
   rootPid_ = getpid();
   if (rootPid_ < 0) {
@@ -88,7 +89,7 @@ NvlsConnection::Impl::Impl(const std::vector<char>& data) {
   it += sizeof(this->rootPid_);
   std::copy_n(it, sizeof(this->mcFileDesc_), reinterpret_cast<char*>(&this->mcFileDesc_));
 
-  freeRanges_.emplace_back(0, bufferSize_);
+  allocator_ = std::make_unique<RangeAllocator>(bufferSize_, minMcGran_);
   int rootPidFd = syscall(SYS_pidfd_open, rootPid_, 0);
   if (rootPidFd < 0) {
     throw mscclpp::SysError("pidfd_open() failed", errno);
@@ -129,61 +130,18 @@ void NvlsConnection::Impl::addDevice(int cudaDeviceId) {
 }
 
 size_t NvlsConnection::Impl::allocateBuffer(size_t size) {
-  if (freeRanges_.empty()) {
-    throw Error("This NVLS connection mapped more than it was supposed to", ErrorCode::InvalidUsage);
-  }
-  auto it = std::find_if(freeRanges_.begin(), freeRanges_.end(),
-                         [size](const std::pair<size_t, size_t>& range) { return range.second >= size; });
-  if (it != freeRanges_.end()) {
-    size_t offset = it->first;
-    size_t rangeSize = it->second;
-    if (rangeSize == size) {
-      freeRanges_.erase(it);
-    } else {
-      it->first += size;
-      it->second -= size;
-    }
-    allocatedRanges_.emplace_back(offset, size);
-    INFO(MSCCLPP_COLL, "NVLS connection allocated %ld bytes at offset %ld", size, offset);
-    return offset;
-  }
-  throw Error("This NVLS connection cannot map the requested devBuffSize", ErrorCode::InvalidUsage);
+  size_t offset = allocator_->allocate(size);
+  RangeAllocatorStats stats = allocator_->stats();
+  INFO(MSCCLPP_COLL, "NVLS connection allocated %ld bytes at offset %ld, %ld of %ld bytes free (fragmentation %.2f)",
+       size, offset, stats.freeBytes, stats.totalBytes, stats.fragmentation);
+  return offset;
 }
 
 void NvlsConnection::Impl::freeBuffer(size_t offset, size_t size) noexcept {
-  auto it = std::find_if(
-      allocatedRanges_.begin(), allocatedRanges_.end(),
-      [offset, size](const std::pair<size_t, size_t>& range) { return range.first == offset && range.second == size; });
-  if (it == allocatedRanges_.end()) {
+  try {
+    allocator_->free(offset, size);
+  } catch (const Error&) {
     WARN("NVLS connection tried to free a buffer that was not allocated");
-    return;
-  }
-  allocatedRanges_.erase(it);
-  it = std::find_if(freeRanges_.begin(), freeRanges_.end(), [offset, size](const std::pair<size_t, size_t>& range) {
-    return range.first + range.second >= offset;
-  });
-  if (it == freeRanges_.end()) {
-    freeRanges_.emplace_back(offset, size);
-    return;
-  }
-  if (it->first + it->second == offset) {
-    // merge with the previous free range if possible
-    it->second += size;
-    // merge with the next free range if possible
-    auto nextItr = std::next(it);
-    if (nextItr != freeRanges_.end() && it->first + it->second == nextItr->first) {
-      it->second += nextItr->second;
-      freeRanges_.erase(nextItr);
-    }
-    return;
-  } else if (it->first == offset + size) {
-    // merge with the next free range if possible
-    it->first -= size;
-    it->second += size;
-    return;
-  } else {
-    freeRanges_.emplace(it, offset, size);
-    return;
   }
 }
 
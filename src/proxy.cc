@@ -1,17 +1,25 @@
 // Copyright (c) Microsoft Corporation.
 // Licensed under the MIT license.
 
+#include <algorithm>
 #include <atomic>
 #include <mscclpp/core.hpp>
 #include <mscclpp/gpu_utils.hpp>
+#include <mscclpp/metrics.hpp>
 #include <mscclpp/proxy.hpp>
 #include <mscclpp/utils.hpp>
 #include <thread>
 
+#if defined(ENABLE_NPKIT)
+#include <mscclpp/npkit/npkit.hpp>
+#endif
+
 #include "api.h"
+#include "metrics_internal.hpp"
 
 namespace mscclpp {
 
+// The proxy checks whether it is stopped every ProxyStopCheckPeriod polls.
 const int ProxyStopCheckPeriod = 1000;
 
 // Unless explicitly requested, a flush of the tail to device memory is triggered for every ProxyFlushPeriod.
@@ -20,22 +28,52 @@ const int ProxyFlushPeriod = 4;
 
 struct Proxy::Impl {
   ProxyHandler handler;
+  ProxyLoop loop;
   std::function<void()> threadInit;
   Fifo fifo;
   std::thread service;
   std::atomic_bool running;
+  int metricsId;
+  std::shared_ptr<Counter> triggersHandled;
+  std::shared_ptr<Counter> fifoTailFlushes;
+
+  // Never destroyed, since proxies may outlive static objects.
+  static MetricLabelIds& proxyIds() {
+    static MetricLabelIds* ids = new MetricLabelIds();
+    return *ids;
+  }
+
+  MetricLabels metricLabels() const { return {{"proxy", std::to_string(metricsId)}}; }
+
+  Impl(ProxyHandler handler, ProxyLoop loop, std::function<void()> threadInit, size_t fifoSize, int fifoLanes)
+      : handler(handler), loop(loop), threadInit(threadInit), fifo(fifoSize, fifoLanes), running(false) {
+    metricsId = proxyIds().acquire();
+    auto& registry = MetricsRegistry::global();
+    triggersHandled =
+        registry.counter("mscclpp_proxy_triggers_total", "Triggers handled by the proxy", metricLabels());
+    fifoTailFlushes =
+        registry.counter("mscclpp_proxy_fifo_tail_flushes_total", "FIFO tail flushes by the proxy", metricLabels());
+  }
 
-  Impl(ProxyHandler handler, std::function<void()> threadInit, size_t fifoSize)
-      : handler(handler), threadInit(threadInit), fifo(fifoSize), running(false) {}
+  ~Impl() {
+    auto& registry = MetricsRegistry::global();
+    registry.remove("mscclpp_proxy_triggers_total", metricLabels());
+    registry.remove("mscclpp_proxy_fifo_tail_flushes_total", metricLabels());
+    proxyIds().release(metricsId);
+  }
 };
 
-MSCCLPP_API_CPP Proxy::Proxy(ProxyHandler handler, std::function<void()> threadInit, size_t fifoSize) {
-  pimpl = std::make_unique<Impl>(handler, threadInit, fifoSize);
+MSCCLPP_API_CPP Proxy::Proxy(ProxyHandler handler, std::function<void()> threadInit, size_t fifoSize, int fifoLanes) {
+  pimpl = std::make_unique<Impl>(handler, nullptr, threadInit, fifoSize, fifoLanes);
 }
 
-MSCCLPP_API_CPP Proxy::Proxy(ProxyHandler handler, size_t fifoSize)
+MSCCLPP_API_CPP Proxy::Proxy(ProxyHandler handler, size_t fifoSize, int fifoLanes)
     : Proxy(
-          handler, [] {}, fifoSize) {}
+          handler, [] {}, fifoSize, fifoLanes) {}
+
+MSCCLPP_API_CPP Proxy::Proxy(ProxyLoop loop, std::function<void()> threadInit, size_t fifoSize, int fifoLanes) {
+  pimpl = std::make_unique<Impl>(nullptr, loop, threadInit, fifoSize, fifoLanes);
+}
 
 MSCCLPP_API_CPP Proxy::~Proxy() {
   if (pimpl) {
@@ -53,47 +91,11 @@ MSCCLPP_API_CPP void Proxy::start() {
 
     pimpl->threadInit();
 
-    ProxyHandler handler = this->pimpl->handler;
-    Fifo& fifo = this->pimpl->fifo;
-    std::atomic_bool& running = this->pimpl->running;
-    ProxyTrigger trigger;
-
-    int flushPeriod = std::min(fifo.size(), ProxyFlushPeriod);
-
-    int runCnt = ProxyStopCheckPeriod;
-    uint64_t flushCnt = 0;
-    for (;;) {
-      if (runCnt-- == 0) {
-        runCnt = ProxyStopCheckPeriod;
-        if (!running) {
-          break;
-        }
-      }
-      // Poll to see if we are ready to send anything
-      trigger = fifo.poll();
-      if (trigger.fst == 0 || trigger.snd == 0) {  // TODO: this check is a potential pitfall for custom triggers
-        continue;                                  // there is one in progress
-      }
-      trigger.snd ^= ((uint64_t)1 << (uint64_t)63);  // this is where the last bit of snd is reverted.
-
-      ProxyHandlerResult result = handler(trigger);
-
-      // Send completion: reset only the high 64 bits
-      fifo.pop();
-      // Flush the tail to device memory. This is either triggered every flushPeriod to make sure that the fifo can make
-      // progress even if there is no request mscclppSync. However, mscclppSync type is for flush request.
-      if ((++flushCnt % flushPeriod) == 0 || result == ProxyHandlerResult::FlushFifoTailAndContinue) {
-        // TODO: relocate this check: || (trigger.fields.type & mscclppSync)
-        fifo.flushTail();
-      }
-
-      if (result == ProxyHandlerResult::Stop) {
-        break;
-      }
+    if (pimpl->loop) {
+      pimpl->loop(*this);
+    } else {
+      runLoop(pimpl->handler);
     }
-
-    // make sure the tail is flushed before we shut the proxy
-    fifo.flushTail(/*sync=*/true);
     // TODO: do these need to run?
     // bool isP2pProxy = (proxyState->ibContext == nullptr);
     // if (isP2pProxy) {
@@ -112,4 +114,55 @@ MSCCLPP_API_CPP void Proxy::stop() {
 
 MSCCLPP_API_CPP Fifo& Proxy::fifo() { return pimpl->fifo; }
 
+MSCCLPP_API_CPP const std::atomic_bool& Proxy::running() const { return pimpl->running; }
+
+MSCCLPP_API_CPP int Proxy::stopCheckPeriod() const { return ProxyStopCheckPeriod; }
+
+MSCCLPP_API_CPP int Proxy::flushPeriod() const { return std::min(pimpl->fifo.size(), ProxyFlushPeriod); }
+
+MSCCLPP_API_CPP uint64_t Proxy::beginTrigger() {
+#if defined(ENABLE_NPKIT) &&                                                                                \
+    ((defined(ENABLE_NPKIT_EVENT_PROXY_TRIGGER_ENTRY) && defined(ENABLE_NPKIT_EVENT_PROXY_TRIGGER_EXIT)) || \
+     (defined(ENABLE_NPKIT_EVENT_PROXY_HANDLER_ENTRY) && defined(ENABLE_NPKIT_EVENT_PROXY_HANDLER_EXIT)))
+  return NpKit::GetCpuTimestampNow();
+#else
+  return 0;
+#endif
+}
+
+MSCCLPP_API_CPP void Proxy::endHandler([[maybe_unused]] uint64_t entryTime) {
+  // The handler may have set the NpKit channel of this thread, so events are collected after it returns.
+#if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_PROXY_HANDLER_ENTRY) && \
+    defined(ENABLE_NPKIT_EVENT_PROXY_HANDLER_EXIT)
+  NpKit::CollectCpuEvent(NPKIT_EVENT_PROXY_HANDLER_ENTRY, 0, NPKIT_EVENT_PROXY_HANDLER_ENTRY, entryTime);
+  NpKit::CollectCpuEvent(NPKIT_EVENT_PROXY_HANDLER_EXIT, 0, NPKIT_EVENT_PROXY_HANDLER_ENTRY,
+                         NpKit::GetCpuTimestampNow());
+#endif
+}
+
+MSCCLPP_API_CPP void Proxy::endTrigger([[maybe_unused]] uint64_t entryTime) {
+  pimpl->triggersHandled->add();
+#if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_PROXY_TRIGGER_ENTRY) && \
+    defined(ENABLE_NPKIT_EVENT_PROXY_TRIGGER_EXIT)
+  NpKit::CollectCpuEvent(NPKIT_EVENT_PROXY_TRIGGER_ENTRY, 0, NPKIT_EVENT_PROXY_TRIGGER_ENTRY, entryTime);
+  NpKit::CollectCpuEvent(NPKIT_EVENT_PROXY_TRIGGER_EXIT, 0, NPKIT_EVENT_PROXY_TRIGGER_ENTRY,
+                         NpKit::GetCpuTimestampNow());
+#endif
+}
+
+MSCCLPP_API_CPP void Proxy::flushFifoTail() {
+#if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_PROXY_FIFO_FLUSH_TAIL_ENTRY) && \
+    defined(ENABLE_NPKIT_EVENT_PROXY_FIFO_FLUSH_TAIL_EXIT)
+  NpKit::CollectCpuEvent(NPKIT_EVENT_PROXY_FIFO_FLUSH_TAIL_ENTRY, 0, NPKIT_EVENT_PROXY_FIFO_FLUSH_TAIL_ENTRY,
+                         NpKit::GetCpuTimestampNow());
+#endif
+  pimpl->fifo.flushTail();
+  pimpl->fifoTailFlushes->add();
+#if defined(ENABLE_NPKIT) && defined(ENABLE_NPKIT_EVENT_PROXY_FIFO_FLUSH_TAIL_ENTRY) && \
+    defined(ENABLE_NPKIT_EVENT_PROXY_FIFO_FLUSH_TAIL_EXIT)
+  NpKit::CollectCpuEvent(NPKIT_EVENT_PROXY_FIFO_FLUSH_TAIL_EXIT, 0, NPKIT_EVENT_PROXY_FIFO_FLUSH_TAIL_ENTRY,
+                         NpKit::GetCpuTimestampNow());
+#endif
+}
+
 }  // namespace mscclpp
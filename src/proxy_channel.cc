@@ -4,38 +4,56 @@
 #include <mscclpp/numa.hpp>
 #include <mscclpp/proxy_channel.hpp>
 
+#if defined(ENABLE_NPKIT)
+#include <mscclpp/npkit/npkit.hpp>
+#endif
+
 #include "api.h"
 #include "debug.h"
 
 namespace mscclpp {
 
 MSCCLPP_API_CPP ProxyChannel::ProxyChannel(SemaphoreId semaphoreId, std::shared_ptr<Host2DeviceSemaphore> semaphore,
-                                           std::shared_ptr<Proxy> proxy)
-    : semaphoreId_(semaphoreId), semaphore_(semaphore), proxy_(proxy) {}
+                                           std::shared_ptr<Proxy> proxy, TriggerFormat triggerFormat)
+    : semaphoreId_(semaphoreId), semaphore_(semaphore), proxy_(proxy), triggerFormat_(triggerFormat) {}
 
 MSCCLPP_API_CPP SimpleProxyChannel::SimpleProxyChannel(ProxyChannel proxyChan, MemoryId dst, MemoryId src)
     : proxyChan_(proxyChan), dst_(dst), src_(src) {}
 
-MSCCLPP_API_CPP ProxyService::ProxyService(size_t fifoSize)
-    : proxy_(std::make_shared<Proxy>([&](ProxyTrigger triggerRaw) { return handleTrigger(triggerRaw); },
-                                     [&]() { bindThread(); }, fifoSize)) {
+MSCCLPP_API_CPP ProxyService::ProxyService(size_t fifoSize, TriggerFormat triggerFormat, int fifoLanes)
+    : ProxyEngine<ProxyService>(fifoSize, fifoLanes), triggerFormat_(triggerFormat),
+      hasPendingTrigger_(false),
+      proxyStarted_(false) {
   int cudaDevice;
   MSCCLPP_CUDATHROW(cudaGetDevice(&cudaDevice));
   deviceNumaNode = getDeviceNumaNode(cudaDevice);
 }
 
+MSCCLPP_API_CPP ProxyService::~ProxyService() { stopProxy(); }
+
+// Throws if an ID does not fit in its field of the trigger format.
+static void checkIdBits(size_t id, TriggerFormat format, int compactBits, int extendedBits, const char* what) {
+  int bits = (format == TriggerFormat::Extended) ? extendedBits : compactBits;
+  if (id >= (size_t(1) << bits)) {
+    throw Error(std::string("Too many ") + what + " for the trigger format of the proxy service (at most " +
+                    std::to_string(size_t(1) << bits) + "); use TriggerFormat::Extended",
+                ErrorCode::InvalidUsage);
+  }
+}
+
 MSCCLPP_API_CPP SemaphoreId ProxyService::buildAndAddSemaphore(Communicator& communicator,
                                                                std::shared_ptr<Connection> connection) {
-  semaphores_.push_back(std::make_shared<Host2DeviceSemaphore>(communicator, connection));
-  return semaphores_.size() - 1;
+  return addSemaphore(std::make_shared<Host2DeviceSemaphore>(communicator, connection));
 }
 
 MSCCLPP_API_CPP SemaphoreId ProxyService::addSemaphore(std::shared_ptr<Host2DeviceSemaphore> semaphore) {
+  checkIdBits(semaphores_.size(), triggerFormat_, MSCCLPP_BITS_CONNID, MSCCLPP_BITS_EXT_CONNID, "semaphores");
   semaphores_.push_back(semaphore);
   return semaphores_.size() - 1;
 }
 
 MSCCLPP_API_CPP MemoryId ProxyService::addMemory(RegisteredMemory memory) {
+  checkIdBits(memories_.size(), triggerFormat_, MSCCLPP_BITS_REGMEM_HANDLE, MSCCLPP_BITS_EXT_REGMEM_HANDLE, "memories");
   memories_.push_back(memory);
   return memories_.size() - 1;
 }
@@ -45,48 +63,132 @@ MSCCLPP_API_CPP std::shared_ptr<Host2DeviceSemaphore> ProxyService::semaphore(Se
 }
 
 MSCCLPP_API_CPP ProxyChannel ProxyService::proxyChannel(SemaphoreId id) {
-  return ProxyChannel(id, semaphores_[id], proxy_);
+  return ProxyChannel(id, semaphores_[id], proxy_, triggerFormat_);
 }
 
-MSCCLPP_API_CPP void ProxyService::startProxy() { proxy_->start(); }
+MSCCLPP_API_CPP void ProxyService::startProxy() {
+  proxyStarted_ = true;
+  ProxyEngine<ProxyService>::startProxy();
+}
+
+MSCCLPP_API_CPP void ProxyService::stopProxy() { ProxyEngine<ProxyService>::stopProxy(); }
 
-MSCCLPP_API_CPP void ProxyService::stopProxy() { proxy_->stop(); }
+MSCCLPP_API_CPP TriggerFormat ProxyService::triggerFormat() const { return triggerFormat_; }
 
-MSCCLPP_API_CPP void ProxyService::bindThread() {
+MSCCLPP_API_CPP void ProxyService::registerCustomTrigger(uint32_t customType, CustomTriggerHandler handler) {
+  if (proxyStarted_) {
+    throw Error("Custom triggers must be registered before the proxy is started", ErrorCode::InvalidUsage);
+  }
+  if (!handler) {
+    throw Error("The handler of a custom trigger must not be empty", ErrorCode::InvalidUsage);
+  }
+  checkIdBits(customType, triggerFormat_, MSCCLPP_BITS_CONNID, MSCCLPP_BITS_EXT_CONNID, "custom trigger types");
+  if (customHandlers_.size() <= customType) {
+    customHandlers_.resize(customType + 1);
+  }
+  customHandlers_[customType] = std::move(handler);
+}
+
+MSCCLPP_API_CPP void ProxyService::threadInit() {
   if (deviceNumaNode >= 0) {
     numaBind(deviceNumaNode);
     INFO(MSCCLPP_INIT, "NUMA node of ProxyService proxy thread is set to %d", deviceNumaNode);
   }
 }
 
+// Copies the fields of either trigger format into a request.
+template <class Fields>
+static ProxyRequest makeRequest(const Fields& fields) {
+  ProxyRequest request;
+  request.type = fields.type;
+  request.chanId = fields.chanId;
+  request.dst = fields.dstMemoryId;
+  request.dstOffset = fields.dstOffset;
+  request.src = fields.srcMemoryId;
+  request.srcOffset = fields.srcOffset;
+  request.size = fields.size;
+  return request;
+}
+
 ProxyHandlerResult ProxyService::handleTrigger(ProxyTrigger triggerRaw) {
-  ChannelTrigger* trigger = reinterpret_cast<ChannelTrigger*>(&triggerRaw);
-  std::shared_ptr<Host2DeviceSemaphore> semaphore = semaphores_[trigger->fields.chanId];
+  // Handlers indexed by the trigger type, so that a trigger costs a single indirect call after decoding. The type is
+  // a bit mask, and each combination of bits gets its own instantiation of handleRequest().
+  using Handler = ProxyHandlerResult (ProxyService::*)(const ProxyRequest&);
+  static constexpr Handler handlers[1 << MSCCLPP_BITS_TYPE] = {
+      &ProxyService::handleCustomRequest,  // TriggerCustom
+      &ProxyService::handleRequest<1>,     // TriggerData
+      &ProxyService::handleRequest<2>,     // TriggerFlag
+      &ProxyService::handleRequest<3>,     // TriggerData | TriggerFlag
+      &ProxyService::handleRequest<4>,     // TriggerSync
+      &ProxyService::handleRequest<5>,     // TriggerData | TriggerSync
+      &ProxyService::handleRequest<6>,     // TriggerFlag | TriggerSync
+      &ProxyService::handleRequest<7>,     // TriggerData | TriggerFlag | TriggerSync
+  };
+
+  ProxyRequest request;
+  if (triggerFormat_ == TriggerFormat::Extended) {
+    // The device pushes both entries to consecutive places of a FIFO lane, so the proxy pops the second one right
+    // after the first one.
+    if (!hasPendingTrigger_) {
+      pendingTrigger_ = triggerRaw;
+      hasPendingTrigger_ = true;
+      return ProxyHandlerResult::ContinueInSameLane;
+    }
+    hasPendingTrigger_ = false;
+    ExtendedChannelTrigger trigger;
+    trigger.value[0] = pendingTrigger_;
+    trigger.value[1] = triggerRaw;
+    if (trigger.fields.version != ExtendedTriggerVersion || trigger.fields.secondVersion != ExtendedTriggerVersion) {
+      throw Error("Unexpected trigger version " + std::to_string(trigger.fields.version) + "/" +
+                      std::to_string(trigger.fields.secondVersion) + " for the extended trigger format",
+                  ErrorCode::InternalError);
+    }
+    request = makeRequest(trigger.fields);
+  } else {
+    ChannelTrigger* trigger = reinterpret_cast<ChannelTrigger*>(&triggerRaw);
+    request = makeRequest(trigger->fields);
+  }
+  return (this->*handlers[request.type])(request);
+}
+
+template <TriggerType Type>
+ProxyHandlerResult ProxyService::handleRequest(const ProxyRequest& request) {
+  const std::shared_ptr<Host2DeviceSemaphore>& semaphore = semaphores_[request.chanId];
 
-  auto result = ProxyHandlerResult::Continue;
+#if defined(ENABLE_NPKIT)
+  NpKit::SetCpuEventChannel(request.chanId);
+#endif
 
-  if (trigger->fields.type & TriggerData) {
-    RegisteredMemory& dst = memories_[trigger->fields.dstMemoryId];
-    RegisteredMemory& src = memories_[trigger->fields.srcMemoryId];
-    semaphore->connection()->write(dst, trigger->fields.dstOffset, src, trigger->fields.srcOffset,
-                                   trigger->fields.size);
+  if constexpr (bool(Type & TriggerData)) {
+    semaphore->connection()->write(memories_[request.dst], request.dstOffset, memories_[request.src],
+                                   request.srcOffset, request.size);
   }
 
-  if (trigger->fields.type & TriggerFlag) {
+  if constexpr (bool(Type & TriggerFlag)) {
     semaphore->signal();
   }
 
-  if (trigger->fields.type & TriggerSync) {
+  if constexpr (bool(Type & TriggerSync)) {
     semaphore->connection()->flush();
-    result = ProxyHandlerResult::FlushFifoTailAndContinue;
+    return ProxyHandlerResult::FlushFifoTailAndContinue;
   }
 
-  return result;
+  return ProxyHandlerResult::Continue;
+}
+
+ProxyHandlerResult ProxyService::handleCustomRequest(const ProxyRequest& request) {
+  if (request.chanId >= customHandlers_.size() || !customHandlers_[request.chanId]) {
+    throw Error("No handler is registered for custom trigger type " + std::to_string(request.chanId),
+                ErrorCode::InvalidUsage);
+  }
+  return customHandlers_[request.chanId](request);
 }
 
 MSCCLPP_API_CPP ProxyChannel::DeviceHandle ProxyChannel::deviceHandle() const {
-  return ProxyChannel::DeviceHandle{
-      .semaphoreId_ = semaphoreId_, .semaphore_ = semaphore_->deviceHandle(), .fifo_ = proxy_->fifo().deviceHandle()};
+  return ProxyChannel::DeviceHandle{.semaphoreId_ = semaphoreId_,
+                                    .triggerFormat_ = triggerFormat_,
+                                    .semaphore_ = semaphore_->deviceHandle(),
+                                    .fifo_ = proxy_->fifo().deviceHandle()};
 }
 
 MSCCLPP_API_CPP SimpleProxyChannel::DeviceHandle SimpleProxyChannel::deviceHandle() const {
@@ -0,0 +1,115 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "range_allocator.hpp"
+
+#include <iterator>
+#include <mscclpp/errors.hpp>
+#include <string>
+
+namespace mscclpp {
+
+static int sizeClassOf(size_t size) { return 63 - __builtin_clzll(size); }
+
+RangeAllocator::RangeAllocator(size_t totalBytes, size_t alignment)
+    : totalBytes_(0), alignment_(alignment), allocatedBytes_(0), nonEmptyClasses_(0) {
+  if (alignment == 0) {
+    throw Error("RangeAllocator alignment must be positive", ErrorCode::InvalidUsage);
+  }
+  totalBytes_ = totalBytes / alignment * alignment;
+  if (totalBytes_ > 0) insertFreeRange(0, totalBytes_);
+}
+
+size_t RangeAllocator::alignedSize(size_t size) const {
+  if (size == 0 || size > totalBytes_) return 0;
+  return (size + alignment_ - 1) / alignment_ * alignment_;
+}
+
+void RangeAllocator::insertFreeRange(size_t offset, size_t size) {
+  freeRanges_.emplace(offset, size);
+  int sizeClass = sizeClassOf(size);
+  sizeClasses_[sizeClass].emplace(size, offset);
+  nonEmptyClasses_ |= (1ULL << sizeClass);
+}
+
+void RangeAllocator::eraseFreeRange(std::map<size_t, size_t>::iterator it) {
+  int sizeClass = sizeClassOf(it->second);
+  sizeClasses_[sizeClass].erase(std::make_pair(it->second, it->first));
+  if (sizeClasses_[sizeClass].empty()) nonEmptyClasses_ &= ~(1ULL << sizeClass);
+  freeRanges_.erase(it);
+}
+
+size_t RangeAllocator::allocate(size_t size) {
+  size_t aligned = alignedSize(size);
+  std::set<std::pair<size_t, size_t>>::iterator fit;
+  bool found = false;
+  if (aligned > 0) {
+    int sizeClass = sizeClassOf(aligned);
+    // Best fit within the class of the request
+    fit = sizeClasses_[sizeClass].lower_bound(std::make_pair(aligned, size_t(0)));
+    found = (fit != sizeClasses_[sizeClass].end());
+    // Otherwise any range of a larger class fits, so take the smallest one
+    uint64_t largerClasses = (sizeClass + 1 < NumSizeClasses) ? nonEmptyClasses_ & (~0ULL << (sizeClass + 1)) : 0;
+    if (!found && largerClasses != 0) {
+      fit = sizeClasses_[__builtin_ctzll(largerClasses)].begin();
+      found = true;
+    }
+  }
+  if (!found) {
+    throw Error("RangeAllocator has no free range of " + std::to_string(size) + " bytes (largest free range: " +
+                    std::to_string(stats().largestFreeRange) + " bytes)",
+                ErrorCode::InvalidUsage);
+  }
+  size_t rangeSize = fit->first;
+  size_t offset = fit->second;
+  eraseFreeRange(freeRanges_.find(offset));
+  if (rangeSize > aligned) insertFreeRange(offset + aligned, rangeSize - aligned);
+  allocatedRanges_.emplace(offset, aligned);
+  allocatedBytes_ += aligned;
+  return offset;
+}
+
+void RangeAllocator::free(size_t offset, size_t size) {
+  auto allocated = allocatedRanges_.find(offset);
+  if (allocated == allocatedRanges_.end() || allocated->second != alignedSize(size)) {
+    throw Error("RangeAllocator has no range of " + std::to_string(size) + " bytes allocated at offset " +
+                    std::to_string(offset),
+                ErrorCode::InvalidUsage);
+  }
+  size = allocated->second;
+  allocatedRanges_.erase(allocated);
+  allocatedBytes_ -= size;
+
+  // Coalesce with the adjacent free ranges
+  auto next = freeRanges_.lower_bound(offset);
+  if (next != freeRanges_.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == offset) {
+      offset = prev->first;
+      size += prev->second;
+      eraseFreeRange(prev);
+    }
+  }
+  if (next != freeRanges_.end() && next->first == offset + size) {
+    size += next->second;
+    eraseFreeRange(next);
+  }
+  insertFreeRange(offset, size);
+}
+
+RangeAllocatorStats RangeAllocator::stats() const {
+  RangeAllocatorStats stats;
+  stats.totalBytes = totalBytes_;
+  stats.allocatedBytes = allocatedBytes_;
+  stats.freeBytes = totalBytes_ - allocatedBytes_;
+  stats.numAllocations = allocatedRanges_.size();
+  stats.numFreeRanges = freeRanges_.size();
+  stats.largestFreeRange = 0;
+  if (nonEmptyClasses_ != 0) {
+    stats.largestFreeRange = sizeClasses_[63 - __builtin_clzll(nonEmptyClasses_)].rbegin()->first;
+  }
+  stats.fragmentation = (stats.freeBytes > 0) ? 1.0 - (double)stats.largestFreeRange / stats.freeBytes : 0.0;
+  return stats;
+}
+
+}  // namespace mscclpp
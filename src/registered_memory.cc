@@ -3,8 +3,16 @@
 
 #include "registered_memory.hpp"
 
+#include <sys/syscall.h>
+#include <unistd.h>
+
 #include <algorithm>
+#include <cstring>
+#include <functional>
 #include <mscclpp/gpu_utils.hpp>
+#include <mscclpp/metrics.hpp>
+#include <mutex>
+#include <unordered_map>
 
 #include "api.h"
 #include "context.hpp"
@@ -13,6 +21,313 @@
 
 namespace mscclpp {
 
+namespace {
+
+// Process-wide cache of imported CUDA IPC handles, both legacy handles and cuMem handles.
+//
+// Opening a CUDA IPC handle takes milliseconds, and the same allocation of a peer is typically imported many times,
+// e.g., once per registration of a buffer carved out of it. Imports are therefore shared by all RegisteredMemory
+// objects of the process that refer to the same allocation of the same peer process on the same local device, and the
+// handle is closed when the last of them is destroyed.
+class CudaIpcImportCache {
+ public:
+  static CudaIpcImportCache& instance() {
+    // Never destroyed, so that RegisteredMemory objects destroyed during static destruction can still release.
+    static CudaIpcImportCache* cache = new CudaIpcImportCache();
+    return *cache;
+  }
+
+  // Returns the base pointer of the import identified by the `handleSize` bytes at `handle`, calling `open` if it is
+  // not imported yet. `close` is called with the base pointer once the last reference is released.
+  void* acquire(uint64_t hostHash, uint64_t pidHash, const void* handle, size_t handleSize,
+                const std::function<void*()>& open, std::function<void(void*)> close) {
+    int deviceId;
+    MSCCLPP_CUDATHROW(cudaGetDevice(&deviceId));
+    std::string key(sizeof(hostHash) + sizeof(pidHash) + sizeof(deviceId) + handleSize, '\0');
+    char* keyPtr = &key[0];
+    std::memcpy(keyPtr, &hostHash, sizeof(hostHash));
+    std::memcpy(keyPtr += sizeof(hostHash), &pidHash, sizeof(pidHash));
+    std::memcpy(keyPtr += sizeof(pidHash), &deviceId, sizeof(deviceId));
+    std::memcpy(keyPtr += sizeof(deviceId), handle, handleSize);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+      it->second.refCount++;
+      hits_->add();
+      return it->second.base;
+    }
+    void* base = open();
+    entries_.emplace(key, Entry{base, 1, std::move(close)});
+    keys_.emplace(base, key);
+    imports_->add();
+    return base;
+  }
+
+  // Releases an allocation returned by acquire(), closing the handle if this was the last reference.
+  void release(void* base) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto keyIt = keys_.find(base);
+    if (keyIt == keys_.end()) {
+      WARN("CUDA IPC handle at pointer %p is not imported", base);
+      return;
+    }
+    auto it = entries_.find(keyIt->second);
+    if (--it->second.refCount > 0) return;
+    auto close = std::move(it->second.close);
+    entries_.erase(it);
+    keys_.erase(keyIt);
+    close(base);
+  }
+
+ private:
+  CudaIpcImportCache()
+      : imports_(MetricsRegistry::global().counter("mscclpp_cuda_ipc_imports_total", "CUDA IPC handles opened")),
+        hits_(MetricsRegistry::global().counter("mscclpp_cuda_ipc_import_cache_hits_total",
+                                                "CUDA IPC imports served by already opened handles")) {}
+
+  struct Entry {
+    void* base;
+    int refCount;
+    std::function<void(void*)> close;
+  };
+
+  std::mutex mutex_;
+  // Keyed by the exporting host and process, the importing device and the handle
+  std::unordered_map<std::string, Entry> entries_;
+  std::unordered_map<void*, std::string> keys_;
+  std::shared_ptr<Counter> imports_;
+  std::shared_ptr<Counter> hits_;
+};
+
+void* openCudaIpcHandle(const cudaIpcMemHandle_t& handle) {
+  void* base;
+  MSCCLPP_CUDATHROW(cudaIpcOpenMemHandle(&base, handle, cudaIpcMemLazyEnablePeerAccess));
+  INFO(MSCCLPP_P2P, "Opened CUDA IPC handle at pointer %p", base);
+  return base;
+}
+
+void closeCudaIpcHandle(void* base) {
+  cudaError_t err = cudaIpcCloseMemHandle(base);
+  if (err != cudaSuccess) {
+    WARN("Failed to close CUDA IPC handle at pointer %p: %s", base, cudaGetErrorString(err));
+  } else {
+    INFO(MSCCLPP_P2P, "Closed CUDA IPC handle at pointer %p", base);
+  }
+}
+
+// Process-wide POSIX fds exported for cuMem allocations, one per allocation.
+//
+// Peers duplicate the fd of a serialized RegisteredMemory with pidfd_getfd() at any time after it is sent, so the fd
+// has to stay open as long as the allocation is mapped, not just as long as the RegisteredMemory that exported it.
+// The fd of an allocation that is no longer mapped is closed the next time an fd is exported.
+class CuMemFdExports {
+ public:
+  static CuMemFdExports& instance() {
+    // Never destroyed, since the fds have to stay valid as long as their allocations.
+    static CuMemFdExports* exports = new CuMemFdExports();
+    return *exports;
+  }
+
+  // Returns the fd of the allocation `memHandle` mapped to [base, base + size), exporting it if it is not exported yet.
+  int get(void* base, size_t size, CUmemGenericAllocationHandle memHandle) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closeUnmapped();
+    auto it = entries_.find(base);
+    if (it != entries_.end()) return it->second.fd;
+    int fd = -1;
+    MSCCLPP_CUTHROW(
+        cuMemExportToShareableHandle(&fd, memHandle, CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR, 0 /*flags*/));
+    entries_.emplace(base, Entry{size, memHandle, fd});
+    return fd;
+  }
+
+ private:
+  struct Entry {
+    size_t size;
+    CUmemGenericAllocationHandle memHandle;
+    int fd;
+  };
+
+  // Closes the fds of allocations that are not mapped at their address anymore.
+  void closeUnmapped() {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (isMapped(it->first, it->second)) {
+        ++it;
+        continue;
+      }
+      close(it->second.fd);
+      it = entries_.erase(it);
+    }
+  }
+
+  static bool isMapped(void* base, const Entry& entry) {
+    CUdeviceptr mappedBase;
+    size_t mappedSize;
+    if (cuMemGetAddressRange(&mappedBase, &mappedSize, (CUdeviceptr)base) != CUDA_SUCCESS ||
+        mappedBase != (CUdeviceptr)base || mappedSize != entry.size) {
+      return false;
+    }
+    CUmemGenericAllocationHandle memHandle;
+    if (cuMemRetainAllocationHandle(&memHandle, base) != CUDA_SUCCESS) return false;
+    cuMemRelease(memHandle);
+    return memHandle == entry.memHandle;
+  }
+
+  std::mutex mutex_;
+  std::unordered_map<void*, Entry> entries_;
+};
+
+#if !defined(__HIP_PLATFORM_AMD__) && (CUDA_VERSION >= 12030)
+#define USE_CUMEM_FABRIC_HANDLE 1
+#else
+#define USE_CUMEM_FABRIC_HANDLE 0
+#endif
+
+// Fills the cuMem fields of `transportInfo` if `baseDataPtr` is the start of a mapping of memory allocated by
+// cuMemCreate. Returns false if it is not, in which case the memory is shared by a legacy CUDA IPC handle.
+//
+// Only the granularity-aligned part of the allocation covering [data, data + size) is shared, so that importers do not
+// map more than what is registered. The mapping is assumed to start at offset zero of the physical allocation, which
+// is the case for the allocations made by allocSharedPhysicalCuda() and friends.
+bool exportCuMem(TransportInfo& transportInfo, void* data, size_t size, void* baseDataPtr, size_t baseDataSize) {
+  CUmemGenericAllocationHandle memHandle;
+  if (cuMemRetainAllocationHandle(&memHandle, baseDataPtr) != CUDA_SUCCESS) {
+    return false;
+  }
+  try {
+    size_t offset = static_cast<char*>(data) - static_cast<char*>(baseDataPtr);
+    if (offset + size > baseDataSize) {
+      throw Error("Memory registered for CudaIpc spans multiple cuMem mappings", ErrorCode::InvalidUsage);
+    }
+    CUmemAllocationProp prop = {};
+    MSCCLPP_CUTHROW(cuMemGetAllocationPropertiesFromHandle(&prop, memHandle));
+    size_t gran;
+    MSCCLPP_CUTHROW(cuMemGetAllocationGranularity(&gran, &prop, CU_MEM_ALLOC_GRANULARITY_MINIMUM));
+    size_t mapEnd = std::min((offset + std::max<size_t>(size, 1) + gran - 1) / gran * gran, baseDataSize);
+    transportInfo.cuMemMapOffset = offset / gran * gran;
+    transportInfo.cuMemMapSize = mapEnd - transportInfo.cuMemMapOffset;
+    transportInfo.cuMemOffsetFromMap = offset - transportInfo.cuMemMapOffset;
+
+    int handleTypes = prop.MSCCLPP_REQUESTED_HANDLE_TYPES;
+    bool exported = false;
+#if USE_CUMEM_FABRIC_HANDLE
+    if (handleTypes & CU_MEM_HANDLE_TYPE_FABRIC) {
+      // Exporting a fabric handle fails if the IMEX daemon is not running, in which case we try a POSIX fd instead.
+      CUmemFabricHandle fabricHandle;
+      CUresult res = cuMemExportToShareableHandle(&fabricHandle, memHandle, CU_MEM_HANDLE_TYPE_FABRIC, 0 /*flags*/);
+      if (res == CUDA_SUCCESS) {
+        static_assert(sizeof(fabricHandle) == sizeof(transportInfo.cuMemFabricHandle), "Fabric handle size mismatch");
+        std::memcpy(transportInfo.cuMemFabricHandle, &fabricHandle, sizeof(fabricHandle));
+        transportInfo.cudaIpcHandleType = CudaIpcHandleType::Fabric;
+        exported = true;
+      } else {
+        INFO(MSCCLPP_P2P, "Failed to export a fabric handle for pointer %p (error %d), trying a POSIX fd", data, res);
+      }
+    }
+#endif
+    if (!exported && (handleTypes & CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR)) {
+      // The unused bytes of the handle are zeroed, since importers cache imports by all of its bytes.
+      std::memset(transportInfo.cuMemFabricHandle, 0, sizeof(transportInfo.cuMemFabricHandle));
+      transportInfo.cuMemPid = getpid();
+      transportInfo.cuMemFd = CuMemFdExports::instance().get(baseDataPtr, baseDataSize, memHandle);
+      transportInfo.cudaIpcHandleType = CudaIpcHandleType::PosixFd;
+      exported = true;
+    }
+    if (!exported) {
+      throw Error("Memory allocated by cuMemCreate without a shareable handle type cannot be registered for CudaIpc",
+                  ErrorCode::InvalidUsage);
+    }
+  } catch (...) {
+    cuMemRelease(memHandle);
+    throw;
+  }
+  MSCCLPP_CUTHROW(cuMemRelease(memHandle));
+  return true;
+}
+
+// Duplicates the file descriptor `fd` of the process `pid` into this process.
+int getPeerFd(pid_t pid, int fd) {
+#if defined(SYS_pidfd_open) && defined(SYS_pidfd_getfd)
+  int pidFd = syscall(SYS_pidfd_open, pid, 0);
+  if (pidFd < 0) {
+    throw SysError("pidfd_open() failed", errno);
+  }
+  int localFd = syscall(SYS_pidfd_getfd, pidFd, fd, 0);
+  int err = errno;
+  close(pidFd);
+  if (localFd < 0) {
+    throw SysError("pidfd_getfd() failed", err);
+  }
+  return localFd;
+#else
+  (void)pid;
+  (void)fd;
+  throw Error("Importing POSIX fd handles requires pidfd_getfd()", ErrorCode::InvalidUsage);
+#endif
+}
+
+// Imports the allocation shared by exportCuMem() and maps the shared range to the current device. Returns the start of
+// the mapped range.
+void* importCuMem(const TransportInfo& transportInfo) {
+  CUmemGenericAllocationHandle memHandle;
+  if (transportInfo.cudaIpcHandleType == CudaIpcHandleType::Fabric) {
+#if USE_CUMEM_FABRIC_HANDLE
+    MSCCLPP_CUTHROW(cuMemImportFromShareableHandle(&memHandle, const_cast<char*>(transportInfo.cuMemFabricHandle),
+                                                   CU_MEM_HANDLE_TYPE_FABRIC));
+#else
+    throw Error("Fabric handles are not supported by this build", ErrorCode::InvalidUsage);
+#endif
+  } else {
+    int fd = getPeerFd(transportInfo.cuMemPid, transportInfo.cuMemFd);
+    CUresult res = cuMemImportFromShareableHandle(&memHandle, reinterpret_cast<void*>(static_cast<uintptr_t>(fd)),
+                                                  CU_MEM_HANDLE_TYPE_POSIX_FILE_DESCRIPTOR);
+    close(fd);
+    if (res != CUDA_SUCCESS) {
+      throw CuError("Failed to import a POSIX fd handle", res);
+    }
+  }
+
+  void* ptr = nullptr;
+  bool mapped = false;
+  try {
+    int deviceId;
+    MSCCLPP_CUDATHROW(cudaGetDevice(&deviceId));
+    CUmemAllocationProp prop = {};
+    MSCCLPP_CUTHROW(cuMemGetAllocationPropertiesFromHandle(&prop, memHandle));
+    size_t gran;
+    MSCCLPP_CUTHROW(cuMemGetAllocationGranularity(&gran, &prop, CU_MEM_ALLOC_GRANULARITY_MINIMUM));
+    MSCCLPP_CUTHROW(cuMemAddressReserve((CUdeviceptr*)&ptr, transportInfo.cuMemMapSize, gran, 0U, 0));
+    MSCCLPP_CUTHROW(
+        cuMemMap((CUdeviceptr)ptr, transportInfo.cuMemMapSize, transportInfo.cuMemMapOffset, memHandle, 0 /*flags*/));
+    mapped = true;
+    CUmemAccessDesc accessDesc = {};
+    accessDesc.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+    accessDesc.location.id = deviceId;
+    accessDesc.flags = CU_MEM_ACCESS_FLAGS_PROT_READWRITE;
+    MSCCLPP_CUTHROW(cuMemSetAccess((CUdeviceptr)ptr, transportInfo.cuMemMapSize, &accessDesc, 1));
+  } catch (...) {
+    if (mapped) cuMemUnmap((CUdeviceptr)ptr, transportInfo.cuMemMapSize);
+    if (ptr) cuMemAddressFree((CUdeviceptr)ptr, transportInfo.cuMemMapSize);
+    cuMemRelease(memHandle);
+    throw;
+  }
+  // The mapping keeps the allocation alive until it is unmapped
+  MSCCLPP_CUTHROW(cuMemRelease(memHandle));
+  INFO(MSCCLPP_P2P, "Mapped %ld bytes of a cuMem allocation at pointer %p", transportInfo.cuMemMapSize, ptr);
+  return ptr;
+}
+
+void unmapCuMem(void* ptr, size_t size) {
+  CUresult res = cuMemUnmap((CUdeviceptr)ptr, size);
+  if (res == CUDA_SUCCESS) res = cuMemAddressFree((CUdeviceptr)ptr, size);
+  if (res != CUDA_SUCCESS) {
+    WARN("Failed to unmap the cuMem allocation at pointer %p (error %d)", ptr, res);
+  }
+}
+
+}  // namespace
+
 RegisteredMemory::Impl::Impl(void* data, size_t size, TransportFlags transports, Context::Impl& contextImpl)
     : data(data),
       originalDataPtr(data),
@@ -23,15 +338,18 @@ RegisteredMemory::Impl::Impl(void* data, size_t size, TransportFlags transports,
   if (transports.has(Transport::CudaIpc)) {
     TransportInfo transportInfo;
     transportInfo.transport = Transport::CudaIpc;
-    cudaIpcMemHandle_t handle;
 
     void* baseDataPtr;
-    size_t baseDataSize;  // dummy
+    size_t baseDataSize;
     MSCCLPP_CUTHROW(cuMemGetAddressRange((CUdeviceptr*)&baseDataPtr, &baseDataSize, (CUdeviceptr)data));
-    MSCCLPP_CUDATHROW(cudaIpcGetMemHandle(&handle, baseDataPtr));
-    // TODO: bug with offset of base?
-    transportInfo.cudaIpcBaseHandle = handle;
-    transportInfo.cudaIpcOffsetFromBase = (char*)data - (char*)baseDataPtr;
+    if (!exportCuMem(transportInfo, data, size, baseDataPtr, baseDataSize)) {
+      cudaIpcMemHandle_t handle;
+      MSCCLPP_CUDATHROW(cudaIpcGetMemHandle(&handle, baseDataPtr));
+      // TODO: bug with offset of base?
+      transportInfo.cudaIpcHandleType = CudaIpcHandleType::Legacy;
+      transportInfo.cudaIpcBaseHandle = handle;
+      transportInfo.cudaIpcOffsetFromBase = (char*)data - (char*)baseDataPtr;
+    }
     this->transportInfos.push_back(transportInfo);
   }
   if ((transports & AllIBTransports).any()) {
@@ -84,10 +402,23 @@ MSCCLPP_API_CPP std::vector<char> RegisteredMemory::serialize() {
   for (auto& entry : pimpl_->transportInfos) {
     std::copy_n(reinterpret_cast<char*>(&entry.transport), sizeof(entry.transport), std::back_inserter(result));
     if (entry.transport == Transport::CudaIpc) {
-      std::copy_n(reinterpret_cast<char*>(&entry.cudaIpcBaseHandle), sizeof(entry.cudaIpcBaseHandle),
-                  std::back_inserter(result));
-      std::copy_n(reinterpret_cast<char*>(&entry.cudaIpcOffsetFromBase), sizeof(entry.cudaIpcOffsetFromBase),
+      std::copy_n(reinterpret_cast<char*>(&entry.cudaIpcHandleType), sizeof(entry.cudaIpcHandleType),
                   std::back_inserter(result));
+      if (entry.cudaIpcHandleType == CudaIpcHandleType::Legacy) {
+        std::copy_n(reinterpret_cast<char*>(&entry.cudaIpcBaseHandle), sizeof(entry.cudaIpcBaseHandle),
+                    std::back_inserter(result));
+        std::copy_n(reinterpret_cast<char*>(&entry.cudaIpcOffsetFromBase), sizeof(entry.cudaIpcOffsetFromBase),
+                    std::back_inserter(result));
+      } else {
+        std::copy_n(reinterpret_cast<char*>(&entry.cuMemFabricHandle), sizeof(entry.cuMemFabricHandle),
+                    std::back_inserter(result));
+        std::copy_n(reinterpret_cast<char*>(&entry.cuMemMapOffset), sizeof(entry.cuMemMapOffset),
+                    std::back_inserter(result));
+        std::copy_n(reinterpret_cast<char*>(&entry.cuMemMapSize), sizeof(entry.cuMemMapSize),
+                    std::back_inserter(result));
+        std::copy_n(reinterpret_cast<char*>(&entry.cuMemOffsetFromMap), sizeof(entry.cuMemOffsetFromMap),
+                    std::back_inserter(result));
+      }
     } else if (AllIBTransports.has(entry.transport)) {
       std::copy_n(reinterpret_cast<char*>(&entry.ibMrInfo), sizeof(entry.ibMrInfo), std::back_inserter(result));
     } else {
@@ -121,12 +452,28 @@ RegisteredMemory::Impl::Impl(const std::vector<char>& serialization) {
     std::copy_n(it, sizeof(transportInfo.transport), reinterpret_cast<char*>(&transportInfo.transport));
     it += sizeof(transportInfo.transport);
     if (transportInfo.transport == Transport::CudaIpc) {
-      std::copy_n(it, sizeof(transportInfo.cudaIpcBaseHandle),
-                  reinterpret_cast<char*>(&transportInfo.cudaIpcBaseHandle));
-      it += sizeof(transportInfo.cudaIpcBaseHandle);
-      std::copy_n(it, sizeof(transportInfo.cudaIpcOffsetFromBase),
-                  reinterpret_cast<char*>(&transportInfo.cudaIpcOffsetFromBase));
-      it += sizeof(transportInfo.cudaIpcOffsetFromBase);
+      std::copy_n(it, sizeof(transportInfo.cudaIpcHandleType),
+                  reinterpret_cast<char*>(&transportInfo.cudaIpcHandleType));
+      it += sizeof(transportInfo.cudaIpcHandleType);
+      if (transportInfo.cudaIpcHandleType == CudaIpcHandleType::Legacy) {
+        std::copy_n(it, sizeof(transportInfo.cudaIpcBaseHandle),
+                    reinterpret_cast<char*>(&transportInfo.cudaIpcBaseHandle));
+        it += sizeof(transportInfo.cudaIpcBaseHandle);
+        std::copy_n(it, sizeof(transportInfo.cudaIpcOffsetFromBase),
+                    reinterpret_cast<char*>(&transportInfo.cudaIpcOffsetFromBase));
+        it += sizeof(transportInfo.cudaIpcOffsetFromBase);
+      } else {
+        std::copy_n(it, sizeof(transportInfo.cuMemFabricHandle),
+                    reinterpret_cast<char*>(&transportInfo.cuMemFabricHandle));
+        it += sizeof(transportInfo.cuMemFabricHandle);
+        std::copy_n(it, sizeof(transportInfo.cuMemMapOffset), reinterpret_cast<char*>(&transportInfo.cuMemMapOffset));
+        it += sizeof(transportInfo.cuMemMapOffset);
+        std::copy_n(it, sizeof(transportInfo.cuMemMapSize), reinterpret_cast<char*>(&transportInfo.cuMemMapSize));
+        it += sizeof(transportInfo.cuMemMapSize);
+        std::copy_n(it, sizeof(transportInfo.cuMemOffsetFromMap),
+                    reinterpret_cast<char*>(&transportInfo.cuMemOffsetFromMap));
+        it += sizeof(transportInfo.cuMemOffsetFromMap);
+      }
     } else if (AllIBTransports.has(transportInfo.transport)) {
       std::copy_n(it, sizeof(transportInfo.ibMrInfo), reinterpret_cast<char*>(&transportInfo.ibMrInfo));
       it += sizeof(transportInfo.ibMrInfo);
@@ -144,13 +491,43 @@ RegisteredMemory::Impl::Impl(const std::vector<char>& serialization) {
   if (getHostHash() == this->hostHash && getPidHash() == this->pidHash) {
     // The memory is local to the process, so originalDataPtr is valid as is
     this->data = this->originalDataPtr;
-  } else if (transports.has(Transport::CudaIpc) && getHostHash() == this->hostHash) {
+  } else if (transports.has(Transport::CudaIpc) && getHostHash() == this->hostHash &&
+             getTransportInfo(Transport::CudaIpc).cudaIpcHandleType == CudaIpcHandleType::Legacy) {
     // The memory is local to the machine but not to the process, so we need to open the CUDA IPC handle
     auto entry = getTransportInfo(Transport::CudaIpc);
-    void* base;
-    MSCCLPP_CUDATHROW(cudaIpcOpenMemHandle(&base, entry.cudaIpcBaseHandle, cudaIpcMemLazyEnablePeerAccess));
+    const cudaIpcMemHandle_t& handle = entry.cudaIpcBaseHandle;
+    void* base = CudaIpcImportCache::instance().acquire(
+        this->hostHash, this->pidHash, &handle, sizeof(handle), [&handle]() { return openCudaIpcHandle(handle); },
+        closeCudaIpcHandle);
     this->data = static_cast<char*>(base) + entry.cudaIpcOffsetFromBase;
-    INFO(MSCCLPP_P2P, "Opened CUDA IPC handle at pointer %p", this->data);
+  } else if (transports.has(Transport::CudaIpc) &&
+             (getHostHash() == this->hostHash ||
+              getTransportInfo(Transport::CudaIpc).cudaIpcHandleType == CudaIpcHandleType::Fabric)) {
+    // The memory is allocated by cuMemCreate, so we map the shared range of the allocation. Fabric handles may come
+    // from other machines of the same NVLink domain.
+    auto& entry = getTransportInfo(Transport::CudaIpc);
+    // The same range of an allocation is mapped once, however many times it is registered
+    struct {
+      char handle[sizeof(entry.cuMemFabricHandle)];
+      size_t mapOffset;
+      size_t mapSize;
+    } key;
+    std::memset(&key, 0, sizeof(key));
+    std::memcpy(key.handle, entry.cuMemFabricHandle, sizeof(key.handle));
+    key.mapOffset = entry.cuMemMapOffset;
+    key.mapSize = entry.cuMemMapSize;
+    size_t mapSize = entry.cuMemMapSize;
+    try {
+      this->cuMemMappedPtr = CudaIpcImportCache::instance().acquire(
+          this->hostHash, this->pidHash, &key, sizeof(key), [&entry]() { return importCuMem(entry); },
+          [mapSize](void* ptr) { unmapCuMem(ptr, mapSize); });
+      this->data = static_cast<char*>(this->cuMemMappedPtr) + entry.cuMemOffsetFromMap;
+    } catch (const BaseError& e) {
+      if (getHostHash() == this->hostHash) throw;
+      INFO(MSCCLPP_P2P, "Fabric handle of a remote machine is not importable, probably not in this NVLink domain: %s",
+           e.what());
+      this->data = nullptr;
+    }
   } else {
     // No valid data pointer can be set
     this->data = nullptr;
@@ -158,15 +535,15 @@ RegisteredMemory::Impl::Impl(const std::vector<char>& serialization) {
 }
 
 RegisteredMemory::Impl::~Impl() {
-  // Close the CUDA IPC handle if it was opened during deserialization
-  if (data && transports.has(Transport::CudaIpc) && getHostHash() == this->hostHash && getPidHash() != this->pidHash) {
+  // Release the CUDA IPC handle or the cuMem mapping if it was imported during deserialization
+  if (cuMemMappedPtr) {
+    CudaIpcImportCache::instance().release(cuMemMappedPtr);
+    cuMemMappedPtr = nullptr;
+    data = nullptr;
+  } else if (data && transports.has(Transport::CudaIpc) && getHostHash() == this->hostHash &&
+             getPidHash() != this->pidHash) {
     void* base = static_cast<char*>(data) - getTransportInfo(Transport::CudaIpc).cudaIpcOffsetFromBase;
-    cudaError_t err = cudaIpcCloseMemHandle(base);
-    if (err != cudaSuccess) {
-      WARN("Failed to close CUDA IPC handle at pointer %p: %s", base, cudaGetErrorString(err));
-    } else {
-      INFO(MSCCLPP_P2P, "Closed CUDA IPC handle at pointer %p", base);
-    }
+    CudaIpcImportCache::instance().release(base);
     data = nullptr;
   }
 }
@@ -3,38 +3,90 @@
 
 #include <mscclpp/semaphore.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <type_traits>
+
 #include "api.h"
 #include "atomic.hpp"
 #include "debug.h"
+#include "hang_detector_internal.hpp"
+#include "semaphore_pool.hpp"
+#include "utils_internal.hpp"
 
 namespace mscclpp {
 
-static NonblockingFuture<RegisteredMemory> setupInboundSemaphoreId(Communicator& communicator, Connection* connection,
-                                                                   void* localInboundSemaphoreId) {
-  auto localInboundSemaphoreIdsRegMem =
-      communicator.registerMemory(localInboundSemaphoreId, sizeof(uint64_t), connection->transport());
-  int remoteRank = communicator.remoteRankOf(*connection);
-  int tag = communicator.tagOf(*connection);
-  communicator.sendMemoryOnSetup(localInboundSemaphoreIdsRegMem, remoteRank, tag);
-  return communicator.recvMemoryOnSetup(remoteRank, tag);
+template <template <typename> typename InboundDeleter, template <typename> typename OutboundDeleter>
+void BaseSemaphore<InboundDeleter, OutboundDeleter>::allocateSemaphoreIds(Communicator& communicator,
+                                                                          std::shared_ptr<Connection> connection,
+                                                                          bool pairInbound) {
+  // The deleters tell where the IDs are
+  const bool inboundOnDevice = std::is_same<InboundDeleter<uint64_t>, CudaDeleter<uint64_t>>::value;
+  const bool outboundOnDevice = std::is_same<OutboundDeleter<uint64_t>, CudaDeleter<uint64_t>>::value;
+  SemaphorePool& pool = SemaphorePool::get(communicator);
+  if (pairInbound) {
+    // The locations of the IDs tell the kind of the semaphore
+    SemaphoreKind kind = !inboundOnDevice   ? SemaphoreKind::Host2Host
+                         : outboundOnDevice ? SemaphoreKind::SmDevice2Device
+                                            : SemaphoreKind::Host2Device;
+    PairedSemaphoreId inbound = pool.allocatePaired(communicator, connection, kind);
+    localInboundSemaphore_ = inbound.local;
+    remoteInboundSemaphoreIdsRegMem_ = inbound.remoteSlab;
+    remoteInboundSemaphoreIdOffset_ = inbound.remoteOffset;
+  } else {
+    localInboundSemaphore_ = pool.allocate(inboundOnDevice);
+  }
+  expectedInboundSemaphore_ = pool.allocate(inboundOnDevice);
+  outboundSemaphore_ = pool.allocate(outboundOnDevice);
+}
+
+template class BaseSemaphore<CudaDeleter, std::default_delete>;
+template class BaseSemaphore<std::default_delete, std::default_delete>;
+template class BaseSemaphore<CudaDeleter, CudaDeleter>;
+
+static std::shared_ptr<Connection> checkHost2HostConnection(std::shared_ptr<Connection> connection) {
+  if (connection->transport() == Transport::CudaIpc) {
+    throw Error("Host2HostSemaphore cannot be used with CudaIpc transport", ErrorCode::InvalidUsage);
+  }
+  return connection;
+}
+
+static std::shared_ptr<void> watchSemaphore(const std::string& name, int remoteRank, const uint64_t* inbound,
+                                            const uint64_t* expected, const uint64_t* outbound, bool inboundOnDevice,
+                                            bool outboundOnDevice) {
+  auto watched = [](const std::string& name, const uint64_t* ptr, bool onDevice) {
+    WatchedValue value;
+    value.name = name;
+    (onDevice ? value.devicePtr : value.hostPtr) = ptr;
+    return value;
+  };
+  WatchEntry entry;
+  entry.name = name;
+  entry.remoteRank = remoteRank;
+  entry.values = {watched("inbound", inbound, inboundOnDevice), watched("expected", expected, inboundOnDevice),
+                  watched("outbound", outbound, outboundOnDevice)};
+  // A waiting peer has incremented the expected ID beyond the inbound ID.
+  entry.isWaiting = [](const std::vector<uint64_t>& values) { return values[0] < values[1]; };
+  return registerWatchEntry(std::move(entry));
 }
 
 MSCCLPP_API_CPP Host2DeviceSemaphore::Host2DeviceSemaphore(Communicator& communicator,
                                                            std::shared_ptr<Connection> connection)
-    : BaseSemaphore(allocExtUniqueCuda<uint64_t>(), allocExtUniqueCuda<uint64_t>(), std::make_unique<uint64_t>()),
-      connection_(connection) {
+    : connection_(connection) {
+  allocateSemaphoreIds(communicator, connection, true);
   INFO(MSCCLPP_INIT, "Creating a Host2Device semaphore for %s transport from %d to %d",
        connection->getTransportName().c_str(), communicator.bootstrap()->getRank(),
        communicator.remoteRankOf(*connection));
-  remoteInboundSemaphoreIdsRegMem_ =
-      setupInboundSemaphoreId(communicator, connection.get(), localInboundSemaphore_.get());
+  hangDetectorEntry_ = watchSemaphore("Host2DeviceSemaphore", communicator.remoteRankOf(*connection),
+                                      localInboundSemaphore_.get(), expectedInboundSemaphore_.get(),
+                                      outboundSemaphore_.get(), true, false);
 }
 
 MSCCLPP_API_CPP std::shared_ptr<Connection> Host2DeviceSemaphore::connection() { return connection_; }
 
 MSCCLPP_API_CPP void Host2DeviceSemaphore::signal() {
-  connection_->updateAndSync(remoteInboundSemaphoreIdsRegMem_.get(), 0, outboundSemaphore_.get(),
-                             *outboundSemaphore_ + 1);
+  connection_->updateAndSync(remoteInboundSemaphoreIdsRegMem_.get(), remoteInboundSemaphoreIdOffset_,
+                             outboundSemaphore_.get(), *outboundSemaphore_ + 1);
 }
 
 MSCCLPP_API_CPP Host2DeviceSemaphore::DeviceHandle Host2DeviceSemaphore::deviceHandle() {
@@ -46,24 +98,21 @@ MSCCLPP_API_CPP Host2DeviceSemaphore::DeviceHandle Host2DeviceSemaphore::deviceH
 
 MSCCLPP_API_CPP Host2HostSemaphore::Host2HostSemaphore(Communicator& communicator,
                                                        std::shared_ptr<Connection> connection)
-    : BaseSemaphore(std::make_unique<uint64_t>(), std::make_unique<uint64_t>(), std::make_unique<uint64_t>()),
-      connection_(connection) {
+    : connection_(checkHost2HostConnection(connection)) {
+  allocateSemaphoreIds(communicator, connection, true);
   INFO(MSCCLPP_INIT, "Creating a Host2Host semaphore for %s transport from %d to %d",
        connection->getTransportName().c_str(), communicator.bootstrap()->getRank(),
        communicator.remoteRankOf(*connection));
-
-  if (connection->transport() == Transport::CudaIpc) {
-    throw Error("Host2HostSemaphore cannot be used with CudaIpc transport", ErrorCode::InvalidUsage);
-  }
-  remoteInboundSemaphoreIdsRegMem_ =
-      setupInboundSemaphoreId(communicator, connection.get(), localInboundSemaphore_.get());
+  hangDetectorEntry_ = watchSemaphore("Host2HostSemaphore", communicator.remoteRankOf(*connection),
+                                      localInboundSemaphore_.get(), expectedInboundSemaphore_.get(),
+                                      outboundSemaphore_.get(), false, false);
 }
 
 MSCCLPP_API_CPP std::shared_ptr<Connection> Host2HostSemaphore::connection() { return connection_; }
 
 MSCCLPP_API_CPP void Host2HostSemaphore::signal() {
-  connection_->updateAndSync(remoteInboundSemaphoreIdsRegMem_.get(), 0, outboundSemaphore_.get(),
-                             *outboundSemaphore_ + 1);
+  connection_->updateAndSync(remoteInboundSemaphoreIdsRegMem_.get(), remoteInboundSemaphoreIdOffset_,
+                             outboundSemaphore_.get(), *outboundSemaphore_ + 1);
 }
 
 MSCCLPP_API_CPP bool Host2HostSemaphore::poll() {
@@ -76,34 +125,73 @@ MSCCLPP_API_CPP bool Host2HostSemaphore::poll() {
 MSCCLPP_API_CPP void Host2HostSemaphore::wait(int64_t maxSpinCount) {
   (*expectedInboundSemaphore_) += 1;
   int64_t spinCount = 0;
-  while (atomicLoad((uint64_t*)localInboundSemaphore_.get(), memoryOrderAcquire) < (*expectedInboundSemaphore_)) {
+  while (atomicLoad(localInboundSemaphore_.get(), memoryOrderAcquire) < (*expectedInboundSemaphore_)) {
     if (maxSpinCount >= 0 && spinCount++ == maxSpinCount) {
       throw Error("Host2HostSemaphore::wait timed out", ErrorCode::Timeout);
     }
   }
 }
 
+MSCCLPP_API_CPP void Host2HostSemaphore::waitBlocking(int64_t timeoutUsec, int64_t spinUsec) {
+  // Polls in growing intervals up to this when nothing wakes up the waiter
+  constexpr int64_t MaxPollIntervalNs = 100000;
+  // Bounds a single block in case a wake-up is missed
+  constexpr int64_t MaxBlockNs = 10000000;
+
+  const uint64_t expected = ++(*expectedInboundSemaphore_);
+  auto inbound = [this]() { return atomicLoad(localInboundSemaphore_.get(), memoryOrderAcquire); };
+  if (inbound() >= expected) return;
+
+  auto start = std::chrono::steady_clock::now();
+  auto elapsedNs = [start]() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  };
+  do {
+    for (int i = 0; i < 64; ++i) {
+      if (inbound() >= expected) return;
+    }
+  } while (elapsedNs() < spinUsec * 1000);
+
+  const bool wokenUp = connection_->transport() == Transport::Ethernet;
+  FutexWaiter waiter(localInboundSemaphore_.get());
+  int64_t pollIntervalNs = 1000;
+  for (;;) {
+    uint64_t value = inbound();
+    if (value >= expected) return;
+    int64_t blockNs = wokenUp ? MaxBlockNs : pollIntervalNs;
+    pollIntervalNs = std::min(pollIntervalNs * 2, MaxPollIntervalNs);
+    if (timeoutUsec >= 0) {
+      int64_t remainingNs = timeoutUsec * 1000 - elapsedNs();
+      if (remainingNs <= 0) {
+        throw Error("Host2HostSemaphore::waitBlocking timed out", ErrorCode::Timeout);
+      }
+      blockNs = std::min(blockNs, remainingNs);
+    }
+    // The futex word is the lower half of the inbound ID, which changes on every signal (little-endian only).
+    futexWait(localInboundSemaphore_.get(), static_cast<uint32_t>(value), blockNs);
+  }
+}
+
 MSCCLPP_API_CPP SmDevice2DeviceSemaphore::SmDevice2DeviceSemaphore(Communicator& communicator,
                                                                    std::shared_ptr<Connection> connection)
-    : BaseSemaphore(allocExtUniqueCuda<uint64_t>(), allocExtUniqueCuda<uint64_t>(), allocExtUniqueCuda<uint64_t>()) {
+    // Only CudaIpc needs the remote inbound semaphore ID, since signals over the other transports go through the proxy
+    : isRemoteInboundSemaphoreIdSet_(connection->transport() == Transport::CudaIpc) {
+  allocateSemaphoreIds(communicator, connection, isRemoteInboundSemaphoreIdSet_);
   INFO(MSCCLPP_INIT, "Creating a Device2Device semaphore for %s transport from %d to %d",
        connection->getTransportName().c_str(), communicator.bootstrap()->getRank(),
        communicator.remoteRankOf(*connection));
-  if (connection->transport() == Transport::CudaIpc) {
-    remoteInboundSemaphoreIdsRegMem_ =
-        setupInboundSemaphoreId(communicator, connection.get(), localInboundSemaphore_.get());
-    isRemoteInboundSemaphoreIdSet_ = true;
-  } else if (AllIBTransports.has(connection->transport())) {
-    // We don't need to really with any of the IB transports, since the values will be local
-    isRemoteInboundSemaphoreIdSet_ = false;
-  }
+  hangDetectorEntry_ = watchSemaphore("SmDevice2DeviceSemaphore", communicator.remoteRankOf(*connection),
+                                      localInboundSemaphore_.get(), expectedInboundSemaphore_.get(),
+                                      outboundSemaphore_.get(), true, true);
 }
 
 MSCCLPP_API_CPP SmDevice2DeviceSemaphore::DeviceHandle SmDevice2DeviceSemaphore::deviceHandle() const {
   SmDevice2DeviceSemaphore::DeviceHandle device;
-  device.remoteInboundSemaphoreId = isRemoteInboundSemaphoreIdSet_
-                                        ? reinterpret_cast<uint64_t*>(remoteInboundSemaphoreIdsRegMem_.get().data())
-                                        : nullptr;
+  device.remoteInboundSemaphoreId =
+      isRemoteInboundSemaphoreIdSet_
+          ? reinterpret_cast<uint64_t*>(static_cast<char*>(remoteInboundSemaphoreIdsRegMem_.get().data()) +
+                                        remoteInboundSemaphoreIdOffset_)
+          : nullptr;
   device.inboundSemaphoreId = localInboundSemaphore_.get();
   device.expectedInboundSemaphoreId = expectedInboundSemaphore_.get();
   device.outboundSemaphoreId = outboundSemaphore_.get();
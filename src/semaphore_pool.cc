@@ -0,0 +1,179 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "semaphore_pool.hpp"
+
+#include <algorithm>
+#include <future>
+#include <mscclpp/gpu_utils.hpp>
+
+#include "communicator.hpp"
+#include "debug.h"
+
+namespace mscclpp {
+
+static bool isOnDevice(SemaphoreKind kind) { return kind != SemaphoreKind::Host2Host; }
+
+static bool hasGpu() {
+  static const bool result = []() {
+    int count = 0;
+    if (cudaGetDeviceCount(&count) != cudaSuccess) {
+      (void)cudaGetLastError();
+      return false;
+    }
+    return count > 0;
+  }();
+  return result;
+}
+
+static NonblockingFuture<RegisteredMemory> readyFuture(RegisteredMemory memory) {
+  std::promise<RegisteredMemory> promise;
+  promise.set_value(std::move(memory));
+  return NonblockingFuture<RegisteredMemory>(promise.get_future().share());
+}
+
+SemaphorePool& SemaphorePool::get(Communicator& communicator) { return communicator.pimpl_->semaphorePool_; }
+
+SemaphorePool::Slab SemaphorePool::newSlab(bool onDevice, size_t numSlabs) {
+  Slab slab;
+  if (onDevice) {
+    slab.ids = allocExtSharedCuda<uint64_t>(numSlabs * SlabSize);
+  } else {
+    slab.ids = std::shared_ptr<uint64_t>(new uint64_t[numSlabs * SlabSize](), std::default_delete<uint64_t[]>());
+  }
+  slab.used = 0;
+  return slab;
+}
+
+SemaphorePool::Slab SemaphorePool::carveSlab(Context& context, bool onDevice, Transport transport,
+                                             RegisteredMemory& arenaMemory, uint64_t& offset) {
+  std::shared_ptr<Arena>& arena = onDevice ? deviceArena_ : hostArena_;
+  if (!arena || arena->used == ArenaSlabs) {
+    arena = std::make_shared<Arena>();
+    arena->ids = newSlab(onDevice, ArenaSlabs).ids;
+  }
+  auto it = arena->registrations.find(transport);
+  if (it == arena->registrations.end()) {
+    RegisteredMemory memory =
+        context.registerMemory(arena->ids.get(), ArenaSlabs * SlabSize * sizeof(uint64_t), transport);
+    it = arena->registrations.emplace(transport, memory).first;
+  }
+  arenaMemory = it->second;
+  offset = arena->used * SlabSize * sizeof(uint64_t);
+  Slab slab;
+  // The slab keeps the whole arena alive, including the registrations the peer writes through.
+  slab.ids = std::shared_ptr<uint64_t>(arena, arena->ids.get() + arena->used * SlabSize);
+  slab.used = 0;
+  arena->used++;
+  return slab;
+}
+
+std::vector<char> SemaphorePool::prepareConnection(Context& context, Transport transport, InitialSlabs& slabs) {
+  // Host2HostSemaphore cannot use CudaIpc, and SmDevice2DeviceSemaphore only pairs over CudaIpc. A process without a
+  // GPU, which can only use host semaphores, skips the Host2Device slab and the peer exchanges one on first use.
+  std::vector<SemaphoreKind> kinds;
+  if (transport == Transport::CudaIpc) {
+    kinds = {SemaphoreKind::Host2Device, SemaphoreKind::SmDevice2Device};
+  } else {
+    if (hasGpu()) kinds.push_back(SemaphoreKind::Host2Device);
+    kinds.push_back(SemaphoreKind::Host2Host);
+  }
+
+  std::vector<char> data;
+  for (SemaphoreKind kind : kinds) {
+    RegisteredMemory arenaMemory;
+    uint64_t offset;
+    slabs[kind] = carveSlab(context, isOnDevice(kind), transport, arenaMemory, offset);
+    std::vector<char> serialized = arenaMemory.serialize();
+    uint64_t size = serialized.size();
+    std::copy_n(reinterpret_cast<char*>(&kind), sizeof(kind), std::back_inserter(data));
+    std::copy_n(reinterpret_cast<char*>(&offset), sizeof(offset), std::back_inserter(data));
+    std::copy_n(reinterpret_cast<char*>(&size), sizeof(size), std::back_inserter(data));
+    std::copy(serialized.begin(), serialized.end(), std::back_inserter(data));
+  }
+  return data;
+}
+
+void SemaphorePool::dropExpiredConnectionSlabs() {
+  if (connectionSlabs_.size() < 2 * connectionSlabsAfterDrop_) return;
+  for (auto it = connectionSlabs_.begin(); it != connectionSlabs_.end();) {
+    it = it->second.connection.expired() ? connectionSlabs_.erase(it) : std::next(it);
+  }
+  connectionSlabsAfterDrop_ = std::max<size_t>(connectionSlabs_.size(), 1);
+}
+
+void SemaphorePool::addConnection(std::shared_ptr<Connection> connection, const InitialSlabs& slabs,
+                                  const std::vector<char>& remoteData) {
+  dropExpiredConnectionSlabs();
+  // The arenas of the peer along with the offsets of the slabs in them.
+  std::map<SemaphoreKind, std::pair<RegisteredMemory, uint64_t>> remoteSlabs;
+  auto it = remoteData.begin();
+  while (it != remoteData.end()) {
+    SemaphoreKind kind;
+    uint64_t offset;
+    uint64_t size;
+    if (static_cast<size_t>(remoteData.end() - it) < sizeof(kind) + sizeof(offset) + sizeof(size)) {
+      throw Error("Invalid semaphore slab data", ErrorCode::InternalError);
+    }
+    std::copy_n(it, sizeof(kind), reinterpret_cast<char*>(&kind));
+    it += sizeof(kind);
+    std::copy_n(it, sizeof(offset), reinterpret_cast<char*>(&offset));
+    it += sizeof(offset);
+    std::copy_n(it, sizeof(size), reinterpret_cast<char*>(&size));
+    it += sizeof(size);
+    if (static_cast<uint64_t>(remoteData.end() - it) < size) {
+      throw Error("Invalid semaphore slab data", ErrorCode::InternalError);
+    }
+    remoteSlabs.emplace(kind, std::make_pair(RegisteredMemory::deserialize(std::vector<char>(it, it + size)), offset));
+    it += size;
+  }
+  for (auto& [kind, slab] : slabs) {
+    ConnectionSlab& entry = connectionSlabs_[{connection.get(), kind}];
+    entry = ConnectionSlab();
+    entry.connection = connection;
+    auto remoteIt = remoteSlabs.find(kind);
+    if (remoteIt != remoteSlabs.end()) {
+      entry.slab = slab;
+      entry.remoteSlab = readyFuture(remoteIt->second.first);
+      entry.remoteSlabOffset = remoteIt->second.second;
+    }
+  }
+}
+
+std::shared_ptr<uint64_t> SemaphorePool::allocate(bool onDevice) {
+  Slab& slab = onDevice ? deviceSlab_ : hostSlab_;
+  if (slab.full()) {
+    slab = newSlab(onDevice);
+  }
+  return slab.next();
+}
+
+PairedSemaphoreId SemaphorePool::allocatePaired(Communicator& communicator, std::shared_ptr<Connection> connection,
+                                                SemaphoreKind kind) {
+  dropExpiredConnectionSlabs();
+  ConnectionSlab& entry = connectionSlabs_[{connection.get(), kind}];
+  if (entry.connection.lock() != connection) {
+    // A connection without initial slabs, possibly reusing the address of a destroyed one
+    entry = ConnectionSlab();
+    entry.connection = connection;
+  }
+  if (entry.slab.full()) {
+    entry.slab = newSlab(isOnDevice(kind));
+    entry.remoteSlabOffset = 0;
+    int remoteRank = communicator.remoteRankOf(*connection);
+    int tag = communicator.tagOf(*connection);
+    auto localSlab =
+        communicator.registerMemory(entry.slab.ids.get(), SlabSize * sizeof(uint64_t), connection->transport());
+    communicator.sendMemoryOnSetup(localSlab, remoteRank, tag);
+    entry.remoteSlab = communicator.recvMemoryOnSetup(remoteRank, tag);
+    INFO(MSCCLPP_INIT, "Allocated a semaphore slab for %s transport from %d to %d",
+         connection->getTransportName().c_str(), communicator.bootstrap()->getRank(), remoteRank);
+  }
+  PairedSemaphoreId id;
+  id.remoteOffset = entry.remoteSlabOffset + entry.slab.used * sizeof(uint64_t);
+  id.local = entry.slab.next();
+  id.remoteSlab = entry.remoteSlab;
+  return id;
+}
+
+}  // namespace mscclpp
@@ -3,13 +3,21 @@
 
 #include "utils_internal.hpp"
 
+#include <linux/futex.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <cerrno>
+#include <climits>
 #include <cstring>
+#include <ctime>
 #include <fstream>
 #include <memory>
 #include <mscclpp/errors.hpp>
+#include <mutex>
 #include <string>
+#include <unordered_set>
 
 #include "debug.h"
 
@@ -190,4 +198,43 @@ void getRandomData(void* buffer, size_t bytes) {
   }
 }
 
+void futexWait(const void* addr, uint32_t value, int64_t timeoutNs) {
+  struct timespec timeout;
+  timeout.tv_sec = timeoutNs / 1000000000;
+  timeout.tv_nsec = timeoutNs % 1000000000;
+  long ret = syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, timeoutNs < 0 ? nullptr : &timeout, nullptr, 0);
+  if (ret != 0 && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT) {
+    throw SysError("futex wait failed", errno);
+  }
+}
+
+void futexWakeAll(const void* addr) { syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0); }
+
+// Addresses marked by FutexWaiter objects. `numFutexWaiters` lets futexWakeWaiters() skip the lock when it is zero.
+static std::mutex futexWaitersMutex;
+static std::unordered_multiset<const void*> futexWaiters;
+static std::atomic<int> numFutexWaiters{0};
+
+FutexWaiter::FutexWaiter(const void* addr) : addr(addr) {
+  std::lock_guard<std::mutex> lock(futexWaitersMutex);
+  futexWaiters.insert(addr);
+  numFutexWaiters.fetch_add(1);
+  // Pairs with the fence of futexWakeWaiters(), so that the word is read after the waiter is visible.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+FutexWaiter::~FutexWaiter() {
+  std::lock_guard<std::mutex> lock(futexWaitersMutex);
+  futexWaiters.erase(futexWaiters.find(addr));
+  numFutexWaiters.fetch_sub(1);
+}
+
+void futexWakeWaiters(const void* addr) {
+  // Orders the update of the word before the check, so that a waiter that was not seen has yet to read the word.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (numFutexWaiters.load() == 0) return;
+  std::lock_guard<std::mutex> lock(futexWaitersMutex);
+  if (futexWaiters.count(addr) > 0) futexWakeAll(addr);
+}
+
 }  // namespace mscclpp
@@ -6,6 +6,7 @@
 #include <mscclpp/gpu_utils.hpp>
 #include <mscclpp/numa.hpp>
 #include <mscclpp/proxy.hpp>
+#include <mscclpp/proxy_channel.hpp>
 #include <mscclpp/semaphore.hpp>
 
 #ifdef MSCCLPP_USE_MPI_FOR_TESTS
@@ -78,7 +79,7 @@ void initializeAndAllocateAllGatherData(int rank, int world_size, size_t dataSiz
   MSCCLPP_CUDATHROW(cudaMemcpy(*data_d, *data_h, dataSize, cudaMemcpyHostToDevice));
 }
 
-class MyProxyService {
+class MyProxyService : public mscclpp::ProxyEngine<MyProxyService> {
  private:
   int dataSize_;
   std::vector<mscclpp::RegisteredMemory> remoteMemories_;
@@ -87,15 +88,11 @@ class MyProxyService {
   std::vector<std::shared_ptr<mscclpp::Host2DeviceSemaphore>> deviceSemaphores1_;
   std::vector<std::shared_ptr<mscclpp::Host2DeviceSemaphore>> deviceSemaphores2_;
   std::vector<std::shared_ptr<mscclpp::Connection>> connections_;
-  mscclpp::Proxy proxy_;
   int deviceNumaNode_;
 
  public:
   MyProxyService(mscclpp::Communicator& comm, int* data_d, int dataSize)
-      : dataSize_(dataSize),
-        remoteMemories_(world_size),
-        connections_(world_size),
-        proxy_([&](mscclpp::ProxyTrigger triggerRaw) { return handleTrigger(triggerRaw); }, [&]() { bindThread(); }) {
+      : dataSize_(dataSize), remoteMemories_(world_size), connections_(world_size) {
     int cudaDevice;
     MSCCLPP_CUDATHROW(cudaGetDevice(&cudaDevice));
     deviceNumaNode_ = mscclpp::getDeviceNumaNode(cudaDevice);
@@ -148,7 +145,9 @@ class MyProxyService {
     comm.setup();
   }
 
-  void bindThread() {
+  ~MyProxyService() { stopProxy(); }
+
+  void threadInit() {
     if (deviceNumaNode_ >= 0) {
       mscclpp::numaBind(deviceNumaNode_);
     }
@@ -176,11 +175,11 @@ class MyProxyService {
     return mscclpp::ProxyHandlerResult::FlushFifoTailAndContinue;
   }
 
-  void start() { proxy_.start(); }
+  void start() { startProxy(); }
 
-  void stop() { proxy_.stop(); }
+  void stop() { stopProxy(); }
 
-  mscclpp::Fifo& fifo() { return proxy_.fifo(); }
+  mscclpp::Fifo& fifo() { return proxy_->fifo(); }
 
   mscclpp::Host2DeviceSemaphore::DeviceHandle getDeviceHandle1(int r) { return deviceSemaphores1_[r]->deviceHandle(); }
 
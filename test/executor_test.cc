@@ -127,7 +127,7 @@ int main(int argc, char* argv[]) {
   std::shared_ptr<mscclpp::Executor> executor = std::make_shared<mscclpp::Executor>(communicator);
 
   if (npkitDumpDir != nullptr) {
-    NpKit::Init(rank);
+    NpKit::Init(rank, bootstrap);
   }
 
   mscclpp::ExecutionPlan plan(executionPlanName, executionPlanPath);
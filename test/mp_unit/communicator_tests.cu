@@ -1,13 +1,22 @@
 // Copyright (c) Microsoft Corporation.
 // Licensed under the MIT license.
 
+#include <dirent.h>
 #include <mpi.h>
+#include <unistd.h>
 
+#include <cstring>
 #include <mscclpp/gpu_utils.hpp>
+#include <mscclpp/metrics.hpp>
 #include <mscclpp/semaphore.hpp>
 
+#include "connection.hpp"
 #include "mp_unit_tests.hpp"
 
+#if defined(USE_IBVERBS)
+#include <infiniband/verbs.h>
+#endif  // defined(USE_IBVERBS)
+
 void CommunicatorTestBase::SetUp() {
   MultiProcessTest::SetUp();
 
@@ -283,4 +292,241 @@ TEST_F(CommunicatorTest, WriteWithHostSemaphores) {
 
   ASSERT_TRUE(testWriteCorrectness());
   communicator->bootstrap()->barrier();
-}
\ No newline at end of file
+}
+
+TEST_F(CommunicatorTest, CudaIpcImportCache) {
+  if (gEnv->rank >= numRanksToUse) return;
+
+  std::vector<int> localPeers;
+  for (int i = 0; i < gEnv->worldSize; i++) {
+    if (i != gEnv->rank && rankToNode(i) == rankToNode(gEnv->rank)) localPeers.push_back(i);
+  }
+  auto hits = mscclpp::MetricsRegistry::global().counter("mscclpp_cuda_ipc_import_cache_hits_total", "");
+  uint64_t hitsBefore = hits->value();
+
+  // Two registrations carved out of the same allocation share one import on the peers.
+  const size_t offset = deviceBufferSize / 2;
+  char* base = reinterpret_cast<char*>(devicePtr[0].get());
+  mscclpp::RegisteredMemory localFirst, localSecond;
+  std::unordered_map<int, mscclpp::RegisteredMemory> remoteFirst, remoteSecond;
+  registerMemoryPairs(base, offset, mscclpp::Transport::CudaIpc, 1, localPeers, localFirst, remoteFirst);
+  registerMemoryPairs(base + offset, offset, mscclpp::Transport::CudaIpc, 2, localPeers, localSecond, remoteSecond);
+  for (int peer : localPeers) {
+    // The buffers registered in SetUp() already imported this allocation.
+    EXPECT_EQ(remoteFirst[peer].data(), remoteMemory[0].at(peer).data());
+    EXPECT_EQ(static_cast<char*>(remoteSecond[peer].data()), static_cast<char*>(remoteFirst[peer].data()) + offset);
+  }
+  EXPECT_EQ(hits->value() - hitsBefore, 2 * localPeers.size());
+  communicator->bootstrap()->barrier();
+}
+
+TEST_F(CommunicatorTest, CuMemSharing) {
+  if (gEnv->rank >= numRanksToUse) return;
+
+  std::vector<int> localPeers;
+  for (int i = 0; i < gEnv->worldSize; i++) {
+    if (i != gEnv->rank && rankToNode(i) == rankToNode(gEnv->rank)) localPeers.push_back(i);
+  }
+
+  int deviceId;
+  MSCCLPP_CUDATHROW(cudaGetDevice(&deviceId));
+  CUmemAllocationProp prop = {};
+  prop.type = CU_MEM_ALLOCATION_TYPE_PINNED;
+  prop.location.type = CU_MEM_LOCATION_TYPE_DEVICE;
+  prop.location.id = deviceId;
+  size_t gran;
+  MSCCLPP_CUTHROW(cuMemGetAllocationGranularity(&gran, &prop, CU_MEM_ALLOC_GRANULARITY_MINIMUM));
+
+  // Register a sub-range that straddles a granularity boundary of a cuMem allocation.
+  const size_t count = 1024;
+  auto mem = mscclpp::allocSharedPhysicalCuda<int>(4 * gran / sizeof(int), gran);
+  int* buff = mem->devicePtr_ + gran / sizeof(int) - count / 2;
+  std::vector<int> hostBuff(count, gEnv->rank);
+  mscclpp::memcpyCuda<int>(buff, hostBuff.data(), count, cudaMemcpyHostToDevice);
+
+  mscclpp::RegisteredMemory localMem;
+  std::unordered_map<int, mscclpp::RegisteredMemory> remoteMems;
+  registerMemoryPairs(buff, count * sizeof(int), mscclpp::Transport::CudaIpc, 1, localPeers, localMem, remoteMems);
+  for (int peer : localPeers) {
+    ASSERT_NE(remoteMems[peer].data(), nullptr);
+    mscclpp::memcpyCuda<int>(hostBuff.data(), static_cast<int*>(remoteMems[peer].data()), count,
+                             cudaMemcpyDeviceToHost);
+    for (size_t i = 0; i < count; i++) {
+      ASSERT_EQ(hostBuff[i], peer);
+    }
+  }
+
+  // Registering the range again after the first local registration is gone exports the same fd, so the peers reuse
+  // their mapping.
+  localMem = mscclpp::RegisteredMemory();
+  mscclpp::RegisteredMemory localAgain;
+  std::unordered_map<int, mscclpp::RegisteredMemory> remoteAgain;
+  registerMemoryPairs(buff, count * sizeof(int), mscclpp::Transport::CudaIpc, 2, localPeers, localAgain, remoteAgain);
+  for (int peer : localPeers) {
+    EXPECT_EQ(remoteAgain[peer].data(), remoteMems[peer].data());
+  }
+  communicator->bootstrap()->barrier();
+}
+
+TEST_F(CommunicatorTest, SemaphoreSlabs) {
+  if (gEnv->rank >= numRanksToUse) return;
+
+  // Semaphores on the same connection get consecutive remote inbound IDs within a slab, across more than one slab.
+  const int numSemaphores = 1000;
+  std::unordered_map<int, std::vector<std::shared_ptr<mscclpp::SmDevice2DeviceSemaphore>>> semaphores;
+  for (auto& [peer, connection] : connections) {
+    if (connection->transport() != mscclpp::Transport::CudaIpc) continue;
+    for (int i = 0; i < numSemaphores; i++) {
+      semaphores[peer].push_back(std::make_shared<mscclpp::SmDevice2DeviceSemaphore>(*communicator, connection));
+    }
+  }
+  communicator->setup();
+  for (auto& [peer, peerSemaphores] : semaphores) {
+    for (int i = 1; i < numSemaphores; i++) {
+      auto prev = peerSemaphores[i - 1]->deviceHandle();
+      auto curr = peerSemaphores[i]->deviceHandle();
+      EXPECT_NE(curr.remoteInboundSemaphoreId, prev.remoteInboundSemaphoreId);
+      if (i % 512 != 0) {
+        EXPECT_EQ(curr.remoteInboundSemaphoreId, prev.remoteInboundSemaphoreId + 1);
+        EXPECT_EQ(curr.inboundSemaphoreId, prev.inboundSemaphoreId + 1);
+      }
+    }
+  }
+  communicator->bootstrap()->barrier();
+}
+
+TEST_F(CommunicatorTest, OneSidedHostSemaphores) {
+  if (gEnv->rank >= numRanksToUse) return;
+
+  // Lower ranks construct an extra semaphore that has no counterpart on the higher ranks.
+  std::unordered_map<int, std::vector<std::shared_ptr<mscclpp::Host2HostSemaphore>>> semaphores;
+  for (auto& [peer, connection] : connections) {
+    if (connection->transport() == mscclpp::Transport::CudaIpc) continue;
+    int numSemaphores = gEnv->rank < peer ? 2 : 1;
+    for (int i = 0; i < numSemaphores; i++) {
+      semaphores[peer].push_back(std::make_shared<mscclpp::Host2HostSemaphore>(*communicator, connection));
+    }
+  }
+  communicator->setup();
+
+  for (auto& [peer, peerSemaphores] : semaphores) {
+    if (gEnv->rank < peer) {
+      peerSemaphores[0]->signal();
+      peerSemaphores[1]->signal();
+    } else {
+      peerSemaphores[0]->wait();
+    }
+  }
+  communicator->bootstrap()->barrier();
+}
+
+// Returns the number of sockets open in this process.
+static int countSockets() {
+  int count = 0;
+  DIR* dir = opendir("/proc/self/fd");
+  if (dir == nullptr) return -1;
+  char target[64];
+  for (dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+    std::string path = std::string("/proc/self/fd/") + entry->d_name;
+    ssize_t len = readlink(path.c_str(), target, sizeof(target) - 1);
+    if (len > 0 && strncmp(target, "socket:", strlen("socket:")) == 0) count++;
+  }
+  closedir(dir);
+  return count;
+}
+
+TEST_F(CommunicatorTest, LazyEthernetConnections) {
+  if (gEnv->rank >= numRanksToUse) return;
+
+  // Two lazy connections per peer, of which the second is used only after the first.
+  mscclpp::EndpointConfig config(mscclpp::Transport::Ethernet);
+  config.lazy = true;
+  std::unordered_map<int, mscclpp::NonblockingFuture<std::shared_ptr<mscclpp::Connection>>> usedFutures, idleFutures;
+  for (int peer = 0; peer < numRanksToUse; peer++) {
+    if (peer == gEnv->rank) continue;
+    usedFutures[peer] = communicator->connectOnSetup(peer, 1, config);
+    idleFutures[peer] = communicator->connectOnSetup(peer, 2, config);
+  }
+  communicator->setup();
+
+  // Exchanging the semaphores opens the bootstrap sockets of both tags, so only the connections open sockets later.
+  std::unordered_map<int, std::shared_ptr<mscclpp::Host2HostSemaphore>> usedSemaphores, idleSemaphores;
+  for (auto& [peer, future] : usedFutures) {
+    usedSemaphores[peer] = std::make_shared<mscclpp::Host2HostSemaphore>(*communicator, future.get());
+    idleSemaphores[peer] = std::make_shared<mscclpp::Host2HostSemaphore>(*communicator, idleFutures[peer].get());
+  }
+  communicator->setup();
+
+  for (auto& [peer, semaphore] : usedSemaphores) {
+    semaphore->signal();
+  }
+  for (auto& [peer, semaphore] : usedSemaphores) {
+    semaphore->waitBlocking();
+  }
+  communicator->bootstrap()->barrier();
+  int sockets = countSockets();
+  ASSERT_GE(sockets, 0);
+
+  // The first use of an idle connection connects its sending socket, and the peer accepts its receiving socket.
+  for (auto& [peer, semaphore] : idleSemaphores) {
+    semaphore->signal();
+  }
+  for (auto& [peer, semaphore] : idleSemaphores) {
+    semaphore->waitBlocking();
+  }
+  communicator->bootstrap()->barrier();
+  EXPECT_EQ(countSockets() - sockets, 2 * (numRanksToUse - 1));
+  communicator->bootstrap()->barrier();
+}
+
+TEST_F(CommunicatorTest, LazyIbConnections) {
+  if (gEnv->rank >= numRanksToUse) return;
+#if defined(USE_IBVERBS)
+  mscclpp::EndpointConfig config(ibTransport);
+  config.lazy = true;
+  std::unordered_map<int, mscclpp::NonblockingFuture<std::shared_ptr<mscclpp::Connection>>> usedFutures, idleFutures;
+  for (int peer = 0; peer < numRanksToUse; peer++) {
+    if (peer == gEnv->rank) continue;
+    usedFutures[peer] = communicator->connectOnSetup(peer, 1, config);
+    idleFutures[peer] = communicator->connectOnSetup(peer, 2, config);
+  }
+  communicator->setup();
+
+  auto qpState = [](const std::shared_ptr<mscclpp::Connection>& connection) {
+    return dynamic_cast<mscclpp::IBConnection&>(*connection).getQp()->getState();
+  };
+  // The QPs of lazy connections are ready to receive but not to send.
+  std::unordered_map<int, std::shared_ptr<mscclpp::Host2HostSemaphore>> usedSemaphores, idleSemaphores;
+  for (auto& [peer, future] : usedFutures) {
+    EXPECT_EQ(qpState(future.get()), IBV_QPS_RTR);
+    EXPECT_EQ(qpState(idleFutures[peer].get()), IBV_QPS_RTR);
+    usedSemaphores[peer] = std::make_shared<mscclpp::Host2HostSemaphore>(*communicator, future.get());
+    idleSemaphores[peer] = std::make_shared<mscclpp::Host2HostSemaphore>(*communicator, idleFutures[peer].get());
+  }
+  communicator->setup();
+
+  for (auto& [peer, semaphore] : usedSemaphores) {
+    semaphore->signal();
+  }
+  for (auto& [peer, semaphore] : usedSemaphores) {
+    semaphore->waitBlocking();
+  }
+  // Only the lower rank of each pair signals over the idle connection, so the higher rank receives at RTR.
+  for (auto& [peer, semaphore] : idleSemaphores) {
+    if (gEnv->rank < peer) {
+      semaphore->signal();
+    } else {
+      semaphore->waitBlocking();
+    }
+  }
+  communicator->bootstrap()->barrier();
+
+  for (auto& [peer, future] : usedFutures) {
+    EXPECT_EQ(qpState(future.get()), IBV_QPS_RTS);
+    EXPECT_EQ(qpState(idleFutures[peer].get()), gEnv->rank < peer ? IBV_QPS_RTS : IBV_QPS_RTR);
+  }
+  communicator->bootstrap()->barrier();
+#else   // !defined(USE_IBVERBS)
+  GTEST_SKIP() << "This test requires IB";
+#endif  // !defined(USE_IBVERBS)
+}
@@ -33,7 +33,7 @@ void ExecutorTest::SetUp() {
   executor = std::make_shared<mscclpp::Executor>(communicator);
   npkitDumpDir = getenv("NPKIT_DUMP_DIR");
   if (npkitDumpDir != nullptr) {
-    NpKit::Init(gEnv->rank);
+    NpKit::Init(gEnv->rank, bootstrap);
   }
 }
 
@@ -63,3 +63,38 @@ TEST_F(ExecutorTest, TwoNodesAllreduce) {
                     plan, stream);
   MSCCLPP_CUDATHROW(cudaStreamSynchronize(stream));
 }
+
+TEST_F(ExecutorTest, Profiling) {
+  if (gEnv->worldSize != 2 || gEnv->nRanksPerNode != 2) {
+    GTEST_SKIP() << "This test requires world size to be 2 and ranks per node to be 2";
+    return;
+  }
+  std::filesystem::path path = getExecutablePath();
+  std::filesystem::path executionFilesPath =
+      path.parent_path().parent_path().parent_path() / "test/execution-files/allreduce.json";
+  mscclpp::ExecutionPlan plan("allreduce_pairs", executionFilesPath.string());
+  const int bufferSize = 1024 * 1024;
+  const int nIters = 4;
+  std::shared_ptr<char> sendbuff = mscclpp::allocExtSharedCuda<char>(bufferSize);
+  mscclpp::CudaStreamWithFlags stream(cudaStreamNonBlocking);
+  executor->setProfiling(true);
+  for (int i = 0; i < nIters; i++) {
+    executor->execute(gEnv->rank, sendbuff.get(), sendbuff.get(), bufferSize, bufferSize, mscclpp::DataType::FLOAT16,
+                      plan, stream);
+  }
+  MSCCLPP_CUDATHROW(cudaStreamSynchronize(stream));
+
+  std::vector<mscclpp::ExecutionProfile> profiles = executor->getProfiles();
+  ASSERT_EQ(profiles.size(), 1u);
+  EXPECT_EQ(profiles[0].planName, "allreduce_pairs");
+  EXPECT_EQ(profiles[0].messageSize, (size_t)bufferSize);
+  EXPECT_EQ(profiles[0].lookup.count, (uint64_t)nIters);
+  EXPECT_EQ(profiles[0].launch.count, (uint64_t)nIters);
+  EXPECT_EQ(profiles[0].device.count, (uint64_t)nIters);
+  EXPECT_GT(profiles[0].device.meanUs(), 0);
+  EXPECT_LE(profiles[0].launch.minUs, profiles[0].launch.maxUs);
+
+  executor->resetProfiles();
+  EXPECT_TRUE(executor->getProfiles().empty());
+  executor->setProfiling(false);
+}
@@ -145,6 +145,7 @@ class ProxyChannelOneToOneTest : public CommunicatorTestBase {
                             size_t recvBuffBytes = 0);
   void testPingPong(PingPongTestParams params);
   void testPingPongPerf(PingPongTestParams params);
+  void testCustomTrigger(uint32_t customType, const mscclpp::ProxyRequest& expected);
   void testPacketPingPong(bool useIbOnly);
   void testPacketPingPongPerf(bool useIbOnly);
 
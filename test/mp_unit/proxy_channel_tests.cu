@@ -260,6 +260,71 @@ TEST_F(ProxyChannelOneToOneTest, PingPongIbWithPoll) {
   testPingPong(PingPongTestParams{.useIPC = false, .useIB = true, .useEthernet = false, .waitWithPoll = true});
 }
 
+TEST_F(ProxyChannelOneToOneTest, PingPongExtendedTrigger) {
+  proxyService = std::make_shared<mscclpp::ProxyService>(mscclpp::DEFAULT_FIFO_SIZE, mscclpp::TriggerFormat::Extended);
+  testPingPong(PingPongTestParams{.useIPC = true, .useIB = true, .useEthernet = false, .waitWithPoll = false});
+}
+
+__global__ void kernelProxyCustomTrigger(mscclpp::ProxyChannelDeviceHandle chan, uint32_t customType,
+                                         mscclpp::ProxyRequest expected) {
+  uint64_t head =
+      chan.pushCustom(customType, expected.dst, expected.dstOffset, expected.src, expected.srcOffset, expected.size);
+  chan.fifo_.sync(head);
+}
+
+void ProxyChannelOneToOneTest::testCustomTrigger(uint32_t customType, const mscclpp::ProxyRequest& expected) {
+  if (gEnv->rank >= numRanksToUse) return;
+
+  std::vector<mscclpp::SimpleProxyChannel> proxyChannels;
+  std::shared_ptr<int> buff = mscclpp::allocExtSharedCuda<int>(1024);
+  setupMeshConnections(proxyChannels, true, false, false, buff.get(), 1024 * sizeof(int));
+
+  mscclpp::ProxyRequest received = {};
+  proxyService->registerCustomTrigger(customType, [&](const mscclpp::ProxyRequest& request) {
+    received = request;
+    return mscclpp::ProxyHandlerResult::FlushFifoTailAndContinue;
+  });
+  proxyService->startProxy();
+  // Handlers are fixed once the proxy runs.
+  auto noop = [](const mscclpp::ProxyRequest&) { return mscclpp::ProxyHandlerResult::Continue; };
+  EXPECT_THROW(proxyService->registerCustomTrigger(customType + 1, noop), mscclpp::Error);
+
+  kernelProxyCustomTrigger<<<1, 1>>>(proxyService->proxyChannel(0).deviceHandle(), customType, expected);
+  MSCCLPP_CUDATHROW(cudaDeviceSynchronize());
+  proxyService->stopProxy();
+
+  EXPECT_EQ(received.type, mscclpp::TriggerCustom);
+  EXPECT_EQ(received.chanId, customType);
+  EXPECT_EQ(received.dst, expected.dst);
+  EXPECT_EQ(received.dstOffset, expected.dstOffset);
+  EXPECT_EQ(received.src, expected.src);
+  EXPECT_EQ(received.srcOffset, expected.srcOffset);
+  EXPECT_EQ(received.size, expected.size);
+}
+
+TEST_F(ProxyChannelOneToOneTest, CustomTrigger) {
+  mscclpp::ProxyRequest expected = {};
+  expected.dst = 1;
+  expected.dstOffset = 2;
+  expected.src = 3;
+  expected.srcOffset = 4;
+  expected.size = 5;
+  testCustomTrigger(5, expected);
+}
+
+TEST_F(ProxyChannelOneToOneTest, CustomTriggerExtended) {
+  proxyService = std::make_shared<mscclpp::ProxyService>(mscclpp::DEFAULT_FIFO_SIZE, mscclpp::TriggerFormat::Extended);
+  // Every field is beyond what the compact format can hold: offsets and sizes above 4 GiB, memory IDs above 2^9 and
+  // a semaphore ID (the custom type) above 2^10. The proxy decodes them from the two FIFO entries of the trigger.
+  mscclpp::ProxyRequest expected = {};
+  expected.dst = (1u << MSCCLPP_BITS_EXT_REGMEM_HANDLE) - 1;
+  expected.dstOffset = (5ULL << 32) + 8;
+  expected.src = 600;
+  expected.srcOffset = (1ULL << MSCCLPP_BITS_EXT_OFFSET) - 16;
+  expected.size = (6ULL << 32) + 4;
+  testCustomTrigger(1500, expected);
+}
+
 TEST_F(ProxyChannelOneToOneTest, PingPongPerf) {
   testPingPongPerf(PingPongTestParams{.useIPC = true, .useIB = true, .useEthernet = false, .waitWithPoll = false});
 }
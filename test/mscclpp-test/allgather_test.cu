@@ -499,11 +499,10 @@ __global__ void __launch_bounds__(1024, 1)
   }
 }
 
-class AllGatherProxyService : public mscclpp::BaseProxyService {
+class AllGatherProxyService : public mscclpp::ProxyEngine<AllGatherProxyService> {
  public:
   AllGatherProxyService(int worldSize, int rank, int cudaDevice);
-  void startProxy() override { proxy_->start(); }
-  void stopProxy() override { proxy_->stop(); }
+  ~AllGatherProxyService() { stopProxy(); }
   void setSendBytes(size_t sendBytes) { this->sendBytes_ = sendBytes; }
   void addRemoteMemory(mscclpp::RegisteredMemory memory) { remoteMemories_.push_back(memory); }
   void setLocalMemory(mscclpp::RegisteredMemory memory) { localMemory_ = memory; }
@@ -526,25 +525,22 @@ class AllGatherProxyService : public mscclpp::BaseProxyService {
   int cudaDevice_;
   size_t sendBytes_;
 
-  std::shared_ptr<mscclpp::Proxy> proxy_;
   std::vector<std::shared_ptr<mscclpp::Host2DeviceSemaphore>> semaphores_;
   std::vector<mscclpp::RegisteredMemory> remoteMemories_;
   mscclpp::RegisteredMemory localMemory_;
 
+  friend class mscclpp::ProxyEngine<AllGatherProxyService>;
+
+  void threadInit() {
+    int deviceNumaNode = getDeviceNumaNode(cudaDevice_);
+    numaBind(deviceNumaNode);
+  }
+
   mscclpp::ProxyHandlerResult handleTrigger(mscclpp::ProxyTrigger triggerRaw);
 };
 
 AllGatherProxyService::AllGatherProxyService(int worldSize, int rank, int cudaDevice)
-    : worldSize_(worldSize),
-      rank_(rank),
-      cudaDevice_(cudaDevice),
-      sendBytes_(0),
-      proxy_(
-          std::make_shared<mscclpp::Proxy>([&](mscclpp::ProxyTrigger triggerRaw) { return handleTrigger(triggerRaw); },
-                                           [&]() {
-                                             int deviceNumaNode = getDeviceNumaNode(cudaDevice_);
-                                             numaBind(deviceNumaNode);
-                                           })) {}
+    : worldSize_(worldSize), rank_(rank), cudaDevice_(cudaDevice), sendBytes_(0) {}
 
 mscclpp::ProxyHandlerResult AllGatherProxyService::handleTrigger(mscclpp::ProxyTrigger triggerRaw) {
   size_t offset = rank_ * sendBytes_;
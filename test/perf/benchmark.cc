@@ -0,0 +1,272 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "benchmark.hpp"
+
+#include <getopt.h>
+#include <libgen.h>
+#include <mpi.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mscclpp/gpu.hpp>
+#include <nlohmann/json.hpp>
+#include <numeric>
+
+static std::vector<BenchmarkSuite>& benchmarkSuites() {
+  static std::vector<BenchmarkSuite> suites;
+  return suites;
+}
+
+bool registerBenchmarkSuite(BenchmarkSuite suite) {
+  benchmarkSuites().push_back(std::move(suite));
+  return true;
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+  size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+  return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+BenchmarkRunner::BenchmarkRunner(std::shared_ptr<mscclpp::Bootstrap> bootstrap, const BenchmarkOptions& options,
+                                 bool gpuAvailable)
+    : bootstrap_(bootstrap), options_(options), gpuAvailable_(gpuAvailable) {}
+
+std::vector<size_t> BenchmarkRunner::sizes() const {
+  std::vector<size_t> sizes;
+  size_t factor = std::max<size_t>(options_.stepFactor, 2);
+  for (size_t size = options_.minBytes; size > 0 && size <= options_.maxBytes; size *= factor) {
+    sizes.push_back(size);
+    // Stops before the next size overflows
+    if (size > options_.maxBytes / factor) break;
+  }
+  return sizes;
+}
+
+void BenchmarkRunner::run(const std::string& name, size_t size, const std::function<void()>& iteration,
+                          double busBwFactor) {
+  int iters = std::max(options_.iters, 1);
+  bootstrap_->barrier();
+  for (int i = 0; i < options_.warmupIters; ++i) {
+    iteration();
+  }
+  bootstrap_->barrier();
+
+  std::vector<double> samples(iters * nranks());
+  double* mySamples = samples.data() + iters * rank();
+  for (int i = 0; i < iters; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    iteration();
+    mySamples[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  }
+  bootstrap_->allGather(samples.data(), iters * sizeof(double));
+
+  std::vector<double> latencies(samples.begin(), samples.begin() + iters);
+  for (int r = 1; r < nranks(); ++r) {
+    for (int i = 0; i < iters; ++i) {
+      latencies[i] = std::max(latencies[i], samples[r * iters + i]);
+    }
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  BenchmarkResult result;
+  result.suite = suite_;
+  result.name = name;
+  result.size = size;
+  result.nranks = nranks();
+  result.nranksPerNode = nranksPerNode();
+  result.iters = iters;
+  result.latencyUs.mean = std::accumulate(latencies.begin(), latencies.end(), 0.0) / iters;
+  result.latencyUs.min = latencies.front();
+  result.latencyUs.p50 = percentile(latencies, 0.5);
+  result.latencyUs.p90 = percentile(latencies, 0.9);
+  result.latencyUs.p99 = percentile(latencies, 0.99);
+  result.latencyUs.max = latencies.back();
+  result.algBw = result.latencyUs.p50 > 0 ? size / result.latencyUs.p50 / 1e3 : 0;
+  result.busBw = result.algBw * busBwFactor;
+  results_.push_back(result);
+}
+
+static nlohmann::json toJson(const BenchmarkResult& result) {
+  return {{"suite", result.suite},
+          {"name", result.name},
+          {"size", result.size},
+          {"ranks", result.nranks},
+          {"ranksPerNode", result.nranksPerNode},
+          {"iters", result.iters},
+          {"latencyUs",
+           {{"mean", result.latencyUs.mean},
+            {"min", result.latencyUs.min},
+            {"p50", result.latencyUs.p50},
+            {"p90", result.latencyUs.p90},
+            {"p99", result.latencyUs.p99},
+            {"max", result.latencyUs.max}}},
+          {"algBw", result.algBw},
+          {"busBw", result.busBw}};
+}
+
+static double parseSize(const char* value) {
+  char* end;
+  double size = strtod(value, &end);
+  switch (*end) {
+    case 'G':
+    case 'g':
+      return size * (1 << 30);
+    case 'M':
+    case 'm':
+      return size * (1 << 20);
+    case 'K':
+    case 'k':
+      return size * (1 << 10);
+    case '\0':
+      return size;
+    default:
+      return -1;
+  }
+}
+
+static int parseOptions(int argc, char* argv[], BenchmarkOptions& options) {
+  static option longopts[] = {{"minbytes", required_argument, 0, 'b'},
+                              {"maxbytes", required_argument, 0, 'e'},
+                              {"stepfactor", required_argument, 0, 'f'},
+                              {"iters", required_argument, 0, 'n'},
+                              {"warmup_iters", required_argument, 0, 'w'},
+                              {"suite", required_argument, 0, 's'},
+                              {"plan", required_argument, 0, 'p'},
+                              {"output_file", required_argument, 0, 'o'},
+                              {"help", no_argument, 0, 'h'},
+                              {}};
+  int longindex;
+  while (true) {
+    int c = getopt_long(argc, argv, "b:e:f:n:w:s:p:o:h", longopts, &longindex);
+    if (c == -1) break;
+    double parsed;
+    switch (c) {
+      case 'b':
+      case 'e':
+        parsed = parseSize(optarg);
+        if (parsed < 0) {
+          fprintf(stderr, "invalid size '%s'\n", optarg);
+          return -1;
+        }
+        (c == 'b' ? options.minBytes : options.maxBytes) = (size_t)parsed;
+        break;
+      case 'f':
+        options.stepFactor = strtol(optarg, NULL, 0);
+        break;
+      case 'n':
+        options.iters = (int)strtol(optarg, NULL, 0);
+        break;
+      case 'w':
+        options.warmupIters = (int)strtol(optarg, NULL, 0);
+        break;
+      case 's':
+        options.suites.push_back(optarg);
+        break;
+      case 'p': {
+        std::string plan(optarg);
+        size_t colon = plan.find(':');
+        if (colon == std::string::npos) {
+          fprintf(stderr, "invalid plan '%s', expected <name>:<path>\n", optarg);
+          return -1;
+        }
+        options.plans.emplace_back(plan.substr(0, colon), plan.substr(colon + 1));
+        break;
+      }
+      case 'o':
+        options.outputFile = optarg;
+        break;
+      case 'h':
+      default:
+        printf(
+            "USAGE: %s \n\t"
+            "[-b,--minbytes <min size in bytes>] \n\t"
+            "[-e,--maxbytes <max size in bytes>] \n\t"
+            "[-f,--stepfactor <increment factor>] \n\t"
+            "[-n,--iters <iteration count>] \n\t"
+            "[-w,--warmup_iters <warmup iteration count>] \n\t"
+            "[-s,--suite <suite to run, may be repeated>] \n\t"
+            "[-p,--plan <execution plan name>:<execution plan path>, may be repeated] \n\t"
+            "[-o,--output_file <JSON lines file to append the results to>] \n\t"
+            "[-h,--help]\n"
+            "Suites:",
+            basename(argv[0]));
+        for (const auto& suite : benchmarkSuites()) {
+          printf(" %s%s", suite.name.c_str(), suite.requiresGpu ? "" : " (host only)");
+        }
+        printf("\n");
+        return 1;
+    }
+  }
+  if (options.minBytes == 0) {
+    fprintf(stderr, "invalid size for 'minbytes': 0\n");
+    return -1;
+  }
+  if (options.minBytes > options.maxBytes) {
+    fprintf(stderr, "invalid sizes for 'minbytes' and 'maxbytes': %zu > %zu\n", options.minBytes, options.maxBytes);
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  BenchmarkOptions options;
+  int ret = parseOptions(argc, argv, options);
+  if (ret != 0) return ret > 0 ? 0 : 1;
+
+  int rank, nranks;
+  MPI_Init(NULL, NULL);
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &nranks);
+
+  // Host-only suites still run when there is no GPU or no driver.
+  int ngpus = 0;
+  bool gpuAvailable = (cudaGetDeviceCount(&ngpus) == cudaSuccess && ngpus > 0);
+  if (gpuAvailable) {
+    MSCCLPP_CUDATHROW(cudaSetDevice(rank % ngpus));
+  } else {
+    (void)cudaGetLastError();
+  }
+
+  auto bootstrap = std::make_shared<mscclpp::TcpBootstrap>(rank, nranks);
+  mscclpp::UniqueId id;
+  if (rank == 0) id = bootstrap->createUniqueId();
+  MPI_Bcast(&id, sizeof(id), MPI_BYTE, 0, MPI_COMM_WORLD);
+  bootstrap->initialize(id);
+
+  BenchmarkRunner runner(bootstrap, options, gpuAvailable);
+  for (const auto& suite : benchmarkSuites()) {
+    if (!options.suites.empty() &&
+        std::find(options.suites.begin(), options.suites.end(), suite.name) == options.suites.end()) {
+      continue;
+    }
+    if (suite.requiresGpu && !gpuAvailable) {
+      if (rank == 0) std::cout << "Skipping suite " << suite.name << " without a GPU" << std::endl;
+      continue;
+    }
+    runner.setSuite(suite.name);
+    suite.run(runner);
+  }
+
+  if (rank == 0) {
+    printf("%-12s %-32s %12s %10s %10s %10s %10s\n", "suite", "name", "size", "p50(us)", "p99(us)", "algbw", "busbw");
+    for (const auto& result : runner.results()) {
+      printf("%-12s %-32s %12zu %10.2f %10.2f %10.2f %10.2f\n", result.suite.c_str(), result.name.c_str(), result.size,
+             result.latencyUs.p50, result.latencyUs.p99, result.algBw, result.busBw);
+    }
+    if (!options.outputFile.empty()) {
+      std::ofstream out(options.outputFile, std::ios_base::app);
+      for (const auto& result : runner.results()) {
+        out << toJson(result) << std::endl;
+      }
+    }
+  }
+
+  bootstrap->barrier();
+  MPI_Finalize();
+  return 0;
+}
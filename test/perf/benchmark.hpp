@@ -0,0 +1,92 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#ifndef MSCCLPP_PERF_BENCHMARK_HPP_
+#define MSCCLPP_PERF_BENCHMARK_HPP_
+
+#include <functional>
+#include <memory>
+#include <mscclpp/core.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct BenchmarkOptions {
+  size_t minBytes = 1024;
+  size_t maxBytes = 1 << 20;
+  size_t stepFactor = 4;
+  int warmupIters = 10;
+  int iters = 100;
+  // Suites to run. All suites if empty.
+  std::vector<std::string> suites;
+  // Execution plans for the executor suite as (name, path) pairs.
+  std::vector<std::pair<std::string, std::string>> plans;
+  // File to append the results to as JSON lines. Results are only printed if empty.
+  std::string outputFile;
+};
+
+// Latencies in microseconds. Each sample is the latency of the slowest rank at one iteration.
+struct LatencyStats {
+  double mean = 0;
+  double min = 0;
+  double p50 = 0;
+  double p90 = 0;
+  double p99 = 0;
+  double max = 0;
+};
+
+struct BenchmarkResult {
+  std::string suite;
+  std::string name;
+  size_t size;
+  int nranks;
+  int nranksPerNode;
+  int iters;
+  LatencyStats latencyUs;
+  // In GB/s, based on the median latency.
+  double algBw;
+  double busBw;
+};
+
+// Runs the cases of a suite on all ranks and collects their results. Every rank has to run the same cases in the same
+// order, as the ranks synchronize before each case and reduce the latencies of each iteration.
+class BenchmarkRunner {
+ public:
+  BenchmarkRunner(std::shared_ptr<mscclpp::Bootstrap> bootstrap, const BenchmarkOptions& options, bool gpuAvailable);
+
+  int rank() const { return bootstrap_->getRank(); }
+  int nranks() const { return bootstrap_->getNranks(); }
+  int nranksPerNode() const { return bootstrap_->getNranksPerNode(); }
+  bool gpuAvailable() const { return gpuAvailable_; }
+  const BenchmarkOptions& options() const { return options_; }
+  std::shared_ptr<mscclpp::Bootstrap> bootstrap() const { return bootstrap_; }
+
+  // The message sizes from the options, growing by the step factor.
+  std::vector<size_t> sizes() const;
+
+  // Times `iteration`, which has to complete its work before returning, for the configured number of iterations after
+  // warming up. The bus bandwidth is the algorithm bandwidth times `busBwFactor`, e.g. 2(n-1)/n for an allreduce.
+  void run(const std::string& name, size_t size, const std::function<void()>& iteration, double busBwFactor = 1);
+
+  void setSuite(const std::string& suite) { suite_ = suite; }
+  const std::vector<BenchmarkResult>& results() const { return results_; }
+
+ private:
+  std::shared_ptr<mscclpp::Bootstrap> bootstrap_;
+  BenchmarkOptions options_;
+  bool gpuAvailable_;
+  std::string suite_;
+  std::vector<BenchmarkResult> results_;
+};
+
+struct BenchmarkSuite {
+  std::string name;
+  // Suites that need no GPU can run on any machine.
+  bool requiresGpu;
+  std::function<void(BenchmarkRunner&)> run;
+};
+
+// Registers a suite to be run by the harness. Meant to initialize a static variable in the file of the suite.
+bool registerBenchmarkSuite(BenchmarkSuite suite);
+
+#endif  // MSCCLPP_PERF_BENCHMARK_HPP_
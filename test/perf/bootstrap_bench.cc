@@ -0,0 +1,40 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "benchmark.hpp"
+
+static void runBootstrapSuite(BenchmarkRunner& runner) {
+  auto bootstrap = runner.bootstrap();
+  int rank = runner.rank();
+  int nranks = runner.nranks();
+
+  runner.run("barrier", 0, [&]() { bootstrap->barrier(); });
+
+  for (size_t size : runner.sizes()) {
+    // The size is the total gathered size, as for collectives.
+    size_t bytesPerRank = size / nranks;
+    if (bytesPerRank == 0) continue;
+    std::vector<char> buffer(bytesPerRank * nranks);
+    runner.run(
+        "allgather", bytesPerRank * nranks, [&]() { bootstrap->allGather(buffer.data(), (int)bytesPerRank); },
+        double(nranks - 1) / nranks);
+  }
+
+  // Ranks exchange with their neighbor in pairs. A remaining odd rank idles.
+  int peer = rank ^ 1;
+  for (size_t size : runner.sizes()) {
+    std::vector<char> sendBuffer(size), recvBuffer(size);
+    runner.run("sendrecv", size, [&]() {
+      if (peer >= nranks) return;
+      if (rank % 2 == 0) {
+        bootstrap->send(sendBuffer.data(), (int)size, peer, 0);
+        bootstrap->recv(recvBuffer.data(), (int)size, peer, 0);
+      } else {
+        bootstrap->recv(recvBuffer.data(), (int)size, peer, 0);
+        bootstrap->send(sendBuffer.data(), (int)size, peer, 0);
+      }
+    });
+  }
+}
+
+static bool registered = registerBenchmarkSuite({"bootstrap", /*requiresGpu=*/false, runBootstrapSuite});
@@ -0,0 +1,69 @@
+# Copyright (c) Microsoft Corporation.
+# Licensed under the MIT License.
+
+"""Compare results of mscclpp_bench against a baseline and flag regressions.
+
+Both files are JSON lines as written by `mscclpp_bench --output_file`. Small messages are judged by their median
+latency, which is noisier, and large messages by their bus bandwidth.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load_results(path: str) -> dict:
+    results = {}
+    with open(path, "r") as f:
+        for line in f:
+            if not line.strip():
+                continue
+            data = json.loads(line)
+            key = (data["suite"], data["name"], data["size"], data["ranks"], data["ranksPerNode"])
+            results[key] = data
+    return results
+
+
+def compare(
+    results: dict, baseline: dict, latency_threshold: float, bandwidth_threshold: float, bandwidth_min_size: int
+):
+    """Returns the regressions as (key, metric, value, baseline value) tuples, and the baseline keys without results."""
+    regressions = []
+    for key, value in results.items():
+        if key not in baseline:
+            continue
+        base = baseline[key]
+        size = key[2]
+        if size >= bandwidth_min_size and base["busBw"] > 0:
+            if value["busBw"] < base["busBw"] * (1 - bandwidth_threshold):
+                regressions.append((key, "busBw", value["busBw"], base["busBw"]))
+        elif value["latencyUs"]["p50"] > base["latencyUs"]["p50"] * (1 + latency_threshold):
+            regressions.append((key, "p50", value["latencyUs"]["p50"], base["latencyUs"]["p50"]))
+    missing = [key for key in baseline if key not in results]
+    return regressions, missing
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--result-file", type=str, required=True)
+    parser.add_argument("--baseline-file", type=str, required=True)
+    parser.add_argument("--latency-threshold", type=float, default=0.15)
+    parser.add_argument("--bandwidth-threshold", type=float, default=0.05)
+    parser.add_argument("--bandwidth-min-size", type=int, default=1 << 20)
+    args = parser.parse_args()
+
+    regressions, missing = compare(
+        load_results(args.result_file),
+        load_results(args.baseline_file),
+        args.latency_threshold,
+        args.bandwidth_threshold,
+        args.bandwidth_min_size,
+    )
+    for key in missing:
+        print(f"MISSING {key}")
+    for key, metric, value, base in regressions:
+        print(f"REGRESSION {key}: {metric} {value:.2f} vs baseline {base:.2f}")
+    if regressions:
+        print("FAIL")
+        sys.exit(1)
+    print("PASS")
@@ -0,0 +1,70 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <algorithm>
+#include <mscclpp/gpu_utils.hpp>
+
+#include "benchmark.hpp"
+
+// Returns whether `value` holds on all ranks.
+static bool onAllRanks(std::shared_ptr<mscclpp::Bootstrap> bootstrap, bool value) {
+  std::vector<char> values(bootstrap->getNranks());
+  values[bootstrap->getRank()] = value;
+  bootstrap->allGather(values.data(), sizeof(char));
+  return std::all_of(values.begin(), values.end(), [](char v) { return v != 0; });
+}
+
+static void runConnectionSuite(BenchmarkRunner& runner) {
+  auto bootstrap = runner.bootstrap();
+  int rank = runner.rank();
+  int localRank = rank % runner.nranksPerNode();
+  // Ranks connect with their neighbor in pairs. A remaining odd rank idles.
+  int peer = rank ^ 1;
+  bool hasPeer = peer < runner.nranks();
+  mscclpp::Communicator comm(bootstrap);
+
+  std::vector<std::pair<std::string, mscclpp::Transport>> transports;
+  if (runner.nranksPerNode() % 2 == 0) {
+    transports.emplace_back("ipc", mscclpp::Transport::CudaIpc);
+  }
+  int nIbDevices = mscclpp::getIBDeviceCount();
+  if (onAllRanks(bootstrap, nIbDevices > 0)) {
+    transports.emplace_back("ib", static_cast<mscclpp::Transport>(static_cast<int>(mscclpp::Transport::IB0) +
+                                                                  localRank % std::min(nIbDevices, 8)));
+  }
+  transports.emplace_back("eth", mscclpp::Transport::Ethernet);
+
+  size_t maxBytes = runner.sizes().back();
+  std::shared_ptr<char> buffer = mscclpp::allocExtSharedCuda<char>(maxBytes);
+  for (const auto& [name, transport] : transports) {
+    runner.run("connect/" + name, 0, [&]() {
+      if (!hasPeer) return;
+      // Connections live as long as their communicator, so each iteration releases its own with it.
+      mscclpp::Communicator connectComm(bootstrap);
+      auto connection = connectComm.connectOnSetup(peer, 0, transport);
+      connectComm.setup();
+      connection.get();
+    });
+
+    std::shared_ptr<mscclpp::Connection> connection;
+    mscclpp::RegisteredMemory localMemory = comm.registerMemory(buffer.get(), maxBytes, transport);
+    mscclpp::RegisteredMemory remoteMemory;
+    if (hasPeer) {
+      auto connectionFuture = comm.connectOnSetup(peer, 0, transport);
+      comm.sendMemoryOnSetup(localMemory, peer, 0);
+      auto remoteMemoryFuture = comm.recvMemoryOnSetup(peer, 0);
+      comm.setup();
+      connection = connectionFuture.get();
+      remoteMemory = remoteMemoryFuture.get();
+    }
+    for (size_t size : runner.sizes()) {
+      runner.run("write/" + name, size, [&]() {
+        if (!hasPeer) return;
+        connection->write(remoteMemory, 0, localMemory, 0, size);
+        connection->flush();
+      });
+    }
+  }
+}
+
+static bool registered = registerBenchmarkSuite({"connection", /*requiresGpu=*/true, runConnectionSuite});
@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <fstream>
+#include <mscclpp/executor.hpp>
+#include <mscclpp/gpu_utils.hpp>
+#include <nlohmann/json.hpp>
+
+#include "benchmark.hpp"
+
+// Runs the execution plans given on the command line. Each plan runs on all ranks, so the number of ranks has to match
+// the plans. The size of a case is the number of bytes each rank sends, so an allgather receives `nranks` times that.
+static void runExecutorSuite(BenchmarkRunner& runner) {
+  auto comm = std::make_shared<mscclpp::Communicator>(runner.bootstrap());
+  mscclpp::Executor executor(comm);
+  mscclpp::CudaStreamWithFlags stream(cudaStreamNonBlocking);
+  int nranks = runner.nranks();
+  size_t maxBytes = runner.sizes().back();
+  std::shared_ptr<char> sendBuffer = mscclpp::allocExtSharedCuda<char>(maxBytes);
+  std::shared_ptr<char> recvBuffer = mscclpp::allocExtSharedCuda<char>(maxBytes * nranks);
+
+  for (const auto& [name, path] : runner.options().plans) {
+    nlohmann::json planJson = nlohmann::json::parse(std::ifstream(path));
+    // Older plans spell the key "colletive".
+    std::string collective = planJson.value("collective", planJson.value("colletive", ""));
+    bool inPlace = planJson.value("inplace", false);
+    bool allgather = collective == "allgather";
+    double busBwFactor = 1;
+    if (collective == "allreduce") {
+      busBwFactor = 2.0 * (nranks - 1) / nranks;
+    } else if (allgather) {
+      // The bus bandwidth of an allgather is (n - 1) / n of the bytes received, which are n times the size.
+      busBwFactor = nranks - 1;
+    } else if (collective == "reducescatter") {
+      busBwFactor = double(nranks - 1) / nranks;
+    }
+
+    mscclpp::ExecutionPlan plan(name, path);
+    // An in-place allgather gathers into the receive buffer, which holds the input of this rank at its offset.
+    char* send = (allgather && inPlace) ? recvBuffer.get() : sendBuffer.get();
+    char* recv = (inPlace && !allgather) ? sendBuffer.get() : recvBuffer.get();
+    for (size_t size : runner.sizes()) {
+      size_t recvBytes = allgather ? size * nranks : size;
+      size_t sendBytes = (allgather && inPlace) ? recvBytes : size;
+      runner.run(
+          name, size,
+          [&]() {
+            executor.execute(runner.rank(), send, recv, sendBytes, recvBytes, mscclpp::DataType::FLOAT16, plan,
+                             stream);
+            MSCCLPP_CUDATHROW(cudaStreamSynchronize(stream));
+          },
+          busBwFactor);
+    }
+  }
+}
+
+static bool registered = registerBenchmarkSuite({"executor", /*requiresGpu=*/true, runExecutorSuite});
@@ -0,0 +1,117 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <mscclpp/gpu_utils.hpp>
+#include <mscclpp/proxy.hpp>
+#include <mscclpp/proxy_channel.hpp>
+#include <tuple>
+
+#include "benchmark.hpp"
+
+// Triggers pushed by each case. The size of a case is this count, so its algBw is in billions of triggers per second.
+constexpr int FifoBenchTriggers = 1 << 14;
+
+__global__ void kernelFifoPush(mscclpp::ProxyChannelDeviceHandle chan, int count) {
+  int nthreads = blockDim.x * gridDim.x;
+  for (int i = blockIdx.x * blockDim.x + threadIdx.x; i < count; i += nthreads) {
+    chan.put(0, i, 0, i, 1 + i % 1024);
+  }
+  __syncthreads();
+  // The proxy handles the triggers of a lane in order, so the flush returns after all triggers of the block are
+  // handled.
+  if (threadIdx.x == 0) {
+    chan.flush();
+  }
+}
+
+// Decodes the triggers like ProxyService does, without acting on them.
+class TriggerDecoder {
+ public:
+  TriggerDecoder(mscclpp::TriggerFormat format) : format_(format), hasPending_(false), bytes_(0) {}
+
+  mscclpp::ProxyHandlerResult handle(mscclpp::ProxyTrigger triggerRaw) {
+    mscclpp::TriggerType type;
+    if (format_ == mscclpp::TriggerFormat::Extended) {
+      if (!hasPending_) {
+        pending_[0] = triggerRaw;
+        hasPending_ = true;
+        return mscclpp::ProxyHandlerResult::ContinueInSameLane;
+      }
+      hasPending_ = false;
+      pending_[1] = triggerRaw;
+      auto trigger = reinterpret_cast<mscclpp::ExtendedChannelTrigger*>(pending_);
+      type = trigger->fields.type;
+      bytes_ += trigger->fields.size;
+    } else {
+      auto trigger = reinterpret_cast<mscclpp::ChannelTrigger*>(&triggerRaw);
+      type = trigger->fields.type;
+      bytes_ += trigger->fields.size;
+    }
+    return (type & mscclpp::TriggerSync) ? mscclpp::ProxyHandlerResult::FlushFifoTailAndContinue
+                                         : mscclpp::ProxyHandlerResult::Continue;
+  }
+
+ private:
+  mscclpp::TriggerFormat format_;
+  mscclpp::ProxyTrigger pending_[2];
+  bool hasPending_;
+  uint64_t bytes_;
+};
+
+// The same decoder behind a ProxyEngine, which calls it without a std::function in between.
+class TriggerDecoderEngine : public mscclpp::ProxyEngine<TriggerDecoderEngine> {
+ public:
+  TriggerDecoderEngine(mscclpp::TriggerFormat format, int fifoLanes)
+      : mscclpp::ProxyEngine<TriggerDecoderEngine>(mscclpp::DEFAULT_FIFO_SIZE, fifoLanes), decoder_(format) {}
+  ~TriggerDecoderEngine() { stopProxy(); }
+
+  mscclpp::ProxyHandlerResult handleTrigger(mscclpp::ProxyTrigger triggerRaw) { return decoder_.handle(triggerRaw); }
+
+ private:
+  TriggerDecoder decoder_;
+};
+
+static void runFifoSuite(BenchmarkRunner& runner) {
+  mscclpp::CudaStreamWithFlags stream(cudaStreamNonBlocking);
+  std::vector<std::pair<std::string, mscclpp::TriggerFormat>> formats = {
+      {"compact", mscclpp::TriggerFormat::Compact}, {"extended", mscclpp::TriggerFormat::Extended}};
+  // (blocks, threads per block, lanes). An extended trigger takes two entries, so at most half of the FIFO size of
+  // threads may push to a lane at once.
+  std::vector<std::tuple<int, int, int>> configs = {{1, 1, 1}, {1, 32, 1}, {8, 8, 1}, {8, 8, 8}};
+  // Each config runs with the decoder called through the std::function of a Proxy, and directly by a ProxyEngine
+  // ("/engine"), to show the per-trigger cost of the dispatch.
+  for (const auto& [name, format] : formats) {
+    for (const auto& config : configs) {
+      int nblocks = std::get<0>(config);
+      int nthreads = std::get<1>(config);
+      int nlanes = std::get<2>(config);
+      mscclpp::TriggerFormat triggerFormat = format;
+      std::string caseName = "push/" + name + "/" + std::to_string(nblocks) + "x" + std::to_string(nthreads) +
+                             "threads/" + std::to_string(nlanes) + "lanes";
+      auto runCase = [&](const std::string& label, mscclpp::Fifo& fifo) {
+        mscclpp::ProxyChannelDeviceHandle chan = {};
+        chan.triggerFormat_ = triggerFormat;
+        chan.fifo_ = fifo.deviceHandle();
+        runner.run(label, FifoBenchTriggers, [&]() {
+          kernelFifoPush<<<nblocks, nthreads, 0, stream>>>(chan, FifoBenchTriggers);
+          MSCCLPP_CUDATHROW(cudaGetLastError());
+          MSCCLPP_CUDATHROW(cudaStreamSynchronize(stream));
+        });
+      };
+
+      TriggerDecoder decoder(format);
+      mscclpp::Proxy proxy([&](mscclpp::ProxyTrigger trigger) { return decoder.handle(trigger); },
+                           mscclpp::DEFAULT_FIFO_SIZE, nlanes);
+      proxy.start();
+      runCase(caseName, proxy.fifo());
+      proxy.stop();
+
+      TriggerDecoderEngine engine(format, nlanes);
+      engine.startProxy();
+      runCase(caseName + "/engine", engine.proxy()->fifo());
+      engine.stopProxy();
+    }
+  }
+}
+
+static bool registered = registerBenchmarkSuite({"fifo", /*requiresGpu=*/true, runFifoSuite});
@@ -0,0 +1,102 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+
+// Triggers pushed by each case. The size of a case is this count, so its algBw is in billions of triggers per second.
+constexpr int FifoEmulationTriggers = 1 << 16;
+constexpr int FifoEmulationSize = 128;
+
+// Host emulation of the proxy FIFO, to measure how pushes scale with the number of producers on machines without GPUs.
+// Producer threads play the part of thread blocks and push like FifoDeviceHandle::push, i.e. a fetch-add on the head
+// of their lane and a wait for the tail, and a consumer thread polls the lanes round-robin like the proxy.
+class EmulatedFifo {
+ public:
+  EmulatedFifo(int size, int numLanes)
+      : size_(size),
+        numLanes_(numLanes),
+        lanes_(new Lane[numLanes]),
+        triggers_(new std::atomic<uint64_t>[size * numLanes]) {
+    for (int i = 0; i < size * numLanes; ++i) {
+      triggers_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  void push(int producer, uint64_t trigger) {
+    int lane = producer % numLanes_;
+    Lane& l = lanes_[lane];
+    uint64_t head = l.head.fetch_add(1, std::memory_order_relaxed);
+    while (head >= size_ + l.tail.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+    triggers_[lane * size_ + head % size_].store(trigger, std::memory_order_release);
+  }
+
+  // Pops `count` triggers, polling the lanes round-robin.
+  void consume(int count) {
+    int lane = 0;
+    while (count > 0) {
+      Lane& l = lanes_[lane];
+      uint64_t tail = l.tail.load(std::memory_order_relaxed);
+      std::atomic<uint64_t>& entry = triggers_[lane * size_ + tail % size_];
+      if (entry.load(std::memory_order_acquire) != 0) {
+        entry.store(0, std::memory_order_relaxed);
+        l.tail.store(tail + 1, std::memory_order_release);
+        --count;
+      } else {
+        std::this_thread::yield();
+      }
+      if (++lane == numLanes_) {
+        lane = 0;
+      }
+    }
+  }
+
+ private:
+  // The head is contended by the producers of a lane and the tail is written by the consumer, so they are kept in
+  // separate cache lines.
+  struct Lane {
+    alignas(128) std::atomic<uint64_t> head{0};
+    alignas(128) std::atomic<uint64_t> tail{0};
+  };
+
+  const uint64_t size_;
+  const int numLanes_;
+  std::unique_ptr<Lane[]> lanes_;
+  std::unique_ptr<std::atomic<uint64_t>[]> triggers_;
+};
+
+static void runFifoEmulationSuite(BenchmarkRunner& runner) {
+  // Each producer count runs with a single lane, where all producers contend on one head, and with a lane each.
+  for (int nproducers : {1, 2, 4, 8, 16}) {
+    std::vector<int> laneCounts = {1};
+    if (nproducers > 1) laneCounts.push_back(nproducers);
+    for (int nlanes : laneCounts) {
+      std::string name = "push/" + std::to_string(nproducers) + "producers/" + std::to_string(nlanes) + "lanes";
+      runner.run(name, FifoEmulationTriggers, [&]() {
+        EmulatedFifo fifo(FifoEmulationSize, nlanes);
+        std::thread consumer([&]() { fifo.consume(FifoEmulationTriggers); });
+        std::vector<std::thread> producers;
+        for (int p = 0; p < nproducers; ++p) {
+          producers.emplace_back([&, p]() {
+            for (int i = p; i < FifoEmulationTriggers; i += nproducers) {
+              fifo.push(p, i + 1);
+            }
+          });
+        }
+        for (auto& producer : producers) {
+          producer.join();
+        }
+        consumer.join();
+      });
+    }
+  }
+}
+
+static bool registered = registerBenchmarkSuite({"fifo_emulation", /*requiresGpu=*/false, runFifoEmulationSuite});
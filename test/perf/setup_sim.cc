@@ -0,0 +1,376 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Simulates the setup of many ranks on one machine without GPUs. Every rank runs in a thread or a forked process,
+// bootstraps over loopback, and connects with its peers in a pattern over the Ethernet transport.
+
+#include <dirent.h>
+#include <getopt.h>
+#include <libgen.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mscclpp/core.hpp>
+#include <mscclpp/metrics.hpp>
+#include <mscclpp/semaphore.hpp>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SimOptions {
+  int nranks = 8;
+  // "full", "ring" or "hier".
+  std::string pattern = "full";
+  // Ranks per group of the hierarchical pattern.
+  int groupSize = 8;
+  bool fork = false;
+  // Connect over Ethernet and pair a host semaphore per connection, or only exchange memories.
+  bool connect = true;
+  // Defer connecting to the first use, which never comes in the simulation.
+  bool lazy = false;
+  std::string outputFile;
+};
+
+// Statistics of one process: its rank in the fork mode, or all ranks in the thread mode.
+struct SimStats {
+  double bootstrapUs = 0;
+  double setupUs = 0;
+  uint64_t fds = 0;
+  uint64_t sockets = 0;
+  uint64_t bytesSent = 0;
+  uint64_t connections = 0;
+};
+
+static std::vector<int> patternPeers(const SimOptions& options, int rank) {
+  int n = options.nranks;
+  std::set<int> peers;
+  if (options.pattern == "full") {
+    for (int peer = 0; peer < n; ++peer) peers.insert(peer);
+  } else if (options.pattern == "ring") {
+    peers = {(rank + 1) % n, (rank + n - 1) % n};
+  } else {
+    // A full mesh within each group, like the GPUs of a node, and rings across groups between the ranks of the same
+    // index, like the rails of a cluster.
+    int g = options.groupSize;
+    int group = rank / g;
+    for (int peer = group * g; peer < std::min(n, (group + 1) * g); ++peer) peers.insert(peer);
+    if (rank + g < n) peers.insert(rank + g);
+    if (rank - g >= 0) peers.insert(rank - g);
+    int ngroups = (n + g - 1) / g;
+    int last = (ngroups - 1) * g + rank % g;
+    if (group == 0 && last < n) peers.insert(last);
+    if (group == ngroups - 1) peers.insert(rank % g);
+  }
+  peers.erase(rank);
+  return std::vector<int>(peers.begin(), peers.end());
+}
+
+// File descriptors that a connection may hold during setup: its listening, sending and receiving sockets.
+constexpr uint64_t FdsPerConnection = 3;
+// Memory mappings that an eager connection holds without io_uring: its receive buffer, and the stack of its receiving
+// thread and the guard page of the stack.
+constexpr uint64_t MappingsPerConnection = 3;
+
+// Returns the connections held by the ranks of one process.
+static uint64_t connectionsPerProcess(const SimOptions& options) {
+  uint64_t total = 0;
+  uint64_t most = 0;
+  for (int rank = 0; rank < options.nranks; ++rank) {
+    uint64_t connections = patternPeers(options, rank).size();
+    total += connections;
+    most = std::max(most, connections);
+  }
+  return options.fork ? most : total;
+}
+
+static uint64_t readProcValue(const char* path, uint64_t fallback) {
+  std::ifstream file(path);
+  uint64_t value;
+  return (file >> value) ? value : fallback;
+}
+
+// Returns why the connections of one process do not fit in its limits, or an empty string if they fit. Raises the
+// limit of file descriptors to the hard limit first.
+static std::string checkLimits(const SimOptions& options) {
+  if (!options.connect) return "";
+  uint64_t connections = connectionsPerProcess(options);
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    if (limit.rlim_cur < limit.rlim_max) {
+      limit.rlim_cur = limit.rlim_max;
+      (void)setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur != RLIM_INFINITY && connections * FdsPerConnection > limit.rlim_cur) {
+      return std::to_string(connections) + " connections per process need about " +
+             std::to_string(connections * FdsPerConnection) + " file descriptors, over the limit of " +
+             std::to_string(limit.rlim_cur);
+    }
+  }
+  if (!options.lazy && getenv("MSCCLPP_SOCKET_IO_URING") == nullptr) {
+    uint64_t maxMappings = readProcValue("/proc/sys/vm/max_map_count", 65530);
+    uint64_t maxThreads = readProcValue("/proc/sys/kernel/threads-max", UINT64_MAX);
+    if (connections * MappingsPerConnection > maxMappings || connections > maxThreads) {
+      return std::to_string(connections) + " eager connections per process need a receiving thread and buffer each, " +
+             "over vm.max_map_count (" + std::to_string(maxMappings) + ") or kernel.threads-max (" +
+             std::to_string(maxThreads) + ")";
+    }
+  }
+  return "";
+}
+
+// Counts the open file descriptors of this process and those that are sockets.
+static void countFds(uint64_t& fds, uint64_t& sockets) {
+  fds = 0;
+  sockets = 0;
+  DIR* dir = opendir("/proc/self/fd");
+  if (dir == nullptr) return;
+  char target[64];
+  while (dirent* entry = readdir(dir)) {
+    if (entry->d_name[0] == '.') continue;
+    fds++;
+    std::string path = std::string("/proc/self/fd/") + entry->d_name;
+    ssize_t len = readlink(path.c_str(), target, sizeof(target) - 1);
+    if (len > 0 && strncmp(target, "socket:", 7) == 0) sockets++;
+  }
+  closedir(dir);
+  // Not counting the descriptor of the directory itself.
+  fds--;
+}
+
+static uint64_t bootstrapBytesSent() {
+  return mscclpp::MetricsRegistry::global()
+      .counter("mscclpp_bootstrap_sent_bytes_total", "Bytes sent over bootstrap sockets")
+      ->value();
+}
+
+static double elapsedUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs one rank. The rank that samples the resources of the process fills them in `stats`.
+static void runRank(const SimOptions& options, const std::string& rootAddress, int rank, bool samplesProcess,
+                    SimStats& stats) {
+  uint64_t fdsBefore, socketsBefore;
+  countFds(fdsBefore, socketsBefore);
+  uint64_t bytesBefore = options.fork ? bootstrapBytesSent() : 0;
+
+  auto start = std::chrono::steady_clock::now();
+  auto bootstrap = std::make_shared<mscclpp::TcpBootstrap>(rank, options.nranks);
+  bootstrap->initialize(rootAddress);
+  stats.bootstrapUs = elapsedUs(start);
+
+  mscclpp::Communicator comm(bootstrap);
+  std::vector<int> peers = patternPeers(options, rank);
+  std::vector<uint64_t> buffer(peers.size());
+  mscclpp::TransportFlags transports =
+      options.connect ? mscclpp::TransportFlags(mscclpp::Transport::Ethernet) : mscclpp::TransportFlags();
+  bootstrap->barrier();
+
+  start = std::chrono::steady_clock::now();
+  std::vector<mscclpp::NonblockingFuture<std::shared_ptr<mscclpp::Connection>>> connectionFutures;
+  std::vector<mscclpp::NonblockingFuture<mscclpp::RegisteredMemory>> memoryFutures;
+  mscclpp::RegisteredMemory memory = comm.registerMemory(buffer.data(), buffer.size() * sizeof(uint64_t), transports);
+  for (int peer : peers) {
+    if (options.connect) {
+      mscclpp::EndpointConfig config(mscclpp::Transport::Ethernet);
+      config.lazy = options.lazy;
+      connectionFutures.push_back(comm.connectOnSetup(peer, 0, config));
+    }
+    comm.sendMemoryOnSetup(memory, peer, 0);
+    memoryFutures.push_back(comm.recvMemoryOnSetup(peer, 0));
+  }
+  comm.setup();
+  std::vector<std::shared_ptr<mscclpp::Host2HostSemaphore>> semaphores;
+  for (auto& future : connectionFutures) {
+    semaphores.push_back(std::make_shared<mscclpp::Host2HostSemaphore>(comm, future.get()));
+  }
+  comm.setup();
+  for (auto& future : memoryFutures) future.get();
+  stats.setupUs = elapsedUs(start);
+  stats.connections = connectionFutures.size();
+
+  // In the thread mode, one rank samples the process while all ranks hold their resources.
+  bootstrap->barrier();
+  if (samplesProcess) {
+    countFds(stats.fds, stats.sockets);
+    stats.fds -= fdsBefore;
+    stats.sockets -= socketsBefore;
+    stats.bytesSent = bootstrapBytesSent() - bytesBefore;
+  }
+  bootstrap->barrier();
+}
+
+// Returns a loopback address with a free port for the bootstrap root.
+static std::string loopbackRootAddress() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || getsockname(fd, (sockaddr*)&addr, &len) != 0) {
+    throw mscclpp::SysError("Failed to find a free port", errno);
+  }
+  close(fd);
+  return "lo:127.0.0.1:" + std::to_string(ntohs(addr.sin_port));
+}
+
+static std::vector<SimStats> runThreads(const SimOptions& options, const std::string& rootAddress) {
+  std::vector<SimStats> stats(options.nranks);
+  std::vector<std::thread> threads;
+  for (int rank = 0; rank < options.nranks; ++rank) {
+    threads.emplace_back([&, rank]() { runRank(options, rootAddress, rank, rank == 0, stats[rank]); });
+  }
+  for (auto& thread : threads) thread.join();
+  return stats;
+}
+
+static std::vector<SimStats> runProcesses(const SimOptions& options, const std::string& rootAddress) {
+  int fds[2];
+  if (pipe(fds) != 0) throw mscclpp::SysError("pipe failed", errno);
+  for (int rank = 0; rank < options.nranks; ++rank) {
+    pid_t pid = fork();
+    if (pid < 0) throw mscclpp::SysError("fork failed", errno);
+    if (pid == 0) {
+      close(fds[0]);
+      SimStats stats;
+      int ret = 0;
+      try {
+        runRank(options, rootAddress, rank, true, stats);
+      } catch (const std::exception& e) {
+        std::cerr << "Rank " << rank << " failed: " << e.what() << std::endl;
+        ret = 1;
+      }
+      // Writes of at most PIPE_BUF bytes are atomic.
+      if (write(fds[1], &stats, sizeof(stats)) != sizeof(stats)) ret = 1;
+      _exit(ret);
+    }
+  }
+  close(fds[1]);
+  std::vector<SimStats> stats(options.nranks);
+  int nread = 0;
+  while (nread < options.nranks && read(fds[0], &stats[nread], sizeof(SimStats)) == sizeof(SimStats)) nread++;
+  close(fds[0]);
+  bool failed = (nread < options.nranks);
+  for (int i = 0; i < options.nranks; ++i) {
+    int status;
+    if (wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = true;
+  }
+  if (failed) throw mscclpp::Error("Some ranks failed", mscclpp::ErrorCode::InternalError);
+  return stats;
+}
+
+static int parseOptions(int argc, char* argv[], SimOptions& options) {
+  static option longopts[] = {{"nranks", required_argument, 0, 'n'},
+                              {"pattern", required_argument, 0, 'p'},
+                              {"group_size", required_argument, 0, 'g'},
+                              {"mode", required_argument, 0, 'm'},
+                              {"no_connect", no_argument, 0, 'x'},
+                              {"lazy", no_argument, 0, 'l'},
+                              {"output_file", required_argument, 0, 'o'},
+                              {"help", no_argument, 0, 'h'},
+                              {}};
+  int longindex;
+  while (true) {
+    int c = getopt_long(argc, argv, "n:p:g:m:xlo:h", longopts, &longindex);
+    if (c == -1) break;
+    switch (c) {
+      case 'n':
+        options.nranks = (int)strtol(optarg, NULL, 0);
+        break;
+      case 'p':
+        options.pattern = optarg;
+        break;
+      case 'g':
+        options.groupSize = (int)strtol(optarg, NULL, 0);
+        break;
+      case 'm':
+        options.fork = (std::string(optarg) == "fork");
+        break;
+      case 'x':
+        options.connect = false;
+        break;
+      case 'l':
+        options.lazy = true;
+        break;
+      case 'o':
+        options.outputFile = optarg;
+        break;
+      case 'h':
+      default:
+        printf(
+            "USAGE: %s \n\t"
+            "[-n,--nranks <number of ranks>] \n\t"
+            "[-p,--pattern <full/ring/hier>] \n\t"
+            "[-g,--group_size <ranks per group of the hier pattern>] \n\t"
+            "[-m,--mode <thread/fork>] \n\t"
+            "[-x,--no_connect only exchange memories without connecting] \n\t"
+            "[-l,--lazy connect on first use, i.e. only exchange endpoints] \n\t"
+            "[-o,--output_file <JSON lines file to append the result to>] \n\t"
+            "[-h,--help]\n",
+            basename(argv[0]));
+        return 1;
+    }
+  }
+  if (options.nranks < 2 || options.groupSize < 1 ||
+      (options.pattern != "full" && options.pattern != "ring" && options.pattern != "hier")) {
+    fprintf(stderr, "invalid options\n");
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  SimOptions options;
+  int ret = parseOptions(argc, argv, options);
+  if (ret != 0) return ret > 0 ? 0 : 1;
+  std::string overLimit = checkLimits(options);
+  if (!overLimit.empty()) {
+    fprintf(stderr, "%s; try the ring or hier pattern, the fork mode or --lazy\n", overLimit.c_str());
+    return 1;
+  }
+  // Ethernet endpoints listen on the loopback interface unless told otherwise.
+  setenv("MSCCLPP_SOCKET_IFNAME", "lo", 0);
+
+  std::string rootAddress = loopbackRootAddress();
+  std::vector<SimStats> stats = options.fork ? runProcesses(options, rootAddress) : runThreads(options, rootAddress);
+
+  SimStats total;
+  double meanSetupUs = 0;
+  for (const auto& s : stats) {
+    total.bootstrapUs = std::max(total.bootstrapUs, s.bootstrapUs);
+    total.setupUs = std::max(total.setupUs, s.setupUs);
+    total.fds += s.fds;
+    total.sockets += s.sockets;
+    total.bytesSent += s.bytesSent;
+    total.connections += s.connections;
+    meanSetupUs += s.setupUs / stats.size();
+  }
+
+  nlohmann::json result = {{"pattern", options.pattern},
+                           {"ranks", options.nranks},
+                           {"mode", options.fork ? "fork" : "thread"},
+                           {"connect", options.connect},
+                           {"lazy", options.lazy},
+                           {"connections", total.connections},
+                           {"bootstrapUs", total.bootstrapUs},
+                           {"setupUs", total.setupUs},
+                           {"meanSetupUs", meanSetupUs},
+                           {"fds", total.fds},
+                           {"sockets", total.sockets},
+                           {"bootstrapBytesSent", total.bytesSent}};
+  std::cout << result.dump(2) << std::endl;
+  if (!options.outputFile.empty()) {
+    std::ofstream(options.outputFile, std::ios_base::app) << result << std::endl;
+  }
+  return 0;
+}
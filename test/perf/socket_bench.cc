@@ -0,0 +1,97 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <sys/uio.h>
+
+#include <mscclpp/errors.hpp>
+#include <thread>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "socket.h"
+
+// Precedes each message of the client. The server echoes the payload back if `echo` is set, and acknowledges it with a
+// single byte otherwise. A zero size ends the server.
+struct SocketBenchHeader {
+  uint64_t size;
+  uint64_t echo;
+};
+
+// Blocking receive, so that the two ends of a loopback connection do not compete for the CPU while waiting.
+static void recvAll(mscclpp::Socket& sock, void* ptr, size_t size) {
+  int closed;
+  sock.recvUntilEnd(ptr, size, &closed);
+  if (closed) throw mscclpp::Error("socket closed by peer", mscclpp::ErrorCode::RemoteError);
+}
+
+static void serveSocketBench(mscclpp::Socket& sock, size_t maxBytes) {
+  std::vector<char> buffer(maxBytes);
+  char ack = 0;
+  for (;;) {
+    SocketBenchHeader header;
+    recvAll(sock, &header, sizeof(header));
+    if (header.size == 0) break;
+    recvAll(sock, buffer.data(), header.size);
+    if (header.echo) {
+      sock.send(buffer.data(), header.size);
+    } else {
+      sock.send(&ack, sizeof(ack));
+    }
+  }
+}
+
+// Measures the socket layer alone over loopback on each rank, without a GPU or a peer process.
+static void runSocketSuite(BenchmarkRunner& runner) {
+  if (runner.sizes().empty()) return;
+  size_t maxBytes = runner.sizes().back();
+  mscclpp::SocketAddress listenAddr;
+  mscclpp::SocketGetAddrFromString(&listenAddr, "127.0.0.1:0");
+  mscclpp::Socket listenSock(&listenAddr);
+  listenSock.bindAndListen();
+  mscclpp::SocketAddress serverAddr = listenSock.getAddr();
+
+  std::thread server([&]() {
+    mscclpp::Socket sock;
+    sock.accept(&listenSock);
+    serveSocketBench(sock, maxBytes);
+  });
+  mscclpp::Socket client(&serverAddr);
+  client.connect();
+
+  std::vector<char> sendBuffer(maxBytes), recvBuffer(maxBytes);
+  char ack;
+  for (size_t size : runner.sizes()) {
+    // Round trip of a message that the server echoes back, with the client receiving the echo in as many calls as the
+    // socket gives, and in a single MSG_WAITALL call.
+    auto pingpong = [&]() {
+      SocketBenchHeader header{size, 1};
+      struct iovec iov[2] = {{&header, sizeof(header)}, {sendBuffer.data(), size}};
+      client.sendv(iov, 2);
+      recvAll(client, recvBuffer.data(), size);
+    };
+    runner.run("pingpong", size, pingpong);
+    client.setRecvWaitAll(true);
+    runner.run("pingpong/waitall", size, pingpong);
+    client.setRecvWaitAll(false);
+    // One-way transfer of a header and its payload, with a separate send for each of them.
+    runner.run("send", size, [&]() {
+      SocketBenchHeader header{size, 0};
+      client.send(&header, sizeof(header));
+      client.send(sendBuffer.data(), size);
+      recvAll(client, &ack, sizeof(ack));
+    });
+    // The same transfer with both buffers in a single sendmsg().
+    runner.run("sendv", size, [&]() {
+      SocketBenchHeader header{size, 0};
+      struct iovec iov[2] = {{&header, sizeof(header)}, {sendBuffer.data(), size}};
+      client.sendv(iov, 2);
+      recvAll(client, &ack, sizeof(ack));
+    });
+  }
+
+  SocketBenchHeader end{0, 0};
+  client.send(&end, sizeof(end));
+  server.join();
+}
+
+static bool registered = registerBenchmarkSuite({"socket", /*requiresGpu=*/false, runSocketSuite});
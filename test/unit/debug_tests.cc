@@ -0,0 +1,207 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "debug.h"
+
+static std::mutex capturedMutex;
+static std::vector<std::string> captured;
+
+static void captureLogHandler(const char* msg) {
+  std::lock_guard<std::mutex> lock(capturedMutex);
+  captured.emplace_back(msg);
+}
+
+static std::string messageBody(const std::string& line) {
+  const std::string tag = "MSCCLPP INFO ";
+  size_t pos = line.find(tag);
+  if (pos == std::string::npos) return "";
+  return line.substr(pos + tag.size());
+}
+
+class DebugAsyncTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_EQ(mscclppDebugSetLogHandler(captureLogHandler), mscclppSuccess);
+    savedLevel = mscclppDebugLevel;
+    savedMask = mscclppDebugMask;
+    mscclppDebugLevel = MSCCLPP_LOG_INFO;
+    mscclppDebugMask = MSCCLPP_ALL;
+    mscclppDebugSetAsync(1);
+    captured.clear();
+  }
+
+  void TearDown() override {
+    mscclppDebugFlush();
+    mscclppDebugSetAsync(0);
+    mscclppDebugSetSubsysLevel(MSCCLPP_ALL, -1);
+    mscclppDebugSetRateLimit(0, 0);
+    mscclppDebugSetJson(0);
+    mscclppDebugLevel = savedLevel;
+    mscclppDebugMask = savedMask;
+    mscclppDebugSetLogHandler(mscclppDebugDefaultLogHandler);
+  }
+
+  int savedLevel;
+  uint64_t savedMask;
+};
+
+TEST_F(DebugAsyncTest, Formatting) {
+  const char* str = "hello";
+  char notTerminated[4] = {'a', 'b', 'c', 'd'};
+  INFO(MSCCLPP_INIT, "plain message");
+  INFO(MSCCLPP_INIT, "int %d unsigned %u hex %#x long %ld size %zu", -7, 7u, 255, -1234567890123L, (size_t)42);
+  INFO(MSCCLPP_INIT, "str %s width [%8s] [%-8s] precision %.*s", str, str, str, 4, notTerminated);
+  INFO(MSCCLPP_INIT, "double %f %.3e char %c ptr %p percent %%", 3.25, 1234.5, 'x', (void*)0x1234);
+  INFO(MSCCLPP_INIT, "star width [%*d] [%-*.*f]", 6, 42, 9, 2, 1.005);
+  mscclppDebugFlush();
+
+  std::vector<std::string> expected(5);
+  char buf[1024];
+  snprintf(buf, sizeof(buf), "plain message\n");
+  expected[0] = buf;
+  snprintf(buf, sizeof(buf), "int %d unsigned %u hex %#x long %ld size %zu\n", -7, 7u, 255, -1234567890123L,
+           (size_t)42);
+  expected[1] = buf;
+  snprintf(buf, sizeof(buf), "str %s width [%8s] [%-8s] precision %.*s\n", str, str, str, 4, notTerminated);
+  expected[2] = buf;
+  snprintf(buf, sizeof(buf), "double %f %.3e char %c ptr %p percent %%\n", 3.25, 1234.5, 'x', (void*)0x1234);
+  expected[3] = buf;
+  snprintf(buf, sizeof(buf), "star width [%*d] [%-*.*f]\n", 6, 42, 9, 2, 1.005);
+  expected[4] = buf;
+
+  std::lock_guard<std::mutex> lock(capturedMutex);
+  ASSERT_EQ(captured.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(messageBody(captured[i]), expected[i]);
+  }
+}
+
+TEST_F(DebugAsyncTest, MultipleThreads) {
+  const int numThreads = 4;
+  const int numMessages = 100;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([t]() {
+      for (int i = 0; i < numMessages; ++i) {
+        INFO(MSCCLPP_P2P, "thread %d message %d", t, i);
+      }
+    });
+  }
+  for (auto& th : threads) th.join();
+  mscclppDebugFlush();
+
+  std::vector<int> next(numThreads, 0);
+  std::lock_guard<std::mutex> lock(capturedMutex);
+  ASSERT_EQ(captured.size(), (size_t)(numThreads * numMessages));
+  for (const auto& line : captured) {
+    int t, i;
+    ASSERT_EQ(sscanf(messageBody(line).c_str(), "thread %d message %d", &t, &i), 2);
+    ASSERT_GE(t, 0);
+    ASSERT_LT(t, numThreads);
+    // Messages of a single thread keep their order.
+    EXPECT_EQ(i, next[t]++);
+  }
+}
+
+// Logs from its destructor at thread exit, after the logging state of the thread is destroyed.
+struct LogAtThreadExit {
+  ~LogAtThreadExit() { INFO(MSCCLPP_INIT, "message at thread exit"); }
+};
+
+TEST_F(DebugAsyncTest, LogAtThreadExit) {
+  std::thread thread([]() {
+    // Constructed before the logging state of the thread, so destroyed after it.
+    thread_local LogAtThreadExit logAtExit;
+    (void)logAtExit;
+    INFO(MSCCLPP_INIT, "message before exit");
+  });
+  thread.join();
+  mscclppDebugFlush();
+
+  std::lock_guard<std::mutex> lock(capturedMutex);
+  ASSERT_EQ(captured.size(), 2u);
+  EXPECT_EQ(messageBody(captured[0]), "message before exit\n");
+  EXPECT_EQ(messageBody(captured[1]), "message at thread exit\n");
+}
+
+TEST_F(DebugAsyncTest, WarnIsSynchronous) {
+  INFO(MSCCLPP_INIT, "before warning");
+  WARN("warning %d", 1);
+  std::lock_guard<std::mutex> lock(capturedMutex);
+  ASSERT_EQ(captured.size(), 2u);
+  EXPECT_EQ(messageBody(captured[0]), "before warning\n");
+  EXPECT_NE(captured[1].find("MSCCLPP WARN warning 1"), std::string::npos);
+  EXPECT_STREQ(mscclppLastError, "warning 1");
+}
+
+TEST_F(DebugAsyncTest, VersionAndAbort) {
+  mscclppDebugLevel = MSCCLPP_LOG_ABORT;
+  mscclppDebugSetRateLimit(1e-6, 1);
+  mscclppDebugLog(MSCCLPP_LOG_VERSION, MSCCLPP_ALL, __func__, __LINE__, "version %d", 1);
+  for (int i = 0; i < 2; ++i) mscclppDebugLog(MSCCLPP_LOG_ABORT, MSCCLPP_ALL, __func__, __LINE__, "abort %d", i);
+  mscclppDebugFlush();
+
+  // Aborts are neither rate limited nor deferred.
+  std::lock_guard<std::mutex> lock(capturedMutex);
+  ASSERT_EQ(captured.size(), 3u);
+  EXPECT_NE(captured[0].find("MSCCLPP VERSION version 1\n"), std::string::npos) << captured[0];
+  EXPECT_NE(captured[1].find("MSCCLPP ABORT abort 0\n"), std::string::npos) << captured[1];
+  EXPECT_NE(captured[2].find("MSCCLPP ABORT abort 1\n"), std::string::npos) << captured[2];
+}
+
+TEST_F(DebugAsyncTest, SubsysLevel) {
+  mscclppDebugLevel = MSCCLPP_LOG_WARN;
+  mscclppDebugSetSubsysLevel(MSCCLPP_NET, MSCCLPP_LOG_INFO);
+  INFO(MSCCLPP_INIT, "init message");
+  INFO(MSCCLPP_NET, "net message");
+  INFO(MSCCLPP_INIT | MSCCLPP_NET, "init or net message");
+  mscclppDebugSetSubsysLevel(MSCCLPP_NET, -1);
+  INFO(MSCCLPP_NET, "net message after reset");
+  mscclppDebugFlush();
+
+  std::lock_guard<std::mutex> lock(capturedMutex);
+  ASSERT_EQ(captured.size(), 2u);
+  EXPECT_EQ(messageBody(captured[0]), "net message\n");
+  EXPECT_EQ(messageBody(captured[1]), "init or net message\n");
+}
+
+TEST_F(DebugAsyncTest, RateLimit) {
+  // Practically no refill at first, so only the burst gets through until the rate is raised.
+  mscclppDebugSetRateLimit(1e-6, 3);
+  for (int i = 0; i <= 10; ++i) {
+    if (i == 10) mscclppDebugSetRateLimit(1e9, 3);
+    INFO(MSCCLPP_INIT, "limited message %d", i);
+  }
+  mscclppDebugFlush();
+
+  std::lock_guard<std::mutex> lock(capturedMutex);
+  ASSERT_EQ(captured.size(), 5u);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(messageBody(captured[i]), "limited message " + std::to_string(i) + "\n");
+  }
+  EXPECT_EQ(messageBody(captured[3]), "7 messages of this call site were dropped by the rate limit\n");
+  EXPECT_EQ(messageBody(captured[4]), "limited message 10\n");
+}
+
+TEST_F(DebugAsyncTest, Json) {
+  mscclppDebugSetJson(1);
+  INFO(MSCCLPP_NET, "quote \" tab\t%s", "line\nbreak");
+  mscclppDebugFlush();
+
+  std::lock_guard<std::mutex> lock(capturedMutex);
+  ASSERT_EQ(captured.size(), 1u);
+  const std::string& line = captured[0];
+  EXPECT_EQ(line.front(), '{');
+  EXPECT_NE(line.find("\"level\":\"INFO\""), std::string::npos) << line;
+  EXPECT_NE(line.find("\"subsys\":\"NET\""), std::string::npos) << line;
+  const std::string msg = "\"msg\":\"quote \\\" tab\\tline\\nbreak\"}\n";
+  ASSERT_GE(line.size(), msg.size());
+  EXPECT_EQ(line.substr(line.size() - msg.size()), msg);
+}
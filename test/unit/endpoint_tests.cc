@@ -0,0 +1,35 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "endpoint.hpp"
+
+using Interfaces = std::vector<mscclpp::EthernetInterfaceInfo>;
+
+TEST(EthernetInterfaces, PreferLocalPhysicalDevices) {
+  // lo, a NIC on node 1, a bridge, NICs on node 0 and node 1
+  Interfaces interfaces = {{false, -1}, {true, 1}, {false, -1}, {true, 0}, {true, 1}};
+  EXPECT_EQ(mscclpp::selectEthernetInterfaces(interfaces, 1, false), (std::vector<int>{1, 4}));
+  EXPECT_EQ(mscclpp::selectEthernetInterfaces(interfaces, 0, false), (std::vector<int>{3}));
+  EXPECT_EQ(mscclpp::selectEthernetInterfaces(interfaces, 0, true), (std::vector<int>{3}));
+}
+
+TEST(EthernetInterfaces, DetectedWithoutLocalityUseFirst) {
+  // Virtual interfaces report no NUMA node, and neither do devices on single-node machines.
+  Interfaces interfaces = {{false, -1}, {true, -1}, {true, -1}};
+  EXPECT_EQ(mscclpp::selectEthernetInterfaces(interfaces, 0, false), (std::vector<int>{0}));
+  EXPECT_EQ(mscclpp::selectEthernetInterfaces(interfaces, -1, false), (std::vector<int>{0}));
+  EXPECT_EQ(mscclpp::selectEthernetInterfaces({{true, 0}, {true, 0}}, 1, false), (std::vector<int>{0}));
+}
+
+TEST(EthernetInterfaces, NamedSpreadOverPhysicalDevices) {
+  Interfaces interfaces = {{false, -1}, {true, -1}, {false, -1}, {true, 2}};
+  EXPECT_EQ(mscclpp::selectEthernetInterfaces(interfaces, -1, true), (std::vector<int>{1, 3}));
+  EXPECT_EQ(mscclpp::selectEthernetInterfaces(interfaces, 0, true), (std::vector<int>{1, 3}));
+  EXPECT_EQ(mscclpp::selectEthernetInterfaces(interfaces, 2, true), (std::vector<int>{3}));
+  // Named virtual interfaces only, e.g. lo.
+  EXPECT_EQ(mscclpp::selectEthernetInterfaces({{false, -1}, {false, -1}}, 0, true), (std::vector<int>{0}));
+}
@@ -0,0 +1,184 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <mscclpp/core.hpp>
+#include <mscclpp/errors.hpp>
+#include <mscclpp/utils.hpp>
+#include <thread>
+#include <vector>
+
+#include "socket.h"
+
+// Ethernet connections between two contexts of the process over the loopback interface, with their messages received
+// by the io_uring reaper of each context.
+class EthernetReaperTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    setenv("MSCCLPP_SOCKET_IO_URING", "1", 1);
+    contexts_[0] = std::make_unique<mscclpp::Context>();
+    contexts_[1] = std::make_unique<mscclpp::Context>();
+  }
+
+  void TearDown() override {
+    contexts_[0].reset();
+    contexts_[1].reset();
+    unsetenv("MSCCLPP_SOCKET_IO_URING");
+  }
+
+  // Returns the connections of both contexts to each other, which are established concurrently. Sets `listener` to
+  // the address that the connection of the second context accepts on.
+  std::vector<std::shared_ptr<mscclpp::Connection>> connect(bool lazy = false,
+                                                            mscclpp::SocketAddress* listener = nullptr) {
+    mscclpp::EndpointConfig config(mscclpp::Transport::Ethernet);
+    config.ethInterfaces = "=lo";
+    config.lazy = lazy;
+    mscclpp::Endpoint endpoint0 = contexts_[0]->createEndpoint(config);
+    mscclpp::Endpoint endpoint1 = contexts_[1]->createEndpoint(config);
+    if (listener) {
+      // The address follows the transport and the host hash in the serialization.
+      std::vector<char> data = endpoint1.serialize();
+      memcpy(listener, data.data() + sizeof(mscclpp::Transport) + sizeof(uint64_t), sizeof(*listener));
+    }
+    std::vector<std::shared_ptr<mscclpp::Connection>> connections(2);
+    std::thread peer([&]() { connections[1] = contexts_[1]->connect(endpoint1, endpoint0); });
+    connections[0] = contexts_[0]->connect(endpoint0, endpoint1);
+    peer.join();
+    return connections;
+  }
+
+  // Writes `size` bytes from `src` to `dst` over `connection`, and waits until `flag` of the peer is `value`.
+  static void writeAndWait(mscclpp::Connection& connection, mscclpp::RegisteredMemory dst,
+                           mscclpp::RegisteredMemory src, size_t size, mscclpp::RegisteredMemory flagMemory,
+                           uint64_t& flag, uint64_t value) {
+    uint64_t token = 0;
+    connection.write(dst, 0, src, 0, size);
+    // Messages of a connection arrive in order, so the flag is updated after the payload is in place.
+    connection.updateAndSync(flagMemory, 0, &token, value);
+    mscclpp::Timer timeout(10);
+    while (__atomic_load_n(&flag, __ATOMIC_ACQUIRE) != value) std::this_thread::yield();
+  }
+
+  // Checks that a stranger slow to send its handshake to a lazy connection does not hold up the others, and that the
+  // peer is accepted once the stranger is dropped.
+  void testLazyAcceptDoesNotBlock();
+
+  // Checks that a lazy connection can be destroyed while its accepted socket waits for the handshake.
+  void testDestroyWhileAccepting();
+
+  std::unique_ptr<mscclpp::Context> contexts_[2];
+};
+
+void EthernetReaperTest::testLazyAcceptDoesNotBlock() {
+  std::vector<char> src(4096, 7);
+  std::vector<char> dst(4096);
+  uint64_t flag = 0;
+  const size_t size = src.size();
+  mscclpp::RegisteredMemory srcMemory = contexts_[0]->registerMemory(src.data(), size, mscclpp::Transport::Ethernet);
+  mscclpp::RegisteredMemory dstMemory = contexts_[1]->registerMemory(dst.data(), size, mscclpp::Transport::Ethernet);
+  mscclpp::RegisteredMemory flagMemory =
+      contexts_[1]->registerMemory(&flag, sizeof(flag), mscclpp::Transport::Ethernet);
+  mscclpp::SocketAddress listener;
+  auto stalled = connect(true, &listener);
+  auto other = connect(true);
+
+  // A stranger connects to the lazy connection first, and is slow to send its handshake.
+  int stranger = ::socket(listener.sa.sa_family, SOCK_STREAM, 0);
+  ASSERT_GE(stranger, 0);
+  ASSERT_EQ(::connect(stranger, &listener.sa, sizeof(listener)), 0);
+
+  // The receiver of the context waits for the handshake without blocking, so other connections still receive.
+  writeAndWait(*other[0], dstMemory, srcMemory, size, flagMemory, flag, 1);
+
+  // A wrong magic makes the receiver drop the stranger and accept the peer.
+  char handshake[sizeof(uint64_t) + sizeof(mscclpp::SocketType)] = {};
+  ASSERT_EQ(::send(stranger, handshake, sizeof(handshake), 0), (ssize_t)sizeof(handshake));
+  writeAndWait(*stalled[0], dstMemory, srcMemory, size, flagMemory, flag, 2);
+  ::close(stranger);
+}
+
+void EthernetReaperTest::testDestroyWhileAccepting() {
+  mscclpp::SocketAddress listener;
+  auto connections = connect(true, &listener);
+  int stranger = ::socket(listener.sa.sa_family, SOCK_STREAM, 0);
+  ASSERT_GE(stranger, 0);
+  ASSERT_EQ(::connect(stranger, &listener.sa, sizeof(listener)), 0);
+
+  // The connection goes away while the receiver of the context waits for the handshake of the accepted socket.
+  mscclpp::Timer timeout(10);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  connections.clear();
+  contexts_[1].reset();
+  ::close(stranger);
+}
+
+TEST_F(EthernetReaperTest, MultiChunkMessages) {
+  // Larger than the part of a receive buffer that the reaper registers with the ring (1 MiB), and not a multiple of it.
+  const size_t size = 3 * 1024 * 1024 + 4093;
+  std::vector<char> src(size);
+  std::vector<char> dst(size);
+  uint64_t flag = 0;
+  mscclpp::RegisteredMemory srcMemory = contexts_[0]->registerMemory(src.data(), size, mscclpp::Transport::Ethernet);
+  mscclpp::RegisteredMemory dstMemory = contexts_[1]->registerMemory(dst.data(), size, mscclpp::Transport::Ethernet);
+  mscclpp::RegisteredMemory flagMemory =
+      contexts_[1]->registerMemory(&flag, sizeof(flag), mscclpp::Transport::Ethernet);
+  auto connections = connect();
+
+  for (uint64_t round = 1; round <= 3; ++round) {
+    for (size_t i = 0; i < size; ++i) src[i] = static_cast<char>(i * 13 + round);
+    writeAndWait(*connections[0], dstMemory, srcMemory, size, flagMemory, flag, round);
+    for (size_t i = 0; i < size; ++i) {
+      ASSERT_EQ(dst[i], static_cast<char>(i * 13 + round)) << "byte " << i << " of round " << round;
+    }
+  }
+}
+
+TEST_F(EthernetReaperTest, DestroyWithReceivesInFlight) {
+  const size_t size = 64 * 1024 * 1024;
+  std::vector<char> src(size, 1);
+  std::vector<char> dst(size);
+  mscclpp::RegisteredMemory srcMemory = contexts_[0]->registerMemory(src.data(), size, mscclpp::Transport::Ethernet);
+  mscclpp::RegisteredMemory dstMemory = contexts_[1]->registerMemory(dst.data(), size, mscclpp::Transport::Ethernet);
+  auto connections = connect();
+
+  // The receiving side goes away in the middle of a message that spans many chunks.
+  std::thread sender([&]() {
+    try {
+      connections[0]->write(dstMemory, 0, srcMemory, 0, size);
+    } catch (const mscclpp::BaseError&) {
+      // The peer may close the connection before the message is sent.
+    }
+  });
+  mscclpp::Timer timeout(10);
+  connections[1].reset();
+  contexts_[1].reset();
+  sender.join();
+
+  // The other side only has its receive of the next message header in flight.
+  connections[0].reset();
+  contexts_[0].reset();
+}
+
+TEST_F(EthernetReaperTest, LazyAcceptDoesNotBlock) { testLazyAcceptDoesNotBlock(); }
+
+TEST_F(EthernetReaperTest, DestroyWhileAccepting) { testDestroyWhileAccepting(); }
+
+// The same connections with the lazy ones accepted by the acceptor thread of each context, without io_uring.
+class EthernetAcceptorTest : public EthernetReaperTest {
+ protected:
+  void SetUp() override {
+    unsetenv("MSCCLPP_SOCKET_IO_URING");
+    contexts_[0] = std::make_unique<mscclpp::Context>();
+    contexts_[1] = std::make_unique<mscclpp::Context>();
+  }
+};
+
+TEST_F(EthernetAcceptorTest, LazyAcceptDoesNotBlock) { testLazyAcceptDoesNotBlock(); }
+
+TEST_F(EthernetAcceptorTest, DestroyWhileAccepting) { testDestroyWhileAccepting(); }
@@ -77,3 +77,105 @@ TEST(FifoTest, Fifo) {
 
   MSCCLPP_CUDATHROW(cudaDeviceSynchronize());
 }
+
+__constant__ mscclpp::FifoDeviceHandle gFifoPairTestFifoDeviceHandle;
+__global__ void kernelFifoPairTest() {
+  mscclpp::FifoDeviceHandle& fifo = gFifoPairTestFifoDeviceHandle;
+  mscclpp::ProxyTrigger first, second;
+  for (uint64_t i = threadIdx.x + 1; i < ITER + 1; i += blockDim.x) {
+    first.fst = i;
+    first.snd = i;
+    second.fst = i + ITER;
+    second.snd = i + ITER;
+    fifo.push(first, second);
+  }
+}
+
+TEST(FifoTest, FifoPair) {
+  mscclpp::Fifo hostFifo;
+  mscclpp::FifoDeviceHandle devFifo = hostFifo.deviceHandle();
+  MSCCLPP_CUDATHROW(cudaMemcpyToSymbol(gFifoPairTestFifoDeviceHandle, &devFifo, sizeof(devFifo)));
+
+  // A pair takes two entries, so at most half of the FIFO size of threads push at once.
+  kernelFifoPairTest<<<1, hostFifo.size() / 2>>>();
+  MSCCLPP_CUDATHROW(cudaGetLastError());
+
+  auto pollOne = [&hostFifo]() {
+    mscclpp::ProxyTrigger trigger = hostFifo.poll();
+    uint64_t spin = 0;
+    while (trigger.fst == 0 || trigger.snd == 0) {
+      trigger = hostFifo.poll();
+      if (spin++ > 1000000) {
+        throw std::runtime_error("Polling is stuck.");
+      }
+    }
+    trigger.snd ^= ((uint64_t)1 << (uint64_t)63);
+    hostFifo.pop();
+    hostFifo.flushTail();
+    return trigger;
+  };
+
+  std::vector<bool> seen(ITER + 1, false);
+  for (uint64_t i = 0; i < ITER; ++i) {
+    mscclpp::ProxyTrigger first = pollOne();
+    mscclpp::ProxyTrigger second = pollOne();
+    ASSERT_TRUE(first.fst >= 1 && first.fst <= ITER);
+    ASSERT_FALSE(seen[first.fst]);
+    seen[first.fst] = true;
+    // the second trigger of a pair always follows the first one
+    ASSERT_EQ(first.snd, first.fst);
+    ASSERT_EQ(second.fst, first.fst + ITER);
+    ASSERT_EQ(second.snd, first.fst + ITER);
+  }
+  hostFifo.flushTail(true);
+
+  MSCCLPP_CUDATHROW(cudaDeviceSynchronize());
+}
+
+__constant__ mscclpp::FifoDeviceHandle gFifoLanesTestFifoDeviceHandle;
+__global__ void kernelFifoLanesTest() {
+  if (threadIdx.x != 0) return;
+  mscclpp::FifoDeviceHandle& fifo = gFifoLanesTestFifoDeviceHandle;
+  mscclpp::ProxyTrigger trigger;
+  for (uint64_t i = 1; i < ITER + 1; ++i) {
+    trigger.fst = i;
+    trigger.snd = blockIdx.x;
+    fifo.push(trigger);
+  }
+}
+
+TEST(FifoTest, FifoLanes) {
+  const int numLanes = 4;
+  const int numBlocks = 8;
+  mscclpp::Fifo hostFifo(mscclpp::DEFAULT_FIFO_SIZE, numLanes);
+  ASSERT_EQ(hostFifo.numLanes(), numLanes);
+  mscclpp::FifoDeviceHandle devFifo = hostFifo.deviceHandle();
+  MSCCLPP_CUDATHROW(cudaMemcpyToSymbol(gFifoLanesTestFifoDeviceHandle, &devFifo, sizeof(devFifo)));
+
+  kernelFifoLanesTest<<<numBlocks, 1>>>();
+  MSCCLPP_CUDATHROW(cudaGetLastError());
+
+  // Triggers of each block arrive in order on the lane of the block.
+  std::vector<uint64_t> expected(numBlocks, 1);
+  uint64_t spin = 0;
+  int lane = 0;
+  for (uint64_t i = 0; i < (uint64_t)ITER * numBlocks;) {
+    mscclpp::ProxyTrigger trigger = hostFifo.poll(lane);
+    if (trigger.fst != 0 && trigger.snd != 0) {
+      trigger.snd ^= ((uint64_t)1 << (uint64_t)63);
+      ASSERT_LT(trigger.snd, (uint64_t)numBlocks);
+      ASSERT_EQ((int)trigger.snd % numLanes, lane);
+      ASSERT_EQ(trigger.fst, expected[trigger.snd]++);
+      hostFifo.pop(lane);
+      hostFifo.flushTail();
+      ++i;
+      spin = 0;
+    } else if (spin++ > 10000000) {
+      FAIL() << "Polling is stuck.";
+    }
+    lane = (lane + 1) % numLanes;
+  }
+  hostFifo.flushTail(true);
+
+  MSCCLPP_CUDATHROW(cudaDeviceSynchronize());
+}
@@ -0,0 +1,106 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mscclpp/core.hpp>
+#include <mscclpp/errors.hpp>
+#include <mscclpp/hang_detector.hpp>
+#include <mutex>
+#include <thread>
+
+#include "hang_detector_internal.hpp"
+
+static bool waitFor(const mscclpp::HangDetector& detector, bool stalled) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (detector.stalled() != stalled) {
+    if (std::chrono::steady_clock::now() > deadline) return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return true;
+}
+
+TEST(HangDetectorTest, DetectsStall) {
+  auto bootstrap = std::make_shared<mscclpp::TcpBootstrap>(0, 1);
+  bootstrap->initialize(bootstrap->createUniqueId());
+
+  uint64_t inbound = 0;
+  uint64_t expected = 1;
+  mscclpp::WatchEntry entry;
+  entry.name = "TestSemaphore";
+  entry.remoteRank = 3;
+  entry.values.resize(2);
+  entry.values[0].name = "inbound";
+  entry.values[0].hostPtr = &inbound;
+  entry.values[1].name = "expected";
+  entry.values[1].hostPtr = &expected;
+  entry.isWaiting = [](const std::vector<uint64_t>& values) { return values[0] < values[1]; };
+  auto handle = mscclpp::registerWatchEntry(std::move(entry));
+
+  mscclpp::HangDetector detector(bootstrap, 0, 10);
+  ASSERT_TRUE(waitFor(detector, true));
+  std::string report = detector.report();
+  EXPECT_NE(report.find("TestSemaphore with rank 3: inbound 0 expected 1 [waiting]"), std::string::npos) << report;
+
+  __atomic_store_n(&inbound, 1, __ATOMIC_RELAXED);
+  EXPECT_TRUE(waitFor(detector, false));
+
+  handle.reset();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(detector.report().find("TestSemaphore"), std::string::npos);
+}
+
+// A bootstrap of rank 0 out of two ranks whose peer never sends until released, or whose receives throw.
+class FakePeerBootstrap : public mscclpp::Bootstrap {
+ public:
+  explicit FakePeerBootstrap(bool throwOnRecv) : throwOnRecv_(throwOnRecv) {}
+  int getRank() override { return 0; }
+  int getNranks() override { return 2; }
+  int getNranksPerNode() override { return 2; }
+  void send(void*, int, int, int) override {}
+  void recv(void* data, int size, int, int) override {
+    if (throwOnRecv_) throw mscclpp::Error("peer is gone", mscclpp::ErrorCode::RemoteError);
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return released_; });
+    // The summary of a stopping peer: its rank followed by a nonzero stop flag.
+    std::memset(data, 0, size);
+    int32_t header[2] = {1, 1};
+    std::memcpy(data, header, std::min<size_t>(size, sizeof(header)));
+  }
+  void allGather(void*, int) override {}
+  void barrier() override {}
+
+  void release() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    released_ = true;
+    cv_.notify_all();
+  }
+
+ private:
+  bool throwOnRecv_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool released_ = false;
+};
+
+TEST(HangDetectorTest, BoundedStopWithoutPeer) {
+  auto bootstrap = std::make_shared<FakePeerBootstrap>(false);
+  auto start = std::chrono::steady_clock::now();
+  {
+    mscclpp::HangDetector detector(bootstrap, 0, 10);
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(elapsed, std::chrono::seconds(30));
+  // Lets the thread that was left behind finish.
+  bootstrap->release();
+}
+
+TEST(HangDetectorTest, SurvivesBootstrapErrors) {
+  auto bootstrap = std::make_shared<FakePeerBootstrap>(true);
+  mscclpp::HangDetector detector(bootstrap, 0, 10);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(detector.stalled());
+}
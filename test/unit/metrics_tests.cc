@@ -0,0 +1,144 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <mscclpp/errors.hpp>
+#include <mscclpp/metrics.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "metrics_internal.hpp"
+
+TEST(MetricsTest, CounterMultipleThreads) {
+  mscclpp::Counter counter;
+  const int numThreads = 8;
+  const int numAdds = 10000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&counter]() {
+      for (int i = 0; i < numAdds; ++i) counter.add(2);
+    });
+  }
+  for (auto& th : threads) th.join();
+  EXPECT_EQ(counter.value(), (uint64_t)numThreads * numAdds * 2);
+  counter.reset();
+  EXPECT_EQ(counter.value(), 0u);
+}
+
+TEST(MetricsTest, HistogramQuantiles) {
+  mscclpp::Histogram histogram;
+  EXPECT_EQ(histogram.snapshot().quantile(0.5), 0u);
+  for (uint64_t v = 1; v <= 100000; ++v) histogram.record(v);
+  mscclpp::HistogramSnapshot snapshot = histogram.snapshot();
+  EXPECT_EQ(snapshot.count, 100000u);
+  EXPECT_EQ(snapshot.sum, 100000ull * 100001ull / 2);
+  EXPECT_EQ(snapshot.min, 1u);
+  EXPECT_EQ(snapshot.max, 100000u);
+  EXPECT_EQ(snapshot.quantile(0), 1u);
+  EXPECT_EQ(snapshot.quantile(1), 100000u);
+  for (double q : {0.5, 0.9, 0.99}) {
+    double expected = q * 100000;
+    double estimate = snapshot.quantile(q);
+    EXPECT_GE(estimate, expected);
+    EXPECT_LE(estimate, expected * (1 + 1.0 / mscclpp::Histogram::SubBuckets));
+  }
+
+  // Small values are exact and large values do not overflow the buckets.
+  histogram.reset();
+  histogram.record(3);
+  histogram.record(UINT64_MAX);
+  snapshot = histogram.snapshot();
+  EXPECT_EQ(snapshot.count, 2u);
+  EXPECT_EQ(snapshot.quantile(0.5), 3u);
+  EXPECT_EQ(snapshot.quantile(1), UINT64_MAX);
+}
+
+TEST(MetricsTest, Registry) {
+  mscclpp::MetricsRegistry registry;
+  auto a = registry.counter("test_total", "A test counter", {{"kind", "a"}});
+  auto b = registry.counter("test_total", "A test counter", {{"kind", "b\"c"}});
+  EXPECT_EQ(a, registry.counter("test_total", "", {{"kind", "a"}}));
+  EXPECT_NE(a, b);
+  EXPECT_THROW(registry.histogram("test_total", ""), mscclpp::Error);
+  a->add(3);
+  b->add(5);
+  auto latency = registry.histogram("test_latency_ns", "A test histogram");
+  latency->record(100);
+
+  std::string text = registry.prometheusText();
+  EXPECT_NE(text.find("# TYPE test_total counter\n"), std::string::npos);
+  EXPECT_NE(text.find("test_total{kind=\"a\"} 3\n"), std::string::npos);
+  EXPECT_NE(text.find("test_total{kind=\"b\\\"c\"} 5\n"), std::string::npos);
+  EXPECT_NE(text.find("# TYPE test_latency_ns summary\n"), std::string::npos);
+  EXPECT_NE(text.find("test_latency_ns_count 1\n"), std::string::npos);
+  EXPECT_NE(text.find("test_latency_ns_sum 100\n"), std::string::npos);
+
+  registry.reset();
+  EXPECT_EQ(a->value(), 0u);
+  EXPECT_EQ(latency->snapshot().count, 0u);
+}
+
+TEST(MetricsTest, RegistryRemove) {
+  mscclpp::MetricsRegistry registry;
+  auto a = registry.counter("test_total", "A test counter", {{"kind", "a"}});
+  auto b = registry.counter("test_total", "A test counter", {{"kind", "b"}});
+  registry.histogram("test_latency_ns", "A test histogram");
+  a->add(1);
+  b->add(2);
+
+  registry.remove("test_total", {{"kind", "a"}});
+  registry.remove("test_total", {{"kind", "missing"}});
+  registry.remove("missing_total");
+  std::string text = registry.prometheusText();
+  EXPECT_EQ(text.find("test_total{kind=\"a\"}"), std::string::npos);
+  EXPECT_NE(text.find("test_total{kind=\"b\"} 2\n"), std::string::npos);
+  // The removed counter stays usable and a new one is created on the next request.
+  a->add(1);
+  EXPECT_NE(registry.counter("test_total", "", {{"kind", "a"}}), a);
+
+  registry.remove("test_latency_ns");
+  EXPECT_EQ(registry.prometheusText().find("test_latency_ns"), std::string::npos);
+}
+
+TEST(MetricsTest, LabelIdsAreReused) {
+  mscclpp::MetricLabelIds ids;
+  EXPECT_EQ(ids.acquire(), 0);
+  EXPECT_EQ(ids.acquire(), 1);
+  EXPECT_EQ(ids.acquire(), 2);
+  ids.release(1);
+  ids.release(0);
+  EXPECT_EQ(ids.acquire(), 0);
+  EXPECT_EQ(ids.acquire(), 1);
+  EXPECT_EQ(ids.acquire(), 3);
+}
+
+TEST(MetricsTest, HttpServer) {
+  mscclpp::MetricsRegistry registry;
+  registry.counter("test_requests_total", "A test counter")->add(7);
+  mscclpp::MetricsHttpServer server(registry, 0);
+  ASSERT_GT(server.port(), 0);
+
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  ASSERT_GE(fd, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(server.port());
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  ASSERT_EQ(connect(fd, (sockaddr*)&addr, sizeof(addr)), 0);
+  std::string request = "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  ASSERT_EQ(send(fd, request.data(), request.size(), 0), (ssize_t)request.size());
+  std::string response;
+  char buf[1024];
+  ssize_t n;
+  while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) response.append(buf, n);
+  close(fd);
+
+  EXPECT_EQ(response.rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+  EXPECT_NE(response.find("test_requests_total 7\n"), std::string::npos);
+}
@@ -0,0 +1,260 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <dirent.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mscclpp/core.hpp>
+#include <mscclpp/errors.hpp>
+#include <mscclpp/npkit/npkit.hpp>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class NpKitTraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dirTemplate[] = "/tmp/mscclpp_npkit_XXXXXX";
+    ASSERT_NE(mkdtemp(dirTemplate), nullptr);
+    dir_ = dirTemplate;
+  }
+
+  void TearDown() override {
+    DIR* dir = opendir(dir_.c_str());
+    if (dir != nullptr) {
+      for (dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') unlink((dir_ + "/" + entry->d_name).c_str());
+      }
+      closedir(dir);
+    }
+    rmdir(dir_.c_str());
+  }
+
+  std::string path(const std::string& name) { return dir_ + "/" + name; }
+
+  void writeText(const std::string& name, const std::string& content) { std::ofstream(path(name)) << content; }
+
+  void writeEvents(const std::string& name, const std::vector<NpKitEvent>& events) {
+    std::ofstream file(path(name), std::ios::binary);
+    file.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(NpKitEvent));
+  }
+
+  std::vector<NpKitEvent> readEvents(const std::string& name) {
+    std::ifstream file(path(name), std::ios::binary | std::ios::ate);
+    std::vector<NpKitEvent> events(static_cast<size_t>(file.tellg()) / sizeof(NpKitEvent));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(events.data()), events.size() * sizeof(NpKitEvent));
+    return events;
+  }
+
+  // Write the clock info of `rank` so that both CPU and GPU ticks are nanoseconds.
+  void writeClockInfo(int rank, const std::string& offsets) {
+    std::string suffix = "_rank_" + std::to_string(rank);
+    writeText("cpu_clock_period_num" + suffix, "1");
+    writeText("cpu_clock_period_den" + suffix, "1000000000");
+    writeText("gpu_clock_rate" + suffix, "1000000");
+    writeText("cpu_clock_offset" + suffix, offsets);
+  }
+
+  std::string readText(const std::string& name) {
+    std::ifstream file(path(name));
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+  }
+
+  static NpKitEvent event(uint8_t type, uint32_t size, uint32_t rsvd, uint64_t timestamp) {
+    NpKitEvent e;
+    e.fields.type = type;
+    e.fields.size = size;
+    e.fields.rsvd = rsvd;
+    e.fields.timestamp = timestamp;
+    return e;
+  }
+
+  static size_t count(const std::string& haystack, const std::string& needle) {
+    size_t n = 0;
+    for (size_t pos = haystack.find(needle); pos != std::string::npos; pos = haystack.find(needle, pos + 1)) n++;
+    return n;
+  }
+
+  std::string dir_;
+};
+
+TEST_F(NpKitTraceTest, ExportCpuEvents) {
+  writeClockInfo(0, "0 1000\n");
+  // Two interleaved handlers on different slots, and an exit without an entry that must be dropped.
+  writeEvents("cpu_events_rank_0_channel_2", {
+                                                 event(NPKIT_EVENT_PROXY_HANDLER_EXIT, 0, 9, 1000),
+                                                 event(NPKIT_EVENT_PROXY_HANDLER_ENTRY, 64, 3, 2000),
+                                                 event(NPKIT_EVENT_PROXY_HANDLER_ENTRY, 32, 4, 2500),
+                                                 event(NPKIT_EVENT_PROXY_HANDLER_EXIT, 0, 3, 5000),
+                                                 event(NPKIT_EVENT_PROXY_HANDLER_EXIT, 0, 4, 6000),
+                                             });
+  NpKit::ExportTrace(dir_, 0, path("trace_rank_0.json"));
+  std::string trace = readText("trace_rank_0.json");
+
+  EXPECT_EQ(trace.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0u);
+  EXPECT_EQ(count(trace, "\"ph\":\"X\""), 2u);
+  int tid = NpKit::kNumGpuEventBuffers + 1 + 2;
+  EXPECT_NE(trace.find("\"name\":\"PROXY_HANDLER\",\"cat\":\"CPU\",\"ph\":\"X\",\"pid\":0,\"tid\":" +
+                       std::to_string(tid) + ",\"ts\":3.000,\"dur\":3.000,\"args\":{\"size\":64,\"rsvd\":3}"),
+            std::string::npos);
+  EXPECT_NE(trace.find("\"ts\":3.500,\"dur\":3.500,\"args\":{\"size\":32,\"rsvd\":4}"), std::string::npos);
+  EXPECT_NE(trace.find("\"args\":{\"name\":\"CPU channel 2\"}"), std::string::npos);
+}
+
+TEST_F(NpKitTraceTest, ExportGpuEventsWithDrift) {
+  // The offset drifts linearly from 0 to 2000 ns between local times 0 and 20000 ns.
+  writeClockInfo(1, "20000 2000\n0 0\n");
+  writeEvents("gpu_events_rank_1_buf_5", {
+                                             // Events before the first time sync are skipped.
+                                             event(NPKIT_EVENT_EXECUTOR_INIT_ENTRY, 0, 0, 100),
+                                             event(NPKIT_EVENT_TIME_SYNC_CPU, 0, 0, 10000),
+                                             event(NPKIT_EVENT_TIME_SYNC_GPU, 0, 0, 500),
+                                             event(NPKIT_EVENT_EXECUTOR_INIT_ENTRY, 16, 0, 600),
+                                             event(NPKIT_EVENT_EXECUTOR_INIT_EXIT, 0, 0, 900),
+                                         });
+  NpKit::ExportTrace(dir_, 1, path("trace_rank_1.json"));
+  std::string trace = readText("trace_rank_1.json");
+
+  EXPECT_EQ(count(trace, "\"ph\":\"X\""), 1u);
+  // Entry: 10000 + (600 - 500) = 10100 local, +1010 drift. Exit: 10400 local, +1040 drift.
+  EXPECT_NE(trace.find("\"name\":\"EXECUTOR_INIT\",\"cat\":\"GPU\",\"ph\":\"X\",\"pid\":1,\"tid\":6,\"ts\":11.110,"
+                       "\"dur\":0.330,\"args\":{\"size\":16,\"rsvd\":0}"),
+            std::string::npos);
+  EXPECT_NE(trace.find("\"args\":{\"name\":\"GPU block 5\"}"), std::string::npos);
+}
+
+TEST_F(NpKitTraceTest, MergeTraces) {
+  std::vector<std::string> traces;
+  for (int rank = 0; rank < 3; rank++) {
+    std::string suffix = "_rank_" + std::to_string(rank);
+    writeClockInfo(rank, "");
+    writeEvents("cpu_events" + suffix + "_channel_0", {
+                                                          event(NPKIT_EVENT_PROXY_HANDLER_ENTRY, 8, 0, 100),
+                                                          event(NPKIT_EVENT_PROXY_HANDLER_EXIT, 0, 0, 200),
+                                                      });
+    traces.push_back(path("trace" + suffix + ".json"));
+    NpKit::ExportTrace(dir_, rank, traces.back());
+  }
+  NpKit::MergeTraces(traces, path("merged.json"));
+  std::string merged = readText("merged.json");
+
+  EXPECT_EQ(merged.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", 0), 0u);
+  EXPECT_EQ(merged.substr(merged.size() - 4), "\n]}\n");
+  EXPECT_EQ(count(merged, "\"ph\":\"X\""), 3u);
+  // One process name and one thread name per rank.
+  EXPECT_EQ(count(merged, "\"ph\":\"M\""), 6u);
+  for (int rank = 0; rank < 3; rank++) {
+    EXPECT_NE(merged.find("\"args\":{\"name\":\"rank " + std::to_string(rank) + "\"}"), std::string::npos);
+  }
+  // Events are separated by exactly one comma and there is no trailing comma before the closing bracket.
+  EXPECT_EQ(count(merged, ",\n"), 8u);
+  EXPECT_EQ(count(merged, ",,"), 0u);
+  EXPECT_EQ(merged.find(",\n]"), std::string::npos);
+}
+
+TEST_F(NpKitTraceTest, MissingInputs) {
+  EXPECT_THROW(NpKit::ExportTrace(dir_, 7, path("trace_rank_7.json")), mscclpp::Error);
+  EXPECT_THROW(NpKit::MergeTraces({dir_ + "/does_not_exist.json"}, path("merged.json")), mscclpp::Error);
+}
+
+// Collects CPU events into the ring buffers of an initialized NpKit, with event `i` of a run stamped with `i`.
+class NpKitRingTest : public NpKitTraceTest {
+ protected:
+  void SetUp() override {
+    NpKitTraceTest::SetUp();
+    NpKit::Init(0);
+    if (NpKit::GetGpuEventCollectContexts() == nullptr) {
+      GTEST_SKIP() << "The library is not built with NpKit enabled";
+    }
+  }
+
+  void TearDown() override {
+    NpKit::Shutdown();
+    NpKitTraceTest::TearDown();
+  }
+
+  void collect(uint64_t begin, uint64_t end) {
+    for (uint64_t i = begin; i < end; i++) NpKit::CollectCpuEvent(1, 0, 0, i, kChannel);
+  }
+
+  // Expects the events of the channel to be stamped `begin`, `begin + 1`, ... up to `end`.
+  void expectEvents(uint64_t begin, uint64_t end) {
+    std::vector<NpKitEvent> events = readEvents("cpu_events_rank_0_channel_" + std::to_string(kChannel));
+    ASSERT_EQ(events.size(), end - begin);
+    for (size_t i = 0; i < events.size(); i++) {
+      ASSERT_EQ(events[i].fields.timestamp, begin + i) << "event " << i;
+    }
+  }
+
+  // Waits until at least `count` events of the channel have been streamed to its file.
+  bool waitForStreamedEvents(uint64_t count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    std::string file = path("cpu_events_rank_0_channel_" + std::to_string(kChannel));
+    struct stat st;
+    while (stat(file.c_str(), &st) != 0 || static_cast<uint64_t>(st.st_size) < count * sizeof(NpKitEvent)) {
+      if (std::chrono::steady_clock::now() > deadline) return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+  }
+
+  static const int kChannel = 3;
+  static const uint64_t kCapacity = NpKit::kMaxNumCpuEventsPerBuffer;
+};
+
+TEST_F(NpKitRingTest, DumpKeepsLatestEvents) {
+  const uint64_t overwritten = 1000;
+  collect(0, kCapacity + overwritten);
+  NpKit::Dump(dir_);
+  expectEvents(overwritten, kCapacity + overwritten);
+  EXPECT_EQ(NpKit::GetNumDroppedEvents(), overwritten);
+}
+
+TEST_F(NpKitRingTest, StreamingWrapsAround) {
+  // Events collected before streaming starts are not streamed.
+  collect(0, 10);
+  NpKit::StartStreaming(dir_, 1);
+  // Each chunk is collected only after the previous ones have been streamed, so the ring never overruns the drain.
+  const uint64_t chunk = kCapacity / 8;
+  for (uint64_t begin = 10; begin < 2 * kCapacity; begin += chunk) {
+    uint64_t end = std::min(begin + chunk, 2 * kCapacity);
+    collect(begin, end);
+    ASSERT_TRUE(waitForStreamedEvents(end - 10)) << "events up to " << end << " were not streamed";
+  }
+  NpKit::StopStreaming();
+  expectEvents(10, 2 * kCapacity);
+  EXPECT_EQ(NpKit::GetNumDroppedEvents(), 0u);
+}
+
+TEST_F(NpKitRingTest, StreamingCountsDroppedEvents) {
+  // Nothing is drained until the final drain of StopStreaming(), by which time the ring has wrapped around.
+  NpKit::StartStreaming(dir_, 3600 * 1000);
+  const uint64_t overwritten = 1000;
+  collect(0, kCapacity + overwritten);
+  NpKit::StopStreaming();
+  expectEvents(overwritten, kCapacity + overwritten);
+  EXPECT_EQ(NpKit::GetNumDroppedEvents(), overwritten);
+}
+
+TEST_F(NpKitRingTest, ReinitDropsClockOffsets) {
+  auto bootstrap = std::make_shared<mscclpp::TcpBootstrap>(0, 1);
+  bootstrap->initialize(bootstrap->createUniqueId());
+  // Init() and Shutdown() of the first session each measure an offset.
+  NpKit::Shutdown();
+  NpKit::Init(0, bootstrap);
+  NpKit::Shutdown();
+  NpKit::Init(0, bootstrap);
+  NpKit::Dump(dir_);
+  std::string offsets = readText("cpu_clock_offset_rank_0");
+  EXPECT_EQ(count(offsets, "\n"), 1u) << offsets;
+}
@@ -0,0 +1,137 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <mscclpp/errors.hpp>
+#include <random>
+#include <vector>
+
+#include "range_allocator.hpp"
+
+TEST(RangeAllocatorTest, AllocateAndCoalesce) {
+  mscclpp::RangeAllocator allocator(1000, 100);
+  EXPECT_EQ(allocator.allocate(100), 0u);
+  EXPECT_EQ(allocator.allocate(150), 100u);  // rounded up to 200
+  EXPECT_EQ(allocator.allocate(100), 300u);
+  auto stats = allocator.stats();
+  EXPECT_EQ(stats.allocatedBytes, 400u);
+  EXPECT_EQ(stats.numAllocations, 3u);
+  EXPECT_EQ(stats.numFreeRanges, 1u);
+  EXPECT_EQ(stats.fragmentation, 0.0);
+
+  allocator.free(100, 150);
+  stats = allocator.stats();
+  EXPECT_EQ(stats.numFreeRanges, 2u);
+  EXPECT_EQ(stats.largestFreeRange, 600u);
+  EXPECT_DOUBLE_EQ(stats.fragmentation, 0.25);
+
+  // Best fit takes the hole rather than the tail
+  EXPECT_EQ(allocator.allocate(200), 100u);
+  allocator.free(100, 200);
+  allocator.free(0, 100);
+  allocator.free(300, 100);
+  stats = allocator.stats();
+  EXPECT_EQ(stats.numFreeRanges, 1u);
+  EXPECT_EQ(stats.freeBytes, 1000u);
+  EXPECT_EQ(allocator.allocate(1000), 0u);
+}
+
+TEST(RangeAllocatorTest, InvalidUsage) {
+  mscclpp::RangeAllocator allocator(1024, 256);
+  EXPECT_THROW(allocator.allocate(0), mscclpp::Error);
+  EXPECT_THROW(allocator.allocate(2048), mscclpp::Error);
+  size_t offset = allocator.allocate(1024);
+  EXPECT_THROW(allocator.allocate(1), mscclpp::Error);
+  EXPECT_THROW(allocator.free(offset, 512), mscclpp::Error);
+  EXPECT_THROW(allocator.free(offset + 256, 256), mscclpp::Error);
+  allocator.free(offset, 1024);
+  EXPECT_THROW(allocator.free(offset, 1024), mscclpp::Error);
+}
+
+// Random allocations and frees checked against a map of the occupied units.
+TEST(RangeAllocatorTest, Fuzz) {
+  const size_t unit = 64;
+  const size_t numUnits = 4096;
+  mscclpp::RangeAllocator allocator(numUnits * unit, unit);
+  std::vector<bool> occupied(numUnits, false);
+  std::vector<std::pair<size_t, size_t>> live;
+  std::mt19937_64 rng(12345);
+  size_t allocatedUnits = 0;
+
+  for (int step = 0; step < 200000; ++step) {
+    bool doAllocate = live.empty() || rng() % 100 < 55;
+    if (doAllocate) {
+      size_t size = 1 + rng() % (rng() % 8 == 0 ? 512 * unit : 8 * unit);
+      size_t units = (size + unit - 1) / unit;
+      size_t offset;
+      try {
+        offset = allocator.allocate(size);
+      } catch (const mscclpp::Error&) {
+        // Must only fail if no free run of units is large enough.
+        size_t run = 0, longest = 0;
+        for (bool o : occupied) {
+          run = o ? 0 : run + 1;
+          longest = std::max(longest, run);
+        }
+        ASSERT_LT(longest, units);
+        continue;
+      }
+      ASSERT_EQ(offset % unit, 0u);
+      ASSERT_LE(offset / unit + units, numUnits);
+      for (size_t i = offset / unit; i < offset / unit + units; ++i) {
+        ASSERT_FALSE(occupied[i]) << "overlapping allocation at step " << step;
+        occupied[i] = true;
+      }
+      live.emplace_back(offset, size);
+      allocatedUnits += units;
+    } else {
+      size_t index = rng() % live.size();
+      auto range = live[index];
+      live[index] = live.back();
+      live.pop_back();
+      allocator.free(range.first, range.second);
+      size_t units = (range.second + unit - 1) / unit;
+      for (size_t i = range.first / unit; i < range.first / unit + units; ++i) occupied[i] = false;
+      allocatedUnits -= units;
+    }
+    if (step % 1000 == 0) {
+      auto stats = allocator.stats();
+      ASSERT_EQ(stats.allocatedBytes, allocatedUnits * unit);
+      ASSERT_EQ(stats.numAllocations, live.size());
+      // Coalescing leaves exactly one free range per maximal run of free units
+      size_t runs = 0;
+      for (size_t i = 0; i < numUnits; ++i) runs += (!occupied[i] && (i == 0 || occupied[i - 1]));
+      ASSERT_EQ(stats.numFreeRanges, runs);
+    }
+  }
+  for (auto& range : live) allocator.free(range.first, range.second);
+  EXPECT_EQ(allocator.stats().numFreeRanges, 1u);
+}
+
+// Run with --gtest_also_run_disabled_tests.
+TEST(RangeAllocatorTest, DISABLED_Benchmark) {
+  const size_t numLive = 16384;
+  const int numOps = 1000000;
+  mscclpp::RangeAllocator allocator(size_t(1) << 40, 4096);
+  std::vector<std::pair<size_t, size_t>> live;
+  std::mt19937_64 rng(1);
+  for (size_t i = 0; i < numLive; ++i) {
+    size_t size = 4096 * (1 + rng() % 256);
+    live.emplace_back(allocator.allocate(size), size);
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < numOps; ++i) {
+    auto& range = live[rng() % numLive];
+    allocator.free(range.first, range.second);
+    range.second = 4096 * (1 + rng() % 256);
+    range.first = allocator.allocate(range.second);
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  auto stats = allocator.stats();
+  std::cout << "free+allocate: " << elapsed / numOps * 1e9 << " ns/op with " << numLive << " live ranges, "
+            << stats.numFreeRanges << " free ranges, fragmentation " << stats.fragmentation << std::endl;
+}
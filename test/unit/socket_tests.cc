@@ -5,6 +5,7 @@
 
 #include <mscclpp/utils.hpp>
 #include <thread>
+#include <vector>
 
 #include "socket.h"
 
@@ -29,3 +30,45 @@ TEST(Socket, ListenAndConnect) {
 
   clientThread.join();
 }
+
+TEST(Socket, VectoredSendRecv) {
+  std::string ipPortPair = "127.0.0.1:0";
+  mscclpp::SocketAddress listenAddr;
+  ASSERT_NO_THROW(mscclpp::SocketGetAddrFromString(&listenAddr, ipPortPair.c_str()));
+
+  mscclpp::Socket listenSock(&listenAddr);
+  listenSock.bindAndListen();
+  mscclpp::SocketAddress serverAddr = listenSock.getAddr();
+
+  // Larger than the socket buffers, so that the payload takes several calls.
+  const size_t payloadSize = 16 << 20;
+  std::vector<char> payload(payloadSize);
+  for (size_t i = 0; i < payloadSize; ++i) payload[i] = (char)(i * 7);
+  uint64_t header = 0x1234;
+
+  std::thread clientThread([&]() {
+    mscclpp::Socket sock(&serverAddr);
+    sock.connect();
+    struct iovec iov[3] = {{&header, sizeof(header)}, {nullptr, 0}, {payload.data(), payloadSize}};
+    sock.sendv(iov, 3);
+  });
+
+  mscclpp::Socket sock;
+  sock.accept(&listenSock);
+  uint64_t recvHeader = 0;
+  std::vector<char> recvPayload(payloadSize);
+  struct iovec iov[2] = {{&recvHeader, sizeof(recvHeader)}, {recvPayload.data(), payloadSize}};
+  sock.recvv(iov, 2);
+  clientThread.join();
+
+  EXPECT_EQ(recvHeader, header);
+  EXPECT_EQ(recvPayload, payload);
+}
+
+TEST(Socket, InterfaceNumaNode) {
+  // Virtual interfaces have no device, so their NUMA node is unknown
+  EXPECT_EQ(mscclpp::GetInterfaceNumaNode("lo"), -1);
+  EXPECT_EQ(mscclpp::GetInterfaceNumaNode("no-such-interface"), -1);
+  EXPECT_FALSE(mscclpp::InterfaceHasDevice("lo"));
+  EXPECT_FALSE(mscclpp::InterfaceHasDevice("no-such-interface"));
+}
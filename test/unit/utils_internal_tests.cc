@@ -3,6 +3,8 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
 #include <thread>
 
 #include "utils_internal.hpp"
@@ -18,3 +20,42 @@ TEST(UtilsInternalTest, getHostHash) {
 
   EXPECT_EQ(hash1, hash2);
 }
+
+TEST(UtilsInternalTest, futex) {
+  std::atomic<uint32_t> word{0};
+
+  // Returns on the timeout or immediately if the word differs.
+  auto start = std::chrono::steady_clock::now();
+  mscclpp::futexWait(&word, 0, 1000000);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::microseconds(500));
+  mscclpp::futexWait(&word, 1, -1);
+
+  std::thread th([&word]() {
+    while (word.load() == 0) mscclpp::futexWait(&word, 0, -1);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  word.store(1);
+  mscclpp::futexWakeAll(&word);
+  th.join();
+  EXPECT_EQ(word.load(), 1u);
+}
+
+TEST(UtilsInternalTest, futexWakeWaiters) {
+  std::atomic<uint32_t> word{0};
+  std::atomic<bool> waiting{false};
+
+  // Returns right away without any waiter.
+  mscclpp::futexWakeWaiters(&word);
+
+  std::thread th([&word, &waiting]() {
+    mscclpp::FutexWaiter waiter(&word);
+    waiting.store(true);
+    while (word.load() == 0) mscclpp::futexWait(&word, 0, -1);
+  });
+  while (!waiting.load()) std::this_thread::yield();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  word.store(1);
+  mscclpp::futexWakeWaiters(&word);
+  th.join();
+  EXPECT_EQ(word.load(), 1u);
+}
@@ -109,6 +109,9 @@ def parse_gpu_event_file(npkit_dump_dir, npkit_event_def, rank, buf_idx, gpu_clo
             elif npkit_event_def["id_to_type"][parsed_gpu_event["id"]] == "NPKIT_EVENT_TIME_SYNC_GPU":
                 if curr_gpu_base_time is None:
                     curr_gpu_base_time = parsed_gpu_event["timestamp"] / gpu_clock_scale
+            elif curr_cpu_base_time is None:
+                # Ring buffers may start in the middle of a kernel, skip events until the first time sync.
+                pass
             else:
                 if curr_gpu_base_time is None:
                     curr_gpu_base_time = parsed_gpu_event["timestamp"] / gpu_clock_scale
@@ -168,6 +171,10 @@ def parse_cpu_event_file(npkit_dump_dir, npkit_event_def, rank, channel, cpu_clo
             parsed_cpu_event = parse_cpu_event(raw_content[raw_content_idx : raw_content_idx + raw_event_size])
             event_type = npkit_event_def["id_to_type"][parsed_cpu_event["id"]]
             phase = "B" if event_type.endswith("_ENTRY") else "E"
+            if phase == "E" and parsed_cpu_event["slot"] not in slot_to_fiber_id:
+                # The matching entry event was overwritten in the ring buffer.
+                raw_content_idx += raw_event_size
+                continue
             cpu_events.append({"ph": phase, "ts": parsed_cpu_event["timestamp"] / cpu_clock_scale, "pid": rank})
             slot = parsed_cpu_event["slot"]
             if phase == "B":